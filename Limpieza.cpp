@@ -1,119 +1,228 @@
 #include <iostream>
-#include <fstream>
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 // Limpieza.cpp
 // Herramienta que realiza una "limpieza física" de los archivos binarios:
 // reconstruye `registros.dat` y `tabla_hash.dat` compactando registros
 // y corrigiendo offsets. Útil para eliminar gaps o inconsistencias
-// producidas por operaciones de eliminación lógicas.
-
-// Estructura de registro clínico, empaquetada para evitar relleno de memoria
-#pragma pack(push, 1)
-struct RegistroClinico {
-    char fecha[11];           // Fecha del registro (formato: "YYYY-MM-DD")
-    int dni;                  // DNI del paciente
-    char nombre[25];          // Nombre del paciente
-    char apellido[25];        // Apellido del paciente
-    int edad;                 // Edad del paciente
-    char medico[40];          // Nombre del médico
-    char motivo[50];          // Motivo de la consulta
-    char examenes[50];        // Exámenes realizados
-    char resultados[30];      // Resultados de los exámenes
-    char receta[60];          // Receta médica
-    long long pos_siguiente;  // Offset al siguiente registro en la lista enlazada
-};
-
-// Entrada de la tabla hash, almacena el offset al primer registro de la lista
-struct HashEntry {
-    long long head_offset = -1; // Offset al primer registro, -1 si está vacío
-};
-#pragma pack(pop)
-
-const int TABLE_SIZE = 131072;      // Tamaño de la tabla hash
-const long long NULL_OFFSET = -1;   // Valor para indicar ausencia de offset
-
-int main() {
-    // Abrir archivos binarios existentes de la tabla hash y registros
-    std::ifstream tabla_in("tabla_hash.dat", std::ios::binary);
-    std::ifstream registros_in("registros.dat", std::ios::binary);
+// producidas por operaciones de eliminación lógicas: las lápidas (ver
+// registros_libres.h) no se copian y la lista de libres se borra.
+// Con --agrupado los registros de cada bucket se escriben contiguos y en
+// orden de cadena, y la tabla se guarda en formato v2 con el tramo de cada
+// bucket (ver tabla_hash.h); sin la opción se conserva el formato legado.
+// La tabla nueva conserva el tamaño y el factor de carga de la vieja (si creció
+// por hashing lineal, cada registro sigue en el mismo bucket); para cambiar la
+// cantidad de buckets está rehash_tabla. Si hay índices por fecha o nombre,
+// filtro de DNI (filtro_dni.h) o directorio de pacientes (directorio_pacientes.h)
+// se reconstruyen sobre el registros.dat compactado (los offsets cambian).
+// Antes se aplica el diario de la GUI (registros_wal.h), si quedó alguno; no
+// arranca si la GUI o gestor_dni tienen la tabla abierta (tabla_compartida.h).
+//
+// Se hace en dos pasadas paralelas (OpenMP) sobre registros.dat proyectado con
+// mmap: la primera cuenta los registros vivos de cada bucket y una suma de
+// prefijos da el offset de salida de cada uno; la segunda reparte los buckets
+// en tramos contiguos de cantidad de registros parecida y cada hilo escribe el
+// suyo con pwrite en su región de registros_new.dat, sin seeks compartidos.
+// El resultado es el mismo que recorriendo los buckets en orden.
+// Uso: Limpieza [--agrupado] [--hilos N]
+
+// Estructuras y constantes compartidas (RegistroClinico, HashEntry, TABLE_SIZE...)
+#include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "registros_libres.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
+
+static const size_t BYTES_ESCRITURA = (size_t)8 << 20; // buffer de salida por hilo
+
+int main(int argc, char** argv) {
+    // Opciones: --agrupado (layout agrupado por bucket), --hilos N
+    bool agrupado = false;
+    int hilos = omp_get_max_threads();
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--agrupado") agrupado = true;
+        else if (a == "--hilos" && i + 1 < argc) hilos = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Uso: Limpieza [--agrupado] [--hilos N]\n";
+            return 1;
+        }
+    }
+    auto t0 = std::chrono::steady_clock::now();
 
-    // Verificar que los archivos se abrieron correctamente
-    if (!tabla_in || !registros_in) {
-        std::cerr << "Error al abrir archivos existentes.\n";
+    tabla_compartida::Exclusivo exclusivo("tabla_hash.dat");
+    if (!exclusivo) {
+        std::cerr << "tabla_hash.dat está en uso (GUI o gestor_dni abiertos).\n";
+        return 1;
+    }
+    if (wal::recuperar("registros.dat", "tabla_hash.dat") < 0) {
+        std::cerr << "Error aplicando registros.wal.\n";
         return 1;
     }
 
-    // Crear archivos temporales para la nueva tabla hash y registros limpios
-    std::ofstream nueva_tabla("tabla_hash_new.dat", std::ios::binary);
-    std::ofstream nuevos_registros("registros_new.dat", std::ios::binary);
-
-    // Vector para almacenar los nuevos offsets de los registros
-    std::vector<long long> nuevos_offsets(TABLE_SIZE, NULL_OFFSET);
-
-    std::cout << "Iniciando limpieza física de registros...\n";
-
-    // Recorrer cada posición de la tabla hash
-    for (int i = 0; i < TABLE_SIZE; ++i) {
-        // Mostrar progreso cada 8192 posiciones
-        if (i % 8192 == 0)
-            std::cout << "Procesando posición " << i << " de " << TABLE_SIZE << "...\n";
-
-        HashEntry entry;
-        // Leer la entrada de la tabla hash
-        tabla_in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-
-        long long offset = entry.head_offset; // Offset al primer registro de la lista
-        long long new_head = NULL_OFFSET;     // Nuevo offset al primer registro reconstruido
-
-        std::vector<RegistroClinico> lista;   // Lista temporal para almacenar los registros de la posición
-
-        // Recorrer la lista enlazada de registros en la posición actual
-        while (offset != NULL_OFFSET) {
-            registros_in.seekg(offset); // Ir al offset del registro
-            RegistroClinico r;
-            registros_in.read(reinterpret_cast<char*>(&r), sizeof(r)); // Leer el registro
+    // Leer la tabla hash existente (formato legado, v2 o v3)
+    tabla_hash::Tabla tabla_vieja;
+    bool tabla_ok = tabla_hash::cargar("tabla_hash.dat", tabla_vieja);
+    int fd_in = ::open("registros.dat", O_RDONLY);
 
-            lista.push_back(r);         // Guardar el registro en la lista temporal
-            offset = r.pos_siguiente;   // Avanzar al siguiente registro en la lista
+    // Verificar que los archivos se abrieron correctamente
+    if (!tabla_ok || fd_in < 0) {
+        std::cerr << "Error al abrir archivos existentes.\n";
+        return 1;
+    }
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long filesize = (long long)::lseek(fd_in, 0, SEEK_END);
+
+    // Proyección de solo lectura compartida por todos los hilos (si mmap falla, pread)
+    const char* mapa = nullptr;
+    if (filesize > 0) {
+        void* p = ::mmap(nullptr, (size_t)filesize, PROT_READ, MAP_SHARED, fd_in, 0);
+        if (p != MAP_FAILED) mapa = static_cast<const char*>(p);
+    }
+    auto leer = [&](long long offset, void* destino, size_t bytes) {
+        if (mapa) {
+            std::memcpy(destino, mapa + offset, bytes);
+            return true;
         }
+        return ::pread(fd_in, destino, bytes, (off_t)offset) == (ssize_t)bytes;
+    };
+
+    // Nueva tabla hash con el head (y el tramo, si corresponde) de cada bucket
+    const long long num_buckets = (long long)tabla_vieja.entradas.size();
+    tabla_hash::Tabla nueva_tabla = tabla_hash::tablaVacia(agrupado ? LAYOUT_AGRUPADO : LAYOUT_CADENAS,
+                                                           num_buckets, tabla_vieja.carga_max);
+    nueva_tabla.buckets_base = tabla_vieja.buckets_base;
+
+    std::cout << "Iniciando limpieza física de registros (" << hilos << " hilos)...\n";
+
+    // Pasada 1: registros vivos (alcanzables desde la tabla) de cada bucket
+    std::vector<long long> inicio((size_t)num_buckets + 1, 0);
+#pragma omp parallel for num_threads(hilos) schedule(dynamic, 4096)
+    for (long long b = 0; b < num_buckets; ++b) {
+        long long n = 0;
+        tabla_hash::recorrerBucket(tabla_vieja.entradas[(size_t)b], filesize, leer,
+                                   [&](long long, const RegistroClinico&) { ++n; });
+        inicio[(size_t)b + 1] = n;
+    }
+    // Suma de prefijos: inicio[b] es el primer registro de salida del bucket b
+    for (long long b = 0; b < num_buckets; ++b) inicio[(size_t)b + 1] += inicio[(size_t)b];
+    const long long total = inicio[(size_t)num_buckets];
 
-        // Si se encontraron registros en la posición, mostrar la cantidad
-        if (!lista.empty())
-            std::cout << "  ↪ " << lista.size() << " registro(s) encontrados en posición " << i << "\n";
-
-        // Escribir los registros en orden inverso para reconstruir la lista enlazada
-        for (int j = lista.size() - 1; j >= 0; --j) {
-            RegistroClinico nuevo = lista[j];
-            nuevo.pos_siguiente = new_head; // Actualizar el puntero al siguiente registro
-
-            nuevos_registros.seekp(0, std::ios::end); // Ir al final del archivo de nuevos registros
-            long long nuevo_offset = nuevos_registros.tellp(); // Obtener el offset actual
-            nuevos_registros.write(reinterpret_cast<char*>(&nuevo), sizeof(nuevo)); // Escribir el registro
+    int fd_out = ::open("registros_new.dat", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_out < 0 || ::ftruncate(fd_out, (off_t)(total * sz)) != 0) {
+        std::cerr << "Error al crear registros_new.dat.\n";
+        return 1;
+    }
 
-            new_head = nuevo_offset; // Actualizar el nuevo head de la lista
+    // Pasada 2: tramos de buckets contiguos con ~total/tramos registros cada
+    // uno; el tramo t ocupa [inicio[corte[t]], inicio[corte[t+1]]) en la salida
+    const int tramos = hilos * 4;
+    std::vector<long long> corte((size_t)tramos + 1, num_buckets);
+    corte[0] = 0;
+    for (int t = 1; t < tramos; ++t)
+        corte[(size_t)t] = std::lower_bound(inicio.begin(), inicio.end(), total * t / tramos) - inicio.begin();
+    std::atomic<bool> ok(true);
+#pragma omp parallel for num_threads(hilos) schedule(dynamic, 1)
+    for (int t = 0; t < tramos; ++t) {
+        std::vector<RegistroClinico> lista; // registros del bucket en orden de cadena
+        std::vector<RegistroClinico> salida;
+        salida.reserve(BYTES_ESCRITURA / (size_t)sz);
+        long long escrito = inicio[(size_t)corte[(size_t)t]]; // próximo registro a escribir
+        auto volcar = [&]() {
+            const char* datos = reinterpret_cast<const char*>(salida.data());
+            size_t bytes = salida.size() * (size_t)sz;
+            for (size_t hecho = 0; hecho < bytes;) {
+                ssize_t w = ::pwrite(fd_out, datos + hecho, bytes - hecho, (off_t)(escrito * sz + (long long)hecho));
+                if (w <= 0) {
+                    ok = false;
+                    break;
+                }
+                hecho += (size_t)w;
+            }
+            escrito += (long long)salida.size();
+            salida.clear();
+        };
+        for (long long b = corte[(size_t)t]; b < corte[(size_t)t + 1] && ok; ++b) {
+            lista.clear();
+            tabla_hash::recorrerBucket(tabla_vieja.entradas[(size_t)b], filesize, leer,
+                                       [&](long long, const RegistroClinico& r) { lista.push_back(r); });
+            long long pos = inicio[(size_t)b] * sz; // offset del primer registro del bucket
+            if ((long long)lista.size() != inicio[(size_t)b + 1] - inicio[(size_t)b]) {
+                ok = false; // registros.dat cambió entre pasadas
+                break;
+            }
+            if (lista.empty()) continue;
+            if (agrupado) {
+                // En orden de cadena, contiguos: cada uno apunta al slot siguiente
+                nueva_tabla.entradas[(size_t)b] = HashExtent{pos, pos, (long long)lista.size()};
+                for (size_t j = 0; j < lista.size(); ++j)
+                    lista[j].pos_siguiente = (j + 1 < lista.size()) ? pos + (long long)(j + 1) * sz : NULL_OFFSET;
+                salida.insert(salida.end(), lista.begin(), lista.end());
+            } else {
+                // En orden inverso: la cabeza queda al final, como al insertar
+                long long cabeza = NULL_OFFSET;
+                for (size_t j = lista.size(); j-- > 0;) {
+                    lista[j].pos_siguiente = cabeza;
+                    salida.push_back(lista[j]);
+                    cabeza = pos;
+                    pos += sz;
+                }
+                nueva_tabla.entradas[(size_t)b].head_offset = cabeza;
+            }
+            if (salida.size() * (size_t)sz >= BYTES_ESCRITURA) volcar();
         }
-
-        // Escribir la nueva entrada de la tabla hash con el nuevo head
-        HashEntry nueva_entry;
-        nueva_entry.head_offset = new_head;
-        nueva_tabla.write(reinterpret_cast<char*>(&nueva_entry), sizeof(nueva_entry));
+        if (ok) volcar();
     }
 
-    // Cerrar todos los archivos
-    tabla_in.close();
-    registros_in.close();
-    nueva_tabla.close();
-    nuevos_registros.close();
-
-    // Eliminar los archivos originales y renombrar los nuevos archivos como los originales
-    std::filesystem::remove("tabla_hash.dat");
-    std::filesystem::remove("registros.dat");
-    std::filesystem::rename("tabla_hash_new.dat", "tabla_hash.dat");
-    std::filesystem::rename("registros_new.dat", "registros.dat");
+    // Cerrar todos los archivos y escribir la nueva tabla hash
+    nueva_tabla.num_registros = total;
+    if (mapa) ::munmap(const_cast<char*>(mapa), (size_t)filesize);
+    ::close(fd_in);
+    bool escrito_ok = ok && ::fsync(fd_out) == 0;
+    ::close(fd_out);
+    if (!escrito_ok || !tabla_hash::guardar("tabla_hash_new.dat", nueva_tabla) || !wal::sincronizar("tabla_hash_new.dat")) {
+        std::cerr << "Error escribiendo los temporales; no se modificó nada.\n";
+        std::error_code ec;
+        std::filesystem::remove("registros_new.dat", ec);
+        std::filesystem::remove("tabla_hash_new.dat", ec);
+        return 1;
+    }
 
-    std::cout << "\n Limpieza completada. Registros reconstruidos correctamente.\n";
+    // Reemplazar los originales como par (registros_wal.h): una caída entre los
+    // dos rename se completa al abrir, nunca queda uno nuevo con el otro viejo
+    if (!wal::reemplazarPar("registros.dat", "registros_new.dat", "tabla_hash.dat", "tabla_hash_new.dat")) {
+        std::cerr << "No se pudieron reemplazar los archivos (si quedó registros.reemplazo, se completa al abrir).\n";
+        return 1;
+    }
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::filesystem::remove(libres::rutaLibres("registros.dat")); // ya no quedan lápidas
+    if (tamArchivo(indice_fecha::rutaIndice("registros.dat")) >= 0 && !indice_fecha::construir("registros.dat"))
+        std::cerr << "No se pudo reconstruir indice_fecha.dat (correr indice_fecha construir).\n";
+    if (tamArchivo(indice_nombre::rutaIndice("registros.dat")) >= 0 && !indice_nombre::construir("registros.dat"))
+        std::cerr << "No se pudo reconstruir indice_nombre.dat (correr indice_nombre construir).\n";
+    if (tamArchivo(filtro_dni::rutaFiltro("registros.dat")) >= 0 && !filtro_dni::construir("registros.dat"))
+        std::cerr << "No se pudo reconstruir filtro_dni.dat (correr filtro_dni construir).\n";
+    if (tamArchivo(pacientes::rutaDirectorio("registros.dat")) >= 0 && !pacientes::construir("registros.dat"))
+        std::cerr << "No se pudo reconstruir pacientes.dat (correr directorio_pacientes construir).\n";
+
+    std::cout << "\n Limpieza completada: " << total << " registros vivos de " << filesize / sz << " en "
+              << segundos << " s (" << (segundos > 0 ? (long long)(total / segundos) : 0) << " registros/s).\n";
     return 0;
 }
@@ -0,0 +1,261 @@
+// bench_escalado.cpp
+// Harness de escalado fuerte/débil para `carga_mpi`: ejecuta el loader sobre una
+// matriz de valores de `-np` y `OMP_NUM_THREADS`, lee los tiempos por fase que
+// el loader deja con --reporte-fases y escribe tablas de speedup/eficiencia.
+// - fuerte: el mismo dataset para todas las configuraciones.
+// - débil: el dataset se replica una vez por rank (enlaces simbólicos, sin copiar
+//   datos), así el trabajo por rank se mantiene constante.
+// Uso: bench_escalado [--bin output/carga_mpi] [--csv csv] [--np 1,2,4] [--hilos 1,2,4]
+//                     [--modo fuerte|debil|ambos] [--reps 3] [--salida output/escalado]
+//                     [--mpirun "mpirun"] [--extra "<opciones del loader>"]
+// Salida en <salida>/: escalado.csv y escalado.json (mediana por configuración)
+// y escalado_corridas.csv (cada repetición).
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Fases que reporta carga_mpi (en este orden en las tablas)
+static const std::vector<std::string> FASES = {
+    "lista_bcast", "plan", "parseo", "parseo_espera", "enlace_hash",
+    "escritura_io", "pipeline", "agrupado", "columnas", "tabla_hash", "total"};
+
+struct Corrida {
+    std::string modo;
+    int np = 1;
+    int hilos = 1;
+    long long bytes = 0;
+    std::map<std::string, double> fases;
+};
+
+std::vector<int> parsearLista(const std::string &s)
+{
+    std::vector<int> v;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty() && std::atoi(item.c_str()) > 0) v.push_back(std::atoi(item.c_str()));
+    return v;
+}
+
+// Prepara <trabajo>/csv con `copias` réplicas (enlaces) de cada CSV del dataset.
+// Devuelve los bytes totales que verá el loader.
+long long prepararDataset(const std::vector<fs::path> &csvs, const fs::path &dir_csv, int copias)
+{
+    fs::remove_all(dir_csv);
+    fs::create_directories(dir_csv);
+    long long bytes = 0;
+    for (int c = 0; c < copias; ++c) {
+        for (auto &p : csvs) {
+            fs::path destino = dir_csv / ("r" + std::to_string(c) + "_" + p.filename().string());
+            fs::create_symlink(p, destino);
+            bytes += (long long)fs::file_size(p);
+        }
+    }
+    return bytes;
+}
+
+// Lee el CSV "fase,segundos" que deja carga_mpi
+bool leerFases(const fs::path &ruta, std::map<std::string, double> &fases)
+{
+    std::ifstream in(ruta);
+    std::string linea;
+    if (!std::getline(in, linea)) return false; // cabecera
+    while (std::getline(in, linea)) {
+        size_t coma = linea.find(',');
+        if (coma == std::string::npos) continue;
+        fases[linea.substr(0, coma)] = std::atof(linea.substr(coma + 1).c_str());
+    }
+    return !fases.empty();
+}
+
+double mediana(std::vector<double> v)
+{
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t m = v.size() / 2;
+    return (v.size() % 2) ? v[m] : 0.5 * (v[m - 1] + v[m]);
+}
+
+int main(int argc, char **argv)
+{
+    std::string bin = "output/carga_mpi";
+    std::string dir_dataset = "csv";
+    std::string salida = "output/escalado";
+    std::string mpirun = "mpirun";
+    std::string extra;
+    std::string modo = "ambos";
+    std::vector<int> lista_np = {1, 2, 4};
+    std::vector<int> lista_hilos = {1, 2, 4};
+    int reps = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hay = i + 1 < argc;
+        if (a == "--bin" && hay) bin = argv[++i];
+        else if (a == "--csv" && hay) dir_dataset = argv[++i];
+        else if (a == "--np" && hay) lista_np = parsearLista(argv[++i]);
+        else if (a == "--hilos" && hay) lista_hilos = parsearLista(argv[++i]);
+        else if (a == "--modo" && hay) modo = argv[++i];
+        else if (a == "--reps" && hay) reps = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--salida" && hay) salida = argv[++i];
+        else if (a == "--mpirun" && hay) mpirun = argv[++i];
+        else if (a == "--extra" && hay) extra = argv[++i];
+        else {
+            std::cerr << "Opción desconocida: " << a << std::endl;
+            return 1;
+        }
+    }
+    if (lista_np.empty() || lista_hilos.empty()) {
+        std::cerr << "Listas de --np/--hilos vacías" << std::endl;
+        return 1;
+    }
+
+    std::error_code ec;
+    fs::path ruta_bin = fs::absolute(bin, ec);
+    if (!fs::exists(ruta_bin)) {
+        std::cerr << "No existe el loader: " << ruta_bin << std::endl;
+        return 1;
+    }
+    std::vector<fs::path> csvs;
+    for (auto &f : fs::directory_iterator(dir_dataset, ec))
+        if (f.path().extension() == ".csv") csvs.push_back(fs::absolute(f.path()));
+    std::sort(csvs.begin(), csvs.end());
+    if (csvs.empty()) {
+        std::cerr << "No hay CSV en " << dir_dataset << std::endl;
+        return 1;
+    }
+
+    // carga_mpi lee ../csv y escribe en el directorio actual
+    fs::path dir_salida = fs::absolute(salida);
+    fs::path trabajo = dir_salida / "trabajo";
+    fs::path dir_csv = trabajo / "csv", dir_run = trabajo / "run";
+    fs::create_directories(dir_run);
+
+    std::vector<std::string> modos;
+    if (modo == "fuerte" || modo == "ambos") modos.push_back("fuerte");
+    if (modo == "debil" || modo == "ambos") modos.push_back("debil");
+    if (modos.empty()) {
+        std::cerr << "Modo desconocido: " << modo << std::endl;
+        return 1;
+    }
+
+    std::vector<Corrida> corridas;
+    for (auto &m : modos) {
+        for (int np : lista_np) {
+            long long bytes = prepararDataset(csvs, dir_csv, m == "debil" ? np : 1);
+            for (int hilos : lista_hilos) {
+                for (int r = 0; r < reps; ++r) {
+                    for (auto nombre : {"registros.dat", "tabla_hash.dat", "manifiesto_carga.csv", "fases.csv",
+                                        "edad.col", "dni.col", "fecha.col", "registros_v2.dat", "textos_v2.heap",
+                                        "diccionario_v2.dat", "indice_fecha.dat", "indice_fecha.delta",
+                                        "indice_nombre.dat", "indice_nombre.delta", "filtro_dni.dat", "pacientes.dat", "libres.dat"})
+                        fs::remove(dir_run / nombre, ec);
+                    std::string cmd = "cd '" + dir_run.string() + "' && OMP_NUM_THREADS=" + std::to_string(hilos) +
+                                      " " + mpirun + " -np " + std::to_string(np) + " '" + ruta_bin.string() +
+                                      "' --reporte-fases fases.csv " + extra + " > log.txt 2>&1";
+                    Corrida c;
+                    c.modo = m;
+                    c.np = np;
+                    c.hilos = hilos;
+                    c.bytes = bytes;
+                    if (std::system(cmd.c_str()) != 0 || !leerFases(dir_run / "fases.csv", c.fases)) {
+                        std::cerr << "Falló la corrida " << m << " np=" << np << " hilos=" << hilos
+                                  << " (ver " << (dir_run / "log.txt") << ")" << std::endl;
+                        return 2;
+                    }
+                    std::cout << m << " np=" << np << " hilos=" << hilos << " rep=" << r
+                              << ": " << c.fases["total"] << " s" << std::endl;
+                    corridas.push_back(c);
+                }
+            }
+        }
+    }
+
+    // Corridas individuales
+    {
+        std::ofstream out(dir_salida / "escalado_corridas.csv", std::ios::trunc);
+        out << "modo,np,hilos,bytes";
+        for (auto &f : FASES) out << ',' << f;
+        out << '\n';
+        for (auto &c : corridas) {
+            out << c.modo << ',' << c.np << ',' << c.hilos << ',' << c.bytes;
+            for (auto &f : FASES) out << ',' << c.fases[f];
+            out << '\n';
+        }
+    }
+
+    // Mediana por configuración y speedup/eficiencia respecto de la primera
+    // configuración de cada modo. En escalado débil la eficiencia es T_base/T y
+    // el speedup es el escalado (eficiencia * ranks relativos, porque el dataset
+    // crece con los ranks y no con los hilos).
+    std::ofstream csv(dir_salida / "escalado.csv", std::ios::trunc);
+    std::ofstream json(dir_salida / "escalado.json", std::ios::trunc);
+    csv << "modo,np,hilos,nucleos,bytes";
+    for (auto &f : FASES) csv << ',' << f;
+    csv << ",mb_s,speedup,eficiencia\n";
+    json << "[\n";
+    bool primero_json = true;
+    for (auto &m : modos) {
+        double t_base = 0.0;
+        int nucleos_base = 0, np_base = 0;
+        for (int np : lista_np) {
+            for (int hilos : lista_hilos) {
+                std::map<std::string, double> med;
+                long long bytes = 0;
+                for (auto &f : FASES) {
+                    std::vector<double> v;
+                    for (auto &c : corridas)
+                        if (c.modo == m && c.np == np && c.hilos == hilos) {
+                            v.push_back(c.fases[f]);
+                            bytes = c.bytes;
+                        }
+                    med[f] = mediana(v);
+                }
+                int nucleos = np * hilos;
+                double t = med["total"];
+                if (nucleos_base == 0) {
+                    t_base = t;
+                    nucleos_base = nucleos;
+                    np_base = np;
+                }
+                double relativo = (m == "fuerte") ? (double)nucleos / nucleos_base : (double)np / np_base;
+                double speedup = 0.0, eficiencia = 0.0;
+                if (t > 0.0) {
+                    if (m == "fuerte") {
+                        speedup = t_base / t;
+                        eficiencia = speedup / relativo;
+                    } else {
+                        eficiencia = t_base / t;
+                        speedup = eficiencia * relativo;
+                    }
+                }
+                double mb_s = (t > 0.0) ? (bytes / 1e6) / t : 0.0;
+
+                csv << m << ',' << np << ',' << hilos << ',' << nucleos << ',' << bytes;
+                for (auto &f : FASES) csv << ',' << med[f];
+                csv << ',' << mb_s << ',' << speedup << ',' << eficiencia << '\n';
+
+                json << (primero_json ? "" : ",\n") << "  {\"modo\": \"" << m << "\", \"np\": " << np
+                     << ", \"hilos\": " << hilos << ", \"nucleos\": " << nucleos << ", \"bytes\": " << bytes
+                     << ", \"fases\": {";
+                for (size_t k = 0; k < FASES.size(); ++k)
+                    json << (k ? ", " : "") << '"' << FASES[k] << "\": " << med[FASES[k]];
+                json << "}, \"mb_s\": " << mb_s << ", \"speedup\": " << speedup
+                     << ", \"eficiencia\": " << eficiencia << "}";
+                primero_json = false;
+            }
+        }
+    }
+    json << "\n]\n";
+
+    std::cout << "Resultados en " << (dir_salida / "escalado.csv") << " y " << (dir_salida / "escalado.json") << std::endl;
+    return 0;
+}
@@ -2,55 +2,91 @@
 // Benchmark CLI: utilitario para medir performance de I/O y operaciones CRUD
 // Location: bench_io.cpp -> main(), load_table(), buscar_offsets(), insertar_dummy()
 // Uso: bench_io <search|insert> <registros.dat path> <tabla_hash.dat path> <dni> [iters]
+//      bench_io search-mt <registros.dat path> <tabla_hash.dat path> <dni> [iters] [hilos]
+//      (búsquedas concurrentes con registros_mmap.h; reporta búsquedas/s para 1, 2, 4... hilos)
+//      bench_io insert-mt <registros.dat path> <tabla_hash.dat path> <dni> [iters] [hilos] [--sin-diario]
+//      (inserciones y bajas concurrentes por el camino de la GUI, insercion_viva.h:
+//      franjas por bucket, reuso de lápidas, reserva atómica al final y el diario
+//      con commit en grupo; reporta inserciones/s y fsyncs para 1, 2, 4... hilos y
+//      controla al final que no se perdió ninguna y que los derivados siguen al día)
+//      bench_io lookup-mt <registros.dat path> <tabla_hash.dat path> <dni> [iters] [hilos] [--con-lock]
+//      (lecturas de cabezas como las de la GUI, sin locks con tabla_concurrente.h o
+//      con --con-lock bajo un shared_mutex, mientras un hilo escribe cabezas y
+//      publica divisiones; reporta lecturas/s y latencia p50/p99 para 1, 2, 4... hilos)
+// Las búsquedas consultan el filtro de DNI (filtro_dni.h) y leen solo los
+// registros del paciente con el directorio (directorio_pacientes.h) si están
+// frescos; con --sin-filtro / --sin-directorio al final se mide el recorrido de siempre.
 
 #include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "insercion_viva.h"
+#include "tabla_hash.h"
+#include "registros_libres.h"
+#include "registros_mmap.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_concurrente.h"
 #include "time_utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cstring>
 
 using namespace std;
 
-vector<HashEntry> load_table(const string &tabla_path) {
-    vector<HashEntry> table(TABLE_SIZE);
-    ifstream in(tabla_path, ios::binary);
-    if (!in.is_open()) {
-        cerr << "No se puede abrir " << tabla_path << "\n";
-        return table;
-    }
-    for (int i = 0; i < TABLE_SIZE; ++i) {
-        HashEntry e;
-        in.read(reinterpret_cast<char*>(&e), sizeof(e));
-        if (!in) e.head_offset = NULL_OFFSET;
-        table[i] = e;
-    }
+// Las búsquedas miden sobre la tabla vigente: la compartida si la GUI o
+// gestor_dni están abiertos (tabla_compartida.h), si no la del disco
+tabla_hash::Tabla load_table(const string &registros_path, const string &tabla_path, bool vigente) {
+    tabla_hash::Tabla table;
+    bool ok = vigente ? tabla_compartida::cargarVigente(registros_path, tabla_path, table)
+                      : tabla_hash::cargar(tabla_path, table);
+    if (!ok) cerr << "No se puede abrir " << tabla_path << "\n";
     return table;
 }
 
-vector<long long> buscar_offsets(const string &registros_path, const vector<HashEntry> &table, int dni) {
+vector<long long> buscar_offsets(const string &registros_path, const tabla_hash::Tabla &table,
+                                 const pacientes::Directorio *directorio, int dni) {
     vector<long long> offsets;
     ifstream in(registros_path, ios::binary);
     if (!in.is_open()) return offsets;
-    int pos = dni & (TABLE_SIZE - 1);
-    long long offset = table[pos].head_offset;
-    RegistroClinico r;
+    if (directorio && directorio->buscar(dni, offsets)) {
+        // Directorio: solo los registros del paciente (se leen para medir el mismo trabajo)
+        RegistroClinico r;
+        for (long long offset : offsets) {
+            in.seekg(offset, ios::beg);
+            in.read(reinterpret_cast<char*>(&r), sizeof(r));
+        }
+        return offsets;
+    }
+    int pos = tabla_hash::bucket(table, dni);
     long long filesize = 0;
     try { filesize = filesystem::file_size(registros_path); } catch (...) { in.seekg(0, ios::end); filesize = in.tellg(); in.seekg(0, ios::beg); }
-    while (offset != NULL_OFFSET) {
-        if (offset < 0 || offset + (long long)sizeof(r) > filesize) break;
-        in.seekg(offset, ios::beg);
-        in.read(reinterpret_cast<char*>(&r), sizeof(r));
-        if (r.dni == dni) offsets.push_back(offset);
-        offset = r.pos_siguiente;
-    }
+    tabla_hash::recorrerBucket(table.entradas[pos], filesize,
+        [&](long long offset, void *dst, size_t n) {
+            in.seekg(offset, ios::beg);
+            return (bool)in.read(reinterpret_cast<char*>(dst), n);
+        },
+        [&](long long offset, const RegistroClinico &r) {
+            if (r.dni == dni) offsets.push_back(offset);
+        });
     return offsets;
 }
 
-long long insertar_dummy(const string &registros_path, const string &tabla_path, vector<HashEntry> &table, int dni) {
+long long insertar_dummy(const string &registros_path, const string &tabla_path, tabla_hash::Tabla &table, int dni) {
     RegistroClinico r{};
     strncpy(r.fecha, "2025-11-27", sizeof(r.fecha)-1);
     r.dni = dni;
@@ -64,7 +100,7 @@ long long insertar_dummy(const string &registros_path, const string &tabla_path,
     strncpy(r.receta, "None", sizeof(r.receta)-1);
     r.pos_siguiente = NULL_OFFSET;
 
-    // append
+    // open (or create) registros
     fstream registros(registros_path, ios::in | ios::out | ios::binary);
     if (!registros.is_open()) {
         // try create
@@ -73,49 +109,311 @@ long long insertar_dummy(const string &registros_path, const string &tabla_path,
         registros.open(registros_path, ios::in | ios::out | ios::binary);
         if (!registros.is_open()) return -1;
     }
-    registros.seekp(0, ios::end);
-    long long new_off = registros.tellp();
-    int pos = dni & (TABLE_SIZE - 1);
-    r.pos_siguiente = table[pos].head_offset;
+    // reusa el lugar de una lápida si hay (registros_libres.h), si no al final
+    long long new_off = libres::tomar(registros_path, registros);
+    if (new_off == NULL_OFFSET) {
+        registros.seekp(0, ios::end);
+        new_off = registros.tellp();
+    } else {
+        registros.seekp(new_off, ios::beg);
+    }
+    int pos = tabla_hash::bucket(table, dni);
+    r.pos_siguiente = table.entradas[pos].head_offset;
     registros.write(reinterpret_cast<char*>(&r), sizeof(r));
     registros.flush();
-    registros.close();
-    // update in-memory table and persist head
-    table[pos].head_offset = new_off;
-    ofstream th(tabla_path, ios::binary | ios::in | ios::out | ios::trunc);
-    if (!th.is_open()) {
-        // fallback: try open then write
-        ofstream th2(tabla_path, ios::binary | ios::trunc);
-        if (!th2.is_open()) return new_off;
-        for (int i = 0; i < TABLE_SIZE; ++i) { th2.write(reinterpret_cast<char*>(&table[i]), sizeof(HashEntry)); }
-        th2.close();
-        return new_off;
+    // en un lugar reusado el tamaño no cambia: todos los derivados deben recibir el alta
+    indice_fecha::registrar(registros_path, r, new_off);
+    indice_nombre::registrar(registros_path, r, new_off);
+    filtro_dni::registrar(registros_path, r, new_off);
+    pacientes::registrar(registros_path, r, new_off);
+    // update in-memory table and persist it (same format it was loaded in)
+    table.entradas[pos].head_offset = new_off;
+    ++table.num_registros;
+    tabla_hash::guardar(tabla_path, table);
+    // una tabla que crece divide buckets como cualquier inserción (mide también ese costo)
+    if (tabla_hash::debeDividir(table)) {
+        fstream th(tabla_path, ios::in | ios::out | ios::binary);
+        tabla_hash::crecer(table, registros, th);
     }
-    for (int i = 0; i < TABLE_SIZE; ++i) { th.write(reinterpret_cast<char*>(&table[i]), sizeof(HashEntry)); }
-    th.close();
+    registros.close();
     return new_off;
 }
 
+// Inserciones concurrentes por el camino de la GUI (insercion_viva.h): cada
+// hilo agrega `iters` registros (DNI dni + h*iters + k) con Estado::insertar y
+// elimina por offset uno de cada dos con Estado::eliminar, así que las
+// inserciones siguientes reusan lápidas (registros_libres.h) mientras otras
+// reservan al final y registran sus altas en orden de offset. `quedan` recibe
+// los (DNI, offset) que siguen vivos y `fsyncs` los commits en grupo del
+// diario. Devuelve inserciones/s (-1 si falló).
+double insertar_concurrente(viva::Estado &vivo, int dni, int iters, int hilos, unsigned long long &fsyncs,
+                            long long &eliminados, vector<pair<int, long long>> &quedan) {
+    atomic<bool> error(false);
+    atomic<long long> bajas(0);
+    vector<vector<pair<int, long long>>> propios(hilos);
+    unsigned long long grupos0 = vivo.diario_registros.grupos();
+    vector<thread> ts;
+    auto t0 = chrono::steady_clock::now();
+    for (int h = 0; h < hilos; ++h) {
+        ts.emplace_back([&, h]() {
+            RegistroClinico r{};
+            memcpy(r.fecha, "2025-11-27", sizeof(r.fecha)); // 10 caracteres y el terminador
+            strncpy(r.nombre, "Bench", sizeof(r.nombre)-1);
+            strncpy(r.apellido, "User", sizeof(r.apellido)-1);
+            r.edad = 30;
+            strncpy(r.motivo, "Bench", sizeof(r.motivo)-1);
+            for (int k = 0; k < iters && !error; ++k) {
+                r.dni = dni + h * iters + k;
+                long long off = vivo.insertar(r);
+                if (off == NULL_OFFSET) { error = true; return; }
+                if (k % 2 == 1) {
+                    // baja del anterior de este hilo: su lugar queda en la lista de libres
+                    pair<int, long long> previo = propios[h].back();
+                    propios[h].pop_back();
+                    long long n = vivo.eliminar(previo.first, [&](long long offset, const RegistroClinico &x) {
+                        return offset == previo.second && x.dni == previo.first;
+                    });
+                    if (n != 1) { error = true; return; }
+                    ++bajas;
+                }
+                propios[h].push_back({r.dni, off});
+            }
+        });
+    }
+    for (auto &t : ts) t.join();
+    double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    fsyncs = vivo.diario_registros.grupos() - grupos0;
+    eliminados = bajas;
+    for (auto &v : propios) quedan.insert(quedan.end(), v.begin(), v.end());
+    if (error) return -1;
+    return s > 0 ? (double)hilos * iters / s : 0.0;
+}
+
+// Los derivados que estaban al día lo siguen después de las inserciones:
+// filtro y directorio abiertos, índices por fecha y nombre frescos. Cada
+// registro vivo de la prueba figura en el directorio con su offset.
+struct Derivados {
+    bool filtro = false, directorio = false, fecha = false, nombre = false;
+};
+
+Derivados derivados_al_dia(viva::Estado &vivo) {
+    Derivados d;
+    shared_lock<shared_mutex> dlock(vivo.derivados_mutex);
+    d.filtro = vivo.filtro_dnis.abierto() && vivo.filtro_dnis.fresco();
+    d.directorio = vivo.directorio_pacientes.abierto() && vivo.directorio_pacientes.fresco();
+    indice_fecha::Indice fecha;
+    d.fecha = fecha.abrir(vivo.ruta_registros) && fecha.fresco();
+    indice_nombre::Indice nombre;
+    d.nombre = nombre.abrir(vivo.ruta_registros) && nombre.fresco();
+    return d;
+}
+
+long long faltan_en_directorio(viva::Estado &vivo, const vector<pair<int, long long>> &quedan) {
+    shared_lock<shared_mutex> dlock(vivo.derivados_mutex);
+    if (!vivo.directorio_pacientes.abierto()) return 0;
+    long long faltan = 0;
+    vector<long long> offsets;
+    for (const auto &q : quedan)
+        if (!vivo.directorio_pacientes.buscar(q.first, offsets) ||
+            find(offsets.begin(), offsets.end(), q.second) == offsets.end())
+            ++faltan;
+    return faltan;
+}
+
+// Cuenta los registros alcanzables desde `table` (control de que ninguna
+// inserción concurrente se perdió)
+long long contar_alcanzables(const string &registros_path, const tabla_hash::Tabla &table) {
+    registros_mmap::AlmacenRegistros almacen;
+    if (!almacen.abrir(registros_path)) return -1;
+    long long n = 0;
+    for (const HashExtent &e : table.entradas)
+        almacen.recorrerBucket(e, [&](long long, const RegistroClinico &) { ++n; });
+    return n;
+}
+
+// Búsquedas concurrentes sin locks: cada hilo busca `iters` DNIs distintos
+// (dni + k) recorriendo las cadenas (o la lista del directorio) sobre el mapeo compartido
+double buscar_concurrente(const registros_mmap::AlmacenRegistros &almacen, const tabla_hash::Tabla &table,
+                          const filtro_dni::Filtro *filtro, const pacientes::Directorio *directorio, int dni,
+                          int iters, int hilos) {
+    vector<thread> ts;
+    vector<long long> encontrados(hilos, 0);
+    auto t0 = chrono::steady_clock::now();
+    for (int h = 0; h < hilos; ++h) {
+        ts.emplace_back([&, h]() {
+            long long n = 0; // contador local: evita false sharing entre hilos
+            vector<long long> offsets;
+            RegistroClinico respaldo;
+            for (int k = 0; k < iters; ++k) {
+                int buscado = dni + h * iters + k;
+                const HashExtent &e = table.entradas[tabla_hash::bucket(table, buscado)];
+                if (e.head_offset == NULL_OFFSET || (filtro && !filtro->puedeContener(buscado))) continue;
+                if (directorio && directorio->buscar(buscado, offsets)) {
+                    for (long long offset : offsets) {
+                        const RegistroClinico *r = almacen.ver(offset, respaldo);
+                        if (r && r->dni == buscado) ++n;
+                    }
+                    continue;
+                }
+                almacen.recorrerBucket(e, [&](long long, const RegistroClinico &r) {
+                    if (r.dni == buscado) ++n;
+                });
+            }
+            encontrados[h] = n;
+        });
+    }
+    for (auto &t : ts) t.join();
+    double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return s > 0 ? (double)hilos * iters / s : 0.0;
+}
+
+struct Latencias {
+    double por_s = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+};
+
+// Lecturas de cabezas concurrentes (bucket + entrada de `dni + k`, como las
+// búsquedas de la GUI antes de recorrer la cadena) contra un escritor que
+// reescribe cabezas y cada tanto hace un cambio de estructura (republica la
+// tabla). Sin `con_lock` los lectores usan la vista sin locks; con él, la tabla
+// bajo un shared_mutex compartido (el escritor lo toma exclusivo). La latencia
+// se mide por lote de LOTE lecturas para no medir el reloj.
+Latencias leer_cabezas_concurrente(const tabla_hash::Tabla &table, bool con_lock, int dni, int iters, int hilos) {
+    const int LOTE = 64;
+    tabla_concurrente::Vista vista;
+    vista.publicar(table);
+    tabla_hash::Tabla copia = table;
+    shared_mutex m;
+    atomic<bool> fin(false);
+    thread escritor([&]() {
+        for (unsigned long long k = 0; !fin; ++k) {
+            int pos = (int)(k % copia.entradas.size());
+            if (k % 100000 == 0) {
+                unique_lock<shared_mutex> lk(m);
+                vista.empezarCambio();
+                vista.publicar(copia);
+                vista.terminarCambio();
+            } else if (con_lock) {
+                unique_lock<shared_mutex> lk(m);
+                copia.entradas[(size_t)pos].head_offset = copia.entradas[(size_t)pos].head_offset;
+            } else {
+                vista.escribirCabeza(pos, copia.entradas[(size_t)pos].head_offset);
+            }
+        }
+    });
+    vector<thread> ts;
+    vector<vector<double>> lat(hilos);
+    vector<long long> suma(hilos, 0);
+    auto t0 = chrono::steady_clock::now();
+    for (int h = 0; h < hilos; ++h) {
+        ts.emplace_back([&, h]() {
+            long long s = 0; // local: evita false sharing entre hilos
+            lat[h].reserve((size_t)iters / LOTE + 1);
+            for (int k = 0; k < iters; k += LOTE) {
+                auto l0 = chrono::steady_clock::now();
+                for (int j = k; j < k + LOTE && j < iters; ++j) {
+                    int buscado = dni + h * iters + j;
+                    if (con_lock) {
+                        shared_lock<shared_mutex> lk(m);
+                        s += copia.entradas[(size_t)tabla_hash::bucket(copia, buscado)].head_offset;
+                    } else {
+                        unsigned long long epoca;
+                        s += vista.entradaDe(buscado, epoca).head_offset;
+                    }
+                }
+                lat[h].push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - l0).count() / LOTE);
+            }
+            suma[h] = s;
+        });
+    }
+    for (auto &t : ts) t.join();
+    double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    fin = true;
+    escritor.join();
+    vector<double> todas;
+    for (auto &v : lat) todas.insert(todas.end(), v.begin(), v.end());
+    Latencias r;
+    r.por_s = s > 0 ? (double)hilos * iters / s : 0.0;
+    if (!todas.empty()) {
+        sort(todas.begin(), todas.end());
+        r.p50_ns = todas[todas.size() / 2];
+        r.p99_ns = todas[min(todas.size() - 1, todas.size() * 99 / 100)];
+    }
+    return r;
+}
+
 int main(int argc, char** argv) {
     if (argc < 5) {
-        cout << "Usage: bench_io <search|insert> <registros.dat path> <tabla_hash.dat path> <dni> [iters]\n";
+        cout << "Usage: bench_io <search|insert|search-mt|insert-mt|lookup-mt> <registros.dat path> <tabla_hash.dat path> <dni> [iters] [hilos] [--sin-filtro] [--sin-directorio] [--sin-diario] [--con-lock]\n";
         return 1;
     }
     string mode = argv[1];
     string registros_path = argv[2];
     string tabla_path = argv[3];
     int dni = atoi(argv[4]);
+    bool sin_filtro = false, sin_directorio = false, sin_diario = false, con_lock = false;
+    for (; argc > 5 && string(argv[argc - 1]).rfind("--", 0) == 0; --argc) {
+        sin_filtro = sin_filtro || string(argv[argc - 1]) == "--sin-filtro";
+        sin_directorio = sin_directorio || string(argv[argc - 1]) == "--sin-directorio";
+        sin_diario = sin_diario || string(argv[argc - 1]) == "--sin-diario";
+        con_lock = con_lock || string(argv[argc - 1]) == "--con-lock";
+    }
     int iters = (argc >= 6) ? atoi(argv[5]) : 10;
 
-    auto table = load_table(tabla_path);
+    // `insert` reescribe tabla_hash.dat: sin procesos adjuntos a la tabla
+    // compartida y partiendo de la tabla con el diario de la GUI aplicado
+    // (insert-mt escribe como la GUI, con el rol de escritor)
+    const bool insercion = mode == "insert";
+    unique_ptr<tabla_compartida::Exclusivo> exclusivo;
+    if (insercion) exclusivo = make_unique<tabla_compartida::Exclusivo>(tabla_path);
+    if (insercion && !*exclusivo) {
+        cerr << "La tabla " << tabla_path << " está en uso (GUI o gestor_dni abiertos)\n";
+        return 1;
+    }
+    if (insercion && wal::recuperar(registros_path, tabla_path) < 0) {
+        cerr << "No se pudo aplicar " << wal::rutaDiario(registros_path) << "\n";
+        return 1;
+    }
+    auto table = load_table(registros_path, tabla_path, !insercion);
+    filtro_dni::Filtro filtro;
+    const filtro_dni::Filtro *usar_filtro = nullptr;
+    if (mode.rfind("insert", 0) != 0 && !sin_filtro && filtro.abrir(registros_path) && filtro.fresco()) usar_filtro = &filtro;
+    if (mode.rfind("insert", 0) != 0) cout << "Filtro de DNI: " << (usar_filtro ? "sí" : "no") << "\n";
+    pacientes::Directorio directorio;
+    const pacientes::Directorio *usar_directorio = nullptr;
+    if (mode.rfind("insert", 0) != 0 && !sin_directorio && directorio.abrir(registros_path) && directorio.fresco())
+        usar_directorio = &directorio;
+    if (mode.rfind("insert", 0) != 0) cout << "Directorio de pacientes: " << (usar_directorio ? "sí" : "no") << "\n";
     if (mode == "search") {
         time_utils::ScopedTimer t(string("bench_search DNI:") + to_string(dni) + " iters=" + to_string(iters));
         for (int i = 0; i < iters; ++i) {
-            auto offs = buscar_offsets(registros_path, table, dni);
+            if (usar_filtro && !usar_filtro->puedeContener(dni)) continue;
+            auto offs = buscar_offsets(registros_path, table, usar_directorio, dni);
             // prevent optimizing out
             if (i == -1 && offs.size() > 0) cout << "ok";
         }
         cout << "Bench search completed (" << iters << " iters)\n";
+    } else if (mode == "search-mt") {
+        int max_hilos = (argc >= 7) ? max(1, atoi(argv[6])) : (int)max(1u, thread::hardware_concurrency());
+        registros_mmap::AlmacenRegistros almacen;
+        if (!almacen.abrir(registros_path)) {
+            cerr << "No se puede abrir " << registros_path << "\n";
+            return 1;
+        }
+        for (int h = 1; h <= max_hilos; h *= 2) {
+            time_utils::ScopedTimer t(string("bench_search_mt hilos=") + to_string(h) + " iters=" + to_string(iters));
+            cout << "hilos=" << h << ": " << (long long)buscar_concurrente(almacen, table, usar_filtro, usar_directorio, dni, iters, h) << " busquedas/s\n";
+        }
+    } else if (mode == "lookup-mt") {
+        int max_hilos = (argc >= 7) ? max(1, atoi(argv[6])) : (int)max(1u, thread::hardware_concurrency());
+        cout << "Lecturas de cabezas " << (con_lock ? "con shared_mutex" : "sin locks") << "\n";
+        for (int h = 1; h <= max_hilos; h *= 2) {
+            time_utils::ScopedTimer t(string("bench_lookup_mt hilos=") + to_string(h) + " iters=" + to_string(iters));
+            Latencias l = leer_cabezas_concurrente(table, con_lock, dni, iters, h);
+            cout << "hilos=" << h << ": " << (long long)l.por_s << " lecturas/s, p50 " << l.p50_ns << " ns, p99 "
+                 << l.p99_ns << " ns\n";
+        }
     } else if (mode == "insert") {
         time_utils::ScopedTimer t(string("bench_insert DNI:") + to_string(dni) + " iters=" + to_string(iters));
         for (int i = 0; i < iters; ++i) {
@@ -126,6 +424,62 @@ int main(int argc, char** argv) {
             }
         }
         cout << "Bench insert completed (" << iters << " iters)\n";
+    } else if (mode == "insert-mt") {
+        int max_hilos = (argc >= 7) ? max(1, atoi(argv[6])) : (int)max(1u, thread::hardware_concurrency());
+        // El estado de escritura de la GUI, adjunto a la tabla compartida: puede
+        // correr con la GUI o gestor_dni abiertos
+        viva::Estado vivo;
+        string error;
+        if (!vivo.abrir(registros_path, tabla_path, &error, !sin_diario)) {
+            cerr << error << "\n";
+            return 1;
+        }
+        vivo.recargarDerivados();
+        long long esperados, alcanzables, faltan = 0;
+        Derivados antes, despues;
+        {
+            // el rol de escritor durante toda la prueba: nadie más escribe entre
+            // las rondas y los controles
+            tabla_compartida::Escritura rol(vivo.tabla_viva, [&] { vivo.retomar(); });
+            tabla_hash::Tabla inicial;
+            vivo.tabla_viva.copiar(inicial);
+            esperados = contar_alcanzables(registros_path, inicial);
+            antes = derivados_al_dia(vivo);
+            vector<pair<int, long long>> quedan;
+            for (int h = 1; h <= max_hilos; h *= 2) {
+                time_utils::ScopedTimer t(string("bench_insert_mt hilos=") + to_string(h) + " iters=" + to_string(iters));
+                unsigned long long fsyncs = 0;
+                long long eliminados = 0;
+                double por_s = insertar_concurrente(vivo, dni, iters, h, fsyncs, eliminados, quedan);
+                if (por_s < 0) {
+                    cerr << "Error inserting\n";
+                    return 2;
+                }
+                esperados += (long long)h * iters - eliminados;
+                cout << "hilos=" << h << ": " << (long long)por_s << " inserciones/s, " << eliminados << " eliminados";
+                if (!sin_diario)
+                    cout << ", " << fsyncs << " fsyncs (" << (fsyncs ? (double)h * iters / fsyncs : 0.0) << " inserciones por fsync)";
+                cout << "\n";
+            }
+            // Ninguna inserción perdida: todas alcanzables desde las cabezas
+            tabla_hash::Tabla final;
+            vivo.tabla_viva.copiar(final);
+            alcanzables = contar_alcanzables(registros_path, final);
+            despues = derivados_al_dia(vivo);
+            faltan = faltan_en_directorio(vivo, quedan);
+        }
+        cout << "Registros alcanzables: " << alcanzables << " (esperados " << esperados << ")"
+             << (alcanzables == esperados ? "" : " ¡PERDIDOS!") << "\n";
+        bool derivados_ok = (despues.filtro || !antes.filtro) && (despues.directorio || !antes.directorio) &&
+                            (despues.fecha || !antes.fecha) && (despues.nombre || !antes.nombre);
+        cout << "Derivados al día: filtro " << antes.filtro << "->" << despues.filtro << ", directorio "
+             << antes.directorio << "->" << despues.directorio << ", índice por fecha " << antes.fecha << "->"
+             << despues.fecha << ", por nombre " << antes.nombre << "->" << despues.nombre
+             << (derivados_ok ? "" : " ¡DESACTUALIZADOS!") << "\n";
+        if (faltan) cout << "Registros vivos que faltan en el directorio: " << faltan << "\n";
+        // Checkpoint (tabla completa, diario vacío) y el rol para los demás procesos
+        vivo.soltar();
+        if (alcanzables != esperados || !derivados_ok || faltan) return 2;
     } else {
         cerr << "Unknown mode: " << mode << "\n";
         return 1;
@@ -0,0 +1,52 @@
+// bloqueo_franjas.h
+// Concurrencia fina para las inserciones sobre la tabla hash en memoria:
+// - `Franjas`: un arreglo fijo de mutex (uno por línea de caché) repartido
+//   entre los buckets por su número. Dos inserciones en buckets de franjas
+//   distintas avanzan a la vez; en la misma franja se ordenan, así las cabezas
+//   de un bucket (y sus anotaciones en el diario) cambian de a una.
+// - `Cola`: el final de `registros.dat` como contador atómico. Cada inserción
+//   reserva su lugar con fetch_add y escribe el registro con pwrite, sin seek
+//   compartido ni lock de archivo.
+// Los cambios de estructura (división de buckets, compactación, checkpoint)
+// siguen excluyendo a los escritores con el lock exclusivo de la tabla; las
+// búsquedas no lo toman (ver tabla_concurrente.h).
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace franjas {
+
+static const int FRANJAS_DEFECTO = 1024; // potencia de 2
+
+class Franjas {
+public:
+    explicit Franjas(int cantidad = FRANJAS_DEFECTO) : mascara_(cantidad - 1), franjas_(new Franja[(size_t)cantidad]) {}
+    Franjas(const Franjas &) = delete;
+    Franjas &operator=(const Franjas &) = delete;
+
+    std::mutex &de(int bucket) { return franjas_[(size_t)(bucket & mascara_)].m; }
+    int cantidad() const { return mascara_ + 1; }
+
+private:
+    struct alignas(64) Franja {
+        std::mutex m;
+    };
+    int mascara_;
+    std::unique_ptr<Franja[]> franjas_;
+};
+
+class Cola {
+public:
+    // Final actual (al abrir o tras reemplazar registros.dat, sin escritores)
+    void reiniciar(long long fin) { fin_.store(fin, std::memory_order_relaxed); }
+    // Reserva `bytes` al final y devuelve su offset
+    long long reservar(long long bytes) { return fin_.fetch_add(bytes, std::memory_order_relaxed); }
+    long long fin() const { return fin_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<long long> fin_{0};
+};
+
+} // namespace franjas
@@ -1,10 +1,38 @@
 // carga_mpi.cpp
 // Programa que distribuye el parseo de múltiples CSV usando MPI (ranks)
-// y OpenMP (paralelismo intra-rank). Cada rank convierte su porción
-// de CSVs en un archivo temporal `temp_rank_X.dat`. El proceso maestro
-// concatena los temporales en `registros.dat` y reconstruye `tabla_hash.dat`,
-// rellenando los campos `pos_siguiente` para permitir búsquedas por DNI.
+// y OpenMP (paralelismo intra-rank). Los CSV se dividen en trozos alineados
+// a línea que los ranks toman dinámicamente (contador RMA en el rank 0).
+// Cada rank ejecuta un pipeline de memoria acotada (--max-buffer-mb):
+//   hilo lector (pread en buffers fijos) -> hilo parser (OpenMP, csv_mmap.h)
+//   -> escritura (hilo principal) conectados por colas acotadas.
+// La escritura avanza en rondas colectivas: en cada ronda cada rank aporta un
+// bloque de registros, las cadenas (`pos_siguiente`) se cosen entre ranks con
+// MPI_Exscan y los bloques se escriben en `registros.dat` con MPI-IO colectivo.
+// El proceso maestro solo escribe `tabla_hash.dat` con las cabezas finales.
+// Con --incremental solo se cargan los CSV nuevos o que crecieron (según
+// `manifiesto_carga.csv`) y se enlazan a las cadenas existentes.
+// Con --layout agrupado, al final se reordena registros.dat para que los
+// registros de cada bucket queden contiguos (tabla_hash.dat v2, ver tabla_hash.h).
+// Al terminar se generan las columnas edad/dni/fecha (columnas.h) en paralelo,
+// salvo con --sin-columnas, los índices por fecha (indice_fecha.h) y por
+// nombre (indice_nombre.h) salvo con --sin-indice-fecha / --sin-indice-nombre,
+// el filtro de DNI (filtro_dni.h) salvo con --sin-filtro, el directorio de
+// pacientes (directorio_pacientes.h) salvo con --sin-directorio,
+// y con --registro-v2 la copia compacta v2 con su diccionario (registro_v2.h).
+// No arranca si la GUI o gestor_dni tienen la tabla abierta (tabla_compartida.h).
 #include "common.h"
+#include "csv_mmap.h"
+#include "cola_acotada.h"
+#include "columnas.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "registro_v2.h"
+#include "registros_libres.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
 
 #include <mpi.h>
 #include <omp.h>
@@ -12,74 +40,1562 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "time_utils.h"
 
 
-// Simple hash function (potencia de 2 TABLE_SIZE)
-inline int hash1(int dni) { return dni & (TABLE_SIZE - 1); }
-// Parsea una línea CSV a RegistroClinico (similar al código legado)
-RegistroClinico parsearLinea(const std::string &linea)
-{
-    std::stringstream ss(linea);
-    RegistroClinico r;
-    std::memset(&r, 0, sizeof(r));
-    std::string campo;
-    std::getline(ss, campo, ',');
-    std::strncpy(r.fecha, campo.c_str(), sizeof(r.fecha) - 1);
-    std::getline(ss, campo, ',');
-    r.dni = campo.empty() ? 0 : std::stoi(campo);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.nombre, campo.c_str(), sizeof(r.nombre) - 1);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.apellido, campo.c_str(), sizeof(r.apellido) - 1);
-    std::getline(ss, campo, ',');
-    r.edad = campo.empty() ? 0 : std::stoi(campo);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.medico, campo.c_str(), sizeof(r.medico) - 1);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.motivo, campo.c_str(), sizeof(r.motivo) - 1);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.examenes, campo.c_str(), sizeof(r.examenes) - 1);
-    std::getline(ss, campo, ',');
-    std::strncpy(r.resultados, campo.c_str(), sizeof(r.resultados) - 1);
-    std::getline(ss, campo);
-    std::strncpy(r.receta, campo.c_str(), sizeof(r.receta) - 1);
-    r.pos_siguiente = NULL_OFFSET;
-    return r;
-}
-
-// Lee todas las líneas (sin cabecera) de un CSV en memoria
-std::vector<std::string> leerLineasCSV(const std::string &ruta)
-{
-    std::vector<std::string> lines;
-    std::ifstream in(ruta);
-    if (!in.is_open()) {
-        std::cerr << "No se pudo abrir " << ruta << std::endl;
-        return lines;
+// Operador MPI (no conmutativo) para coser tramos de cadenas: por cada bucket
+// conserva el último offset no nulo en orden de rank (in = ranks previos).
+void opUltimoNoNulo(void *in, void *inout, int *len, MPI_Datatype *)
+{
+    const long long *previo = static_cast<const long long *>(in);
+    long long *actual = static_cast<long long *>(inout);
+    for (int i = 0; i < *len; ++i)
+        if (actual[i] == NULL_OFFSET) actual[i] = previo[i];
+}
+
+// Enlaza un tramo contiguo de registros que comenzará en el byte `base` de
+// registros.dat: cada registro apunta al anterior de su bucket dentro del tramo.
+// `primero[b]` guarda el índice local del primer registro del bucket b (su enlace
+// llega de tramos anteriores) y `ultimo[b]` el offset global del último.
+void enlazarTramoLocal(std::vector<RegistroClinico> &regs, long long base, const tabla_hash::Geometria &geo,
+                       std::vector<long long> &ultimo, std::vector<long long> &primero)
+{
+    long long offset = base;
+    for (size_t i = 0; i < regs.size(); ++i) {
+        int pos = tabla_hash::bucket(geo, regs[i].dni);
+        if (ultimo[pos] == NULL_OFFSET) primero[pos] = (long long)i;
+        regs[i].pos_siguiente = ultimo[pos];
+        ultimo[pos] = offset;
+        offset += sizeof(RegistroClinico);
     }
+}
+
+// Trozo de trabajo: rango nominal de bytes [ini, fin) de un CSV. Cada línea
+// pertenece al trozo donde comienza (ver csv_mmap::alinearInicio).
+struct Trozo {
+    int archivo;
+    long long ini;
+    long long fin;
+};
+
+// Divide el tramo [desdes[i], tams[i]) de cada archivo en trozos de hasta
+// `bytes_trozo` y los ordena de mayor a menor tamaño (reparto tipo LPT: los
+// trozos grandes salen primero)
+std::vector<Trozo> planificarTrozos(const std::vector<long long> &tams, const std::vector<long long> &desdes,
+                                    long long bytes_trozo)
+{
+    std::vector<Trozo> trozos;
+    if (bytes_trozo <= 0) bytes_trozo = 64LL * 1024 * 1024;
+    for (size_t i = 0; i < tams.size(); ++i) {
+        for (long long ini = desdes[i]; ini < tams[i]; ini += bytes_trozo)
+            trozos.push_back({(int)i, ini, std::min(tams[i], ini + bytes_trozo)});
+    }
+    std::stable_sort(trozos.begin(), trozos.end(), [](const Trozo &a, const Trozo &b) {
+        return (a.fin - a.ini) > (b.fin - b.ini);
+    });
+    return trozos;
+}
+
+// Manifiesto de CSV ya cargados, usado por --incremental. Una línea por archivo:
+// "tamaño,mtime_ns,checksum,cola,ruta" (la ruta va al final por si contiene
+// comas). `cola` es el FNV-1a de los últimos BYTES_COLA bytes: un CSV que creció
+// se acepta comparando solo esa cola, sin releer el prefijo. Los manifiestos
+// viejos ("tamaño,mtime_ns,checksum,ruta") se leen sin cola.
+static const char *RUTA_MANIFIESTO = "manifiesto_carga.csv";
+static const unsigned long long FNV_BASE = 14695981039346656037ULL;
+static const long long BYTES_COLA = 4096;
+
+struct EntradaManifiesto {
+    long long tam = 0;
+    long long mtime = 0;
+    unsigned long long suma = FNV_BASE;
+    unsigned long long cola = 0;
+    bool con_cola = false;
+};
+
+std::map<std::string, EntradaManifiesto> leerManifiesto(const std::string &ruta)
+{
+    std::map<std::string, EntradaManifiesto> m;
+    std::ifstream in(ruta);
     std::string linea;
-    // Descarta cabecera
-    if (!std::getline(in, linea)) return lines;
+    if (!std::getline(in, linea)) return m; // cabecera
+    const bool con_cola = linea.find(",cola,") != std::string::npos;
     while (std::getline(in, linea)) {
-        if (!linea.empty()) lines.push_back(linea);
+        size_t c1 = linea.find(','), c2 = linea.find(',', c1 + 1), c3 = linea.find(',', c2 + 1);
+        if (c1 == std::string::npos || c2 == std::string::npos || c3 == std::string::npos) continue;
+        EntradaManifiesto e;
+        e.tam = std::atoll(linea.substr(0, c1).c_str());
+        e.mtime = std::atoll(linea.substr(c1 + 1, c2 - c1 - 1).c_str());
+        e.suma = std::strtoull(linea.substr(c2 + 1, c3 - c2 - 1).c_str(), nullptr, 16);
+        size_t ini_ruta = c3 + 1;
+        if (con_cola) {
+            size_t c4 = linea.find(',', c3 + 1);
+            if (c4 == std::string::npos) continue;
+            e.cola = std::strtoull(linea.substr(c3 + 1, c4 - c3 - 1).c_str(), nullptr, 16);
+            e.con_cola = true;
+            ini_ruta = c4 + 1;
+        }
+        m[linea.substr(ini_ruta)] = e;
+    }
+    return m;
+}
+
+// Escribe el manifiesto en un temporal y lo renombra (reemplazo atómico)
+bool escribirManifiesto(const std::string &ruta, const std::map<std::string, EntradaManifiesto> &m)
+{
+    std::string tmp = ruta + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << "tamano,mtime_ns,checksum,cola,ruta\n";
+        for (auto &kv : m) {
+            char suma[17], cola[17];
+            std::snprintf(suma, sizeof(suma), "%016llx", kv.second.suma);
+            std::snprintf(cola, sizeof(cola), "%016llx", kv.second.cola);
+            out << kv.second.tam << ',' << kv.second.mtime << ',' << suma << ',' << cola << ',' << kv.first << '\n';
+        }
+        if (!out) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, ruta, ec);
+    return !ec;
+}
+
+// mtime en nanosegundos (0 si no se puede leer)
+long long mtimeNs(const std::string &ruta)
+{
+    struct stat st;
+    if (::stat(ruta.c_str(), &st) != 0) return 0;
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+// FNV-1a 64 de los bytes [desde, hasta) continuando desde el estado `h`. Como el
+// estado es el propio hash, el checksum de un CSV que creció se obtiene
+// continuando el guardado solo sobre los bytes nuevos.
+unsigned long long fnv1aArchivo(const std::string &ruta, long long desde, long long hasta, unsigned long long h)
+{
+    int fd = ::open(ruta.c_str(), O_RDONLY);
+    if (fd < 0) return h;
+    std::vector<unsigned char> buf(1 << 20);
+    for (long long p = desde; p < hasta;) {
+        ssize_t n = ::pread(fd, buf.data(), (size_t)std::min<long long>((long long)buf.size(), hasta - p), p);
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; ++i) {
+            h ^= buf[i];
+            h *= 1099511628211ULL;
+        }
+        p += n;
+    }
+    ::close(fd);
+    return h;
+}
+
+// Checksum de la cola del prefijo [0, tam): sus últimos BYTES_COLA bytes
+unsigned long long colaArchivo(const std::string &ruta, long long tam)
+{
+    return fnv1aArchivo(ruta, std::max(0LL, tam - BYTES_COLA), tam, FNV_BASE);
+}
+
+// Primer inicio de línea >= pos leyendo con pread (equivale a csv_mmap::alinearInicio)
+long long alinearInicioFd(int fd, long long tam, long long pos)
+{
+    if (pos <= 0) return 0;
+    if (pos >= tam) return tam;
+    std::vector<char> buf(64 * 1024);
+    long long p = pos - 1;
+    while (p < tam) {
+        ssize_t n = ::pread(fd, buf.data(), (size_t)std::min<long long>((long long)buf.size(), tam - p), p);
+        if (n <= 0) return tam;
+        const char *nl = csv_mmap::buscarByte(buf.data(), buf.data() + n, '\n');
+        if (nl != buf.data() + n) return p + (nl - buf.data()) + 1;
+        p += n;
+    }
+    return tam;
+}
+
+// Lee las líneas que pertenecen al trozo en buffers de ~`bytes_bloque` que
+// siempre terminan en fin de línea y los entrega a `cola`. La cabecera se
+// descarta en el trozo que empieza en el byte 0.
+void leerTrozo(const std::string &ruta, const Trozo &tz, size_t bytes_bloque, ColaAcotada<std::vector<char>> &cola)
+{
+    int fd = ::open(ruta.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "No se pudo abrir " << ruta << std::endl;
+        return;
+    }
+    long long tam = (long long)::lseek(fd, 0, SEEK_END);
+    long long desde = alinearInicioFd(fd, tam, tz.ini == 0 ? 1 : tz.ini);
+    long long hasta = alinearInicioFd(fd, tam, tz.fin);
+    ::posix_fadvise(fd, desde, hasta - desde, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<char> pendiente; // resto de línea incompleta del buffer anterior
+    long long p = desde;
+    while (p < hasta) {
+        // el resto pendiente queda al principio; la reserva es de buf (pendiente
+        // no retiene un buffer entero mientras buf espera lugar en la cola)
+        std::vector<char> buf;
+        buf.swap(pendiente);
+        size_t previo = buf.size();
+        buf.reserve(std::max(bytes_bloque, previo + 1));
+        size_t quiero = (size_t)std::min<long long>((long long)std::max(bytes_bloque, previo + 1) - (long long)previo, hasta - p);
+        buf.resize(previo + quiero);
+        ssize_t n = ::pread(fd, buf.data() + previo, quiero, p);
+        if (n <= 0) {
+            std::cerr << "Error leyendo " << ruta << std::endl;
+            break;
+        }
+        buf.resize(previo + (size_t)n);
+        p += n;
+        if (p < hasta) {
+            // Cortar en el último '\n'; lo que sigue pasa al próximo buffer
+            size_t corte = buf.size();
+            while (corte > 0 && buf[corte - 1] != '\n') --corte;
+            if (corte == 0) { pendiente.swap(buf); continue; } // línea más larga que el buffer
+            pendiente.assign(buf.begin() + corte, buf.end());
+            buf.resize(corte);
+        }
+        if (!cola.insertar(std::move(buf))) break;
+    }
+    ::close(fd);
+}
+
+// Parsea un buffer de líneas completas en bloques de como máximo
+// `max_registros` registros. Cada segmento se cuenta primero y luego se parsea
+// en paralelo con OpenMP directamente sobre el bloque de destino.
+void parsearBuffer(const std::vector<char> &texto, size_t max_registros,
+                   ColaAcotada<std::vector<RegistroClinico>> &cola)
+{
+    const char *datos = texto.data();
+    const char *fin = datos + texto.size();
+    const char *seg = datos;
+    int hilos = omp_get_max_threads();
+    while (seg < fin) {
+        // Segmento con a lo sumo max_registros líneas (registros <= líneas)
+        const char *fin_seg = seg;
+        for (size_t k = 0; k < max_registros && fin_seg < fin; ++k)
+            fin_seg = csv_mmap::buscarByte(fin_seg, fin, '\n') + 1;
+        if (fin_seg > fin) fin_seg = fin;
+        size_t tam = (size_t)(fin_seg - seg);
+        size_t paso = tam / (size_t)hilos;
+
+        std::vector<size_t> cuenta(hilos + 1, 0);
+#pragma omp parallel for schedule(static, 1)
+        for (int h = 0; h < hilos; ++h) {
+            size_t a = paso * h, b = (h == hilos - 1) ? tam : paso * (h + 1);
+            cuenta[h + 1] = csv_mmap::contarRango(seg, tam, a, b, false);
+        }
+        for (int h = 0; h < hilos; ++h) cuenta[h + 1] += cuenta[h];
+        std::vector<RegistroClinico> bloque(cuenta[hilos]);
+#pragma omp parallel for schedule(static, 1)
+        for (int h = 0; h < hilos; ++h) {
+            size_t a = paso * h, b = (h == hilos - 1) ? tam : paso * (h + 1);
+            csv_mmap::parsearRangoEn(seg, tam, a, b, false, bloque.data() + cuenta[h]);
+        }
+        if (!bloque.empty() && !cola.insertar(std::move(bloque))) return;
+        seg = fin_seg;
+    }
+}
+
+// Hints de MPI-IO para las escrituras colectivas (el llamador libera el info)
+MPI_Info crearInfoEscritura(const std::string &cb_modo, long long cb_buffer_mb)
+{
+    MPI_Info info;
+    MPI_Info_create(&info);
+    if (!cb_modo.empty()) MPI_Info_set(info, "romio_cb_write", cb_modo.c_str());
+    if (cb_buffer_mb > 0) MPI_Info_set(info, "cb_buffer_size", std::to_string(cb_buffer_mb * 1024 * 1024).c_str());
+    return info;
+}
+
+// Carga completa con tabla que crece: si la carga final supera carga_max se
+// reenlazan todas las cadenas de registros.dat para `num_buckets` buckets (en
+// vez de dividir bucket por bucket). Cada rank enlaza en el lugar su porción
+// contigua de registros; luego un Exscan entrega a cada rank, por bucket, el
+// último registro de los ranks previos y se parchea el `pos_siguiente` del
+// primero propio (una escritura colectiva de 8 bytes por bucket). En
+// `cabezas` deja, en todos los ranks, la cabeza final de cada bucket.
+bool redimensionarCadenas(long long bytes_total, long long num_buckets, size_t max_registros,
+                          int rank, int size, std::vector<long long> &cabezas)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = bytes_total / sz;
+    const long long desde = n * rank / size, hasta = n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+    const int nb = (int)num_buckets;
+    const tabla_hash::Geometria geo{num_buckets, num_buckets};
+
+    MPI_File f;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDWR, MPI_INFO_NULL, &f) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para redimensionar la tabla" << std::endl;
+        return false;
+    }
+    bool ok = true;
+    std::vector<long long> ultimo(nb, NULL_OFFSET), primero(nb, NULL_OFFSET);
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        MPI_Status st;
+        if (MPI_File_read_at(f, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) != MPI_SUCCESS) {
+            ok = false;
+            break;
+        }
+        for (long long k = 0; k < cuantos; ++k) {
+            int b = tabla_hash::bucket(geo, buf[(size_t)k].dni);
+            long long off = (i + k) * sz;
+            if (ultimo[b] == NULL_OFFSET) primero[b] = off;
+            buf[(size_t)k].pos_siguiente = ultimo[b];
+            ultimo[b] = off;
+        }
+        if (MPI_File_write_at(f, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) != MPI_SUCCESS)
+            ok = false;
+    }
+
+    // Costura entre ranks
+    MPI_Op op_ultimo;
+    MPI_Op_create(&opUltimoNoNulo, 0, &op_ultimo);
+    std::vector<long long> entrante(nb, NULL_OFFSET);
+    MPI_Exscan(ultimo.data(), entrante.data(), nb, MPI_LONG_LONG, op_ultimo, MPI_COMM_WORLD);
+    if (rank == 0) std::fill(entrante.begin(), entrante.end(), NULL_OFFSET);
+    // (offset del pos_siguiente, valor), ordenados: la vista hindexed exige desplazamientos crecientes
+    std::vector<std::pair<long long, long long>> parches;
+    for (int b = 0; b < nb; ++b)
+        if (primero[b] != NULL_OFFSET && entrante[b] != NULL_OFFSET)
+            parches.emplace_back(primero[b] + (long long)offsetof(RegistroClinico, pos_siguiente), entrante[b]);
+    std::sort(parches.begin(), parches.end());
+    std::vector<MPI_Aint> desplaz_ord(parches.size());
+    std::vector<long long> valores_ord(parches.size());
+    for (size_t k = 0; k < parches.size(); ++k) {
+        desplaz_ord[k] = (MPI_Aint)parches[k].first;
+        valores_ord[k] = parches[k].second;
+    }
+    MPI_Datatype vista = MPI_BYTE;
+    if (!desplaz_ord.empty()) {
+        MPI_Type_create_hindexed_block((int)desplaz_ord.size(), (int)sizeof(long long), desplaz_ord.data(), MPI_BYTE, &vista);
+        MPI_Type_commit(&vista);
+    }
+    MPI_File_set_view(f, 0, MPI_BYTE, vista, "native", MPI_INFO_NULL);
+    MPI_Status st;
+    if (MPI_File_write_all(f, valores_ord.empty() ? nullptr : valores_ord.data(),
+                           (int)(valores_ord.size() * sizeof(long long)), MPI_BYTE, &st) != MPI_SUCCESS) ok = false;
+    if (vista != MPI_BYTE) MPI_Type_free(&vista);
+    MPI_File_close(&f);
+
+    cabezas.assign(nb, NULL_OFFSET);
+    MPI_Allreduce(ultimo.data(), cabezas.data(), nb, MPI_LONG_LONG, op_ultimo, MPI_COMM_WORLD);
+    MPI_Op_free(&op_ultimo);
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return ok_todos != 0;
+}
+
+// Reescribe registros.dat (`bytes_total` bytes) con layout agrupado: los
+// registros de cada bucket quedan contiguos y en orden de cadena (cabeza
+// primero), así una búsqueda lee un solo tramo secuencial. Cada rank procesa
+// una porción contigua del archivo en dos pasadas:
+//   1. histograma por bucket; con Allreduce/Exscan cada rank conoce el inicio
+//      de cada bucket en el archivo nuevo y cuántos registros suyos van antes.
+//   2. calcula el slot destino de cada registro, reescribe `pos_siguiente` y
+//      escribe por rondas con una vista (hindexed) y MPI_File_write_all.
+// El orden nuevo de cada cadena es: los registros fuera del tramo previo del
+// bucket en orden inverso de archivo seguidos de los que ya estaban agrupados,
+// en su orden. Para las cargas y las altas al final coincide con el de la
+// cadena previa (se anteponen a la cabeza), pero no para las inserciones que
+// reusaron una lápida (libres::tomar) ni tras dividir buckets: el agrupado
+// conserva los registros de cada bucket, no el orden de su cadena, y nadie
+// debe identificar un registro por su posición en ella (gestor_dni y la GUI
+// eligen por offset). `cabezas`, `ext_offset` y `ext_count` describen las
+// cadenas finales (tramos vacíos en carga completa) y `geo` su tamaño. Solo se
+// conservan los registros vivos alcanzables desde esas cadenas: los sueltos
+// (escritos por la GUI sin que su alta llegara al diario) no se reviven; con
+// `cabezas` vacío (carga completa: todo quedó enlazado) no se filtra. Las
+// lápidas (registros_libres.h) van juntas al final, enlazadas como lista de
+// libres. Deja en `bytes_total` el tamaño nuevo y en el rank 0, en `tabla`, la
+// tabla v2 resultante.
+bool agruparRegistros(long long &bytes_total, const tabla_hash::Geometria &geo, int32_t carga_max,
+                      const std::vector<long long> &cabezas, const std::vector<long long> &ext_offset,
+                      const std::vector<long long> &ext_count, size_t max_registros, MPI_Info info, int rank,
+                      int size, tabla_hash::Tabla &tabla)
+{
+    const int nb = (int)geo.num_buckets;
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = bytes_total / sz;
+    const long long desde = n * rank / size, hasta = n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+    auto enTramo = [&](int b, long long off) {
+        return b < nb && ext_count[b] > 0 && off >= ext_offset[b] && off < ext_offset[b] + ext_count[b] * sz;
+    };
+    // Las lápidas forman un bucket extra (nb) detrás de todos los demás
+    auto bucketDe = [&](const RegistroClinico &r) { return esBorrado(r) ? nb : tabla_hash::bucket(geo, r.dni); };
+
+    // Pasada 0: cada rank recorre las cadenas de sus buckets (b % size) y marca
+    // los registros alcanzables; un OR colectivo junta el mapa en todos
+    const bool filtrar = !cabezas.empty();
+    std::vector<unsigned char> alcanzable(filtrar ? (size_t)((n + 7) / 8) : 0, 0);
+    if (filtrar) {
+        int fd = ::open("registros.dat", O_RDONLY);
+        auto leer = [&](long long off, void *dst, size_t bytes) {
+            return fd >= 0 && ::pread(fd, dst, bytes, (off_t)off) == (ssize_t)bytes;
+        };
+        for (int b = rank; b < nb; b += size) {
+            tabla_hash::recorrerBucket(HashExtent{cabezas[b], ext_offset[b], ext_count[b]}, n * sz, leer,
+                                       [&](long long off, const RegistroClinico &) {
+                                           alcanzable[(size_t)(off / sz / 8)] |= (unsigned char)(1u << (off / sz % 8));
+                                       });
+        }
+        if (fd >= 0) ::close(fd);
+        for (size_t k = 0; k < alcanzable.size(); k += (size_t)INT_MAX) {
+            int cuantos = (int)std::min(alcanzable.size() - k, (size_t)INT_MAX);
+            MPI_Allreduce(MPI_IN_PLACE, alcanzable.data() + k, cuantos, MPI_UNSIGNED_CHAR, MPI_BOR, MPI_COMM_WORLD);
+        }
+    }
+    auto suelto = [&](long long i, const RegistroClinico &r) {
+        return filtrar && !esBorrado(r) && !(alcanzable[(size_t)(i / 8)] & (1u << (i % 8)));
+    };
+
+    MPI_File fin;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para agrupar" << std::endl;
+        return false;
+    }
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    auto leerLote = [&](long long i, long long cuantos) {
+        MPI_Status st;
+        MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st);
+    };
+
+    // Pasada 1: histograma de registros fuera de tramo y dentro de tramo
+    std::vector<long long> hist(nb + 1, 0), en_tramo(nb + 1, 0);
+    for (long long i = desde; i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        leerLote(i, cuantos);
+        for (long long k = 0; k < cuantos; ++k) {
+            if (suelto(i + k, buf[(size_t)k])) continue;
+            int b = bucketDe(buf[(size_t)k]);
+            if (enTramo(b, (i + k) * sz)) ++en_tramo[b];
+            else ++hist[b];
+        }
+    }
+    std::vector<long long> total(nb + 1), total_tramo(nb + 1), antes(nb + 1, 0);
+    MPI_Allreduce(hist.data(), total.data(), nb + 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(en_tramo.data(), total_tramo.data(), nb + 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Exscan(hist.data(), antes.data(), nb + 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) std::fill(antes.begin(), antes.end(), 0);
+    std::vector<long long> inicio(nb + 1);
+    long long acum = 0;
+    for (int b = 0; b <= nb; ++b) {
+        inicio[b] = acum;
+        acum += total[b] + total_tramo[b];
+    }
+
+    MPI_File fout;
+    MPI_File_delete("registros_agrupado.tmp", MPI_INFO_NULL);
+    if (MPI_File_open(MPI_COMM_WORLD, "registros_agrupado.tmp", MPI_MODE_WRONLY | MPI_MODE_CREATE, info, &fout) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo crear registros_agrupado.tmp" << std::endl;
+        MPI_File_close(&fin);
+        return false;
+    }
+
+    // Pasada 2: mismas lecturas, cada registro a su slot. Todas las rondas son
+    // colectivas, así que los ranks con menos lotes escriben rondas vacías.
+    long long mis_rondas = (hasta - desde + lote - 1) / lote, rondas = 0;
+    MPI_Allreduce(&mis_rondas, &rondas, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    std::vector<long long> vistos(nb + 1, 0);
+    std::vector<std::pair<long long, size_t>> destino;
+    std::vector<RegistroClinico> salida;
+    std::vector<MPI_Aint> desplaz;
+    bool ok = true;
+    for (long long r = 0; r < rondas; ++r) {
+        long long i = desde + r * lote;
+        long long cuantos = std::max(0LL, std::min(lote, hasta - i));
+        if (cuantos > 0) leerLote(i, cuantos);
+        destino.clear();
+        for (long long k = 0; k < cuantos; ++k) {
+            if (suelto(i + k, buf[(size_t)k])) continue;
+            int b = bucketDe(buf[(size_t)k]);
+            long long off = (i + k) * sz;
+            long long slot;
+            if (enTramo(b, off)) {
+                slot = inicio[b] + total[b] + (off - ext_offset[b]) / sz;
+            } else {
+                // orden inverso de archivo (no necesariamente el de la cadena previa)
+                long long despues = total[b] - antes[b] - hist[b];
+                slot = inicio[b] + despues + (hist[b] - 1 - vistos[b]++);
+            }
+            bool ultimo = (slot == inicio[b] + total[b] + total_tramo[b] - 1);
+            buf[(size_t)k].pos_siguiente = ultimo ? NULL_OFFSET : (slot + 1) * sz;
+            destino.emplace_back(slot * sz, (size_t)k);
+        }
+        std::sort(destino.begin(), destino.end());
+        salida.resize(destino.size());
+        desplaz.resize(destino.size());
+        for (size_t k = 0; k < destino.size(); ++k) {
+            salida[k] = buf[destino[k].second];
+            desplaz[k] = (MPI_Aint)destino[k].first;
+        }
+
+        MPI_Datatype vista = MPI_BYTE;
+        if (!destino.empty()) {
+            MPI_Type_create_hindexed_block((int)destino.size(), (int)sz, desplaz.data(), MPI_BYTE, &vista);
+            MPI_Type_commit(&vista);
+        }
+        MPI_File_set_view(fout, 0, MPI_BYTE, vista, "native", MPI_INFO_NULL);
+        MPI_Status st;
+        if (MPI_File_write_all(fout, salida.empty() ? nullptr : salida.data(), (int)(salida.size() * sz),
+                               MPI_BYTE, &st) != MPI_SUCCESS) ok = false;
+        if (vista != MPI_BYTE) MPI_Type_free(&vista);
+    }
+    MPI_File_close(&fin);
+    MPI_File_close(&fout);
+    if (rank == 0 && acum < n)
+        std::cout << "Agrupado: " << (n - acum) << " registros sueltos (fuera de toda cadena) descartados" << std::endl;
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) {
+        if (rank == 0) std::cerr << "Error escribiendo registros_agrupado.tmp; registros.dat queda sin agrupar" << std::endl;
+        return false;
+    }
+    if (rank == 0) {
+        std::error_code ec;
+        std::filesystem::rename("registros_agrupado.tmp", "registros.dat", ec);
+        if (ec) {
+            std::cerr << "No se pudo reemplazar registros.dat: " << ec.message() << std::endl;
+            ok_local = 0;
+        }
+        tabla = tabla_hash::tablaVacia(LAYOUT_AGRUPADO, nb, carga_max);
+        tabla.buckets_base = geo.buckets_base;
+        tabla.num_registros = acum - total[nb];
+        for (int b = 0; b < nb; ++b) {
+            long long cuenta = total[b] + total_tramo[b];
+            if (cuenta == 0) continue;
+            tabla.entradas[b] = HashExtent{inicio[b] * sz, inicio[b] * sz, cuenta};
+        }
+        // La lista de libres pasa a ser el tramo final de lápidas
+        if (total[nb] > 0) libres::guardar("registros.dat", libres::cabecera(inicio[nb] * sz, total[nb]));
+        else ::unlink(libres::rutaLibres("registros.dat").c_str());
+    }
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (ok_local) bytes_total = acum * sz;
+    return ok_local != 0;
+}
+
+// Genera edad.col, dni.col y fecha.col a partir de registros.dat ya final
+// (`bytes_total` bytes). Cada rank convierte una porción contigua de registros
+// y escribe su tramo de cada columna (fila i en cabecera + i * ancho); al final
+// el rank 0 escribe las cabeceras con el tamaño/mtime de registros.dat, que es
+// lo que las marca como frescas. En incremental, si las columnas estaban
+// frescas para registros.dat antes de la carga (`bytes_base`, `mtime_base`),
+// solo se agregan las filas de los registros nuevos; si no, se generan completas.
+bool generarColumnas(long long bytes_base, long long mtime_base, long long bytes_total, size_t max_registros, int rank,
+                     int size)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = bytes_total / sz;
+    const long long lote = (long long)max_registros;
+    const MPI_Offset base = (MPI_Offset)sizeof(columnas::CabeceraColumna);
+    const char *nombres[3] = {"edad", "dni", "fecha"};
+
+    long long agregar[3] = {0, 0, 0}; // {modo, escapes previos de edad, de fecha}
+    if (rank == 0 && bytes_base > 0) {
+        columnas::CabeceraColumna cab[3];
+        bool frescas = true;
+        for (int c = 0; c < 3; ++c)
+            frescas = frescas && columnas::leerCabecera("registros.dat", nombres[c], cab[c]) &&
+                      cab[c].tam_registros == bytes_base && cab[c].mtime_registros == mtime_base &&
+                      cab[c].num_registros == bytes_base / sz;
+        if (frescas) {
+            agregar[0] = 1;
+            agregar[1] = cab[0].escapes;
+            agregar[2] = cab[2].escapes;
+        }
+    }
+    MPI_Bcast(agregar, 3, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    const long long desde_reg = agregar[0] ? bytes_base / sz : 0;
+    const long long desde = desde_reg + (n - desde_reg) * rank / size, hasta = desde_reg + (n - desde_reg) * (rank + 1) / size;
+
+    MPI_File fin;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para generar columnas" << std::endl;
+        return false;
+    }
+    MPI_File fcol[3];
+    bool ok = true;
+    for (int c = 0; c < 3; ++c) {
+        std::string ruta = columnas::rutaColumna("registros.dat", nombres[c]);
+        if (!agregar[0]) MPI_File_delete(ruta.c_str(), MPI_INFO_NULL);
+        ok = MPI_File_open(MPI_COMM_WORLD, ruta.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fcol[c]) == MPI_SUCCESS && ok;
+    }
+
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    columnas::LoteColumnas cols;
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        MPI_Status st;
+        ok = MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) == MPI_SUCCESS;
+        if (!ok) break;
+        cols.convertir(buf.data(), (size_t)cuantos);
+        ok = MPI_File_write_at(fcol[0], base + (MPI_Offset)i, cols.edad.data(), (int)cuantos, MPI_BYTE, &st) == MPI_SUCCESS &&
+             MPI_File_write_at(fcol[1], base + (MPI_Offset)(i * 4), cols.dni.data(), (int)(cuantos * 4), MPI_BYTE, &st) == MPI_SUCCESS &&
+             MPI_File_write_at(fcol[2], base + (MPI_Offset)(i * 4), cols.fecha.data(), (int)(cuantos * 4), MPI_BYTE, &st) == MPI_SUCCESS;
+    }
+    MPI_File_close(&fin);
+    for (int c = 0; c < 3; ++c) MPI_File_close(&fcol[c]);
+
+    long long locales[3] = {ok ? 0LL : 1LL, cols.escapes_edad, cols.escapes_fecha}, globales[3] = {0, 0, 0};
+    MPI_Allreduce(locales, globales, 3, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (globales[0] != 0) {
+        if (rank == 0) std::cerr << "Error generando columnas; los análisis leerán registros.dat" << std::endl;
+        return false;
+    }
+    int ok_cab = 1;
+    if (rank == 0)
+        ok_cab = columnas::escribirCabeceras("registros.dat", n, agregar[1] + globales[1], agregar[2] + globales[2]) ? 1 : 0;
+    MPI_Bcast(&ok_cab, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_cab != 0;
+}
+
+// Genera la copia compacta v2 (registros_v2.dat, textos_v2.heap y
+// diccionario_v2.dat) del registros.dat final en dos pasadas por la porción
+// contigua de cada rank:
+//   1. frecuencias de medico/motivo/examenes; el rank 0 junta las de todos
+//      (Gatherv), arma el diccionario, lo guarda y lo difunde. Con las
+//      frecuencias cada rank sabe cuántos bytes de heap ocupará y con Exscan
+//      dónde empieza su tramo del heap.
+//   2. codifica y escribe filas (posición fija) y heap (su tramo).
+// La cabecera (que marca la copia como fresca) la escribe el rank 0 al final.
+// En incremental, si la copia estaba fresca para registros.dat antes de la
+// carga (`bytes_base`, `mtime_base`), los registros nuevos se codifican con el
+// diccionario existente (lo que no está en él va al heap) y se agregan filas y
+// heap al final; si no, se genera completa. Quien reenlazó registros previos
+// (divisiones, agrupado) pasa `bytes_base` 0: sus filas guardan `siguiente`.
+bool generarRegistroV2(long long bytes_base, long long mtime_base, long long bytes_total, size_t max_registros,
+                       int rank, int size)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = bytes_total / sz;
+    const long long lote = (long long)max_registros;
+
+    long long agregar[2] = {0, 0}; // {modo, tamaño del heap existente}
+    if (rank == 0 && bytes_base > 0) {
+        registro_v2::Almacen previo;
+        if (previo.abrir("registros.dat", false) && previo.cabecera().tam_registros == bytes_base &&
+            previo.cabecera().mtime_registros == mtime_base && previo.cabecera().num_registros == bytes_base / sz) {
+            agregar[0] = 1;
+            agregar[1] = previo.cabecera().tam_heap;
+        }
+    }
+    MPI_Bcast(agregar, 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    const long long desde_reg = agregar[0] ? bytes_base / sz : 0;
+    const long long desde = desde_reg + (n - desde_reg) * rank / size, hasta = desde_reg + (n - desde_reg) * (rank + 1) / size;
+
+    MPI_File fin;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para generar v2" << std::endl;
+        return false;
+    }
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    bool ok = true;
+    auto leerLote = [&](long long i, long long cuantos) {
+        MPI_Status st;
+        return MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) == MPI_SUCCESS;
+    };
+
+    registro_v2::Diccionario dic;
+    long long heap_local = 0;
+    if (agregar[0]) {
+        // Pasada 1 con el diccionario existente: bytes de heap de los registros nuevos
+        ok = dic.cargar(registro_v2::rutaDiccionario("registros.dat"));
+        for (long long i = desde; ok && i < hasta; i += lote) {
+            long long cuantos = std::min(lote, hasta - i);
+            ok = leerLote(i, cuantos);
+            for (long long k = 0; ok && k < cuantos; ++k)
+                heap_local += (long long)registro_v2::bytesHeap(buf[(size_t)k], dic);
+        }
+    } else {
+        // Pasada 1: frecuencias y bytes de heap que no dependen del diccionario
+        registro_v2::Frecuencias frec;
+        registro_v2::Diccionario vacio;
+        long long heap_base = 0; // heap de cada registro si ningún valor estuviera en el diccionario
+        for (long long i = desde; ok && i < hasta; i += lote) {
+            long long cuantos = std::min(lote, hasta - i);
+            ok = leerLote(i, cuantos);
+            for (long long k = 0; ok && k < cuantos; ++k) {
+                frec.agregar(buf[(size_t)k]);
+                heap_base += (long long)registro_v2::bytesHeap(buf[(size_t)k], vacio);
+            }
+        }
+
+        // Diccionario global en el rank 0
+        std::string local = frec.serializar();
+        int tam_local = (int)local.size();
+        std::vector<int> tams(rank == 0 ? size : 0), desplaz(rank == 0 ? size : 0);
+        MPI_Gather(&tam_local, 1, MPI_INT, rank == 0 ? tams.data() : nullptr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        std::string todos;
+        if (rank == 0) {
+            long long total = 0;
+            for (int r = 0; r < size; ++r) {
+                desplaz[r] = (int)total;
+                total += tams[r];
+            }
+            todos.resize((size_t)total);
+        }
+        MPI_Gatherv(local.data(), tam_local, MPI_CHAR, rank == 0 ? &todos[0] : nullptr, tams.data(), desplaz.data(),
+                    MPI_CHAR, 0, MPI_COMM_WORLD);
+        std::string dic_serial;
+        if (rank == 0) {
+            registro_v2::Frecuencias global;
+            for (int r = 0; r < size; ++r) global.deserializar(todos.data() + desplaz[r], (size_t)tams[r]);
+            registro_v2::Diccionario d = registro_v2::Diccionario::construir(global);
+            dic_serial = d.serializar();
+            if (!d.guardar(registro_v2::rutaDiccionario("registros.dat"))) ok = false;
+        }
+        int tam_dic = (int)dic_serial.size();
+        MPI_Bcast(&tam_dic, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        dic_serial.resize((size_t)tam_dic);
+        MPI_Bcast(&dic_serial[0], tam_dic, MPI_CHAR, 0, MPI_COMM_WORLD);
+        ok = dic.deserializar(dic_serial) && ok;
+
+        // Heap de este rank: cada valor que entró al diccionario deja de ocupar 1 + largo bytes
+        heap_local = heap_base;
+        for (int c = 0; c < registro_v2::NUM_COLUMNAS_DIC; ++c)
+            for (auto &kv : frec.col[c])
+                if (dic.id(c, kv.first) != registro_v2::ID_EN_HEAP) heap_local -= kv.second * (1 + (long long)kv.first.size());
+    }
+    long long heap_inicio = 0, heap_total = 0;
+    MPI_Exscan(&heap_local, &heap_inicio, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) heap_inicio = 0;
+    MPI_Allreduce(&heap_local, &heap_total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    heap_inicio += agregar[1];
+    heap_total += agregar[1];
+
+    MPI_File ffilas, fheap;
+    std::string ruta_filas = registro_v2::rutaRegistros("registros.dat"), ruta_heap = registro_v2::rutaHeap("registros.dat");
+    if (!agregar[0]) {
+        MPI_File_delete(ruta_filas.c_str(), MPI_INFO_NULL);
+        MPI_File_delete(ruta_heap.c_str(), MPI_INFO_NULL);
+    }
+    bool abiertos = MPI_File_open(MPI_COMM_WORLD, ruta_filas.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &ffilas) == MPI_SUCCESS;
+    abiertos = MPI_File_open(MPI_COMM_WORLD, ruta_heap.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fheap) == MPI_SUCCESS && abiertos;
+    ok = ok && abiertos;
+
+    // Pasada 2: codificar y escribir
+    std::vector<registro_v2::RegistroCompacto> filas;
+    std::string heap;
+    long long heap_pos = heap_inicio;
+    const MPI_Offset base = (MPI_Offset)sizeof(registro_v2::CabeceraV2);
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        ok = leerLote(i, cuantos);
+        filas.resize((size_t)cuantos);
+        heap.clear();
+        for (long long k = 0; ok && k < cuantos; ++k) registro_v2::codificar(buf[(size_t)k], dic, heap_pos, filas[(size_t)k], heap);
+        MPI_Status st;
+        ok = ok && MPI_File_write_at(ffilas, base + (MPI_Offset)(i * (long long)sizeof(registro_v2::RegistroCompacto)), filas.data(),
+                                     (int)(cuantos * (long long)sizeof(registro_v2::RegistroCompacto)), MPI_BYTE, &st) == MPI_SUCCESS &&
+             MPI_File_write_at(fheap, (MPI_Offset)heap_pos, heap.data(), (int)heap.size(), MPI_BYTE, &st) == MPI_SUCCESS;
+        heap_pos += (long long)heap.size();
     }
-    return lines;
+    ok = ok && heap_pos == heap_inicio + heap_local;
+    MPI_File_close(&fin);
+    if (abiertos) {
+        MPI_File_close(&ffilas);
+        MPI_File_close(&fheap);
+    }
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) {
+        if (rank == 0) std::cerr << "Error generando la copia v2 de registros.dat" << std::endl;
+        return false;
+    }
+    if (rank == 0) ok_local = registro_v2::escribirCabecera("registros.dat", n, heap_total) ? 1 : 0;
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_local != 0;
+}
+
+// Agrega al delta `ruta_delta` de un índice (indice_fecha.h, indice_nombre.h)
+// las altas de los registros [desde_reg, hasta_reg): cada rank arma las de su
+// porción con `armar(registro, offset)` y las escribe tras las existentes, en
+// orden de offset como las de la GUI (así cuentan para la frescura del índice).
+// Devuelve en todos los ranks las entradas que quedan en el delta (o -1 si falló).
+template <typename DeltaT, typename ArmarFn>
+long long agregarAltasDelta(const std::string &ruta_delta, long long desde_reg, long long hasta_reg,
+                            size_t max_registros, int rank, int size, ArmarFn armar)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long ed = (long long)sizeof(DeltaT);
+    const long long n = hasta_reg - desde_reg;
+    const long long desde = desde_reg + n * rank / size, hasta = desde_reg + n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+
+    // Entradas previas completas (una escritura cortada de la GUI se pisa)
+    long long previas = 0;
+    if (rank == 0) previas = std::max(0LL, tamArchivo(ruta_delta)) / ed;
+    MPI_Bcast(&previas, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    MPI_File fin, fout;
+    bool ok = MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) == MPI_SUCCESS;
+    bool abierto = MPI_File_open(MPI_COMM_WORLD, ruta_delta.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL,
+                                 &fout) == MPI_SUCCESS;
+    ok = ok && abierto;
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    std::vector<DeltaT> altas(buf.size());
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        MPI_Status st;
+        ok = MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) == MPI_SUCCESS;
+        for (long long k = 0; ok && k < cuantos; ++k) altas[(size_t)k] = armar(buf[(size_t)k], (i + k) * sz);
+        ok = ok && MPI_File_write_at(fout, (MPI_Offset)((previas + i - desde_reg) * ed), altas.data(), (int)(cuantos * ed),
+                                     MPI_BYTE, &st) == MPI_SUCCESS;
+    }
+    MPI_File_close(&fin);
+    if (abierto) MPI_File_close(&fout);
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return ok_todos ? previas + n : -1;
+}
+
+// Genera indice_fecha.dat (indice_fecha.h) del registros.dat final con la misma
+// técnica que el layout agrupado: pasada 1 arma el histograma por día de la
+// porción de cada rank (Allreduce para el total, Exscan para lo anterior), y
+// pasada 2 escribe cada entrada (días, offset) en su posición ordenada en
+// rondas colectivas. El rank 0 escribe el nivel superior y, al final, la cabecera.
+// En incremental, si el índice cubría exactamente lo anterior a la carga
+// (`bytes_base`), los registros nuevos van a su delta como altas (y el delta se
+// fusiona en la base al superar UMBRAL_DELTA, como en las altas de la GUI); si
+// no, se construye completo.
+bool construirIndiceFecha(long long bytes_base, long long bytes_total, size_t max_registros, MPI_Info info, int rank,
+                          int size)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    int agregar = 0;
+    if (rank == 0 && bytes_base > 0) {
+        indice_fecha::Indice idx;
+        agregar = idx.abrir("registros.dat") && idx.cubre(bytes_base) ? 1 : 0;
+    }
+    MPI_Bcast(&agregar, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (agregar) {
+        long long entradas = agregarAltasDelta<indice_fecha::EntradaDelta>(
+            indice_fecha::rutaDelta("registros.dat"), bytes_base / sz, bytes_total / sz, max_registros, rank, size,
+            [](const RegistroClinico &r, long long off) {
+                return indice_fecha::EntradaDelta{columnas::fechaADias(r.fecha), indice_fecha::DELTA_ALTA, off};
+            });
+        int ok_local = entradas >= 0 ? 1 : 0;
+        if (rank == 0 && ok_local && entradas > indice_fecha::UMBRAL_DELTA) {
+            indice_fecha::Indice idx;
+            ok_local = idx.abrir("registros.dat") && idx.compactar() ? 1 : 0;
+        }
+        MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (!ok_local && rank == 0) std::cerr << "Error agregando las altas al índice por fecha" << std::endl;
+        return ok_local != 0;
+    }
+    const long long n = bytes_total / sz;
+    const long long desde = n * rank / size, hasta = n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+    const long long ent = (long long)sizeof(indice_fecha::Entrada);
+
+    MPI_File fin;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para el índice por fecha" << std::endl;
+        return false;
+    }
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    std::vector<int32_t> dias(buf.size());
+    bool ok = true;
+    auto leerLote = [&](long long i, long long cuantos) {
+        MPI_Status st;
+        bool leido = MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) == MPI_SUCCESS;
+        for (long long k = 0; k < cuantos; ++k) dias[(size_t)k] = columnas::fechaADias(buf[(size_t)k].fecha);
+        return leido;
+    };
+
+    // Pasada 1a: rango de días (para dimensionar el histograma)
+    int32_t rango_local[2] = {INT32_MAX, INT32_MAX}, rango[2]; // {mínimo, -máximo}
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        ok = leerLote(i, cuantos);
+        for (long long k = 0; k < cuantos; ++k) {
+            if (dias[(size_t)k] == columnas::FECHA_INVALIDA) continue;
+            rango_local[0] = std::min(rango_local[0], dias[(size_t)k]);
+            rango_local[1] = std::min(rango_local[1], -dias[(size_t)k]);
+        }
+    }
+    MPI_Allreduce(rango_local, rango, 2, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    const int32_t dmin = rango[0], dmax = -rango[1];
+    const size_t num_dias = (dmin <= dmax) ? (size_t)((long long)dmax - dmin + 1) : 0;
+
+    // Pasada 1b: histograma por día; sin_fecha va al final del vector
+    std::vector<long long> hist(num_dias + 1, 0);
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        ok = leerLote(i, cuantos);
+        for (long long k = 0; k < cuantos; ++k) {
+            int32_t d = dias[(size_t)k];
+            if (esBorrado(buf[(size_t)k])) continue; // las lápidas no tienen fecha ni cuentan como sin_fecha
+            ++hist[d == columnas::FECHA_INVALIDA ? num_dias : (size_t)(d - dmin)];
+        }
+    }
+    std::vector<long long> total(hist.size()), antes(hist.size(), 0);
+    MPI_Allreduce(hist.data(), total.data(), (int)hist.size(), MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Exscan(hist.data(), antes.data(), (int)hist.size(), MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) std::fill(antes.begin(), antes.end(), 0);
+    std::vector<long long> inicio(num_dias);
+    long long num_entradas = 0;
+    for (size_t d = 0; d < num_dias; ++d) {
+        inicio[d] = num_entradas;
+        num_entradas += total[d];
+    }
+
+    const std::string ruta = indice_fecha::rutaIndice("registros.dat"), tmp = ruta + ".tmp";
+    MPI_File fout;
+    MPI_File_delete(tmp.c_str(), MPI_INFO_NULL);
+    bool abierto = MPI_File_open(MPI_COMM_WORLD, tmp.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, info, &fout) == MPI_SUCCESS;
+    ok = ok && abierto;
+
+    // Pasada 2: cada entrada a su posición (rondas colectivas, como agruparRegistros)
+    long long mis_rondas = (hasta - desde + lote - 1) / lote, rondas = 0;
+    MPI_Allreduce(&mis_rondas, &rondas, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    std::vector<long long> vistos(num_dias, 0);
+    std::vector<std::pair<long long, indice_fecha::Entrada>> destino;
+    std::vector<indice_fecha::Entrada> salida;
+    std::vector<MPI_Aint> desplaz;
+    for (long long r = 0; abierto && r < rondas; ++r) {
+        long long i = desde + r * lote;
+        long long cuantos = std::max(0LL, std::min(lote, hasta - i));
+        if (cuantos > 0 && !leerLote(i, cuantos)) ok = false;
+        destino.clear();
+        for (long long k = 0; ok && k < cuantos; ++k) {
+            int32_t d = dias[(size_t)k];
+            if (d == columnas::FECHA_INVALIDA) continue;
+            size_t h = (size_t)(d - dmin);
+            long long slot = inicio[h] + antes[h] + vistos[h]++;
+            destino.emplace_back((long long)sizeof(indice_fecha::IndiceCabecera) + slot * ent,
+                                 indice_fecha::Entrada{d, (i + k) * sz});
+        }
+        std::sort(destino.begin(), destino.end(),
+                  [](const auto &a, const auto &b) { return a.first < b.first; });
+        salida.resize(destino.size());
+        desplaz.resize(destino.size());
+        for (size_t k = 0; k < destino.size(); ++k) {
+            salida[k] = destino[k].second;
+            desplaz[k] = (MPI_Aint)destino[k].first;
+        }
+
+        MPI_Datatype vista = MPI_BYTE;
+        if (!destino.empty()) {
+            MPI_Type_create_hindexed_block((int)destino.size(), (int)ent, desplaz.data(), MPI_BYTE, &vista);
+            MPI_Type_commit(&vista);
+        }
+        MPI_File_set_view(fout, 0, MPI_BYTE, vista, "native", MPI_INFO_NULL);
+        MPI_Status st;
+        if (MPI_File_write_all(fout, salida.empty() ? nullptr : salida.data(), (int)(salida.size() * ent),
+                               MPI_BYTE, &st) != MPI_SUCCESS) ok = false;
+        if (vista != MPI_BYTE) MPI_Type_free(&vista);
+    }
+    MPI_File_close(&fin);
+    if (abierto) MPI_File_close(&fout);
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) {
+        if (rank == 0) std::cerr << "Error generando el índice por fecha" << std::endl;
+        return false;
+    }
+    if (rank == 0) {
+        // Nivel superior: la fecha de cada PASO-ésima entrada, a partir del histograma global
+        const long long paso = indice_fecha::PASO_DEFECTO;
+        std::vector<int32_t> superior;
+        for (size_t d = 0; d < num_dias; ++d)
+            for (long long j = (inicio[d] + paso - 1) / paso * paso; j < inicio[d] + total[d]; j += paso)
+                superior.push_back(dmin + (int32_t)d);
+        indice_fecha::IndiceCabecera cab =
+            indice_fecha::cabecera(num_entradas, bytes_total, total[num_dias], (int32_t)paso);
+        int fd = ::open(tmp.c_str(), O_WRONLY);
+        size_t bytes_sup = superior.size() * sizeof(int32_t);
+        ok_local = fd >= 0 &&
+                   ::pwrite(fd, superior.data(), bytes_sup, (off_t)indice_fecha::offsetEntrada(num_entradas)) == (ssize_t)bytes_sup &&
+                   ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+        if (fd >= 0) ::close(fd);
+        ok_local = ok_local && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+        // El delta de inserciones anteriores ya está incluido en la base nueva
+        if (ok_local) ::unlink(indice_fecha::rutaDelta("registros.dat").c_str());
+    }
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_local != 0;
+}
+
+// Genera indice_nombre.dat (indice_nombre.h) del registros.dat final:
+//   1. histograma de claves por sus dos primeros bytes (65536 cubetas) en la
+//      porción de cada rank (Allreduce/Exscan, como agruparRegistros);
+//   2. cada entrada (clave, offset) se escribe sin codificar en la posición de
+//      su cubeta en un temporal (rondas colectivas);
+//   3. cada rank toma un rango contiguo de cubetas con ~n/size entradas, ordena
+//      cubeta por cubeta (memoria acotada por la cubeta más grande) y las
+//      codifica en bloques; con Exscan sabe dónde va su tramo codificado.
+// El rank 0 junta los directorios de bloques (Gatherv) y escribe directorio y cabecera.
+// En incremental, si el índice cubría exactamente lo anterior a la carga, los
+// registros nuevos van a su delta, como en construirIndiceFecha.
+bool construirIndiceNombre(long long bytes_base, long long bytes_total, size_t max_registros, MPI_Info info, int rank,
+                           int size)
+{
+    using indice_nombre::Entrada;
+    const int CUBETAS = 1 << 16;
+    const long long sz = (long long)sizeof(RegistroClinico);
+    int agregar = 0;
+    if (rank == 0 && bytes_base > 0) {
+        indice_nombre::Indice idx;
+        agregar = idx.abrir("registros.dat") && idx.cubre(bytes_base) ? 1 : 0;
+    }
+    MPI_Bcast(&agregar, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (agregar) {
+        long long entradas = agregarAltasDelta<indice_nombre::EntradaDelta>(
+            indice_nombre::rutaDelta("registros.dat"), bytes_base / sz, bytes_total / sz, max_registros, rank, size,
+            [](const RegistroClinico &r, long long off) {
+                return indice_nombre::EntradaDelta{indice_nombre::DELTA_ALTA, indice_nombre::entrada(r, off)};
+            });
+        int ok_local = entradas >= 0 ? 1 : 0;
+        if (rank == 0 && ok_local && entradas > indice_nombre::UMBRAL_DELTA) {
+            indice_nombre::Indice idx;
+            ok_local = idx.abrir("registros.dat") && idx.compactar() ? 1 : 0;
+        }
+        MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (!ok_local && rank == 0) std::cerr << "Error agregando las altas al índice por nombre" << std::endl;
+        return ok_local != 0;
+    }
+    const long long n = bytes_total / sz;
+    const long long desde = n * rank / size, hasta = n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+    const long long ent = (long long)sizeof(Entrada);
+    auto cubeta = [](const Entrada &e) { return ((uint8_t)e.clave[0] << 8) | (uint8_t)e.clave[1]; };
+
+    MPI_File fin;
+    if (MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) != MPI_SUCCESS) {
+        if (rank == 0) std::cerr << "No se pudo abrir registros.dat para el índice por nombre" << std::endl;
+        return false;
+    }
+    std::vector<RegistroClinico> buf((size_t)std::min(lote, std::max(1LL, hasta - desde)));
+    std::vector<Entrada> claves(buf.size());
+    bool ok = true;
+    auto leerLote = [&](long long i, long long cuantos) {
+        MPI_Status st;
+        bool leido = MPI_File_read_at(fin, (MPI_Offset)(i * sz), buf.data(), (int)(cuantos * sz), MPI_BYTE, &st) == MPI_SUCCESS;
+        for (long long k = 0; k < cuantos; ++k) {
+            claves[(size_t)k] = indice_nombre::entrada(buf[(size_t)k], (i + k) * sz);
+            if (esBorrado(buf[(size_t)k])) claves[(size_t)k].offset = NULL_OFFSET; // lápida: no se indexa
+        }
+        return leido;
+    };
+
+    // Pasada 1: histograma por cubeta
+    std::vector<long long> hist(CUBETAS, 0);
+    for (long long i = desde; ok && i < hasta; i += lote) {
+        long long cuantos = std::min(lote, hasta - i);
+        ok = leerLote(i, cuantos);
+        for (long long k = 0; k < cuantos; ++k)
+            if (claves[(size_t)k].offset != NULL_OFFSET) ++hist[cubeta(claves[(size_t)k])];
+    }
+    std::vector<long long> total(CUBETAS), antes(CUBETAS, 0), inicio(CUBETAS + 1, 0);
+    MPI_Allreduce(hist.data(), total.data(), CUBETAS, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Exscan(hist.data(), antes.data(), CUBETAS, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) std::fill(antes.begin(), antes.end(), 0);
+    for (int c = 0; c < CUBETAS; ++c) inicio[c + 1] = inicio[c] + total[c];
+
+    const std::string tmp_plano = "indice_nombre.plano.tmp";
+    MPI_File fplano;
+    MPI_File_delete(tmp_plano.c_str(), MPI_INFO_NULL);
+    bool abierto = MPI_File_open(MPI_COMM_WORLD, tmp_plano.c_str(), MPI_MODE_RDWR | MPI_MODE_CREATE, info, &fplano) == MPI_SUCCESS;
+    ok = ok && abierto;
+
+    // Pasada 2: cada entrada a su cubeta (rondas colectivas, como agruparRegistros)
+    long long mis_rondas = (hasta - desde + lote - 1) / lote, rondas = 0;
+    MPI_Allreduce(&mis_rondas, &rondas, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    std::vector<long long> vistos(CUBETAS, 0);
+    std::vector<std::pair<long long, size_t>> destino;
+    std::vector<Entrada> salida;
+    std::vector<MPI_Aint> desplaz;
+    for (long long r = 0; abierto && r < rondas; ++r) {
+        long long i = desde + r * lote;
+        long long cuantos = std::max(0LL, std::min(lote, hasta - i));
+        if (cuantos > 0 && !leerLote(i, cuantos)) ok = false;
+        destino.clear();
+        for (long long k = 0; ok && k < cuantos; ++k) {
+            if (claves[(size_t)k].offset == NULL_OFFSET) continue;
+            int c = cubeta(claves[(size_t)k]);
+            destino.emplace_back((inicio[c] + antes[c] + vistos[c]++) * ent, (size_t)k);
+        }
+        std::sort(destino.begin(), destino.end());
+        salida.resize(destino.size());
+        desplaz.resize(destino.size());
+        for (size_t k = 0; k < destino.size(); ++k) {
+            salida[k] = claves[destino[k].second];
+            desplaz[k] = (MPI_Aint)destino[k].first;
+        }
+
+        MPI_Datatype vista = MPI_BYTE;
+        if (!destino.empty()) {
+            MPI_Type_create_hindexed_block((int)destino.size(), (int)ent, desplaz.data(), MPI_BYTE, &vista);
+            MPI_Type_commit(&vista);
+        }
+        MPI_File_set_view(fplano, 0, MPI_BYTE, vista, "native", MPI_INFO_NULL);
+        MPI_Status st;
+        if (MPI_File_write_all(fplano, salida.empty() ? nullptr : salida.data(), (int)(salida.size() * ent),
+                               MPI_BYTE, &st) != MPI_SUCCESS) ok = false;
+        if (vista != MPI_BYTE) MPI_Type_free(&vista);
+    }
+    MPI_File_close(&fin);
+    if (abierto) {
+        MPI_File_set_view(fplano, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+        MPI_File_sync(fplano);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (abierto) MPI_File_sync(fplano);
+
+    // Pasada 3: cubetas de este rank (las que empiezan en su parte de las n entradas)
+    const long long n_idx = inicio[CUBETAS];
+    const int c_desde = (int)(std::lower_bound(inicio.begin(), inicio.end() - 1, n_idx * rank / size) - inicio.begin());
+    const int c_hasta = (int)(std::lower_bound(inicio.begin(), inicio.end() - 1, n_idx * (rank + 1) / size) - inicio.begin());
+    const int c_fin = (rank == size - 1) ? CUBETAS : c_hasta;
+    indice_nombre::Codificador cod;
+    std::vector<Entrada> cub;
+    for (int c = c_desde; ok && c < c_fin; ++c) {
+        cub.resize((size_t)total[c]);
+        for (long long k = 0; ok && k < total[c]; k += lote) {
+            long long cuantos = std::min(lote, total[c] - k);
+            MPI_Status st;
+            ok = MPI_File_read_at(fplano, (MPI_Offset)((inicio[c] + k) * ent), cub.data() + k, (int)(cuantos * ent),
+                                  MPI_BYTE, &st) == MPI_SUCCESS;
+        }
+        std::sort(cub.begin(), cub.end());
+        for (const Entrada &e : cub) cod.agregar(e);
+    }
+    if (abierto) MPI_File_close(&fplano);
+
+    // Tramo codificado de este rank y sus bloques
+    long long locales[2] = {(long long)cod.datos.size(), (long long)cod.directorio.size()}, previos[2] = {0, 0}, totales[2];
+    MPI_Exscan(locales, previos, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) previos[0] = previos[1] = 0;
+    MPI_Allreduce(locales, totales, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    const long long base = (long long)sizeof(indice_nombre::NombreCabecera) + previos[0];
+    for (auto &b : cod.directorio) b.offset += base;
+
+    const std::string ruta = indice_nombre::rutaIndice("registros.dat"), tmp = ruta + ".tmp";
+    MPI_File fout;
+    MPI_File_delete(tmp.c_str(), MPI_INFO_NULL);
+    abierto = MPI_File_open(MPI_COMM_WORLD, tmp.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, info, &fout) == MPI_SUCCESS;
+    ok = ok && abierto;
+    const long long TROZO = 1LL << 30;
+    for (long long k = 0; ok && k < (long long)cod.datos.size(); k += TROZO) {
+        long long cuantos = std::min(TROZO, (long long)cod.datos.size() - k);
+        MPI_Status st;
+        ok = MPI_File_write_at(fout, (MPI_Offset)(base + k), cod.datos.data() + k, (int)cuantos, MPI_BYTE, &st) == MPI_SUCCESS;
+    }
+    if (abierto) MPI_File_close(&fout);
+    std::string().swap(cod.datos);
+    if (rank == 0) MPI_File_delete(tmp_plano.c_str(), MPI_INFO_NULL);
+
+    // Directorio completo en el rank 0 (los rangos de cubetas están en orden de rank)
+    const int bd = (int)sizeof(indice_nombre::BloqueDir);
+    int bytes_dir = (int)cod.directorio.size() * bd;
+    std::vector<int> tams(rank == 0 ? size : 0), desp(rank == 0 ? size : 0);
+    MPI_Gather(&bytes_dir, 1, MPI_INT, rank == 0 ? tams.data() : nullptr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<indice_nombre::BloqueDir> directorio(rank == 0 ? (size_t)totales[1] : 0);
+    if (rank == 0)
+        for (int r = 0, acum = 0; r < size; ++r) {
+            desp[r] = acum;
+            acum += tams[r];
+        }
+    MPI_Gatherv(cod.directorio.data(), bytes_dir, MPI_BYTE, rank == 0 ? directorio.data() : nullptr, tams.data(),
+                desp.data(), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    int ok_local = ok ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) {
+        if (rank == 0) std::cerr << "Error generando el índice por nombre" << std::endl;
+        return false;
+    }
+    if (rank == 0) {
+        const long long off_dir = (long long)sizeof(indice_nombre::NombreCabecera) + totales[0];
+        indice_nombre::NombreCabecera cab = indice_nombre::cabecera(
+            n_idx, totales[1], bytes_total, off_dir, indice_nombre::POR_BLOQUE_DEFECTO);
+        size_t bytes = directorio.size() * sizeof(indice_nombre::BloqueDir);
+        int fd = ::open(tmp.c_str(), O_WRONLY);
+        ok_local = fd >= 0 && ::pwrite(fd, directorio.data(), bytes, (off_t)off_dir) == (ssize_t)bytes &&
+                   ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+        if (fd >= 0) ::close(fd);
+        ok_local = ok_local && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+        // El delta de inserciones anteriores ya está incluido en la base nueva
+        if (ok_local) ::unlink(indice_nombre::rutaDelta("registros.dat").c_str());
+    }
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_local != 0;
+}
+
+// Genera filtro_dni.dat (filtro_dni.h) del registros.dat final: cada rank marca
+// los DNI de su porción en un filtro local del tamaño completo y el rank 0 los
+// combina con un Reduce(BOR) por tramos. Si las columnas se acaban de generar
+// se leen los DNI de dni.col (4 bytes por registro en lugar del registro entero).
+// En incremental, si el filtro cubría exactamente lo anterior a la carga
+// (`bytes_base`) con los mismos bits por clave y le siguen alcanzando los bits
+// (hasta un 25% más de claves que aquellas para las que se dimensionó), solo se
+// marcan los DNI nuevos sobre el existente; si no, se construye completo.
+bool construirFiltroDni(long long bytes_base, long long bytes_total, size_t max_registros, int32_t bits_por_clave,
+                        bool desde_columna, int rank, int size)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = bytes_total / sz;
+    const long long lote = (long long)max_registros;
+
+    filtro_dni::Filtro filtro;
+    filtro_dni::FiltroCabecera cab{};
+    int agregar = 0;
+    if (rank == 0 && bytes_base > 0 && filtro.abrir("registros.dat") && filtro.cubre(bytes_base)) {
+        cab = filtro.cabecera();
+        long long claves = cab.num_claves + (n - bytes_base / sz);
+        agregar = cab.bits_por_clave == bits_por_clave &&
+                  filtro_dni::bloquesPara(claves, bits_por_clave) * 4 <= cab.num_bloques * 5 ? 1 : 0;
+    }
+    MPI_Bcast(&agregar, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    long long claves_previas = 0;
+    if (agregar) {
+        // El rank 0 marca sobre el filtro existente; los demás, sobre uno vacío de la misma geometría
+        MPI_Bcast(&cab, (int)sizeof(cab), MPI_BYTE, 0, MPI_COMM_WORLD);
+        claves_previas = cab.num_claves;
+        if (rank != 0) filtro.crear(cab);
+    } else {
+        filtro.crear(n, bits_por_clave);
+    }
+    const long long desde_reg = agregar ? bytes_base / sz : 0;
+    const long long desde = desde_reg + (n - desde_reg) * rank / size, hasta = desde_reg + (n - desde_reg) * (rank + 1) / size;
+    const std::string origen = desde_columna ? columnas::rutaColumna("registros.dat", "dni") : "registros.dat";
+    const long long base = desde_columna ? (long long)sizeof(columnas::CabeceraColumna) : 0;
+    const long long paso = desde_columna ? (long long)sizeof(int32_t) : sz;
+
+    MPI_File fin;
+    bool ok = MPI_File_open(MPI_COMM_WORLD, origen.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) == MPI_SUCCESS;
+    if (ok) {
+        std::vector<RegistroClinico> buf(desde_columna ? 0 : (size_t)std::min(lote, std::max(1LL, hasta - desde)));
+        std::vector<int32_t> dnis(desde_columna ? (size_t)std::min(lote, std::max(1LL, hasta - desde)) : 0);
+        for (long long i = desde; ok && i < hasta; i += lote) {
+            long long cuantos = std::min(lote, hasta - i);
+            void *destino = desde_columna ? (void *)dnis.data() : (void *)buf.data();
+            MPI_Status st;
+            ok = MPI_File_read_at(fin, (MPI_Offset)(base + i * paso), destino, (int)(cuantos * paso), MPI_BYTE, &st) == MPI_SUCCESS;
+            for (long long k = 0; ok && k < cuantos; ++k) {
+                int32_t dni = desde_columna ? dnis[(size_t)k] : buf[(size_t)k].dni;
+                if (dni != DNI_BORRADO) filtro.agregar(dni);
+            }
+        }
+        MPI_File_close(&fin);
+    }
+    int fallo_local = ok ? 0 : 1, fallo = 0;
+    MPI_Allreduce(&fallo_local, &fallo, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (fallo) {
+        if (rank == 0) std::cerr << "Error generando el filtro de DNI; las búsquedas recorrerán las cadenas" << std::endl;
+        if (rank == 0) ::unlink(filtro_dni::rutaFiltro("registros.dat").c_str());
+        return false;
+    }
+
+    std::vector<uint64_t> &palabras = filtro.palabras();
+    const size_t TRAMO = (size_t)1 << 24;
+    std::vector<uint64_t> combinado(rank == 0 ? std::min(TRAMO, palabras.size()) : 0);
+    for (size_t i = 0; i < palabras.size(); i += TRAMO) {
+        int cuantas = (int)std::min(TRAMO, palabras.size() - i);
+        MPI_Reduce(palabras.data() + i, rank == 0 ? combinado.data() : nullptr, cuantas, MPI_UINT64_T, MPI_BOR, 0,
+                   MPI_COMM_WORLD);
+        if (rank == 0) std::copy(combinado.begin(), combinado.begin() + cuantas, palabras.begin() + (long long)i);
+    }
+    int ok_local = 1;
+    if (rank == 0) {
+        ok_local = filtro.guardar("registros.dat", bytes_total, claves_previas + (n - desde_reg)) ? 1 : 0;
+    }
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_local != 0;
+}
+
+// Pares (dni, offset) de los registros [desde_reg, hasta_reg) que le tocan a este
+// rank, leídos de dni.col si está al día o de registros.dat
+bool leerParesDni(long long desde_reg, long long hasta_reg, size_t max_registros, bool desde_columna, int rank, int size,
+                  std::vector<std::pair<int32_t, long long>> &pares)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const long long n = hasta_reg - desde_reg;
+    const long long desde = desde_reg + n * rank / size, hasta = desde_reg + n * (rank + 1) / size;
+    const long long lote = (long long)max_registros;
+    const std::string origen = desde_columna ? columnas::rutaColumna("registros.dat", "dni") : "registros.dat";
+    const long long base = desde_columna ? (long long)sizeof(columnas::CabeceraColumna) : 0;
+    const long long paso = desde_columna ? (long long)sizeof(int32_t) : sz;
+
+    pares.clear();
+    pares.reserve((size_t)(hasta - desde));
+    MPI_File fin;
+    bool ok = MPI_File_open(MPI_COMM_WORLD, origen.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fin) == MPI_SUCCESS;
+    if (ok) {
+        std::vector<RegistroClinico> buf(desde_columna ? 0 : (size_t)std::min(lote, std::max(1LL, hasta - desde)));
+        std::vector<int32_t> dnis(desde_columna ? (size_t)std::min(lote, std::max(1LL, hasta - desde)) : 0);
+        for (long long i = desde; ok && i < hasta; i += lote) {
+            long long cuantos = std::min(lote, hasta - i);
+            void *destino = desde_columna ? (void *)dnis.data() : (void *)buf.data();
+            MPI_Status st;
+            ok = MPI_File_read_at(fin, (MPI_Offset)(base + i * paso), destino, (int)(cuantos * paso), MPI_BYTE, &st) == MPI_SUCCESS;
+            for (long long k = 0; ok && k < cuantos; ++k) {
+                int32_t dni = desde_columna ? dnis[(size_t)k] : buf[(size_t)k].dni;
+                if (dni != DNI_BORRADO) pares.emplace_back(dni, (i + k) * sz); // las lápidas no son de nadie
+            }
+        }
+        MPI_File_close(&fin);
+    }
+    return ok;
+}
+
+// Genera pacientes.dat (directorio_pacientes.h) del registros.dat final. Cada
+// par (dni, offset) va al rank dueño de su DNI (Alltoallv), que arma las listas
+// de sus pacientes y las escribe en la zona de listas a partir de su prefijo
+// (Exscan); el rank 0 junta los slots (24 bytes por paciente), los ubica en la
+// tabla y escribe cabecera y slots. En incremental, si el directorio cubría
+// exactamente lo anterior a la carga, solo se le agregan los registros nuevos
+// (así conserva las bajas de gestor_dni); si no, se construye completo.
+bool construirDirectorioPacientes(long long bytes_base, long long bytes_total, size_t max_registros, bool desde_columna,
+                                  int rank, int size)
+{
+    typedef std::pair<int32_t, long long> Par;
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const std::string ruta = pacientes::rutaDirectorio("registros.dat"), tmp = ruta + ".tmp";
+    auto fallar = [&](const char *que) {
+        if (rank == 0) {
+            std::cerr << "Error " << que << " el directorio de pacientes; las búsquedas recorrerán las cadenas" << std::endl;
+            ::unlink(ruta.c_str());
+        }
+        return false;
+    };
+
+    int agregar = 0;
+    if (rank == 0 && bytes_base > 0) {
+        pacientes::Directorio d;
+        agregar = d.abrir("registros.dat") && d.cabecera().tam_registros == bytes_base ? 1 : 0;
+    }
+    MPI_Bcast(&agregar, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<Par> pares;
+    int ok_local = leerParesDni(agregar ? bytes_base / sz : 0, bytes_total / sz, max_registros, desde_columna, rank,
+                                size, pares) ? 1 : 0, ok_todos = 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) return fallar("leyendo los DNI para");
+
+    MPI_Datatype tipo_par;
+    MPI_Type_contiguous((int)sizeof(Par), MPI_BYTE, &tipo_par);
+    MPI_Type_commit(&tipo_par);
+
+    if (agregar) {
+        // Altas nuevas al rank 0, que las suma al directorio existente
+        int cuantos = (int)pares.size();
+        std::vector<int> tams(rank == 0 ? size : 0), desp(rank == 0 ? size : 0);
+        MPI_Gather(&cuantos, 1, MPI_INT, rank == 0 ? tams.data() : nullptr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        long long total = 0;
+        if (rank == 0)
+            for (int r = 0; r < size; ++r) {
+                desp[r] = (int)total;
+                total += tams[r];
+            }
+        std::vector<Par> altas(rank == 0 ? (size_t)total : 0);
+        MPI_Gatherv(pares.data(), cuantos, tipo_par, rank == 0 ? altas.data() : nullptr, tams.data(), desp.data(),
+                    tipo_par, 0, MPI_COMM_WORLD);
+        MPI_Type_free(&tipo_par);
+        if (rank == 0) ok_local = pacientes::agregarLote("registros.dat", std::move(altas), bytes_total) ? 1 : 0;
+        MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        return ok_local ? true : fallar("actualizando");
+    }
+
+    // Reparto por dueño del DNI
+    std::vector<int> env(size, 0), rec(size, 0), desp_env(size, 0), desp_rec(size, 0);
+    auto duenio = [size](int32_t dni) { return (int)(pacientes::slotInicial(dni, 1LL << 30) % size); };
+    for (const Par &p : pares) ++env[duenio(p.first)];
+    MPI_Alltoall(env.data(), 1, MPI_INT, rec.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int r = 1; r < size; ++r) {
+        desp_env[r] = desp_env[r - 1] + env[r - 1];
+        desp_rec[r] = desp_rec[r - 1] + rec[r - 1];
+    }
+    std::vector<Par> salida(pares.size()), mios((size_t)(desp_rec[size - 1] + rec[size - 1]));
+    std::vector<int> pos(desp_env);
+    for (const Par &p : pares) salida[(size_t)pos[duenio(p.first)]++] = p;
+    std::vector<Par>().swap(pares);
+    MPI_Alltoallv(salida.data(), env.data(), desp_env.data(), tipo_par, mios.data(), rec.data(), desp_rec.data(),
+                  tipo_par, MPI_COMM_WORLD);
+    MPI_Type_free(&tipo_par);
+    std::vector<Par>().swap(salida);
+    std::sort(mios.begin(), mios.end());
+
+    // Listas de mis pacientes, contiguas y con la capacidad justa
+    std::vector<pacientes::Slot> slots;
+    std::vector<long long> listas(mios.size());
+    for (size_t i = 0; i < mios.size(); ++i) {
+        if (i == 0 || mios[i].first != mios[i - 1].first)
+            slots.push_back(pacientes::Slot{mios[i].first, 0, 0, 0, (long long)i});
+        ++slots.back().cantidad;
+        listas[i] = mios[i].second;
+    }
+    std::vector<Par>().swap(mios);
+    long long locales[2] = {(long long)slots.size(), (long long)listas.size()}, previos[2] = {0, 0}, totales[2];
+    MPI_Exscan(locales, previos, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) previos[0] = previos[1] = 0;
+    MPI_Allreduce(locales, totales, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    const long long ns = pacientes::slotsPara(totales[0]);
+    const long long base = pacientes::inicioListas(ns) + previos[1] * (long long)sizeof(long long);
+    for (pacientes::Slot &s : slots) {
+        s.capacidad = s.cantidad;
+        s.lista = base + s.lista * (long long)sizeof(long long);
+    }
+
+    MPI_File fout;
+    MPI_File_delete(tmp.c_str(), MPI_INFO_NULL);
+    bool abierto = MPI_File_open(MPI_COMM_WORLD, tmp.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fout) == MPI_SUCCESS;
+    bool ok = abierto;
+    const long long TROZO = 1LL << 27; // offsets por escritura (1 GiB)
+    for (long long k = 0; ok && k < (long long)listas.size(); k += TROZO) {
+        long long cuantos = std::min(TROZO, (long long)listas.size() - k);
+        MPI_Status st;
+        ok = MPI_File_write_at(fout, (MPI_Offset)(base + k * (long long)sizeof(long long)), listas.data() + k,
+                               (int)(cuantos * (long long)sizeof(long long)), MPI_BYTE, &st) == MPI_SUCCESS;
+    }
+    if (abierto) MPI_File_close(&fout);
+    std::vector<long long>().swap(listas);
+
+    // Slots en el rank 0
+    const int bs = (int)sizeof(pacientes::Slot);
+    int bytes_slots = (int)slots.size() * bs;
+    std::vector<int> tams(rank == 0 ? size : 0), desp(rank == 0 ? size : 0);
+    MPI_Gather(&bytes_slots, 1, MPI_INT, rank == 0 ? tams.data() : nullptr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<pacientes::Slot> todos(rank == 0 ? (size_t)totales[0] : 0);
+    if (rank == 0)
+        for (int r = 0, acum = 0; r < size; ++r) {
+            desp[r] = acum;
+            acum += tams[r];
+        }
+    MPI_Gatherv(slots.data(), bytes_slots, MPI_BYTE, rank == 0 ? todos.data() : nullptr, tams.data(), desp.data(),
+                MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    ok_local = ok ? 1 : 0;
+    MPI_Allreduce(&ok_local, &ok_todos, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!ok_todos) {
+        if (rank == 0) ::unlink(tmp.c_str());
+        return fallar("generando");
+    }
+    if (rank == 0) {
+        std::vector<pacientes::Slot> tabla((size_t)ns, pacientes::Slot{0, 0, 0, 0, 0});
+        for (const pacientes::Slot &s : todos) pacientes::ubicarEnTabla(tabla, s);
+        pacientes::PacientesCabecera cab = pacientes::cabecera(
+            ns, totales[0], bytes_total, pacientes::inicioListas(ns) + totales[1] * (long long)sizeof(long long));
+        size_t bytes = tabla.size() * sizeof(pacientes::Slot);
+        int fd = ::open(tmp.c_str(), O_WRONLY);
+        ok_local = fd >= 0 && ::pwrite(fd, tabla.data(), bytes, (off_t)sizeof(cab)) == (ssize_t)bytes &&
+                   ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+        if (fd >= 0) ::close(fd);
+        ok_local = ok_local && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+    }
+    MPI_Bcast(&ok_local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return ok_local ? true : fallar("escribiendo");
+}
+
+// Tiempos por fase para el harness de escalado (bench_escalado.cpp): una fila
+// "fase,segundos" por fase con el máximo entre ranks (camino crítico)
+bool escribirReporteFases(const std::string &ruta, const std::vector<std::pair<std::string, double>> &fases)
+{
+    std::ofstream out(ruta, std::ios::trunc);
+    if (!out.is_open()) return false;
+    out << "fase,segundos\n";
+    for (auto &f : fases) out << f.first << ',' << f.second << '\n';
+    return (bool)out;
 }
 
 int main(int argc, char** argv)
 {
-    // MPI: Inicio del entorno MPI (MPI_Init)
-    MPI_Init(&argc, &argv);
+    // MPI: Inicio del entorno MPI. El hilo lector pide trozos por RMA mientras
+    // el hilo principal está en colectivas, por eso se pide MPI_THREAD_MULTIPLE.
+    int provisto = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provisto);
     int world_rank, world_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    // Opciones: hints de collective buffering para la escritura MPI-IO
+    //   --cb <enable|disable|automatic>   (romio_cb_write)
+    //   --cb-buffer-mb <N>                (cb_buffer_size)
+    // tamaño de los trozos del reparto dinámico: --chunk-mb <N> (64 por defecto)
+    // y memoria máxima de buffers del pipeline por rank: --max-buffer-mb <N> (256)
+    // Modo: por defecto carga completa (recrea registros.dat); con --incremental
+    // solo se cargan los CSV nuevos o que crecieron según el manifiesto.
+    // Layout físico: --layout <cadenas|agrupado> (cadenas por defecto)
+    // Tiempos por fase (CSV, rank 0): --reporte-fases <ruta>
+    // Sin columnas para análisis (edad.col, dni.col, fecha.col): --sin-columnas
+    // Sin índice por fecha (indice_fecha.dat): --sin-indice-fecha
+    // Sin índice por apellido/nombre (indice_nombre.dat): --sin-indice-nombre
+    // Copia compacta v2 con diccionario (registros_v2.dat, ...): --registro-v2
+    // Sin filtro de DNI (filtro_dni.dat): --sin-filtro. Tamaño del filtro:
+    // --filtro-bits <N> bits por clave (10 por defecto) o --filtro-fp <P> (tasa
+    // de falsos positivos objetivo, p. ej. 0.01)
+    // Sin directorio de pacientes (pacientes.dat): --sin-directorio
+    // Factor de carga máximo de la tabla hash (registros por bucket antes de
+    // crecer): --carga-max <N> (16 por defecto; 0 = tabla fija de TABLE_SIZE).
+    // En incremental se respeta el de la tabla existente salvo que se indique.
+    std::string cb_modo;
+    std::string ruta_fases;
+    long long cb_buffer_mb = 0;
+    long long trozo_mb = 64;
+    long long max_buffer_mb = 256;
+    // Cada bloque (max_buffer_mb / 8) se lee y escribe con un count int de MPI-IO
+    const long long MAX_BUFFER_MB = 8LL * INT_MAX / (1024 * 1024);
+    bool incremental = false;
+    bool agrupar = false;
+    bool columnas_analisis = true;
+    bool indice_por_fecha = true;
+    bool indice_por_nombre = true;
+    bool registro_compacto = false;
+    bool filtro_por_dni = true;
+    bool directorio_pacientes = true;
+    int32_t filtro_bits = filtro_dni::BITS_POR_CLAVE_DEFECTO;
+    int32_t carga_max = CARGA_MAX_DEFECTO;
+    bool carga_explicita = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--cb" && i + 1 < argc) cb_modo = argv[++i];
+        else if (a == "--cb-buffer-mb" && i + 1 < argc) cb_buffer_mb = std::atoll(argv[++i]);
+        else if (a == "--chunk-mb" && i + 1 < argc) trozo_mb = std::max(1LL, std::atoll(argv[++i]));
+        else if (a == "--incremental") incremental = true;
+        else if (a == "--layout" && i + 1 < argc) agrupar = (std::string(argv[++i]) == "agrupado");
+        else if (a == "--max-buffer-mb" && i + 1 < argc) max_buffer_mb = std::clamp(std::atoll(argv[++i]), 8LL, MAX_BUFFER_MB);
+        else if (a == "--reporte-fases" && i + 1 < argc) ruta_fases = argv[++i];
+        else if (a == "--sin-columnas") columnas_analisis = false;
+        else if (a == "--sin-indice-fecha") indice_por_fecha = false;
+        else if (a == "--sin-indice-nombre") indice_por_nombre = false;
+        else if (a == "--registro-v2") registro_compacto = true;
+        else if (a == "--sin-filtro") filtro_por_dni = false;
+        else if (a == "--sin-directorio") directorio_pacientes = false;
+        else if (a == "--filtro-bits" && i + 1 < argc) filtro_bits = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--filtro-fp" && i + 1 < argc) filtro_bits = filtro_dni::bitsParaFp(std::atof(argv[++i]));
+        else if (a == "--carga-max" && i + 1 < argc) {
+            carga_max = std::max(0, std::atoi(argv[++i]));
+            carga_explicita = true;
+        }
+        else if (world_rank == 0) std::cerr << "Opción desconocida: " << a << std::endl;
+    }
+
     // Tiempo total de ejecución del proceso (solo se imprime si hay TTY)
     time_utils::ScopedTimer total_timer(std::string("carga_mpi total (rank ") + std::to_string(world_rank) + ")");
+    const double t_inicio = MPI_Wtime();
 
     // MPI: Maestro recopila lista de csv en ../csv y prepara broadcast
     // (CSV list serialization + MPI_Bcast más abajo)
@@ -119,122 +1635,568 @@ int main(int argc, char** argv)
         std::string p;
         while (std::getline(iss, p)) if (!p.empty()) files.push_back(p);
     }
+    const double t_lista = MPI_Wtime() - t_inicio;
 
-    // MPI: Asignación simple — repartición por round-robin entre ranks
-    // Aquí puedes reemplazar por reparto por tamaño/line-count si lo deseas
-    std::vector<std::string> my_files;
-    for (size_t i = 0; i < files.size(); ++i) {
-        if ((int)(i % world_size) == world_rank) my_files.push_back(files[i]);
+    // Plan de carga: cada CSV se ingiere desde `desdes[i]` hasta su tamaño.
+    // En modo incremental el maestro compara con el manifiesto: los CSV sin
+    // cambios se saltan, los que solo crecieron (prefijo con el mismo checksum)
+    // se cargan desde el tamaño anterior y los nuevos completos; uno modificado
+    // de otra forma aborta la carga incremental.
+    std::vector<long long> tams(files.size(), 0), desdes(files.size(), 0);
+    std::vector<unsigned long long> sumas(files.size(), FNV_BASE);
+    std::vector<long long> mtimes(files.size(), 0);
+    std::map<std::string, EntradaManifiesto> manifiesto;
+    int abortar = 0;
+    // La carga reescribe registros.dat y tabla_hash.dat: nadie puede tenerlos
+    // abiertos (tabla_compartida.h) hasta que termine
+    std::unique_ptr<tabla_compartida::Exclusivo> exclusivo;
+    if (world_rank == 0) {
+        exclusivo = std::make_unique<tabla_compartida::Exclusivo>("tabla_hash.dat");
+        if (!*exclusivo) {
+            std::cerr << "tabla_hash.dat está en uso (GUI o gestor_dni abiertos)" << std::endl;
+            abortar = 1;
+        }
+        if (incremental) {
+            manifiesto = leerManifiesto(RUTA_MANIFIESTO);
+            std::error_code ec;
+            if (manifiesto.empty() && std::filesystem::file_size("registros.dat", ec) > 0 && !ec) {
+                std::cerr << "Modo incremental sin " << RUTA_MANIFIESTO << ": se duplicarían los datos; "
+                          << "ejecute una carga completa primero." << std::endl;
+                abortar = 1;
+            }
+        }
+        for (size_t i = 0; i < files.size(); ++i) {
+            std::error_code ec;
+            auto t = std::filesystem::file_size(files[i], ec);
+            tams[i] = ec ? 0 : (long long)t;
+            mtimes[i] = mtimeNs(files[i]);
+            if (!incremental) continue;
+            auto it = manifiesto.find(files[i]);
+            if (it == manifiesto.end()) {
+                std::cout << "Nuevo: " << files[i] << std::endl;
+                continue;
+            }
+            const EntradaManifiesto &prev = it->second;
+            if (prev.tam == 0) continue; // no aportó registros: se carga como nuevo
+            // Mismo tamaño con otro mtime (touch, copia sin fechas): sin cambios si
+            // el contenido conserva el checksum; la cola descarta rápido si no
+            if (prev.tam == tams[i] &&
+                (prev.mtime == mtimes[i] ||
+                 ((!prev.con_cola || colaArchivo(files[i], prev.tam) == prev.cola) &&
+                  fnv1aArchivo(files[i], 0, prev.tam, FNV_BASE) == prev.suma))) {
+                desdes[i] = tams[i]; // sin cambios
+                sumas[i] = prev.suma;
+                continue;
+            }
+            char ultimo_byte = 0;
+            if (prev.tam > 0 && prev.tam < tams[i]) {
+                std::ifstream in(files[i], std::ios::binary);
+                in.seekg(prev.tam - 1);
+                in.get(ultimo_byte);
+            }
+            // Creció: se confía en el estado guardado al final del prefijo (tamaño y
+            // cola) en lugar de releer todo lo ya cargado; sin cola (manifiesto
+            // viejo) se recalcula el prefijo completo una vez
+            const bool prefijo_igual =
+                ultimo_byte == '\n' && (prev.con_cola ? colaArchivo(files[i], prev.tam) == prev.cola
+                                                      : fnv1aArchivo(files[i], 0, prev.tam, FNV_BASE) == prev.suma);
+            if (prefijo_igual) {
+                desdes[i] = prev.tam;
+                sumas[i] = prev.suma;
+                std::cout << "Creció: " << files[i] << " (se carga desde el byte " << prev.tam << ")" << std::endl;
+            } else {
+                // Recargarlo entero duplicaría sus registros anteriores: solo una
+                // carga completa puede reflejar el cambio
+                std::cerr << files[i] << " cambió (no solo creció) desde la última carga; "
+                          << "ejecute una carga completa." << std::endl;
+                abortar = 1;
+            }
+        }
+    }
+    MPI_Bcast(&abortar, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (abortar) {
+        MPI_Finalize();
+        return 1;
+    }
+    if (!files.empty()) {
+        MPI_Bcast(tams.data(), (int)tams.size(), MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        MPI_Bcast(desdes.data(), (int)desdes.size(), MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        MPI_Bcast(sumas.data(), (int)sumas.size(), MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
     }
 
-    if (my_files.empty()) {
-        if (world_rank == 0) std::cout << "Ningún archivo asignado a este rank?" << std::endl;
+    // Checksums del manifiesto: cada rank calcula los de sus archivos (i % size)
+    // solo sobre los bytes que se cargan; un XOR colectivo los junta en todos.
+    long long bytes_delta = 0;
+    {
+        std::vector<unsigned long long> propias(files.size(), 0);
+        for (size_t i = 0; i < files.size(); ++i) {
+            bytes_delta += tams[i] - desdes[i];
+            if ((int)(i % world_size) == world_rank)
+                propias[i] = fnv1aArchivo(files[i], desdes[i], tams[i], sumas[i]);
+        }
+        if (!files.empty())
+            MPI_Allreduce(propias.data(), sumas.data(), (int)files.size(), MPI_UNSIGNED_LONG_LONG, MPI_BXOR, MPI_COMM_WORLD);
     }
 
-    // OpenMP: Por cada archivo, leer líneas, parsear en paralelo con OpenMP
-    // y escribir temp_rank_X.dat
-    std::vector<RegistroClinico> acumulado;
-    for (auto &ruta : my_files) {
-        std::cout << "Rank " << world_rank << " procesando " << ruta << std::endl;
-        auto lines = leerLineasCSV(ruta);
-        size_t n = lines.size();
-        std::vector<RegistroClinico> regs(n);
-#pragma omp parallel for schedule(static)
-        for (long long i = 0; i < (long long)n; ++i) {
-            regs[i] = parsearLinea(lines[i]);
+    std::vector<Trozo> trozos = planificarTrozos(tams, desdes, trozo_mb * 1024 * 1024);
+    const double t_plan = MPI_Wtime() - t_inicio - t_lista;
+    if (world_rank == 0) {
+        std::cout << files.size() << " CSV (" << bytes_delta << " bytes a cargar) divididos en "
+                  << trozos.size() << " trozos de hasta " << trozo_mb << " MB" << std::endl;
+    }
+
+    // Presupuesto de memoria: 4 buffers de texto (cola de 2 + el que se lee + el
+    // que se parsea) y 4 bloques de registros (cola de 2 + el que se arma + el
+    // que se escribe), cada uno de a lo sumo max_buffer_mb / 8
+    const size_t bytes_bloque = (size_t)(max_buffer_mb * 1024 * 1024) / 8;
+    const size_t max_registros = std::max<size_t>(1, bytes_bloque / sizeof(RegistroClinico));
+
+    // Estado de las cadenas. En modo incremental los registros nuevos van tras
+    // los existentes y las cadenas continúan desde las cabezas actuales (con la
+    // geometría de la tabla existente); en carga completa registros.dat se
+    // trunca y las cadenas empiezan vacías con TABLE_SIZE buckets.
+    long long base_bytes = 0;
+    long long mtime_base = 0; // mtime de registros.dat antes de la carga (frescura de columnas y v2; solo rank 0)
+    tabla_hash::Geometria geo;
+    // Los tramos de una tabla agrupada previa se conservan: los registros nuevos
+    // se anteponen a la cabeza y el tramo sigue siendo válido.
+    std::vector<long long> semilla; // cabezas previas (rank 0) para actualizar solo las tocadas
+    tabla_hash::Tabla tabla = tabla_hash::tablaVacia();
+    bool tabla_previa = false;
+    bool formato_previo = false; // la tabla previa tenía cabecera
+    if (world_rank == 0 && incremental && std::filesystem::exists("registros.dat")) {
+        // Lo que la GUI dejó en el diario sin checkpoint entra a la tabla previa
+        if (wal::recuperar("registros.dat", "tabla_hash.dat") < 0)
+            std::cerr << "Aviso: no se pudo aplicar registros.wal" << std::endl;
+        columnas::estadoArchivo("registros.dat", base_bytes, mtime_base);
+        if (base_bytes > 0) {
+            tabla_previa = tabla_hash::cargar("tabla_hash.dat", tabla);
+            if (!tabla_previa) std::cerr << "Aviso: registros.dat sin tabla_hash.dat; no se enlazan registros previos" << std::endl;
+            formato_previo = tabla_hash::esV2(tabla);
+            geo = tabla_hash::geometria(tabla);
+            if (!carga_explicita) carga_max = tabla.carga_max;
+            // Tablas anteriores a v3 no llevan la cuenta: se estima con el tamaño del archivo
+            if (tabla.num_registros == 0) tabla.num_registros = base_bytes / (long long)sizeof(RegistroClinico);
+        }
+    }
+    MPI_Bcast(&base_bytes, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&geo.num_buckets, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&geo.buckets_base, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&carga_max, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    {
+        int previa = tabla_previa ? 1 : 0;
+        MPI_Bcast(&previa, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        tabla_previa = previa != 0;
+    }
+    const int nb = (int)geo.num_buckets;
+    std::vector<long long> ultimo_global(nb, NULL_OFFSET);
+    std::vector<long long> ext_offset(nb, NULL_OFFSET), ext_count(nb, 0);
+    if (world_rank == 0) {
+        if (base_bytes > 0) {
+            for (int i = 0; i < nb; ++i) {
+                ultimo_global[i] = tabla.entradas[i].head_offset;
+                ext_offset[i] = tabla.entradas[i].ext_offset;
+                ext_count[i] = tabla.entradas[i].ext_count;
+            }
         }
-        // Append regs to acumulado
-        acumulado.insert(acumulado.end(), regs.begin(), regs.end());
-        std::cout << "Rank " << world_rank << " parseó " << n << " líneas de " << ruta << std::endl;
+        semilla = ultimo_global;
+    }
+    MPI_Bcast(ultimo_global.data(), nb, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (agrupar) {
+        MPI_Bcast(ext_offset.data(), nb, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        MPI_Bcast(ext_count.data(), nb, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    }
+
+    // MPI: Reparto dinámico con un contador RMA en el rank 0. El hilo lector
+    // toma el siguiente trozo con MPI_Fetch_and_op hasta agotar la lista; los
+    // trozos salen de mayor a menor, así un CSV enorme no queda en un solo rank.
+    // Sin MPI_THREAD_MULTIPLE se cae a un reparto estático round-robin.
+    const bool reparto_dinamico = (provisto >= MPI_THREAD_MULTIPLE);
+    if (!reparto_dinamico && world_rank == 0)
+        std::cerr << "Aviso: MPI sin THREAD_MULTIPLE; reparto estático de trozos" << std::endl;
+    long long *contador = nullptr;
+    MPI_Win win;
+    MPI_Win_allocate(world_rank == 0 ? (MPI_Aint)sizeof(long long) : 0, sizeof(long long),
+                     MPI_INFO_NULL, MPI_COMM_WORLD, &contador, &win);
+    if (world_rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+        *contador = 0;
+        MPI_Win_unlock(0, win);
     }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    ColaAcotada<std::vector<char>> cola_texto(2);
+    ColaAcotada<std::vector<RegistroClinico>> cola_registros(2);
+    int trozos_propios = 0;
+    double segundos_parseo = 0.0;  // tiempo ocupado
+    double segundos_ocioso = 0.0;  // parser esperando texto (incluye pedir trozos)
+    size_t bytes_parseados = 0;
+
+    // Etapa 1: hilo lector
+    std::thread lector([&]() {
+        if (reparto_dinamico) MPI_Win_lock_all(0, win);
+        for (long long k = 0;; ++k) {
+            long long idx = world_rank + k * world_size;
+            if (reparto_dinamico) {
+                long long uno = 1;
+                MPI_Fetch_and_op(&uno, &idx, MPI_LONG_LONG, 0, 0, MPI_SUM, win);
+                MPI_Win_flush(0, win);
+            }
+            if (idx >= (long long)trozos.size()) break;
+            const Trozo &tz = trozos[idx];
+            ++trozos_propios;
+            leerTrozo(files[tz.archivo], tz, bytes_bloque, cola_texto);
+        }
+        if (reparto_dinamico) MPI_Win_unlock_all(win);
+        cola_texto.cerrar();
+    });
+
+    // Etapa 2: hilo parser (equipos OpenMP por buffer)
+    std::thread parser([&]() {
+        std::vector<char> texto;
+        while (true) {
+            double t_espera = MPI_Wtime();
+            if (!cola_texto.extraer(texto)) break;
+            double t0 = MPI_Wtime();
+            segundos_ocioso += t0 - t_espera;
+            parsearBuffer(texto, max_registros, cola_registros);
+            segundos_parseo += MPI_Wtime() - t0;
+            bytes_parseados += texto.size();
+        }
+        cola_registros.cerrar();
+    });
 
-    // I/O: Escribe archivo temporal binario `temp_rank_X.dat` (uno por proceso)
-    std::ostringstream tmpname;
-    tmpname << "temp_rank_" << world_rank << ".dat";
-    std::ofstream out(tmpname.str(), std::ios::binary);
-    if (!out.is_open()) {
-        std::cerr << "No se pudo crear " << tmpname.str() << std::endl;
+    // Etapa 3: escritura en rondas colectivas (hilo principal). En cada ronda cada
+    // rank aporta a lo sumo un bloque (vacío si ya terminó); el tramo de la ronda
+    // se ubica tras lo escrito en rondas anteriores y, dentro, en orden de rank.
+    MPI_Info info = crearInfoEscritura(cb_modo, cb_buffer_mb);
+    MPI_File fh;
+    int rc = MPI_File_open(MPI_COMM_WORLD, "registros.dat", MPI_MODE_WRONLY | MPI_MODE_CREATE, info, &fh);
+    MPI_Info_free(&info);
+    if (rc != MPI_SUCCESS) {
+        if (world_rank == 0) std::cerr << "No se pudo abrir/crear registros.dat" << std::endl;
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
-    if (!acumulado.empty()) out.write(reinterpret_cast<char*>(acumulado.data()), acumulado.size() * sizeof(RegistroClinico));
-    out.close();
+    // Carga completa: trunca; incremental: descarta restos de una carga interrumpida
+    MPI_File_set_size(fh, (MPI_Offset)base_bytes);
+    // La carga no reusa lápidas: en incremental la lista de libres sigue valiendo
+    // (una carga completa descarta también el diario, que habla del archivo viejo)
+    if (world_rank == 0 && base_bytes == 0) {
+        ::unlink(libres::rutaLibres("registros.dat").c_str());
+        ::unlink(wal::rutaDiario("registros.dat").c_str());
+    }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Op op_ultimo;
+    MPI_Op_create(&opUltimoNoNulo, 0, &op_ultimo);
+    std::vector<long long> ultimo(nb, NULL_OFFSET);
+    std::vector<long long> primero(nb, -1);
+    std::vector<long long> aporte(nb), entrante(nb);
+    long long base_ronda = base_bytes;
+    long long bytes_escritos = 0;
+    long long rondas = 0;
+    double t_escritura = 0.0;
+    double t_enlace = 0.0, t_io = 0.0; // desglose de t_escritura
+    std::vector<RegistroClinico> bloque;
+    while (true) {
+        bloque.clear();
+        int activo = cola_registros.extraer(bloque) ? 1 : 0;
+        int activos = 0;
+        MPI_Allreduce(&activo, &activos, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        if (!activos) break;
+        ++rondas;
+        double t0 = MPI_Wtime();
 
-    // Maestro unifica todos los temporales en registros.dat (append en orden de rank)
-    if (world_rank == 0) {
-        // MPI: Maestro — concatenación de temporales y reconstrucción de tabla hash
-        // (concatenación de temp_rank_X.dat -> registros.dat)
-        // Asegurar existencia de tabla_hash.dat (vacía) para compatibilidad con la GUI
-        if (!std::filesystem::exists("tabla_hash.dat")) {
-            std::ofstream th("tabla_hash.dat", std::ios::binary);
-            HashEntry empty;
-            empty.head_offset = NULL_OFFSET;
-            for (int i = 0; i < TABLE_SIZE; ++i) th.write(reinterpret_cast<char*>(&empty), sizeof(empty));
-        }
-
-        std::ofstream registros("registros.dat", std::ios::binary | std::ios::app);
-        if (!registros.is_open()) {
-            std::cerr << "No se pudo abrir/crear registros.dat" << std::endl;
+        // Offset del bloque dentro de la ronda y tamaño total de la ronda
+        long long bytes_local = (long long)(bloque.size() * sizeof(RegistroClinico));
+        long long bytes_previos = 0, bytes_ronda = 0;
+        MPI_Exscan(&bytes_local, &bytes_previos, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (world_rank == 0) bytes_previos = 0; // Exscan deja indefinido el buffer del rank 0
+        MPI_Allreduce(&bytes_local, &bytes_ronda, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        const long long mi_offset = base_ronda + bytes_previos;
+
+        // Hash: enlace local + costura entre ranks. El rank 0 arrastra el estado
+        // de las rondas anteriores, así el Exscan entrega a cada rank el último
+        // registro de cada bucket escrito antes que su bloque.
+        double t_fase = MPI_Wtime();
+        enlazarTramoLocal(bloque, mi_offset, geo, ultimo, primero);
+        if (world_rank == 0) {
+            for (int i = 0; i < nb; ++i)
+                aporte[i] = (ultimo[i] != NULL_OFFSET) ? ultimo[i] : ultimo_global[i];
+        } else {
+            aporte = ultimo;
+        }
+        MPI_Exscan(aporte.data(), entrante.data(), nb, MPI_LONG_LONG, op_ultimo, MPI_COMM_WORLD);
+        if (world_rank == 0) entrante = ultimo_global;
+        MPI_Allreduce(aporte.data(), ultimo_global.data(), nb, MPI_LONG_LONG, op_ultimo, MPI_COMM_WORLD);
+        for (auto &r : bloque) {
+            int pos = tabla_hash::bucket(geo, r.dni);
+            if (primero[pos] >= 0) {
+                bloque[primero[pos]].pos_siguiente = entrante[pos];
+                primero[pos] = -1;
+            }
+            ultimo[pos] = NULL_OFFSET;
+        }
+
+        t_enlace += MPI_Wtime() - t_fase;
+
+        // I/O: escritura colectiva del bloque (cabe en un count int: ver MAX_BUFFER_MB)
+        t_fase = MPI_Wtime();
+        MPI_Status st;
+        rc = MPI_File_write_at_all(fh, (MPI_Offset)mi_offset, bloque.empty() ? nullptr : bloque.data(),
+                                   (int)bytes_local, MPI_BYTE, &st);
+        if (rc != MPI_SUCCESS) {
+            std::cerr << "Rank " << world_rank << ": error escribiendo registros.dat" << std::endl;
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        for (int r = 0; r < world_size; ++r) {
-            std::ostringstream nm;
-            nm << "temp_rank_" << r << ".dat";
-            if (!std::filesystem::exists(nm.str())) continue;
-            std::ifstream in(nm.str(), std::ios::binary);
-            registros << in.rdbuf();
-            in.close();
-            // opcional: borrar temporal
-            std::filesystem::remove(nm.str());
-            std::cout << "Maestro añadió " << nm.str() << " a registros.dat\n";
-        }
-        registros.close();
-
-        // Reconstruir tabla hash y actualizar pos_siguiente en registros.dat
-        // (Aquí se recorre registros.dat, se actualizan pos_siguiente y se genera tabla_hash.dat)
-        try {
-            std::vector<HashEntry> table(TABLE_SIZE);
-            for (int i = 0; i < TABLE_SIZE; ++i) table[i].head_offset = NULL_OFFSET;
-
-            std::fstream registros_rw("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
-            if (!registros_rw.is_open()) {
-                std::cerr << "No se pudo abrir registros.dat para reconstruir tabla hash" << std::endl;
-            } else {
-                RegistroClinico r;
-                long long offset = 0;
-                registros_rw.seekg(0, std::ios::beg);
-                while (registros_rw.read(reinterpret_cast<char*>(&r), sizeof(r))) {
-                    int pos = hash1(r.dni);
-                    long long prev_head = table[pos].head_offset;
-                    r.pos_siguiente = prev_head;
-                    // escribir de nuevo el registro con pos_siguiente actualizado
-                    registros_rw.seekp(offset, std::ios::beg);
-                    registros_rw.write(reinterpret_cast<char*>(&r), sizeof(r));
-                    registros_rw.flush();
-                    table[pos].head_offset = offset;
-                    offset += sizeof(r);
-                    registros_rw.seekg(offset, std::ios::beg);
+        t_io += MPI_Wtime() - t_fase;
+        base_ronda += bytes_ronda;
+        bytes_escritos += bytes_local;
+        t_escritura += MPI_Wtime() - t0;
+    }
+    MPI_Op_free(&op_ultimo);
+    MPI_File_close(&fh);
+    lector.join();
+    parser.join();
+    MPI_Win_free(&win);
+
+    if (segundos_parseo > 0.0) {
+        std::cout << "Rank " << world_rank << " throughput de parseo: "
+                  << (bytes_parseados / 1e9) / segundos_parseo << " GB/s ("
+                  << bytes_parseados << " bytes en " << segundos_parseo << " s)" << std::endl;
+    }
+
+    // Reporte de balance de carga: tiempo ocupado/ocioso por rank
+    double balance[4] = {segundos_parseo, segundos_ocioso, (double)trozos_propios, (double)bytes_parseados};
+    std::vector<double> balances(world_rank == 0 ? 4 * world_size : 0);
+    MPI_Gather(balance, 4, MPI_DOUBLE, world_rank == 0 ? balances.data() : nullptr, 4, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    // Crecimiento de la tabla hash (antes del agrupado, que usa la geometría
+    // final). Carga completa: si la carga supera carga_max se reenlaza todo en
+    // paralelo con la cantidad de buckets necesaria. Incremental: el rank 0
+    // divide bucket por bucket (hashing lineal) sobre la tabla ya actualizada.
+    const long long sz_registro = (long long)sizeof(RegistroClinico);
+    double t_crecer = MPI_Wtime();
+    long long buckets_previos = geo.num_buckets;
+    int divisiones = 0;
+    if (base_bytes == 0 && carga_max > 0) {
+        long long objetivo = tabla_hash::bucketsPara(base_ronda / sz_registro, carga_max);
+        if (objetivo > geo.num_buckets) {
+            if (!redimensionarCadenas(base_ronda, objetivo, max_registros, world_rank, world_size, ultimo_global)) {
+                if (world_rank == 0) std::cerr << "Error reenlazando registros.dat; repetir la carga completa" << std::endl;
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            geo = tabla_hash::Geometria{objetivo, objetivo};
+            ext_offset.assign((size_t)objetivo, NULL_OFFSET);
+            ext_count.assign((size_t)objetivo, 0);
+        }
+    } else if (base_bytes > 0 && tabla_previa) {
+        if (world_rank == 0) {
+            tabla.carga_max = carga_max;
+            tabla.num_registros += (base_ronda - base_bytes) / sz_registro;
+            if (tabla_hash::debeDividir(tabla)) {
+                // Las divisiones reenlazan registros previos: la tabla debe estar
+                // persistida con las cabezas de esta carga antes de empezar
+                for (int i = 0; i < nb; ++i) tabla.entradas[i].head_offset = ultimo_global[i];
+                std::fstream reg("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
+                std::fstream th;
+                if (tabla_hash::guardar("tabla_hash.dat", tabla))
+                    th.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
+                if (reg.is_open() && th.is_open()) divisiones = tabla_hash::crecer(tabla, reg, th);
+                if (!reg.is_open() || !th.is_open() || !reg || !th || tabla_hash::debeDividir(tabla))
+                    std::cerr << "Aviso: no se pudo completar el crecimiento de tabla_hash.dat" << std::endl;
+                geo = tabla_hash::geometria(tabla);
+            }
+        }
+        MPI_Bcast(&divisiones, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (divisiones > 0 && agrupar) {
+            MPI_Bcast(&geo.num_buckets, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+            MPI_Bcast(&geo.buckets_base, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+            ext_offset.assign((size_t)geo.num_buckets, NULL_OFFSET);
+            ext_count.assign((size_t)geo.num_buckets, 0);
+            if (world_rank == 0) {
+                for (size_t i = 0; i < tabla.entradas.size(); ++i) {
+                    ext_offset[i] = tabla.entradas[i].ext_offset;
+                    ext_count[i] = tabla.entradas[i].ext_count;
                 }
-                registros_rw.close();
+            }
+            MPI_Bcast(ext_offset.data(), (int)geo.num_buckets, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+            MPI_Bcast(ext_count.data(), (int)geo.num_buckets, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        }
+    }
+    t_crecer = MPI_Wtime() - t_crecer;
+    t_enlace += t_crecer;
 
-                // Escribir tabla_hash.dat con los offsets calculados
-                std::ofstream th("tabla_hash.dat", std::ios::binary | std::ios::trunc);
-                if (!th.is_open()) {
-                    std::cerr << "No se pudo escribir tabla_hash.dat" << std::endl;
-                } else {
-                    for (int i = 0; i < TABLE_SIZE; ++i) {
-                        HashEntry e; e.head_offset = table[i].head_offset;
-                        th.write(reinterpret_cast<char*>(&e), sizeof(e));
+    // Layout agrupado: reordenar lo cargado (colectivo, antes de la tabla)
+    bool agrupado = false;
+    double t_agrupado = MPI_Wtime();
+    if (agrupar) {
+        MPI_Info info_agrupado = crearInfoEscritura(cb_modo, cb_buffer_mb);
+        // Cabezas finales en todos los ranks (tras dividir, solo el rank 0 las
+        // tiene); solo hacen falta si hay registros previos que pudieron quedar
+        // sueltos. Sin tabla previa no hay cadenas que seguir y se conservan todos.
+        std::vector<long long> cabezas;
+        if (base_bytes > 0 && tabla_previa) cabezas = ultimo_global;
+        if (!cabezas.empty() && divisiones > 0) {
+            cabezas.assign((size_t)geo.num_buckets, NULL_OFFSET);
+            if (world_rank == 0)
+                for (size_t i = 0; i < tabla.entradas.size(); ++i) cabezas[i] = tabla.entradas[i].head_offset;
+            MPI_Bcast(cabezas.data(), (int)geo.num_buckets, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        }
+        agrupado = agruparRegistros(base_ronda, geo, carga_max, cabezas, ext_offset, ext_count, max_registros,
+                                    info_agrupado, world_rank, world_size, tabla);
+        MPI_Info_free(&info_agrupado);
+    }
+    t_agrupado = MPI_Wtime() - t_agrupado;
+
+    // Columnas para análisis, índices por fecha y nombre, filtro de DNI, directorio de pacientes y copia v2 sobre el registros.dat definitivo (colectivo).
+    // En incremental cada uno que estaba al día con lo anterior a la carga solo
+    // procesa los registros nuevos [base_bytes, base_ronda); el agrupado mueve
+    // todos los offsets y obliga a reconstruirlos completos.
+    const long long bytes_previos = agrupado ? 0 : base_bytes;
+    bool columnas_ok = false;
+    double t_columnas = MPI_Wtime();
+    if (columnas_analisis)
+        columnas_ok = generarColumnas(bytes_previos, mtime_base, base_ronda, max_registros, world_rank, world_size);
+    bool indice_fecha_ok = false;
+    if (indice_por_fecha) {
+        MPI_Info info_indice = crearInfoEscritura(cb_modo, cb_buffer_mb);
+        indice_fecha_ok = construirIndiceFecha(bytes_previos, base_ronda, max_registros, info_indice, world_rank, world_size);
+        MPI_Info_free(&info_indice);
+    }
+    bool indice_nombre_ok = false;
+    if (indice_por_nombre) {
+        MPI_Info info_indice = crearInfoEscritura(cb_modo, cb_buffer_mb);
+        indice_nombre_ok = construirIndiceNombre(bytes_previos, base_ronda, max_registros, info_indice, world_rank, world_size);
+        MPI_Info_free(&info_indice);
+    }
+    bool filtro_ok = false;
+    if (filtro_por_dni)
+        filtro_ok = construirFiltroDni(bytes_previos, base_ronda, max_registros, filtro_bits, columnas_ok, world_rank,
+                                       world_size);
+    else if (world_rank == 0)
+        ::unlink(filtro_dni::rutaFiltro("registros.dat").c_str()); // uno viejo podría coincidir en tamaño
+    bool directorio_ok = false;
+    if (directorio_pacientes)
+        directorio_ok = construirDirectorioPacientes(bytes_previos, base_ronda, max_registros, columnas_ok, world_rank,
+                                                     world_size);
+    else if (world_rank == 0)
+        ::unlink(pacientes::rutaDirectorio("registros.dat").c_str());
+    bool v2_ok = false;
+    // Las divisiones reescriben pos_siguiente de registros previos, que v2 copia
+    if (registro_compacto)
+        v2_ok = generarRegistroV2(divisiones > 0 ? 0 : bytes_previos, mtime_base, base_ronda, max_registros, world_rank,
+                                  world_size);
+    t_columnas = MPI_Wtime() - t_columnas;
+
+    // Ancho de banda agregado: bytes totales / tiempo del rank más lento
+    long long bytes_totales = 0;
+    double t_max = 0.0;
+    MPI_Reduce(&bytes_escritos, &bytes_totales, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&t_escritura, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    // Fases (máximo entre ranks): la tabla y el total se miden luego en el rank 0
+    const double t_pipeline = MPI_Wtime() - t_inicio - t_lista - t_plan - t_agrupado - t_columnas;
+    double fases[9] = {t_lista, t_plan, segundos_parseo, segundos_ocioso, t_enlace, t_io, t_pipeline, t_agrupado, t_columnas};
+    double fases_max[9] = {0};
+    MPI_Reduce(fases, fases_max, 9, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    const double t_tabla_ini = MPI_Wtime();
+
+    if (world_rank == 0) {
+        std::cout << "Balance de carga (rank, trozos, MB, ocupado s, ocioso s):" << std::endl;
+        for (int r = 0; r < world_size; ++r) {
+            std::cout << "  rank " << r << ": " << (long long)balances[4 * r + 2] << " trozos, "
+                      << balances[4 * r + 3] / 1e6 << " MB, " << balances[4 * r] << " s ocupado, "
+                      << balances[4 * r + 1] << " s ocioso" << std::endl;
+        }
+        std::cout << "Escritura MPI-IO: " << bytes_totales << " bytes en " << rondas << " rondas, "
+                  << t_max << " s";
+        if (t_max > 0.0) std::cout << " (" << (bytes_totales / 1e6) / t_max << " MB/s agregados)";
+        std::cout << std::endl;
+
+        if (geo.num_buckets != buckets_previos)
+            std::cout << "Tabla hash: " << buckets_previos << " -> " << geo.num_buckets << " buckets ("
+                      << (divisiones > 0 ? std::to_string(divisiones) + " divisiones" : std::string("reenlace completo"))
+                      << ") en " << t_crecer << " s" << std::endl;
+        if (agrupado) {
+            // Tabla v2 con el tramo de cada bucket
+            std::cout << "Layout agrupado: registros.dat reordenado en " << t_agrupado << " s" << std::endl;
+            if (!tabla_hash::guardar("tabla_hash.dat", tabla)) std::cerr << "No se pudo escribir tabla_hash.dat" << std::endl;
+        } else if (divisiones > 0) {
+            // Ya persistida por las divisiones (cabezas, cabecera y buckets nuevos)
+        } else if (incremental && tabla_previa && tabla_hash::esV2(tabla) != formato_previo) {
+            // Cambió el formato (p. ej. una tabla legada que pasa a crecer): se reescribe completa
+            for (int i = 0; i < nb; ++i) tabla.entradas[i].head_offset = ultimo_global[i];
+            if (!tabla_hash::guardar("tabla_hash.dat", tabla)) std::cerr << "No se pudo escribir tabla_hash.dat" << std::endl;
+        } else if (incremental && tabla_previa) {
+            // Solo se reescriben las cabezas que cambiaron. En formato legado las
+            // cabezas son contiguas y los tramos seguidos se escriben juntos; con
+            // cabecera cada cabeza se escribe sola, el tramo del bucket se
+            // conserva y se actualiza el contador de registros.
+            std::fstream th("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
+            int tocadas = 0;
+            for (int i = 0; th.is_open() && i < nb;) {
+                if (ultimo_global[i] == semilla[i]) { ++i; continue; }
+                int j = i;
+                while (j < nb && ultimo_global[j] != semilla[j]) ++j;
+                if (tabla_hash::esV2(tabla)) {
+                    for (int k = i; k < j; ++k) {
+                        tabla.entradas[k].head_offset = ultimo_global[k];
+                        tabla_hash::escribirCabeza(th, tabla, k);
                     }
-                    th.close();
+                } else {
+                    th.seekp((std::streamoff)i * sizeof(HashEntry), std::ios::beg);
+                    th.write(reinterpret_cast<const char*>(&ultimo_global[i]), (std::streamsize)(j - i) * sizeof(HashEntry));
                 }
+                tocadas += j - i;
+                i = j;
             }
-        } catch (const std::exception &ex) {
-            std::cerr << "Error reconstruyendo tabla hash: " << ex.what() << std::endl;
+            if (th.is_open()) tabla_hash::escribirCabecera(th, tabla);
+            if (!th.is_open() || !th) std::cerr << "No se pudo actualizar tabla_hash.dat" << std::endl;
+            else std::cout << "Cabezas actualizadas en tabla_hash.dat: " << tocadas << std::endl;
+        } else {
+            // Escribir tabla_hash.dat con las cabezas finales de cada bucket (formato
+            // legado si la tabla es fija de TABLE_SIZE)
+            tabla = tabla_hash::tablaVacia(LAYOUT_CADENAS, geo.num_buckets, carga_max);
+            tabla.buckets_base = geo.buckets_base;
+            tabla.num_registros = base_ronda / sz_registro;
+            for (size_t i = 0; i < tabla.entradas.size(); ++i) tabla.entradas[i].head_offset = ultimo_global[i];
+            if (!tabla_hash::guardar("tabla_hash.dat", tabla)) std::cerr << "No se pudo escribir tabla_hash.dat" << std::endl;
         }
+        if (columnas_ok) std::cout << "Columnas edad/dni/fecha generadas" << std::endl;
+        if (indice_fecha_ok) std::cout << "Índice por fecha generado (indice_fecha.dat)" << std::endl;
+        if (indice_nombre_ok) std::cout << "Índice por nombre generado (indice_nombre.dat)" << std::endl;
+        if (filtro_ok) std::cout << "Filtro de DNI generado (filtro_dni.dat, " << filtro_bits << " bits por clave)" << std::endl;
+        if (directorio_ok) std::cout << "Directorio de pacientes generado (pacientes.dat)" << std::endl;
+        if (v2_ok) std::cout << "Copia compacta v2 generada (registros_v2.dat, textos_v2.heap, diccionario_v2.dat)" << std::endl;
+        if (columnas_ok || indice_fecha_ok || indice_nombre_ok || filtro_ok || directorio_ok || v2_ok) std::cout << "Derivados para análisis en " << t_columnas << " s" << std::endl;
 
-        std::cout << "Unificación completada por Maestro (tabla hash reconstruida)." << std::endl;
+        // Manifiesto: en carga completa solo los CSV actuales; en incremental se
+        // conservan las entradas previas y se actualizan las cargadas
+        if (!incremental) manifiesto.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            EntradaManifiesto e;
+            e.tam = tams[i];
+            e.mtime = mtimes[i];
+            e.suma = sumas[i];
+            e.cola = colaArchivo(files[i], tams[i]);
+            e.con_cola = true;
+            manifiesto[files[i]] = e;
+        }
+        if (!escribirManifiesto(RUTA_MANIFIESTO, manifiesto))
+            std::cerr << "No se pudo escribir " << RUTA_MANIFIESTO << std::endl;
+
+        std::cout << "Unificación completada (escritura colectiva y tabla hash construida en paralelo)." << std::endl;
+
+        if (!ruta_fases.empty()) {
+            const double t_fin = MPI_Wtime();
+            std::vector<std::pair<std::string, double>> filas = {
+                {"lista_bcast", fases_max[0]}, {"plan", fases_max[1]}, {"parseo", fases_max[2]},
+                {"parseo_espera", fases_max[3]}, {"enlace_hash", fases_max[4]}, {"escritura_io", fases_max[5]},
+                {"pipeline", fases_max[6]}, {"agrupado", fases_max[7]}, {"columnas", fases_max[8]},
+                {"tabla_hash", t_fin - t_tabla_ini},
+                {"total", t_fin - t_inicio}};
+            if (!escribirReporteFases(ruta_fases, filas)) std::cerr << "No se pudo escribir " << ruta_fases << std::endl;
+        }
     }
 
     MPI_Finalize();
@@ -0,0 +1,55 @@
+// cola_acotada.h
+// Cola bloqueante de capacidad fija para conectar etapas de un pipeline
+// productor/consumidor (p. ej. lectura -> parseo -> escritura en carga_mpi).
+// La capacidad limita cuántos buffers pueden estar en vuelo a la vez, lo que
+// acota la memoria total del pipeline.
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+template <typename T>
+class ColaAcotada {
+public:
+    explicit ColaAcotada(size_t capacidad) : capacidad_(capacidad ? capacidad : 1) {}
+
+    // Bloquea mientras la cola está llena. Devuelve false si ya fue cerrada.
+    bool insertar(T valor) {
+        std::unique_lock<std::mutex> lk(m_);
+        no_llena_.wait(lk, [&] { return cerrada_ || items_.size() < capacidad_; });
+        if (cerrada_) return false;
+        items_.push_back(std::move(valor));
+        no_vacia_.notify_one();
+        return true;
+    }
+
+    // Bloquea mientras la cola está vacía. Devuelve false si está cerrada y vacía.
+    bool extraer(T &valor) {
+        std::unique_lock<std::mutex> lk(m_);
+        no_vacia_.wait(lk, [&] { return cerrada_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        valor = std::move(items_.front());
+        items_.pop_front();
+        no_llena_.notify_one();
+        return true;
+    }
+
+    // El productor indica que no habrá más elementos
+    void cerrar() {
+        std::lock_guard<std::mutex> lk(m_);
+        cerrada_ = true;
+        no_vacia_.notify_all();
+        no_llena_.notify_all();
+    }
+
+private:
+    size_t capacidad_;
+    bool cerrada_ = false;
+    std::deque<T> items_;
+    std::mutex m_;
+    std::condition_variable no_vacia_;
+    std::condition_variable no_llena_;
+};
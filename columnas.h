@@ -0,0 +1,278 @@
+// columnas.h
+// Almacén columnar junto a `registros.dat` para los análisis que recorren todo
+// el archivo y solo necesitan uno o dos campos:
+// - `edad.col`  : uint8 por registro (EDAD_FUERA si la edad no está en 0..254)
+// - `dni.col`   : int32 por registro
+// - `fecha.col` : int32 con días desde 1970-01-01 (FECHA_INVALIDA si no es AAAA-MM-DD)
+// Cada columna tiene una `CabeceraColumna` con el tamaño y mtime de
+// registros.dat al generarla: solo se usa si coinciden (columna "fresca"); si
+// no, los análisis vuelven a leer registros.dat completo.
+// La fila i de cada columna corresponde al registro en el byte i * sizeof(RegistroClinico).
+#pragma once
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace columnas {
+
+static const char COL_MAGIC[8] = {'P', 'P', 'C', 'O', 'L', '1', 0, 0};
+static const int32_t COL_UINT8 = 1;
+static const int32_t COL_INT32 = 4;
+static const uint8_t EDAD_FUERA = 255;
+static const int32_t FECHA_INVALIDA = std::numeric_limits<int32_t>::min();
+
+#pragma pack(push, 1)
+struct CabeceraColumna {
+    char magic[8];             // COL_MAGIC
+    int32_t tipo;              // COL_UINT8 o COL_INT32 (bytes por fila)
+    int32_t reservado0;
+    int64_t num_registros;
+    int64_t tam_registros;     // tamaño de registros.dat al generar
+    int64_t mtime_registros;   // mtime (ns) de registros.dat al generar
+    int64_t escapes;           // filas con valor centinela (EDAD_FUERA / FECHA_INVALIDA)
+    int64_t reservado[3];
+};
+#pragma pack(pop)
+
+// Ruta de la columna `nombre` ("edad", "dni", "fecha") junto a registros.dat
+inline std::string rutaColumna(const std::string &ruta_registros, const std::string &nombre)
+{
+    size_t barra = ruta_registros.find_last_of('/');
+    std::string dir = (barra == std::string::npos) ? "" : ruta_registros.substr(0, barra + 1);
+    return dir + nombre + ".col";
+}
+
+// Tamaño y mtime (ns) de un archivo; false si no existe
+inline bool estadoArchivo(const std::string &ruta, long long &tam, long long &mtime)
+{
+    struct stat st;
+    if (::stat(ruta.c_str(), &st) != 0) return false;
+    tam = (long long)st.st_size;
+    mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+inline uint8_t edadColumna(int edad) { return (edad >= 0 && edad < EDAD_FUERA) ? (uint8_t)edad : EDAD_FUERA; }
+
+// Días desde 1970-01-01 de una fecha "AAAA-MM-DD" (algoritmo de días civiles)
+inline int32_t fechaADias(const char *f)
+{
+    for (int i = 0; i < 10; ++i) {
+        bool guion = (i == 4 || i == 7);
+        if (guion ? f[i] != '-' : (f[i] < '0' || f[i] > '9')) return FECHA_INVALIDA;
+    }
+    int y = (f[0] - '0') * 1000 + (f[1] - '0') * 100 + (f[2] - '0') * 10 + (f[3] - '0');
+    unsigned m = (unsigned)((f[5] - '0') * 10 + (f[6] - '0'));
+    unsigned d = (unsigned)((f[8] - '0') * 10 + (f[9] - '0'));
+    if (m < 1 || m > 12 || d < 1 || d > 31) return FECHA_INVALIDA;
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int32_t)(era * 146097 + (int)doe - 719468);
+}
+
+// Columnas de un lote de registros consecutivos
+struct LoteColumnas {
+    std::vector<uint8_t> edad;
+    std::vector<int32_t> dni;
+    std::vector<int32_t> fecha;
+    long long escapes_edad = 0;
+    long long escapes_fecha = 0;
+
+    void convertir(const RegistroClinico *regs, size_t n) {
+        edad.resize(n);
+        dni.resize(n);
+        fecha.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            edad[i] = edadColumna(regs[i].edad);
+            dni[i] = regs[i].dni;
+            fecha[i] = fechaADias(regs[i].fecha);
+            escapes_edad += (edad[i] == EDAD_FUERA);
+            escapes_fecha += (fecha[i] == FECHA_INVALIDA);
+        }
+    }
+};
+
+inline CabeceraColumna cabecera(int32_t tipo, long long num, long long tam, long long mtime, long long escapes)
+{
+    CabeceraColumna c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, COL_MAGIC, sizeof(COL_MAGIC));
+    c.tipo = tipo;
+    c.num_registros = num;
+    c.tam_registros = tam;
+    c.mtime_registros = mtime;
+    c.escapes = escapes;
+    return c;
+}
+
+// Escribe las cabeceras de las tres columnas (la generación escribe los datos
+// primero y la cabecera al final, así una generación interrumpida nunca queda fresca)
+inline bool escribirCabeceras(const std::string &ruta_registros, long long num, long long escapes_edad,
+                              long long escapes_fecha)
+{
+    long long tam = 0, mtime = 0;
+    if (!estadoArchivo(ruta_registros, tam, mtime)) return false;
+    const struct { const char *nombre; int32_t tipo; long long escapes; } cols[] = {
+        {"edad", COL_UINT8, escapes_edad}, {"dni", COL_INT32, 0}, {"fecha", COL_INT32, escapes_fecha}};
+    bool ok = true;
+    for (auto &c : cols) {
+        int fd = ::open(rutaColumna(ruta_registros, c.nombre).c_str(), O_WRONLY);
+        if (fd < 0) { ok = false; continue; }
+        CabeceraColumna cab = cabecera(c.tipo, num, tam, mtime, c.escapes);
+        ok = ok && ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+        ::close(fd);
+    }
+    return ok;
+}
+
+// Genera las tres columnas leyendo registros.dat secuencialmente
+inline bool generar(const std::string &ruta_registros, size_t registros_por_lote = 1 << 16)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    long long num = tam / (long long)sz;
+    ::posix_fadvise(in, 0, tam, POSIX_FADV_SEQUENTIAL);
+
+    const char *nombres[3] = {"edad", "dni", "fecha"};
+    int out[3];
+    for (int c = 0; c < 3; ++c) {
+        out[c] = ::open(rutaColumna(ruta_registros, nombres[c]).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out[c] < 0) {
+            for (int k = 0; k < c; ++k) ::close(out[k]);
+            ::close(in);
+            return false;
+        }
+        CabeceraColumna vacia;
+        std::memset(&vacia, 0, sizeof(vacia));
+        ::pwrite(out[c], &vacia, sizeof(vacia), 0);
+    }
+
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    LoteColumnas lote;
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+        if (!ok) break;
+        lote.convertir(buf.data(), n);
+        off_t base = (off_t)sizeof(CabeceraColumna);
+        ok = ::pwrite(out[0], lote.edad.data(), n, base + (off_t)i) == (ssize_t)n &&
+             ::pwrite(out[1], lote.dni.data(), n * 4, base + (off_t)(i * 4)) == (ssize_t)(n * 4) &&
+             ::pwrite(out[2], lote.fecha.data(), n * 4, base + (off_t)(i * 4)) == (ssize_t)(n * 4);
+    }
+    for (int c = 0; c < 3; ++c) ::close(out[c]);
+    ::close(in);
+    return ok && escribirCabeceras(ruta_registros, num, lote.escapes_edad, lote.escapes_fecha);
+}
+
+// Lee la cabecera de la columna sin exigir frescura; false si no existe o no es válida
+inline bool leerCabecera(const std::string &ruta_registros, const std::string &nombre, CabeceraColumna &cab)
+{
+    int fd = ::open(rutaColumna(ruta_registros, nombre).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = ::pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) &&
+              std::memcmp(cab.magic, COL_MAGIC, sizeof(COL_MAGIC)) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Abre la columna si está fresca respecto de registros.dat; devuelve el fd (o -1)
+inline int abrirFresca(const std::string &ruta_registros, const std::string &nombre, CabeceraColumna &cab)
+{
+    long long tam = 0, mtime = 0;
+    if (!estadoArchivo(ruta_registros, tam, mtime)) return -1;
+    int fd = ::open(rutaColumna(ruta_registros, nombre).c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    bool fresca = ::pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) &&
+                  std::memcmp(cab.magic, COL_MAGIC, sizeof(COL_MAGIC)) == 0 &&
+                  cab.tam_registros == tam && cab.mtime_registros == mtime &&
+                  cab.num_registros == tam / (long long)sizeof(RegistroClinico);
+    if (!fresca) { ::close(fd); return -1; }
+    return fd;
+}
+
+// Recorre una columna abierta en lotes: f(const T* datos, size_t n, long long fila_inicial)
+template <typename T, typename F>
+inline bool recorrer(int fd, const CabeceraColumna &cab, F f, size_t filas_por_lote = 1 << 20)
+{
+    std::vector<T> buf(filas_por_lote);
+    for (long long i = 0; i < cab.num_registros; i += (long long)filas_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)filas_por_lote, cab.num_registros - i);
+        off_t off = (off_t)sizeof(CabeceraColumna) + (off_t)(i * (long long)sizeof(T));
+        if (::pread(fd, buf.data(), n * sizeof(T), off) != (ssize_t)(n * sizeof(T))) return false;
+        f(buf.data(), n, i);
+    }
+    return true;
+}
+
+// Con escapes en edad.col, un rango que sale de 0..254 podría incluir edades
+// que la columna no guarda: en ese caso hay que leer registros.dat
+inline bool rangoCubierto(const CabeceraColumna &cab, int minEdad, int maxEdad)
+{
+    return cab.escapes == 0 || (minEdad >= 0 && maxEdad < EDAD_FUERA);
+}
+
+// Cuenta registros con edad en [minEdad, maxEdad] usando edad.col.
+// Devuelve false si la columna no está disponible/fresca o no cubre el rango.
+inline bool contarRangoEdad(const std::string &ruta_registros, int minEdad, int maxEdad, long long &resultado)
+{
+    CabeceraColumna cab;
+    int fd = abrirFresca(ruta_registros, "edad", cab);
+    if (fd < 0) return false;
+    if (cab.tipo != COL_UINT8 || !rangoCubierto(cab, minEdad, maxEdad)) { ::close(fd); return false; }
+    long long total = 0;
+    bool ok = recorrer<uint8_t>(fd, cab, [&](const uint8_t *e, size_t n, long long) {
+        long long parcial = 0;
+        for (size_t i = 0; i < n; ++i) parcial += (e[i] != EDAD_FUERA && e[i] >= minEdad && e[i] <= maxEdad);
+        total += parcial;
+    });
+    ::close(fd);
+    if (ok) resultado = total;
+    return ok;
+}
+
+// Cuenta DNIs distintos con alguna visita con edad en [minEdad, maxEdad]
+// usando edad.col y dni.col (leídos en lotes alineados).
+inline bool contarUnicosRangoEdad(const std::string &ruta_registros, int minEdad, int maxEdad, long long &resultado)
+{
+    CabeceraColumna cab_edad, cab_dni;
+    int fd_edad = abrirFresca(ruta_registros, "edad", cab_edad);
+    if (fd_edad < 0) return false;
+    int fd_dni = abrirFresca(ruta_registros, "dni", cab_dni);
+    if (fd_dni < 0 || cab_edad.tipo != COL_UINT8 || cab_dni.tipo != COL_INT32 ||
+        cab_edad.num_registros != cab_dni.num_registros || !rangoCubierto(cab_edad, minEdad, maxEdad)) {
+        ::close(fd_edad);
+        if (fd_dni >= 0) ::close(fd_dni);
+        return false;
+    }
+    std::unordered_set<int> vistos;
+    std::vector<int32_t> dnis;
+    bool ok_dni = true;
+    bool ok = recorrer<uint8_t>(fd_edad, cab_edad, [&](const uint8_t *e, size_t n, long long fila) {
+        dnis.resize(n);
+        off_t off = (off_t)sizeof(CabeceraColumna) + (off_t)(fila * 4);
+        if (::pread(fd_dni, dnis.data(), n * 4, off) != (ssize_t)(n * 4)) { ok_dni = false; return; }
+        for (size_t i = 0; i < n; ++i)
+            if (e[i] != EDAD_FUERA && e[i] >= minEdad && e[i] <= maxEdad) vistos.insert(dnis[i]);
+    }) && ok_dni;
+    ::close(fd_edad);
+    ::close(fd_dni);
+    if (ok) resultado = (long long)vistos.size();
+    return ok;
+}
+
+} // namespace columnas
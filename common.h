@@ -1,12 +1,16 @@
 // common.h
 // Definiciones compartidas entre los módulos C++ y CUDA del proyecto.
 // Contiene la estructura empaquetada `RegistroClinico` (layout fijo en disco),
-// la entrada de la tabla hash `HashEntry` y constantes globales.
+// la entrada de la tabla hash `HashEntry` (y su variante v2 `HashExtent` con
+// cabecera `TablaCabecera`), constantes globales, la marca de registro borrado
+// y las rutas y tamaños de los archivos que acompañan a registros.dat.
 // Mantener este archivo estable es crítico para la compatibilidad binaria.
 #pragma once
 #include <cstdint>
 #include <limits>
+#include <string>
 #include <stddef.h>
+#include <sys/stat.h>
 
 #pragma pack(push, 1)
 struct RegistroClinico {
@@ -26,8 +30,60 @@ struct RegistroClinico {
 struct HashEntry {
     long long head_offset;
 };
+
+// Cabecera de tabla_hash.dat a partir del formato v2. Los archivos legados no
+// tienen cabecera: son TABLE_SIZE HashEntry consecutivos.
+// Desde la versión 3 la tabla crece por hashing lineal: `num_buckets` es el
+// tamaño actual y `buckets_base` la potencia de 2 del nivel en curso
+// (base <= num_buckets < 2 * base). En una v2 ambos valen TABLE_SIZE.
+struct TablaCabecera {
+    char magic[8];          // TABLA_MAGIC
+    int32_t version;        // TABLA_VERSION
+    int32_t layout;         // LAYOUT_CADENAS o LAYOUT_AGRUPADO
+    int64_t num_buckets;    // buckets actuales (TABLE_SIZE en tablas fijas)
+    int64_t buckets_base;   // nivel del hashing lineal (0 en v2: TABLE_SIZE)
+    int64_t num_registros;  // registros enlazados (factor de carga = num_registros / num_buckets)
+    int32_t carga_max;      // registros por bucket que disparan una división (0: tabla fija)
+    int32_t reservado32;
+    int64_t reservado[1];
+};
+
+// Entrada v2: además de la cabeza de la cadena guarda el tramo contiguo
+// [ext_offset, ext_offset + ext_count * sizeof(RegistroClinico)) donde están,
+// en orden de cadena, los registros del bucket (layout agrupado).
+struct HashExtent {
+    long long head_offset;
+    long long ext_offset;
+    long long ext_count;
+};
 #pragma pack(pop)
 
 // Constantes compartidas
 static const int TABLE_SIZE = 131072;
 static const long long NULL_OFFSET = -1LL;
+static const char TABLA_MAGIC[8] = {'P', 'P', 'T', 'A', 'B', 'L', 'A', '2'};
+static const int32_t TABLA_VERSION = 3;
+static const int32_t LAYOUT_CADENAS = 0;   // registros en orden de llegada, cadenas dispersas
+static const int32_t LAYOUT_AGRUPADO = 1;  // registros de cada bucket contiguos en disco
+static const int32_t CARGA_MAX_DEFECTO = 16; // factor de carga objetivo de las tablas que crecen
+// Lápida: un registro eliminado conserva su lugar con este DNI (y el resto de
+// los campos en cero, edad -1) hasta que una inserción lo reusa o se compacta
+// el archivo; su `pos_siguiente` enlaza la lista de libres (registros_libres.h).
+static const int DNI_BORRADO = std::numeric_limits<int>::min();
+
+inline bool esBorrado(const RegistroClinico &r) { return r.dni == DNI_BORRADO; }
+
+// Ruta de un archivo en el mismo directorio que registros.dat (los derivados y
+// archivos auxiliares: índices, filtro, directorio, diario, lista de libres...)
+inline std::string rutaJunto(const std::string &ruta_registros, const std::string &nombre)
+{
+    size_t barra = ruta_registros.find_last_of('/');
+    return (barra == std::string::npos ? "" : ruta_registros.substr(0, barra + 1)) + nombre;
+}
+
+// Tamaño del archivo en bytes; -1 si no existe
+inline long long tamArchivo(const std::string &ruta)
+{
+    struct stat st;
+    return ::stat(ruta.c_str(), &st) == 0 ? (long long)st.st_size : -1;
+}
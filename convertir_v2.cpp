@@ -0,0 +1,147 @@
+// convertir_v2.cpp
+// Conversión entre `registros.dat` y la codificación compacta v2 (ver registro_v2.h).
+// Uso:
+//   convertir_v2 convertir [registros.dat]
+//   convertir_v2 expandir  [registros.dat] [salida.dat]
+//   convertir_v2 filtrar   [registros.dat] [--medico <texto>] [--motivo <texto>] [--edad <min> <max>]
+// `expandir` reconstruye un registros.dat equivalente desde v2 (sirve para
+// verificar la conversión con cmp). `filtrar` cuenta registros comparando solo
+// enteros (IDs de diccionario y edad) sobre las filas compactas.
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "registro_v2.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int convertir(const std::string& ruta)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    if (!registro_v2::convertir(ruta)) {
+        std::cerr << "Error al convertir " << ruta << " a v2\n";
+        return 1;
+    }
+    double t = segundosDesde(t0);
+    registro_v2::Almacen a;
+    if (!a.abrir(ruta)) {
+        std::cerr << "La copia v2 generada no se pudo abrir\n";
+        return 1;
+    }
+    long long crudo = tamArchivo(ruta);
+    long long v2 = tamArchivo(registro_v2::rutaRegistros(ruta)) + tamArchivo(registro_v2::rutaHeap(ruta)) +
+                   tamArchivo(registro_v2::rutaDiccionario(ruta));
+    const auto& dic = a.diccionario();
+    std::cout << "v2: " << a.cabecera().num_registros << " registros en " << t << " s\n";
+    std::cout << "  diccionario: " << dic.tam(registro_v2::COL_MEDICO) << " medicos, "
+              << dic.tam(registro_v2::COL_MOTIVO) << " motivos, " << dic.tam(registro_v2::COL_EXAMENES)
+              << " examenes\n";
+    std::cout << "  " << crudo << " -> " << v2 << " bytes (" << sizeof(RegistroClinico) << " -> "
+              << sizeof(registro_v2::RegistroCompacto) << " bytes fijos + "
+              << (a.cabecera().num_registros ? a.cabecera().tam_heap / a.cabecera().num_registros : 0)
+              << " de heap por registro)\n";
+    return 0;
+}
+
+int expandir(const std::string& ruta, const std::string& salida)
+{
+    registro_v2::Almacen a;
+    if (!a.abrir(ruta, false)) {
+        std::cerr << "No hay copia v2 de " << ruta << "\n";
+        return 1;
+    }
+    std::ofstream out(salida, std::ios::binary | std::ios::trunc);
+    const long long LOTE = 4096;
+    std::vector<RegistroClinico> buf((size_t)LOTE);
+    const long long sz = (long long)sizeof(RegistroClinico);
+    bool ok = out.is_open();
+    for (long long i = 0; ok && i < a.cabecera().num_registros; i += LOTE) {
+        long long n = std::min(LOTE, a.cabecera().num_registros - i);
+        ok = a.leer(i * sz, buf.data(), (size_t)(n * sz)) &&
+             out.write(reinterpret_cast<const char*>(buf.data()), (std::streamsize)(n * sz));
+    }
+    if (!ok) {
+        std::cerr << "Error al expandir v2 en " << salida << "\n";
+        return 1;
+    }
+    std::cout << "Expandido v2 en " << salida << " (" << a.cabecera().num_registros << " registros)\n";
+    return 0;
+}
+
+int filtrar(const std::string& ruta, const std::string* medico, const std::string* motivo, int minEdad, int maxEdad)
+{
+    registro_v2::Almacen a;
+    if (!a.abrir(ruta)) {
+        std::cerr << "No hay copia v2 fresca de " << ruta << " (correr convertir_v2 convertir)\n";
+        return 1;
+    }
+    // Un valor que no está en el diccionario (ID_EN_HEAP) solo coincide con filas del heap
+    const auto& dic = a.diccionario();
+    uint16_t id_medico = medico ? dic.id(registro_v2::COL_MEDICO, *medico) : 0;
+    uint16_t id_motivo = motivo ? dic.id(registro_v2::COL_MOTIVO, *motivo) : 0;
+    long long cuenta = 0, revisados_heap = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = a.recorrer([&](long long, const registro_v2::RegistroCompacto& c) {
+        // Solo las filas con el valor en el heap (o edad fuera de uint8) necesitan leerlo
+        bool heap = (c.flags & registro_v2::FLAG_EDAD_CRUDA) != 0;
+        if (medico) {
+            if (c.ids[registro_v2::COL_MEDICO] == registro_v2::ID_EN_HEAP) heap = true;
+            else if (c.ids[registro_v2::COL_MEDICO] != id_medico) return;
+        }
+        if (motivo) {
+            if (c.ids[registro_v2::COL_MOTIVO] == registro_v2::ID_EN_HEAP) heap = true;
+            else if (c.ids[registro_v2::COL_MOTIVO] != id_motivo) return;
+        }
+        if (heap) {
+            ++revisados_heap;
+            RegistroClinico r;
+            if (!a.decodificar(c, r)) return;
+            if (medico && registro_v2::campoDic(r, registro_v2::COL_MEDICO) != *medico) return;
+            if (motivo && registro_v2::campoDic(r, registro_v2::COL_MOTIVO) != *motivo) return;
+            if (r.edad < minEdad || r.edad > maxEdad) return;
+            ++cuenta;
+            return;
+        }
+        if (c.edad < minEdad || c.edad > maxEdad) return;
+        ++cuenta;
+    });
+    double t = segundosDesde(t0);
+    if (!ok) {
+        std::cerr << "Error al leer registros_v2.dat\n";
+        return 1;
+    }
+    std::cout << cuenta << " registro(s) en " << t << " s (" << revisados_heap << " revisados en el heap)\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = (argc > 1) ? argv[1] : "";
+    if (modo == "convertir") return convertir((argc > 2) ? argv[2] : "registros.dat");
+    if (modo == "expandir")
+        return expandir((argc > 2) ? argv[2] : "registros.dat", (argc > 3) ? argv[3] : "registros_expandido.dat");
+    if (modo == "filtrar") {
+        std::string ruta = "registros.dat", medico, motivo;
+        bool hay_medico = false, hay_motivo = false;
+        int minEdad = std::numeric_limits<int>::min(), maxEdad = std::numeric_limits<int>::max();
+        for (int i = 2; i < argc; ++i) {
+            std::string a = argv[i];
+            if (a == "--medico" && i + 1 < argc) { medico = argv[++i]; hay_medico = true; }
+            else if (a == "--motivo" && i + 1 < argc) { motivo = argv[++i]; hay_motivo = true; }
+            else if (a == "--edad" && i + 2 < argc) { minEdad = std::atoi(argv[++i]); maxEdad = std::atoi(argv[++i]); }
+            else ruta = a;
+        }
+        return filtrar(ruta, hay_medico ? &medico : nullptr, hay_motivo ? &motivo : nullptr, minEdad, maxEdad);
+    }
+    std::cerr << "Uso:\n"
+              << "  convertir_v2 convertir [registros.dat]\n"
+              << "  convertir_v2 expandir  [registros.dat] [salida.dat]\n"
+              << "  convertir_v2 filtrar   [registros.dat] [--medico <texto>] [--motivo <texto>] [--edad <min> <max>]\n";
+    return 1;
+}
@@ -0,0 +1,243 @@
+// csv_mmap.h
+// Lectura de CSV proyectados en memoria (mmap) y parseo directo de los bytes
+// mapeados hacia `RegistroClinico`, sin copiar cada línea a un std::string.
+// - `ArchivoMapeado`: proyección de solo lectura de un archivo completo.
+// - `buscarByte`: búsqueda vectorizada de un delimitador (AVX2 / SSE2 / escalar).
+// - `parsearCampos`: replica exactamente el parser legado (stringstream + getline
+//   + stoi + strncpy), incluidos sus casos borde con campos faltantes.
+// - `parsearRango` / `parsearRangoEn`: parsean las líneas que comienzan dentro de
+//   un rango de bytes, lo que permite repartir un archivo (o un buffer leído del
+//   disco) entre hilos/ranks sin cortar líneas.
+#pragma once
+#include "common.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace csv_mmap {
+
+// Proyección de solo lectura de un archivo. Un archivo vacío queda con datos == nullptr.
+struct ArchivoMapeado {
+    const char *datos = nullptr;
+    size_t tam = 0;
+
+    ArchivoMapeado() = default;
+    ArchivoMapeado(const ArchivoMapeado &) = delete;
+    ArchivoMapeado &operator=(const ArchivoMapeado &) = delete;
+    ~ArchivoMapeado() { cerrar(); }
+
+    bool abrir(const std::string &ruta) {
+        cerrar();
+        int fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+        tam = (size_t)st.st_size;
+        if (tam > 0) {
+            void *p = ::mmap(nullptr, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); tam = 0; return false; }
+            // El parseo recorre el archivo de forma secuencial
+            ::madvise(p, tam, MADV_SEQUENTIAL);
+            datos = static_cast<const char *>(p);
+        }
+        ::close(fd); // el mapeo sigue vivo sin el descriptor
+        return true;
+    }
+
+    void cerrar() {
+        if (datos) ::munmap(const_cast<char *>(datos), tam);
+        datos = nullptr;
+        tam = 0;
+    }
+};
+
+// Devuelve el primer puntero en [p, fin) que contiene `c`, o `fin` si no existe.
+inline const char *buscarByte(const char *p, const char *fin, char c)
+{
+#if defined(__AVX2__)
+    const __m256i v32 = _mm256_set1_epi8(c);
+    while (fin - p >= 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, v32));
+        if (m) return p + __builtin_ctz(m);
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i v16 = _mm_set1_epi8(c);
+    while (fin - p >= 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(b, v16));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+#endif
+    for (; p < fin; ++p)
+        if (*p == c) return p;
+    return fin;
+}
+
+// Emula std::getline sobre un stringstream de una línea: cuando la línea se
+// agota el campo conserva su valor anterior (o queda vacío si la línea
+// terminaba en delimitador), igual que el parser legado.
+struct CursorCampos {
+    const char *p;
+    const char *fin;
+    const char *ini_campo;
+    const char *fin_campo;
+    bool eof = false;
+
+    CursorCampos(const char *ini, const char *f) : p(ini), fin(f), ini_campo(ini), fin_campo(ini) {}
+
+    void siguiente(char delim) {
+        if (eof) return; // getline no toca el string si el stream ya está en EOF
+        const char *q = buscarByte(p, fin, delim);
+        ini_campo = p;
+        fin_campo = q;
+        if (q == fin) { eof = true; p = fin; }
+        else p = q + 1;
+    }
+    bool vacio() const { return ini_campo == fin_campo; }
+};
+
+// Equivalente a strncpy(dst, campo.c_str(), cap - 1) sobre un destino ya en cero
+inline void copiarCampo(char *dst, size_t cap, const char *ini, const char *fin)
+{
+    size_t n = (size_t)(fin - ini);
+    if (n > cap - 1) n = cap - 1;
+    const void *nul = std::memchr(ini, '\0', n);
+    if (nul) n = (size_t)(static_cast<const char *>(nul) - ini);
+    std::memcpy(dst, ini, n);
+}
+
+// Equivalente a std::stoi para el rango dado. Donde stoi lanzaría una
+// excepción (sin dígitos o fuera de rango) se devuelve 0.
+inline int parsearEntero(const char *p, const char *fin)
+{
+    while (p < fin && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+    bool neg = false;
+    if (p < fin && (*p == '+' || *p == '-')) { neg = (*p == '-'); ++p; }
+    long long v = 0;
+    bool digitos = false;
+    for (; p < fin && *p >= '0' && *p <= '9'; ++p) {
+        digitos = true;
+        v = v * 10 + (*p - '0');
+        if (v > (long long)std::numeric_limits<int>::max() + 1) return 0;
+    }
+    if (!digitos) return 0;
+    if (neg) v = -v;
+    if (v > std::numeric_limits<int>::max() || v < std::numeric_limits<int>::min()) return 0;
+    return (int)v;
+}
+
+// Parsea una línea [ini, fin) (sin '\n') a RegistroClinico
+inline void parsearCampos(const char *ini, const char *fin, RegistroClinico &r)
+{
+    std::memset(&r, 0, sizeof(r));
+    CursorCampos c(ini, fin);
+    c.siguiente(','); copiarCampo(r.fecha, sizeof(r.fecha), c.ini_campo, c.fin_campo);
+    c.siguiente(','); r.dni = c.vacio() ? 0 : parsearEntero(c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.nombre, sizeof(r.nombre), c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.apellido, sizeof(r.apellido), c.ini_campo, c.fin_campo);
+    c.siguiente(','); r.edad = c.vacio() ? 0 : parsearEntero(c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.medico, sizeof(r.medico), c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.motivo, sizeof(r.motivo), c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.examenes, sizeof(r.examenes), c.ini_campo, c.fin_campo);
+    c.siguiente(','); copiarCampo(r.resultados, sizeof(r.resultados), c.ini_campo, c.fin_campo);
+    c.siguiente('\n'); copiarCampo(r.receta, sizeof(r.receta), c.ini_campo, c.fin_campo);
+    r.pos_siguiente = NULL_OFFSET;
+}
+
+// Primer inicio de línea en una posición >= pos (una línea "pertenece" al rango
+// donde comienza, así dos rangos contiguos nunca parsean la misma línea).
+inline size_t alinearInicio(const char *datos, size_t tam, size_t pos)
+{
+    if (pos == 0) return 0;
+    if (pos >= tam) return tam;
+    const char *nl = buscarByte(datos + pos - 1, datos + tam, '\n');
+    return (nl == datos + tam) ? tam : (size_t)(nl - datos) + 1;
+}
+
+// Recorre las líneas no vacías que comienzan en [ini, fin) llamando a
+// f(ini_linea, fin_linea). Si `saltarCabecera` y el rango contiene el byte 0,
+// descarta la primera línea.
+template <typename F>
+inline void recorrerLineas(const char *datos, size_t tam, size_t ini, size_t fin,
+                           bool saltarCabecera, F f)
+{
+    if (fin > tam) fin = tam;
+    size_t p = alinearInicio(datos, tam, ini);
+    const char *fin_datos = datos + tam;
+    if (p == 0 && saltarCabecera && fin > 0) {
+        const char *nl = buscarByte(datos, fin_datos, '\n');
+        p = (nl == fin_datos) ? tam : (size_t)(nl - datos) + 1;
+    }
+    while (p < fin) {
+        const char *ini_linea = datos + p;
+        const char *nl = buscarByte(ini_linea, fin_datos, '\n');
+        if (nl != ini_linea) f(ini_linea, nl);
+        p = (size_t)(nl - datos) + 1;
+    }
+}
+
+// Parsea las líneas del rango y las agrega a `out`. Devuelve cuántas agregó.
+inline size_t parsearRango(const char *datos, size_t tam, size_t ini, size_t fin,
+                           bool saltarCabecera, std::vector<RegistroClinico> &out)
+{
+    size_t antes = out.size();
+    recorrerLineas(datos, tam, ini, fin, saltarCabecera, [&](const char *a, const char *b) {
+        out.emplace_back();
+        parsearCampos(a, b, out.back());
+    });
+    return out.size() - antes;
+}
+
+// Cuenta los registros del rango sin parsearlos (permite reservar el destino
+// exacto y parsear luego en paralelo con parsearRangoEn)
+inline size_t contarRango(const char *datos, size_t tam, size_t ini, size_t fin, bool saltarCabecera)
+{
+    size_t n = 0;
+    recorrerLineas(datos, tam, ini, fin, saltarCabecera, [&](const char *, const char *) { ++n; });
+    return n;
+}
+
+// Parsea las líneas del rango en `destino` (con espacio para contarRango(...) registros)
+inline size_t parsearRangoEn(const char *datos, size_t tam, size_t ini, size_t fin,
+                             bool saltarCabecera, RegistroClinico *destino)
+{
+    size_t n = 0;
+    recorrerLineas(datos, tam, ini, fin, saltarCabecera, [&](const char *a, const char *b) {
+        parsearCampos(a, b, destino[n++]);
+    });
+    return n;
+}
+
+// Divide [0, tam) en `partes` rangos nominales de tamaño similar (sin alinear;
+// `parsearRango` se encarga de respetar los límites de línea).
+inline std::vector<std::pair<size_t, size_t>> dividirEnRangos(size_t tam, int partes)
+{
+    std::vector<std::pair<size_t, size_t>> rangos;
+    if (partes < 1) partes = 1;
+    size_t paso = tam / (size_t)partes;
+    for (int i = 0; i < partes; ++i) {
+        size_t a = paso * (size_t)i;
+        size_t b = (i == partes - 1) ? tam : paso * (size_t)(i + 1);
+        rangos.emplace_back(a, b);
+    }
+    return rangos;
+}
+
+} // namespace csv_mmap
@@ -0,0 +1,122 @@
+// directorio_pacientes.cpp
+// Herramienta para el directorio de pacientes (ver directorio_pacientes.h).
+// Uso:
+//   directorio_pacientes construir [registros.dat] [--cadenas tabla_hash.dat]
+//   directorio_pacientes info [registros.dat]
+//   directorio_pacientes buscar <DNI> [registros.dat]
+// `construir` recorre registros.dat en orden; con --cadenas solo toma los
+// registros alcanzables desde la tabla hash (descarta las copias sueltas que
+// dejaban las eliminaciones de versiones anteriores). `buscar` muestra los
+// registros del DNI leyendo solo los suyos.
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "directorio_pacientes.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void imprimir(const pacientes::Directorio& d)
+{
+    const pacientes::PacientesCabecera& c = d.cabecera();
+    long long registros = c.tam_registros / (long long)sizeof(RegistroClinico);
+    std::cout << "Directorio de pacientes: " << c.num_pacientes << " pacientes, " << c.num_slots << " slots ("
+              << 100.0 * c.num_pacientes / c.num_slots << "% ocupados), " << registros << " registros cubiertos, "
+              << c.fin_listas / 1024 << " KiB, " << (d.fresco() ? "fresco" : "desactualizado") << "\n";
+}
+
+int construir(const std::string& ruta, const std::string& ruta_tabla)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = ruta_tabla.empty() ? pacientes::construir(ruta) : pacientes::construirDesdeCadenas(ruta, ruta_tabla);
+    pacientes::Directorio d;
+    if (!ok || !d.abrir(ruta)) {
+        std::cerr << "Error al construir el directorio de pacientes de " << ruta << "\n";
+        return 1;
+    }
+    imprimir(d);
+    std::cout << "Construido en " << segundosDesde(t0) << " s\n";
+    return 0;
+}
+
+int info(const std::string& ruta)
+{
+    pacientes::Directorio d;
+    if (!d.abrir(ruta)) {
+        std::cerr << "No hay directorio de pacientes para " << ruta << " (correr directorio_pacientes construir)\n";
+        return 1;
+    }
+    imprimir(d);
+    std::vector<int32_t> dnis;
+    std::vector<std::vector<long long>> listas;
+    if (!d.leerTodo(dnis, listas)) {
+        std::cerr << "Error leyendo el directorio\n";
+        return 1;
+    }
+    size_t maximo = 0;
+    long long total = 0;
+    for (const auto& l : listas) {
+        maximo = std::max(maximo, l.size());
+        total += (long long)l.size();
+    }
+    std::cout << "Registros por paciente: " << (dnis.empty() ? 0.0 : (double)total / dnis.size()) << " promedio, "
+              << maximo << " máximo\n";
+    return 0;
+}
+
+int buscar(int dni, const std::string& ruta)
+{
+    pacientes::Directorio d;
+    if (!d.abrir(ruta) || !d.fresco()) {
+        std::cerr << "No hay directorio de pacientes fresco para " << ruta << "\n";
+        return 1;
+    }
+    std::ifstream in(ruta, std::ios::binary);
+    std::vector<long long> offsets;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!in.is_open() || !d.buscar(dni, offsets)) {
+        std::cerr << "Error leyendo " << ruta << "\n";
+        return 1;
+    }
+    for (long long off : offsets) {
+        RegistroClinico r;
+        in.seekg(off, std::ios::beg);
+        if (!in.read(reinterpret_cast<char*>(&r), sizeof(r))) break;
+        std::cout << "[" << off << "] " << r.nombre << " " << r.apellido << " | " << r.fecha << " | "
+                  << r.motivo << "\n";
+    }
+    std::cout << offsets.size() << " registros del DNI " << dni << " en " << segundosDesde(t0) * 1e3 << " ms\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = (argc > 1) ? argv[1] : "";
+    std::string ruta = "registros.dat", ruta_tabla;
+    std::vector<std::string> pos;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--cadenas" && i + 1 < argc) ruta_tabla = argv[++i];
+        else pos.push_back(a);
+    }
+    if (modo == "construir" || modo == "info") {
+        if (!pos.empty()) ruta = pos[0];
+        return modo == "construir" ? construir(ruta, ruta_tabla) : info(ruta);
+    }
+    if (modo == "buscar" && !pos.empty()) {
+        if (pos.size() > 1) ruta = pos[1];
+        return buscar(std::atoi(pos[0].c_str()), ruta);
+    }
+    std::cerr << "Uso:\n"
+              << "  directorio_pacientes construir [registros.dat] [--cadenas tabla_hash.dat]\n"
+              << "  directorio_pacientes info [registros.dat]\n"
+              << "  directorio_pacientes buscar <DNI> [registros.dat]\n";
+    return 1;
+}
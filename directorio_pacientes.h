@@ -0,0 +1,456 @@
+// directorio_pacientes.h
+// Directorio de pacientes (`pacientes.dat`): por cada DNI, la lista compacta de
+// offsets de sus registros en registros.dat. Una búsqueda lee el slot del DNI y
+// su lista y después solo los registros del paciente, en lugar de recorrer la
+// cadena del bucket (que mezcla todos los DNI con los mismos bits bajos).
+// Formato (un solo archivo):
+//   PacientesCabecera | num_slots Slot (direccionamiento abierto, sondeo lineal,
+//   clave = DNI completo) | zona de listas (int64 offsets; la de cada paciente
+//   es un tramo contiguo con `capacidad` lugares, `cantidad` usados).
+// Un alta escribe su offset en el lugar libre de la lista; si no hay, la lista
+// se copia al final con el doble de capacidad (la vieja queda como hueco). Si
+// los slots superan el 70% de ocupación el archivo se reescribe con el doble de
+// slots y las listas compactadas (temporal + rename).
+// Frescura: vale solo si `tam_registros` coincide con el tamaño de registros.dat
+// (cada alta al final lo avanza, una que reusa una lápida no; lo último que se
+// escribe es la cabecera). Si no
+// coincide se ignora y se recorre la cadena. Lo construyen el loader y
+// `directorio_pacientes construir`.
+#pragma once
+#include "common.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pacientes {
+
+static const char PAC_MAGIC[8] = {'P', 'P', 'P', 'A', 'C', 'I', 'E', '1'};
+static const int32_t PAC_VERSION = 1;
+static const long long SLOTS_MINIMO = 1024;
+static const int32_t CAPACIDAD_INICIAL = 2;       // lugares de la lista de un paciente nuevo
+static const uint8_t ALTA = 1;
+static const uint8_t BAJA = 2;
+
+#pragma pack(push, 1)
+struct PacientesCabecera {
+    char magic[8];             // PAC_MAGIC
+    int32_t version;           // PAC_VERSION
+    int32_t reservado32;
+    int64_t num_slots;         // potencia de 2
+    int64_t num_pacientes;     // slots ocupados
+    int64_t tam_registros;     // bytes de registros.dat cubiertos
+    int64_t fin_listas;        // fin de la zona de listas (tamaño del archivo)
+    int64_t reservado[2];
+};
+
+struct Slot {
+    int32_t dni;
+    int32_t cantidad;          // offsets en uso
+    int32_t capacidad;         // 0: slot vacío
+    int32_t reservado;
+    int64_t lista;             // offset de la lista en pacientes.dat
+};
+#pragma pack(pop)
+
+inline std::string rutaDirectorio(const std::string &r) { return rutaJunto(r, "pacientes.dat"); }
+
+// Potencia de 2 (>= SLOTS_MINIMO) con ocupación <= 50% para `n` pacientes: deja
+// margen para altas antes de la primera reescritura
+inline long long slotsPara(long long n)
+{
+    long long s = SLOTS_MINIMO;
+    while (s < 2 * n) s <<= 1;
+    return s;
+}
+
+inline bool excedido(long long pacientes, long long slots) { return pacientes * 10 > slots * 7; }
+
+inline long long inicioListas(long long num_slots)
+{
+    return (long long)sizeof(PacientesCabecera) + num_slots * (long long)sizeof(Slot);
+}
+
+// Slot inicial del DNI (splitmix64: los DNI son casi consecutivos)
+inline long long slotInicial(int dni, long long num_slots)
+{
+    uint64_t x = (uint32_t)dni + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return (long long)((x ^ (x >> 31)) & (uint64_t)(num_slots - 1));
+}
+
+inline PacientesCabecera cabecera(long long num_slots, long long num_pacientes, long long tam_registros,
+                                  long long fin_listas)
+{
+    PacientesCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, PAC_MAGIC, sizeof(PAC_MAGIC));
+    c.version = PAC_VERSION;
+    c.num_slots = num_slots;
+    c.num_pacientes = num_pacientes;
+    c.tam_registros = tam_registros;
+    c.fin_listas = fin_listas;
+    return c;
+}
+
+// Ubica un slot en una tabla en memoria (sondeo lineal; la tabla tiene lugar)
+inline void ubicarEnTabla(std::vector<Slot> &tabla, const Slot &s)
+{
+    const long long mascara = (long long)tabla.size() - 1;
+    long long i = slotInicial(s.dni, (long long)tabla.size());
+    while (tabla[(size_t)i].capacidad != 0) i = (i + 1) & mascara;
+    tabla[(size_t)i] = s;
+}
+
+// Escribe un directorio completo (vía temporal + rename) a partir de las listas
+// de cada paciente (`listas[i]` son los offsets del DNI `dnis[i]`), con al
+// menos `min_slots` slots. Cada lista queda con la capacidad justa.
+inline bool escribir(const std::string &ruta_registros, const std::vector<int32_t> &dnis,
+                     const std::vector<std::vector<long long>> &listas, long long tam_registros,
+                     long long min_slots = 0)
+{
+    const long long ns = std::max(slotsPara((long long)dnis.size()), min_slots);
+    std::vector<Slot> tabla((size_t)ns, Slot{0, 0, 0, 0, 0});
+    std::vector<long long> planas;
+    long long pos = inicioListas(ns);
+    for (size_t i = 0; i < dnis.size(); ++i) {
+        const std::vector<long long> &l = listas[i];
+        int32_t cap = std::max<int32_t>(1, (int32_t)l.size());
+        ubicarEnTabla(tabla, Slot{dnis[i], (int32_t)l.size(), cap, 0, pos});
+        planas.insert(planas.end(), l.begin(), l.end());
+        planas.resize(planas.size() + (size_t)cap - l.size(), -1);
+        pos += cap * (long long)sizeof(long long);
+    }
+    const std::string ruta = rutaDirectorio(ruta_registros), tmp = ruta + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    PacientesCabecera cab = cabecera(ns, (long long)dnis.size(), tam_registros, pos);
+    size_t bytes_tabla = tabla.size() * sizeof(Slot), bytes_listas = planas.size() * sizeof(long long);
+    bool ok = ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) &&
+              ::pwrite(fd, tabla.data(), bytes_tabla, (off_t)sizeof(cab)) == (ssize_t)bytes_tabla &&
+              ::pwrite(fd, planas.data(), bytes_listas, (off_t)inicioListas(ns)) == (ssize_t)bytes_listas;
+    ::close(fd);
+    return ok && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+}
+
+class Directorio {
+public:
+    Directorio() = default;
+    Directorio(const Directorio &) = delete;
+    Directorio &operator=(const Directorio &) = delete;
+    ~Directorio() { cerrar(); }
+
+    // Abre pacientes.dat (solo la cabecera queda en memoria). false si no hay directorio.
+    bool abrir(const std::string &ruta_registros) {
+        cerrar();
+        ruta_registros_ = ruta_registros;
+        fd_ = ::open(rutaDirectorio(ruta_registros).c_str(), O_RDWR);
+        if (fd_ < 0) fd_ = ::open(rutaDirectorio(ruta_registros).c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        bool ok = ::pread(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  std::memcmp(cab_.magic, PAC_MAGIC, sizeof(PAC_MAGIC)) == 0 && cab_.version == PAC_VERSION &&
+                  cab_.num_slots >= SLOTS_MINIMO && (cab_.num_slots & (cab_.num_slots - 1)) == 0 &&
+                  cab_.fin_listas >= inicioListas(cab_.num_slots);
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool abierto() const { return fd_ >= 0; }
+    const PacientesCabecera &cabecera() const { return cab_; }
+
+    // El directorio cubre exactamente el registros.dat actual
+    bool fresco() const { return abierto() && tamArchivo(ruta_registros_) == cab_.tam_registros; }
+
+    // Offsets de los registros del DNI, del más nuevo al más viejo (como las
+    // cadenas armadas por inserción). Dos lecturas: el slot y la lista.
+    bool buscar(int dni, std::vector<long long> &offsets) const {
+        offsets.clear();
+        long long pos;
+        Slot s;
+        int r = abierto() ? ubicar(dni, pos, s) : -1;
+        if (r <= 0) return r == 0;
+        offsets.resize((size_t)s.cantidad);
+        size_t bytes = offsets.size() * sizeof(long long);
+        if (bytes > 0 && ::pread(fd_, offsets.data(), bytes, (off_t)s.lista) != (ssize_t)bytes) {
+            offsets.clear();
+            return false;
+        }
+        std::sort(offsets.begin(), offsets.end(), [](long long a, long long b) { return a > b; });
+        return true;
+    }
+
+    // Todos los pacientes con sus listas (para reescribir o fusionar un lote)
+    bool leerTodo(std::vector<int32_t> &dnis, std::vector<std::vector<long long>> &listas) const {
+        dnis.clear();
+        listas.clear();
+        std::vector<Slot> tabla((size_t)cab_.num_slots);
+        size_t bytes = tabla.size() * sizeof(Slot);
+        if (!abierto() || ::pread(fd_, tabla.data(), bytes, (off_t)sizeof(PacientesCabecera)) != (ssize_t)bytes)
+            return false;
+        for (const Slot &s : tabla) {
+            if (s.capacidad == 0) continue;
+            dnis.push_back(s.dni);
+            listas.emplace_back((size_t)s.cantidad);
+            size_t b = (size_t)s.cantidad * sizeof(long long);
+            if (b > 0 && ::pread(fd_, listas.back().data(), b, (off_t)s.lista) != (ssize_t)b) return false;
+        }
+        return true;
+    }
+
+    // Alta (registro recién escrito en `offset`, debe ser el final de lo cubierto)
+    // o baja de un offset del DNI. Un alta sobre un directorio desactualizado, o
+    // cualquier error de escritura, lo cierra: queda ignorado hasta reconstruirlo.
+    bool registrar(int dni, long long offset, uint8_t tipo = ALTA) {
+        if (!abierto()) return false;
+        bool ok = (tipo == ALTA) ? alta(dni, offset) : baja(dni, offset);
+        if (!ok) cerrar();
+        return ok;
+    }
+
+private:
+    // Busca el slot del DNI: 1 si está, 0 si no (`pos` queda en el primer slot
+    // vacío, o -1 si la tabla está llena) y -1 si falla la lectura
+    int ubicar(int dni, long long &pos, Slot &s) const {
+        const long long LOTE = 16; // 384 bytes por lectura
+        Slot buf[LOTE];
+        const long long mascara = cab_.num_slots - 1;
+        long long i = slotInicial(dni, cab_.num_slots);
+        for (long long vistos = 0; vistos < cab_.num_slots;) {
+            long long n = std::min(LOTE, cab_.num_slots - i);
+            if (::pread(fd_, buf, (size_t)n * sizeof(Slot), (off_t)offsetSlot(i)) != (ssize_t)(n * sizeof(Slot)))
+                return -1;
+            for (long long k = 0; k < n; ++k, ++vistos) {
+                if (buf[k].capacidad == 0 || buf[k].dni == dni) {
+                    pos = i + k;
+                    s = buf[k];
+                    return buf[k].capacidad != 0 ? 1 : 0;
+                }
+            }
+            i = (i + n) & mascara;
+        }
+        pos = -1;
+        return 0;
+    }
+
+    long long offsetSlot(long long i) const { return (long long)sizeof(PacientesCabecera) + i * (long long)sizeof(Slot); }
+
+    bool escribirSlot(long long pos, const Slot &s) {
+        return ::pwrite(fd_, &s, sizeof(s), (off_t)offsetSlot(pos)) == (ssize_t)sizeof(s);
+    }
+    bool escribirCabecera() { return ::pwrite(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_); }
+
+    // Orden: lista, slot y por último la cabecera con el tamaño cubierto nuevo.
+    // `offset` es el final cubierto (alta al final) o un lugar reusado antes de él.
+    bool alta(int dni, long long offset) {
+        if (offset > cab_.tam_registros) return false;
+        long long pos;
+        Slot s;
+        int r = ubicar(dni, pos, s);
+        if (r == 0 && (pos < 0 || excedido(cab_.num_pacientes + 1, cab_.num_slots))) {
+            if (!reescribir(cab_.num_slots * 2)) return false;
+            r = ubicar(dni, pos, s);
+        }
+        if (r < 0 || pos < 0) return false;
+        bool existe = r == 1;
+        if (!existe) {
+            s = Slot{dni, 0, CAPACIDAD_INICIAL, 0, cab_.fin_listas};
+            std::vector<long long> vacia((size_t)CAPACIDAD_INICIAL, -1);
+            if (::pwrite(fd_, vacia.data(), vacia.size() * sizeof(long long), (off_t)s.lista) !=
+                (ssize_t)(vacia.size() * sizeof(long long)))
+                return false;
+            cab_.fin_listas += CAPACIDAD_INICIAL * (long long)sizeof(long long);
+            ++cab_.num_pacientes;
+        } else if (s.cantidad >= s.capacidad) {
+            // Lista llena: se copia al final con el doble de lugares
+            std::vector<long long> lista((size_t)s.capacidad * 2, -1);
+            size_t bytes = (size_t)s.cantidad * sizeof(long long);
+            if (::pread(fd_, lista.data(), bytes, (off_t)s.lista) != (ssize_t)bytes) return false;
+            if (::pwrite(fd_, lista.data(), lista.size() * sizeof(long long), (off_t)cab_.fin_listas) !=
+                (ssize_t)(lista.size() * sizeof(long long)))
+                return false;
+            s.lista = cab_.fin_listas;
+            s.capacidad *= 2;
+            cab_.fin_listas += s.capacidad * (long long)sizeof(long long);
+        }
+        if (::pwrite(fd_, &offset, sizeof(offset), (off_t)(s.lista + s.cantidad * (long long)sizeof(long long))) !=
+            (ssize_t)sizeof(offset))
+            return false;
+        ++s.cantidad;
+        cab_.tam_registros = std::max<long long>(cab_.tam_registros, offset + (long long)sizeof(RegistroClinico));
+        return escribirSlot(pos, s) && escribirCabecera();
+    }
+
+    bool baja(int dni, long long offset) {
+        long long pos;
+        Slot s;
+        int r = ubicar(dni, pos, s);
+        if (r <= 0) return r == 0; // el DNI no figura: nada que quitar
+        std::vector<long long> lista((size_t)s.cantidad);
+        size_t bytes = lista.size() * sizeof(long long);
+        if (bytes == 0) return true;
+        if (::pread(fd_, lista.data(), bytes, (off_t)s.lista) != (ssize_t)bytes) return false;
+        auto it = std::find(lista.begin(), lista.end(), offset);
+        if (it == lista.end()) return true;
+        // El último ocupa el lugar del quitado (la lista no tiene orden)
+        *it = lista.back();
+        long long idx = (long long)(it - lista.begin());
+        if (::pwrite(fd_, &*it, sizeof(long long), (off_t)(s.lista + idx * (long long)sizeof(long long))) !=
+            (ssize_t)sizeof(long long))
+            return false;
+        --s.cantidad;
+        return escribirSlot(pos, s);
+    }
+
+    // Reescribe el directorio con `slots` slots y las listas compactadas
+    bool reescribir(long long slots) {
+        std::vector<int32_t> dnis;
+        std::vector<std::vector<long long>> listas;
+        std::string ruta = ruta_registros_;
+        return leerTodo(dnis, listas) && escribir(ruta, dnis, listas, cab_.tam_registros, slots) && abrir(ruta);
+    }
+
+    std::string ruta_registros_;
+    int fd_ = -1;
+    PacientesCabecera cab_{};
+};
+
+// Alta o baja de un registro en el directorio de registros.dat (si existe). Un
+// directorio desactualizado se deja así (se ignora hasta reconstruirlo).
+inline bool registrar(const std::string &ruta_registros, const RegistroClinico &r, long long offset,
+                      uint8_t tipo = ALTA)
+{
+    if (tamArchivo(rutaDirectorio(ruta_registros)) < 0) return true;
+    Directorio d;
+    if (!d.abrir(ruta_registros)) return false;
+    if (tipo == ALTA && offset > d.cabecera().tam_registros) return true;
+    return d.registrar(r.dni, offset, tipo);
+}
+
+// Agrupa pares (dni, offset) ordenados en listas por paciente
+inline void agrupar(const std::vector<std::pair<int32_t, long long>> &pares, std::vector<int32_t> &dnis,
+                    std::vector<std::vector<long long>> &listas)
+{
+    for (size_t i = 0; i < pares.size(); ++i) {
+        if (i == 0 || pares[i].first != pares[i - 1].first) {
+            dnis.push_back(pares[i].first);
+            listas.emplace_back();
+        }
+        listas.back().push_back(pares[i].second);
+    }
+}
+
+// Agrega de una vez un lote de altas (registros escritos al final de
+// registros.dat desde el tamaño que cubre el directorio hasta `tam_registros`):
+// lee el directorio completo, suma las altas y lo reescribe. Conviene frente a
+// `registrar` uno por uno cuando el lote es grande. false si no hay directorio
+// o no estaba al día con el inicio del lote.
+inline bool agregarLote(const std::string &ruta_registros, std::vector<std::pair<int32_t, long long>> altas,
+                        long long tam_registros)
+{
+    Directorio d;
+    std::vector<int32_t> dnis;
+    std::vector<std::vector<long long>> listas;
+    if (!d.abrir(ruta_registros) || !d.leerTodo(dnis, listas)) return false;
+    if (!altas.empty() && std::min_element(altas.begin(), altas.end(), [](const std::pair<int32_t, long long> &a,
+                                                                          const std::pair<int32_t, long long> &b) {
+                              return a.second < b.second;
+                          })->second != d.cabecera().tam_registros)
+        return false;
+    d.cerrar();
+    std::vector<std::pair<int32_t, long long>> pares;
+    for (size_t i = 0; i < dnis.size(); ++i)
+        for (long long off : listas[i]) pares.emplace_back(dnis[i], off);
+    pares.insert(pares.end(), altas.begin(), altas.end());
+    std::sort(pares.begin(), pares.end());
+    dnis.clear();
+    listas.clear();
+    agrupar(pares, dnis, listas);
+    return escribir(ruta_registros, dnis, listas, tam_registros);
+}
+
+// Registra las altas de `n` registros escritos seguidos desde `offset_base`
+// (insercion_lote.h). Un lote chico frente al directorio va de a una alta; uno
+// grande se suma con agregarLote (una lectura y una reescritura completas). Si
+// el directorio no cubría hasta `offset_base` lo deja así.
+inline bool registrarLote(const std::string &ruta_registros, const RegistroClinico *r, size_t n, long long offset_base)
+{
+    if (n == 0 || tamArchivo(rutaDirectorio(ruta_registros)) < 0) return true;
+    const long long sz = (long long)sizeof(RegistroClinico);
+    Directorio d;
+    if (!d.abrir(ruta_registros)) return false;
+    if (d.cabecera().tam_registros != offset_base) return true;
+    if ((long long)n * 4 < d.cabecera().num_pacientes) {
+        for (size_t i = 0; i < n; ++i)
+            if (!d.registrar(r[i].dni, offset_base + (long long)i * sz)) return false;
+        return true;
+    }
+    d.cerrar();
+    std::vector<std::pair<int32_t, long long>> altas(n);
+    for (size_t i = 0; i < n; ++i) altas[i] = std::make_pair(r[i].dni, offset_base + (long long)i * sz);
+    return agregarLote(ruta_registros, std::move(altas), offset_base + (long long)n * sz);
+}
+
+// Construye el directorio recorriendo registros.dat en orden (todos los
+// registros salvo las lápidas; las copias sueltas que dejaban las eliminaciones
+// de versiones anteriores se descartan con construirDesdeCadenas)
+inline bool construir(const std::string &ruta_registros, size_t registros_por_lote = 1 << 15)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    long long num = tam / (long long)sz;
+    std::vector<std::pair<int32_t, long long>> pares;
+    pares.reserve((size_t)num);
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+        for (size_t k = 0; ok && k < n; ++k)
+            if (!esBorrado(buf[k])) pares.emplace_back(buf[k].dni, (i + (long long)k) * (long long)sz);
+    }
+    ::close(in);
+    if (!ok) return false;
+    std::sort(pares.begin(), pares.end());
+    std::vector<int32_t> dnis;
+    std::vector<std::vector<long long>> listas;
+    agrupar(pares, dnis, listas);
+    return escribir(ruta_registros, dnis, listas, tam);
+}
+
+// Construye el directorio solo con los registros alcanzables desde tabla_hash.dat
+inline bool construirDesdeCadenas(const std::string &ruta_registros, const std::string &ruta_tabla)
+{
+    tabla_hash::Tabla tabla;
+    if (!tabla_hash::cargar(ruta_tabla, tabla)) return false;
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    std::vector<std::pair<int32_t, long long>> pares;
+    for (const HashExtent &e : tabla.entradas) {
+        tabla_hash::recorrerBucket(e, tam,
+            [&](long long off, void *dst, size_t n) { return ::pread(in, dst, n, (off_t)off) == (ssize_t)n; },
+            [&](long long off, const RegistroClinico &r) { pares.emplace_back(r.dni, off); });
+    }
+    ::close(in);
+    std::sort(pares.begin(), pares.end());
+    std::vector<int32_t> dnis;
+    std::vector<std::vector<long long>> listas;
+    agrupar(pares, dnis, listas);
+    return escribir(ruta_registros, dnis, listas, tam);
+}
+
+} // namespace pacientes
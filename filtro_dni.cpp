@@ -0,0 +1,105 @@
+// filtro_dni.cpp
+// Herramienta para el filtro de DNI (ver filtro_dni.h).
+// Uso:
+//   filtro_dni construir [registros.dat] [--bits N | --fp P]
+//   filtro_dni info [registros.dat]
+//   filtro_dni probar <DNI> [registros.dat]
+// `construir` recorre registros.dat en orden; --bits fija los bits por clave y
+// --fp los deriva de una tasa de falsos positivos objetivo (por defecto se
+// conservan los del filtro existente, o 10). `info` mide además la tasa real
+// de falsos positivos con DNI negativos (que nunca se insertan).
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "filtro_dni.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void imprimir(const filtro_dni::Filtro& f, bool fresco)
+{
+    const filtro_dni::FiltroCabecera& c = f.cabecera();
+    double bits_reales = c.num_claves > 0 ? (double)c.num_bloques * filtro_dni::BITS_POR_BLOQUE / c.num_claves : 0.0;
+    std::cout << "Filtro de DNI: " << c.num_claves << " claves, " << c.num_bloques << " bloques ("
+              << c.num_bloques * 64 / 1024 << " KiB), " << c.bits_por_clave << " bits por clave al construir ("
+              << bits_reales << " actuales), " << c.num_hashes << " hashes, fp teórica "
+              << filtro_dni::fpTeorico((int32_t)bits_reales, c.num_hashes) << ", "
+              << (fresco ? "fresco" : "desactualizado") << "\n";
+}
+
+int construir(const std::string& ruta, int32_t bits)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    filtro_dni::Filtro f;
+    if (!filtro_dni::construir(ruta, bits) || !f.abrir(ruta)) {
+        std::cerr << "Error al construir el filtro de DNI de " << ruta << "\n";
+        return 1;
+    }
+    imprimir(f, f.fresco());
+    std::cout << "Construido en " << segundosDesde(t0) << " s\n";
+    return 0;
+}
+
+int info(const std::string& ruta)
+{
+    filtro_dni::Filtro f;
+    if (!f.abrir(ruta)) {
+        std::cerr << "No hay filtro de DNI para " << ruta << " (correr filtro_dni construir)\n";
+        return 1;
+    }
+    imprimir(f, f.fresco());
+    const int MUESTRAS = 1000000;
+    long long positivos = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 1; i <= MUESTRAS; ++i) positivos += f.puedeContener(-i);
+    double t = segundosDesde(t0);
+    std::cout << "fp medida: " << (double)positivos / MUESTRAS << " (" << MUESTRAS << " DNI ausentes, "
+              << t * 1e9 / MUESTRAS << " ns por consulta)\n";
+    if (f.cabecera().num_claves > 2 * (f.cabecera().num_bloques * filtro_dni::BITS_POR_BLOQUE / f.cabecera().bits_por_clave))
+        std::cout << "Aviso: el filtro tiene más del doble de claves que su capacidad; conviene reconstruirlo\n";
+    return 0;
+}
+
+int probar(int dni, const std::string& ruta)
+{
+    filtro_dni::Filtro f;
+    if (!f.abrir(ruta) || !f.fresco()) {
+        std::cerr << "No hay filtro de DNI fresco para " << ruta << "\n";
+        return 1;
+    }
+    std::cout << "DNI " << dni << ": " << (f.puedeContener(dni) ? "puede estar" : "no está") << "\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = (argc > 1) ? argv[1] : "";
+    std::string ruta = "registros.dat";
+    std::vector<std::string> pos;
+    int32_t bits = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--bits" && i + 1 < argc) bits = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--fp" && i + 1 < argc) bits = filtro_dni::bitsParaFp(std::atof(argv[++i]));
+        else pos.push_back(a);
+    }
+    if (modo == "construir" || modo == "info") {
+        if (!pos.empty()) ruta = pos[0];
+        return modo == "construir" ? construir(ruta, bits) : info(ruta);
+    }
+    if (modo == "probar" && !pos.empty()) {
+        if (pos.size() > 1) ruta = pos[1];
+        return probar(std::atoi(pos[0].c_str()), ruta);
+    }
+    std::cerr << "Uso:\n"
+              << "  filtro_dni construir [registros.dat] [--bits N | --fp P]\n"
+              << "  filtro_dni info [registros.dat]\n"
+              << "  filtro_dni probar <DNI> [registros.dat]\n";
+    return 1;
+}
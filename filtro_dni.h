@@ -0,0 +1,329 @@
+// filtro_dni.h
+// Filtro de Bloom por bloques sobre los DNI de registros.dat (`filtro_dni.dat`)
+// para descartar sin recorrer la cadena las búsquedas de un DNI inexistente (el
+// peor caso de la búsqueda: se lee la cadena completa del bucket).
+// - Cada DNI cae en un bloque de 64 bytes (una línea de caché) y marca
+//   `num_hashes` bits dentro de él: una consulta toca una sola línea en memoria,
+//   o hace un único pread de 64 bytes si el filtro no está cargado.
+// - `bits_por_clave` fija el tamaño y la tasa de falsos positivos (10 bits ~ 1%,
+//   ver bitsParaFp). Las claves son los registros: un DNI con varias visitas
+//   marca siempre los mismos bits, así que en la práctica sobran bits.
+// - Las altas agregan su DNI (`registrar` / Filtro::registrar). Las bajas no se
+//   quitan (un Bloom no lo permite): el DNI eliminado vuelve a costar un recorrido.
+// Frescura: el filtro solo vale si `tam_registros` coincide con el tamaño de
+// registros.dat (cada alta al final lo avanza un registro; las que reusan una
+// lápida, ver registros_libres.h, no lo cambian). Si no coincide se ignora y se
+// busca como siempre, así nunca hay falsos negativos. Lo construyen el loader y
+// `filtro_dni construir`.
+#pragma once
+#include "common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace filtro_dni {
+
+static const char FILTRO_MAGIC[8] = {'P', 'P', 'F', 'I', 'L', 'T', 'R', '1'};
+static const int32_t FILTRO_VERSION = 1;
+static const int32_t BITS_POR_CLAVE_DEFECTO = 10;
+static const int PALABRAS_POR_BLOQUE = 8;        // 512 bits = 64 bytes
+static const int BITS_POR_BLOQUE = 64 * PALABRAS_POR_BLOQUE;
+
+#pragma pack(push, 1)
+struct FiltroCabecera {
+    char magic[8];             // FILTRO_MAGIC
+    int32_t version;           // FILTRO_VERSION
+    int32_t bits_por_clave;
+    int32_t num_hashes;        // bits marcados por clave (dentro de su bloque)
+    int32_t reservado32;
+    int64_t num_bloques;
+    int64_t num_claves;        // registros agregados (construcción + altas)
+    int64_t tam_registros;     // bytes de registros.dat cubiertos
+    int64_t reservado[3];
+};
+#pragma pack(pop)
+
+inline std::string rutaFiltro(const std::string &r) { return rutaJunto(r, "filtro_dni.dat"); }
+
+// Bits por clave para una tasa de falsos positivos objetivo (-ln p / ln² 2)
+inline int32_t bitsParaFp(double fp)
+{
+    fp = std::min(0.5, std::max(1e-6, fp));
+    double bits = -std::log(fp) / (std::log(2.0) * std::log(2.0));
+    return std::min(40, std::max(2, (int32_t)std::ceil(bits)));
+}
+
+// Cantidad de hashes óptima para `bits` por clave (bits * ln 2)
+inline int32_t hashesPara(int32_t bits)
+{
+    return std::min(16, std::max(1, (int32_t)std::lround(bits * std::log(2.0))));
+}
+
+// Tasa de falsos positivos teórica de un Bloom clásico; el de bloques queda algo
+// por encima porque la carga de los bloques varía (ver `filtro_dni info`)
+inline double fpTeorico(int32_t bits, int32_t hashes)
+{
+    return std::pow(1.0 - std::exp(-(double)hashes / std::max(1, bits)), hashes);
+}
+
+inline long long bloquesPara(long long claves, int32_t bits)
+{
+    return std::max(1LL, (std::max(0LL, claves) * bits + BITS_POR_BLOQUE - 1) / BITS_POR_BLOQUE);
+}
+
+inline long long offsetBloque(long long b)
+{
+    return (long long)sizeof(FiltroCabecera) + b * PALABRAS_POR_BLOQUE * (long long)sizeof(uint64_t);
+}
+
+inline uint64_t mezclar(uint64_t x)
+{
+    // splitmix64: los DNI son casi consecutivos, hace falta dispersarlos
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Bloque del DNI y los bits que marca dentro de él
+inline long long marcas(const FiltroCabecera &cab, int dni, uint64_t mascara[PALABRAS_POR_BLOQUE])
+{
+    uint64_t h = mezclar((uint32_t)dni);
+    uint64_t g = mezclar(h);
+    uint32_t a = (uint32_t)g, paso = (uint32_t)(g >> 32) | 1;
+    std::memset(mascara, 0, PALABRAS_POR_BLOQUE * sizeof(uint64_t));
+    for (int32_t i = 0; i < cab.num_hashes; ++i, a += paso)
+        mascara[(a % BITS_POR_BLOQUE) / 64] |= 1ULL << (a % 64);
+    return (long long)(h % (uint64_t)cab.num_bloques);
+}
+
+inline FiltroCabecera cabecera(long long claves, int32_t bits_por_clave, long long tam_registros)
+{
+    FiltroCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, FILTRO_MAGIC, sizeof(FILTRO_MAGIC));
+    c.version = FILTRO_VERSION;
+    c.bits_por_clave = std::max(1, bits_por_clave);
+    c.num_hashes = hashesPara(c.bits_por_clave);
+    c.num_bloques = bloquesPara(claves, c.bits_por_clave);
+    c.tam_registros = tam_registros;
+    return c;
+}
+
+inline bool cabeceraValida(const FiltroCabecera &c)
+{
+    return std::memcmp(c.magic, FILTRO_MAGIC, sizeof(FILTRO_MAGIC)) == 0 && c.version == FILTRO_VERSION &&
+           c.num_bloques > 0 && c.num_hashes > 0 && c.num_hashes <= BITS_POR_BLOQUE;
+}
+
+// Agrega el DNI de un alta en el bloque y la cabecera de un filtro en disco
+// (abierto en `fd`). El bloque se escribe antes que la cabecera: si el proceso
+// cae entre medio, el filtro queda desactualizado (se ignora), no incompleto.
+inline bool persistirAlta(int fd, FiltroCabecera &cab, int dni, long long offset)
+{
+    uint64_t mascara[PALABRAS_POR_BLOQUE], bloque[PALABRAS_POR_BLOQUE];
+    long long b = marcas(cab, dni, mascara);
+    const size_t bytes = sizeof(bloque);
+    if (::pread(fd, bloque, bytes, (off_t)offsetBloque(b)) != (ssize_t)bytes) return false;
+    for (int w = 0; w < PALABRAS_POR_BLOQUE; ++w) bloque[w] |= mascara[w];
+    if (::pwrite(fd, bloque, bytes, (off_t)offsetBloque(b)) != (ssize_t)bytes) return false;
+    cab.tam_registros = std::max<long long>(cab.tam_registros, offset + (long long)sizeof(RegistroClinico));
+    ++cab.num_claves;
+    return ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+}
+
+class Filtro {
+public:
+    // Filtro vacío (en memoria) dimensionado para `claves` registros
+    void crear(long long claves, int32_t bits_por_clave = BITS_POR_CLAVE_DEFECTO, long long tam_registros = 0) {
+        cab_ = filtro_dni::cabecera(claves, bits_por_clave, tam_registros);
+        palabras_.assign((size_t)(cab_.num_bloques * PALABRAS_POR_BLOQUE), 0);
+    }
+    // Filtro vacío con la geometría de `cab` (para combinar altas con un filtro existente)
+    void crear(const FiltroCabecera &cab) {
+        cab_ = cab;
+        cab_.num_claves = 0;
+        palabras_.assign((size_t)(cab_.num_bloques * PALABRAS_POR_BLOQUE), 0);
+    }
+
+    // Carga filtro_dni.dat completo. false si no hay filtro o es inválido.
+    bool abrir(const std::string &ruta_registros) {
+        cerrar();
+        ruta_registros_ = ruta_registros;
+        int fd = ::open(rutaFiltro(ruta_registros).c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        bool ok = ::pread(fd, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) && cabeceraValida(cab_);
+        if (ok) {
+            palabras_.resize((size_t)(cab_.num_bloques * PALABRAS_POR_BLOQUE));
+            size_t bytes = palabras_.size() * sizeof(uint64_t);
+            ok = ::pread(fd, palabras_.data(), bytes, (off_t)sizeof(cab_)) == (ssize_t)bytes;
+        }
+        ::close(fd);
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar() {
+        palabras_.clear();
+        std::memset(&cab_, 0, sizeof(cab_));
+    }
+
+    bool abierto() const { return !palabras_.empty(); }
+    const FiltroCabecera &cabecera() const { return cab_; }
+    std::vector<uint64_t> &palabras() { return palabras_; }
+
+    // El filtro cubre exactamente el registros.dat actual
+    bool fresco() const { return abierto() && tamArchivo(ruta_registros_) == cab_.tam_registros; }
+    // Variante sin stat, para quien ya conoce el tamaño de registros.dat
+    bool cubre(long long tam_registros) const { return abierto() && cab_.tam_registros == tam_registros; }
+
+    void agregar(int dni) {
+        marcar(dni);
+        ++cab_.num_claves;
+    }
+
+    // false: el DNI seguro no está. true: puede estar (hay que recorrer la cadena).
+    bool puedeContener(int dni) const {
+        uint64_t mascara[PALABRAS_POR_BLOQUE];
+        const uint64_t *bloque = &palabras_[(size_t)(marcas(cab_, dni, mascara) * PALABRAS_POR_BLOQUE)];
+        for (int w = 0; w < PALABRAS_POR_BLOQUE; ++w)
+            if ((bloque[w] & mascara[w]) != mascara[w]) return false;
+        return true;
+    }
+
+    // Alta del registro en `offset`: si el filtro estaba al día (cubría hasta
+    // `offset`, o más allá si el alta reusa un lugar libre) se agrega en disco y en memoria. Si estaba desactualizado (o falla
+    // la escritura) se cierra: queda ignorado hasta reconstruirlo.
+    bool registrar(int dni, long long offset) {
+        if (!abierto()) return false;
+        int fd = offset <= cab_.tam_registros ? ::open(rutaFiltro(ruta_registros_).c_str(), O_RDWR) : -1;
+        bool ok = fd >= 0 && persistirAlta(fd, cab_, dni, offset);
+        if (fd >= 0) ::close(fd);
+        if (ok) marcar(dni);
+        else cerrar();
+        return ok;
+    }
+
+    // Escribe el filtro completo (vía temporal + rename). `num_claves` >= 0
+    // reemplaza el contador (filtros combinados de varios procesos).
+    bool guardar(const std::string &ruta_registros, long long tam_registros, long long num_claves = -1) {
+        ruta_registros_ = ruta_registros;
+        cab_.tam_registros = tam_registros;
+        if (num_claves >= 0) cab_.num_claves = num_claves;
+        const std::string ruta = rutaFiltro(ruta_registros), tmp = ruta + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        size_t bytes = palabras_.size() * sizeof(uint64_t);
+        bool ok = ::pwrite(fd, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  ::pwrite(fd, palabras_.data(), bytes, (off_t)sizeof(cab_)) == (ssize_t)bytes;
+        ::close(fd);
+        return ok && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+    }
+
+private:
+    void marcar(int dni) {
+        uint64_t mascara[PALABRAS_POR_BLOQUE];
+        uint64_t *bloque = &palabras_[(size_t)(marcas(cab_, dni, mascara) * PALABRAS_POR_BLOQUE)];
+        for (int w = 0; w < PALABRAS_POR_BLOQUE; ++w) bloque[w] |= mascara[w];
+    }
+
+    std::string ruta_registros_;
+    FiltroCabecera cab_{};
+    std::vector<uint64_t> palabras_;
+};
+
+// Consulta puntual sin cargar el filtro (cabecera + un bloque). true solo si hay
+// filtro fresco y el DNI seguro no está en registros.dat.
+inline bool descartado(const std::string &ruta_registros, int dni)
+{
+    int fd = ::open(rutaFiltro(ruta_registros).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    FiltroCabecera cab;
+    uint64_t mascara[PALABRAS_POR_BLOQUE], bloque[PALABRAS_POR_BLOQUE];
+    bool ok = ::pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) && cabeceraValida(cab) &&
+              cab.tam_registros == tamArchivo(ruta_registros);
+    ok = ok && ::pread(fd, bloque, sizeof(bloque), (off_t)offsetBloque(marcas(cab, dni, mascara))) == (ssize_t)sizeof(bloque);
+    ::close(fd);
+    if (!ok) return false;
+    for (int w = 0; w < PALABRAS_POR_BLOQUE; ++w)
+        if ((bloque[w] & mascara[w]) != mascara[w]) return true;
+    return false;
+}
+
+// Registra el alta del registro escrito en `offset` (un pread y dos pwrite). Si
+// no hay filtro no hace nada; si estaba desactualizado lo deja así.
+inline bool registrar(const std::string &ruta_registros, const RegistroClinico &r, long long offset)
+{
+    int fd = ::open(rutaFiltro(ruta_registros).c_str(), O_RDWR);
+    if (fd < 0) return true;
+    FiltroCabecera cab;
+    bool ok = ::pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) && cabeceraValida(cab);
+    if (ok && offset <= cab.tam_registros) ok = persistirAlta(fd, cab, r.dni, offset);
+    ::close(fd);
+    return ok;
+}
+
+// Registra las altas de `n` registros escritos seguidos desde `offset_base`
+// (insercion_lote.h): cada DNI actualiza su bloque y la cabecera se escribe una
+// sola vez al final. Si el filtro no cubría hasta `offset_base` lo deja así.
+inline bool registrarLote(const std::string &ruta_registros, const RegistroClinico *r, size_t n, long long offset_base)
+{
+    int fd = ::open(rutaFiltro(ruta_registros).c_str(), O_RDWR);
+    if (fd < 0 || n == 0) {
+        if (fd >= 0) ::close(fd);
+        return true;
+    }
+    FiltroCabecera cab;
+    bool ok = ::pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) && cabeceraValida(cab);
+    if (ok && offset_base <= cab.tam_registros) {
+        uint64_t mascara[PALABRAS_POR_BLOQUE], bloque[PALABRAS_POR_BLOQUE];
+        for (size_t i = 0; ok && i < n; ++i) {
+            off_t pos = (off_t)offsetBloque(marcas(cab, r[i].dni, mascara));
+            ok = ::pread(fd, bloque, sizeof(bloque), pos) == (ssize_t)sizeof(bloque);
+            for (int w = 0; ok && w < PALABRAS_POR_BLOQUE; ++w) bloque[w] |= mascara[w];
+            ok = ok && ::pwrite(fd, bloque, sizeof(bloque), pos) == (ssize_t)sizeof(bloque);
+        }
+        cab.tam_registros = std::max<long long>(cab.tam_registros,
+                                                offset_base + (long long)n * (long long)sizeof(RegistroClinico));
+        cab.num_claves += (long long)n;
+        ok = ok && ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+    }
+    ::close(fd);
+    return ok;
+}
+
+// Construye el filtro recorriendo registros.dat en orden. Con bits_por_clave <= 0
+// conserva el de un filtro existente (o el por defecto).
+inline bool construir(const std::string &ruta_registros, int32_t bits_por_clave = 0, size_t registros_por_lote = 1 << 15)
+{
+    if (bits_por_clave <= 0) {
+        Filtro previo;
+        bits_por_clave = previo.abrir(ruta_registros) ? previo.cabecera().bits_por_clave : BITS_POR_CLAVE_DEFECTO;
+    }
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    long long num = tam / (long long)sz;
+    Filtro f;
+    f.crear(num, bits_por_clave);
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+        for (size_t k = 0; ok && k < n; ++k)
+            if (!esBorrado(buf[k])) f.agregar(buf[k].dni);
+    }
+    ::close(in);
+    return ok && f.guardar(ruta_registros, tam);
+}
+
+} // namespace filtro_dni
@@ -0,0 +1,31 @@
+// generar_columnas.cpp
+// Genera (o regenera) las columnas para análisis `edad.col`, `dni.col` y
+// `fecha.col` junto a registros.dat (formato en columnas.h). carga_mpi ya las
+// escribe al cargar; esta herramienta sirve tras Limpieza, inserciones o
+// eliminaciones, que dejan las columnas viejas (no frescas).
+// Uso: generar_columnas [registros.dat]
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "common.h"
+#include "columnas.h"
+
+int main(int argc, char** argv) {
+    std::string ruta = (argc > 1) ? argv[1] : "registros.dat";
+
+    auto inicio = std::chrono::steady_clock::now();
+    bool ok = columnas::generar(ruta);
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    if (!ok) {
+        std::cerr << "Error al generar columnas desde " << ruta << "\n";
+        return 1;
+    }
+
+    columnas::CabeceraColumna cab;
+    int fd = columnas::abrirFresca(ruta, "edad", cab);
+    if (fd >= 0) ::close(fd);
+    std::cout << "Columnas edad/dni/fecha generadas: " << cab.num_registros << " registros en "
+              << t << " s (" << cab.escapes << " edades fuera de 0..254)\n";
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -11,43 +12,63 @@
 // - Buscar por DNI
 // - Insertar registros
 // - Eliminar registros (todos o por índice)
-// Implementa las mismas estructuras empaquetadas que el resto del proyecto
-// y usa la tabla hash + lista enlazada en disco.
-
-// Estructura que representa un registro clínico
-#pragma pack(push, 1)
-struct RegistroClinico
-{
-    char fecha[11];         // Fecha en formato AAAA-MM-DD
-    int dni;                // DNI del paciente
-    char nombre[25];        // Nombre del paciente
-    char apellido[25];      // Apellido del paciente
-    int edad;               // Edad del paciente
-    char medico[40];        // Nombre del médico
-    char motivo[50];        // Motivo de la consulta
-    char examenes[50];      // Exámenes realizados
-    char resultados[30];    // Resultados de los exámenes
-    char receta[60];        // Receta médica
-    long long pos_siguiente;// Offset al siguiente registro en la lista enlazada
-};
-
-// Estructura para la entrada de la tabla hash
-struct HashEntry
-{
-    long long head_offset = -1; // Offset al primer registro de la lista enlazada
-};
-#pragma pack(pop)
-
-const int TABLE_SIZE = 131072;      // Tamaño de la tabla hash (potencia de 2)
-const long long NULL_OFFSET = -1;   // Valor para indicar fin de lista o vacío
+// - Editar un registro (en el lugar si no cambia el DNI, registros_edicion.h)
+// Usa las mismas estructuras empaquetadas que el resto del proyecto (common.h)
+// y la tabla hash + lista enlazada en disco (formato legado, v2 o v3, tabla_hash.h).
+// Las inserciones hacen crecer la tabla (hashing lineal) cuando supera su
+// factor de carga. Las búsquedas consultan antes el filtro de DNI
+// (filtro_dni.h, si existe) y no recorren la cadena de un DNI inexistente; con
+// directorio de pacientes fresco (directorio_pacientes.h) leen solo los
+// registros del DNI. Las eliminaciones dejan lápidas que reusan las
+// inserciones siguientes (registros_libres.h). La tabla es la que comparte con
+// la GUI (tabla_compartida.h): al empezar se adjunta (si nadie la tiene, la
+// crea aplicando el diario que haya dejado la GUI) y cada operación que escribe
+// toma el rol de escritor y lo suelta al terminar. Si lo tiene la GUI, espera a
+// que lo ceda (a lo sumo un intervalo de su mantenimiento).
+
+#include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "registros_edicion.h"
+#include "registros_libres.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
 
 std::fstream tabla_file;            // Archivo para la tabla hash
 std::fstream registros_file;        // Archivo para los registros clínicos
+tabla_compartida::Segmento tabla;   // Tabla viva compartida (geometría, formato y cabezas)
+unsigned long long generacion_abierta = 0; // de registros.dat al abrirlo (la GUI la cambia al compactar)
 
-// Función hash simple usando AND para aprovechar potencia de 2
+// Bucket del DNI según el tamaño actual de la tabla
 int hash1(int dni)
 {
-    return dni & (TABLE_SIZE - 1);
+    return tabla.bucket(dni);
+}
+
+// Abre (o vuelve a abrir) ambos archivos en modo lectura/escritura binario: al
+// empezar, tras una inserción y cuando otro proceso los reemplazó (checkpoint o
+// compactación de la GUI)
+void abrirArchivos()
+{
+    tabla_file.close();
+    registros_file.close();
+    tabla_file.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
+    registros_file.open("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
+    if (!tabla_file.is_open() || !registros_file.is_open())
+    {
+        std::cerr << "Error abriendo archivos binarios." << std::endl;
+        exit(1);
+    }
+    generacion_abierta = tabla.generacion();
+}
+
+// Antes de leer: si la GUI reemplazó registros.dat desde que se abrió
+void reabrirSiCambio()
+{
+    if (tabla.generacion() != generacion_abierta)
+        abrirArchivos();
 }
 
 // Inicializa los archivos binarios si no existen y los abre
@@ -56,96 +77,135 @@ void inicializarArchivos()
     // Si no existe la tabla hash, la crea e inicializa con valores vacíos
     if (!std::filesystem::exists("tabla_hash.dat"))
     {
-        std::ofstream out("tabla_hash.dat", std::ios::binary);
-        HashEntry empty;
-        for (int i = 0; i < TABLE_SIZE; ++i)
-            out.write(reinterpret_cast<char *>(&empty), sizeof(empty));
+        tabla_hash::guardar("tabla_hash.dat", tabla_hash::tablaVacia(LAYOUT_CADENAS, TABLE_SIZE, CARGA_MAX_DEFECTO));
     }
     // Si no existe el archivo de registros, lo crea vacío
     if (!std::filesystem::exists("registros.dat"))
     {
         std::ofstream out("registros.dat", std::ios::binary);
     }
-
-    // Abre ambos archivos en modo lectura/escritura binario
-    tabla_file.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
-    registros_file.open("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
-    if (!tabla_file.is_open() || !registros_file.is_open())
+    // Se adjunta a la tabla compartida; si nadie la tiene se carga de
+    // tabla_hash.dat con las operaciones de la GUI que no llegaron a un checkpoint
+    std::string error;
+    if (!tabla.adjuntar("registros.dat", "tabla_hash.dat", &error))
     {
-        std::cerr << "Error abriendo archivos binarios." << std::endl;
+        std::cerr << "Error adjuntando la tabla compartida: " << error << std::endl;
         exit(1);
     }
+    abrirArchivos();
 }
 
 // Escribe el offset del primer registro en la posición de la tabla hash
-void escribirHead(int pos, long long head_offset)
+// (compartida y en disco). Si la cadena se reconstruyó (`invalidarTramo`,
+// dentro de un cambio de estructura), el tramo agrupado del bucket deja de
+// valer y se anula; una inserción lo conserva.
+void escribirHead(int pos, long long head_offset, bool invalidarTramo = true)
 {
-    tabla_file.seekp(pos * sizeof(HashEntry), std::ios::beg);
-    HashEntry e{head_offset};
-    tabla_file.write(reinterpret_cast<char *>(&e), sizeof(e));
+    if (invalidarTramo)
+        tabla.escribirEntrada(pos, HashExtent{head_offset, NULL_OFFSET, 0});
+    else
+        tabla.escribirCabeza(pos, head_offset);
+    tabla_compartida::escribirEntrada(tabla_file, tabla, pos);
 }
 
-// Lee el offset del primer registro desde la tabla hash
+// Lee el offset del primer registro de la tabla compartida (al día con lo que
+// escribió la GUI aunque no haya llegado a tabla_hash.dat)
 long long leerHead(int pos)
 {
-    HashEntry e;
-    tabla_file.seekg(pos * sizeof(HashEntry), std::ios::beg);
-    tabla_file.read(reinterpret_cast<char *>(&e), sizeof(e));
-    return e.head_offset;
+    return tabla.leer(pos).head_offset;
 }
 
-// Inserta un nuevo registro clínico en la lista enlazada correspondiente al DNI
-void insertarRegistro(const RegistroClinico &r)
+// Inserta un nuevo registro clínico en la lista enlazada correspondiente al DNI.
+// Devuelve su offset, o NULL_OFFSET si no se pudo escribir.
+long long insertarRegistro(const RegistroClinico &r)
 {
+    tabla_compartida::Escritura rol(tabla, abrirArchivos); // si escribió la GUI, se reabren los archivos
     int pos = hash1(r.dni);                // Calcula la posición en la tabla hash
     long long head = leerHead(pos);        // Lee el offset actual de la cabeza de la lista
     RegistroClinico tmp = r;
-    registros_file.seekp(0, std::ios::end);// Se posiciona al final del archivo de registros
-    long long new_off = registros_file.tellp(); // Obtiene el offset donde se insertará el nuevo registro
+    long long new_off = libres::tomar("registros.dat", registros_file); // Reusa el lugar de una lápida si hay
+    if (new_off == NULL_OFFSET)
+    {
+        registros_file.seekp(0, std::ios::end);// Si no, se posiciona al final del archivo de registros
+        new_off = registros_file.tellp();  // Obtiene el offset donde se insertará el nuevo registro
+    }
+    else
+        registros_file.seekp(new_off, std::ios::beg);
     tmp.pos_siguiente = head;              // El nuevo registro apunta al anterior head
     registros_file.write(reinterpret_cast<char *>(&tmp), sizeof(tmp)); // Escribe el registro
-    escribirHead(pos, new_off);            // Actualiza la cabeza de la lista en la tabla hash
+    registros_file.flush();                // Visible en el tamaño del archivo (frescura de los derivados)
+    if (!registros_file)
+    {
+        registros_file.clear();
+        std::cerr << "No se pudo escribir el registro en registros.dat" << std::endl;
+        return NULL_OFFSET;                // la cadena y la tabla quedan como estaban
+    }
+    tabla.publicarTamRegistros(new_off + (long long)sizeof(tmp)); // y para los lectores de la GUI
+    escribirHead(pos, new_off, false);     // Actualiza la cabeza de la lista en la tabla hash
+    indice_fecha::registrar("registros.dat", tmp, new_off); // Alta en los índices por fecha y nombre (si existen)
+    indice_nombre::registrar("registros.dat", tmp, new_off);
+    filtro_dni::registrar("registros.dat", tmp, new_off);   // en el filtro de DNI
+    pacientes::registrar("registros.dat", tmp, new_off);    // y en el directorio de pacientes
+    tabla.sumarRegistros(1);               // Contador de la cabecera y, si hace falta, división de buckets
+    tabla_compartida::escribirCabecera(tabla_file, tabla);
+    tabla_compartida::crecer(tabla, registros_file, tabla_file);
+    tabla_file.flush();
+    return new_off;
+}
+
+// Offsets y registros de un DNI recorriendo su cadena. Si otro proceso cambió
+// la estructura mientras tanto (la GUI dividió buckets o eliminó), se repite.
+std::vector<std::pair<long long, RegistroClinico>> registrosDeDNI(int dni)
+{
+    std::vector<std::pair<long long, RegistroClinico>> encontrados;
+    reabrirSiCambio();
+    while (true)
+    {
+        unsigned long long epoca;
+        long long offset = tabla.entradaDe(dni, epoca).head_offset;
+        if (offset == NULL_OFFSET || filtro_dni::descartado("registros.dat", dni))
+            return encontrados;
+        long long filesize = std::filesystem::file_size("registros.dat");
+        long long invalido = NULL_OFFSET;
+        RegistroClinico r;
+        while (offset != NULL_OFFSET)
+        {
+            if (offset < 0 || offset + (long long)sizeof(r) > filesize)
+            {
+                invalido = offset;
+                break;
+            }
+            registros_file.seekg(offset, std::ios::beg);
+            registros_file.read(reinterpret_cast<char *>(&r), sizeof(r));
+            if (r.dni == dni)
+                encontrados.emplace_back(offset, r);
+            offset = r.pos_siguiente;
+        }
+        if (tabla.validar(epoca))
+        {
+            if (invalido != NULL_OFFSET)
+                std::cerr << "Offset inválido: " << invalido << "\n";
+            return encontrados;
+        }
+        encontrados.clear();
+    }
 }
 
 // Muestra los registros asociados a un DNI con índice y retorna sus offsets
 std::vector<long long> mostrarRegistrosConIndices(int dni)
 {
     std::vector<long long> offsets;
-    int pos = hash1(dni);
-    long long offset = leerHead(pos);
-    RegistroClinico r;
     int idx = 1;
 
-    if (offset == NULL_OFFSET)
-    {
-        std::cout << "No hay registros para el DNI " << dni << ".\n";
-        return offsets;
-    }
-
-    long long filesize = std::filesystem::file_size("registros.dat");
-
     // Recorre la lista enlazada de registros para ese DNI
-    while (offset != NULL_OFFSET)
+    for (const auto &e : registrosDeDNI(dni))
     {
-        if (offset < 0 || offset + sizeof(r) > filesize)
-        {
-            std::cerr << "Offset inválido: " << offset << "\n";
-            break;
-        }
-
-        registros_file.seekg(offset, std::ios::beg);
-        registros_file.read(reinterpret_cast<char *>(&r), sizeof(r));
-
-        if (r.dni == dni)
-        {
-            std::cout << "[" << idx << "] Fecha: " << r.fecha
-                      << " | Motivo: " << r.motivo
-                      << " | Médico: " << r.medico << "\n";
-            offsets.push_back(offset);
-            ++idx;
-        }
-
-        offset = r.pos_siguiente;
+        const RegistroClinico &r = e.second;
+        std::cout << "[" << idx << "] Fecha: " << r.fecha
+                  << " | Motivo: " << r.motivo
+                  << " | Médico: " << r.medico << "\n";
+        offsets.push_back(e.first);
+        ++idx;
     }
 
     if (offsets.empty())
@@ -157,9 +217,8 @@ std::vector<long long> mostrarRegistrosConIndices(int dni)
 // Busca y muestra todos los registros asociados a un DNI
 void buscarPorDNI(int dni)
 {
-    int pos = hash1(dni);
-    long long offset = leerHead(pos);
-    if (offset == NULL_OFFSET)
+    reabrirSiCambio();
+    if (leerHead(hash1(dni)) == NULL_OFFSET || filtro_dni::descartado("registros.dat", dni))
     {
         std::cout << "No hay registros para DNI " << dni << "\n";
         return;
@@ -167,136 +226,120 @@ void buscarPorDNI(int dni)
 
     RegistroClinico r;
     int idx = 0;
-    long long filesize = std::filesystem::file_size("registros.dat");
-
-    // Recorre la lista enlazada y muestra los registros que coinciden con el DNI
-    while (offset != NULL_OFFSET)
+    auto mostrar = [&]()
+    {
+        std::cout << "--- Registro " << ++idx << " ---\n"
+                  << "Fecha: " << r.fecha << "\n"
+                  << "DNI: " << r.dni << "   Edad: " << r.edad << "\n"
+                  << "Nombre: " << r.nombre << " " << r.apellido << "\n"
+                  << "Medico: " << r.medico << "\n"
+                  << "Motivo: " << r.motivo << "\n"
+                  << "Examenes: " << r.examenes << "\n"
+                  << "Resultados: " << r.resultados << "\n"
+                  << "Receta: " << r.receta << "\n\n";
+    };
+
+    // Con directorio fresco se leen solo los registros del paciente
+    pacientes::Directorio directorio;
+    std::vector<long long> offsets;
+    if (directorio.abrir("registros.dat") && directorio.fresco() && directorio.buscar(dni, offsets))
     {
-        if (offset < 0 || offset + sizeof(r) > filesize)
+        for (long long off : offsets)
         {
-            std::cerr << "Offset inválido " << offset << "\n";
-            break;
+            registros_file.seekg(off, std::ios::beg);
+            if (registros_file.read(reinterpret_cast<char *>(&r), sizeof(r)) && r.dni == dni)
+                mostrar();
         }
-
-        registros_file.seekg(offset, std::ios::beg);
-        registros_file.read(reinterpret_cast<char *>(&r), sizeof(r));
-        if (r.dni == dni)
+    }
+    else
+    {
+        // Si no, recorre la lista enlazada y muestra los registros que coinciden con el DNI
+        for (const auto &e : registrosDeDNI(dni))
         {
-            std::cout << "--- Registro " << ++idx << " ---\n"
-                      << "Fecha: " << r.fecha << "\n"
-                      << "DNI: " << r.dni << "   Edad: " << r.edad << "\n"
-                      << "Nombre: " << r.nombre << " " << r.apellido << "\n"
-                      << "Medico: " << r.medico << "\n"
-                      << "Motivo: " << r.motivo << "\n"
-                      << "Examenes: " << r.examenes << "\n"
-                      << "Resultados: " << r.resultados << "\n"
-                      << "Receta: " << r.receta << "\n\n";
+            r = e.second;
+            mostrar();
         }
-        offset = r.pos_siguiente;
     }
 
     if (idx == 0)
         std::cout << "No se encontraron registros para DNI " << dni << "\n";
 }
 
-// Elimina lógicamente todos los registros asociados a un DNI
-void eliminarRegistrosDeDNI(int dni)
+// Desenlaza de la cadena del DNI los registros que cumplen `quitar` y los
+// convierte en lápidas (lista de libres, registros_libres.h): los demás
+// registros no se mueven, así que los índices solo reciben las bajas.
+template <typename QuitarFn>
+long long eliminarDeCadena(int dni, QuitarFn quitar)
 {
+    tabla_compartida::Escritura rol(tabla, abrirArchivos);
     int pos = hash1(dni);
-    long long offset = leerHead(pos);
-    long long new_head = NULL_OFFSET;
-    RegistroClinico actual;
-
-    // Recorre la lista enlazada y copia solo los registros que NO coinciden con el DNI
-    while (offset != NULL_OFFSET)
+    long long filesize = std::filesystem::file_size("registros.dat");
+    std::vector<std::pair<long long, RegistroClinico>> quitados;
+    // Las búsquedas de la GUI que estén recorriendo la cadena la repiten
+    tabla.empezarCambio();
+    long long new_head = libres::quitarDeCadena(leerHead(pos), filesize, registros_file, quitar, quitados);
+    if (!quitados.empty())
+        escribirHead(pos, new_head);       // La cadena cambió: se anula el tramo agrupado
+    tabla.terminarCambio();
+    if (quitados.empty())
+        return 0;
+
+    for (const auto &q : quitados)
     {
-        registros_file.seekg(offset);
-        registros_file.read(reinterpret_cast<char *>(&actual), sizeof(actual));
-        long long siguiente = actual.pos_siguiente;
-
-        if (actual.dni != dni)
-        {
-            // Guardamos este nodo
-            RegistroClinico copia = actual;
-            copia.pos_siguiente = new_head;
-            registros_file.seekp(0, std::ios::end);
-            long long nuevo_offset = registros_file.tellp();
-            registros_file.write(reinterpret_cast<char *>(&copia), sizeof(copia));
-            new_head = nuevo_offset;
-        }
-
-        offset = siguiente;
+        // El registro deja de estar vivo para los índices y el directorio
+        indice_fecha::registrar("registros.dat", q.second, q.first, indice_fecha::DELTA_BAJA);
+        indice_nombre::registrar("registros.dat", q.second, q.first, indice_nombre::DELTA_BAJA);
+        pacientes::registrar("registros.dat", q.second, q.first, pacientes::BAJA);
+        libres::liberar("registros.dat", registros_file, q.first);
     }
-
-    escribirHead(pos, new_head);
-    std::cout << "Registros del DNI " << dni << " eliminados (lógicamente).\n";
-
-    // Sincronizar y cerrar archivos
+    tabla.sumarRegistros(-(long long)quitados.size());
+    tabla_compartida::escribirCabecera(tabla_file, tabla);
     registros_file.flush();
-    registros_file.close();
     tabla_file.flush();
-    tabla_file.close();
-
-    // Reabrir archivos
-    tabla_file.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
-    registros_file.open("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
-    if (!tabla_file.is_open() || !registros_file.is_open())
-    {
-        std::cerr << "Error reabriendo archivos tras eliminación.\n";
-        exit(1);
-    }
+    return (long long)quitados.size();
 }
 
-// Elimina lógicamente un registro específico de un DNI (por índice)
-void eliminarUnRegistroDeDNI(int dni, int indiceEliminar)
+// Elimina lógicamente todos los registros asociados a un DNI
+void eliminarRegistrosDeDNI(int dni)
 {
-    int pos = hash1(dni);
-    long long offset = leerHead(pos);
-    long long new_head = NULL_OFFSET;
-    RegistroClinico actual;
-    int idx = 0;
-
-    // Recorre la lista enlazada y copia todos los registros excepto el que se quiere eliminar
-    while (offset != NULL_OFFSET)
-    {
-        registros_file.seekg(offset);
-        registros_file.read(reinterpret_cast<char *>(&actual), sizeof(actual));
-        long long siguiente = actual.pos_siguiente;
-
-        if (actual.dni != dni || idx != indiceEliminar)
-        {
-            // Copiar este nodo a una nueva posición, excepto si es el que queremos eliminar
-            RegistroClinico copia = actual;
-            copia.pos_siguiente = new_head;
-            registros_file.seekp(0, std::ios::end);
-            long long nuevo_offset = registros_file.tellp();
-            registros_file.write(reinterpret_cast<char *>(&copia), sizeof(copia));
-            new_head = nuevo_offset;
-        }
-
-        if (actual.dni == dni)
-            idx++;
-
-        offset = siguiente;
-    }
-
-    escribirHead(pos, new_head);
-    std::cout << "Registro " << indiceEliminar << " del DNI " << dni << " eliminado correctamente.\n";
+    eliminarDeCadena(dni, [&](long long, const RegistroClinico &r) { return r.dni == dni; });
+    std::cout << "Registros del DNI " << dni << " eliminados (lógicamente).\n";
+}
 
-    // Sincronizar y cerrar archivos
-    registros_file.flush();
-    registros_file.close();
-    tabla_file.flush();
-    tabla_file.close();
+// Elimina lógicamente un registro específico de un DNI. Se identifica por su
+// offset (el que mostró mostrarRegistrosConIndices): la posición en la cadena
+// no es estable (lápidas reusadas, divisiones, agrupado).
+void eliminarUnRegistroDeDNI(int dni, long long offsetEliminar)
+{
+    long long n = eliminarDeCadena(dni, [&](long long off, const RegistroClinico &r) {
+        return off == offsetEliminar && r.dni == dni;
+    });
+    if (n == 1)
+        std::cout << "Registro del DNI " << dni << " eliminado correctamente.\n";
+    else
+        std::cout << "El registro ya no existe.\n";
+}
 
-    // Reabrir archivos
-    tabla_file.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
-    registros_file.open("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
-    if (!tabla_file.is_open() || !registros_file.is_open())
+// Edita el registro en `offset` (del DNI `dni`). Con el mismo DNI se
+// sobrescribe en el lugar: una escritura, sin tocar la cadena ni la tabla. Con
+// otro DNI se reubica en la cadena nueva (alta del nuevo y después baja del viejo).
+bool actualizarRegistro(int dni, long long offset, const RegistroClinico &nuevo)
+{
+    tabla_compartida::Escritura rol(tabla, abrirArchivos);
+    RegistroClinico viejo;
+    if (!edicion::leerVigente(registros_file, offset, dni, viejo))
+        return false;                      // se eliminó o se reusó el lugar
+    if (edicion::enElLugar(viejo, nuevo))
     {
-        std::cerr << "Error reabriendo archivos tras eliminación.\n";
-        exit(1);
+        if (!edicion::sobrescribir(registros_file, offset, nuevo))
+            return false;
+        edicion::registrarDerivados("registros.dat", offset, viejo, nuevo);
+        return true;
     }
+    // El viejo se elimina solo si el alta quedó escrita (si no, la edición no se hizo)
+    if (insertarRegistro(nuevo) == NULL_OFFSET)
+        return false;
+    return eliminarDeCadena(dni, [&](long long off, const RegistroClinico &r) { return off == offset && r.dni == dni; }) == 1;
 }
 
 // Validaciones de campos de entrada
@@ -316,6 +359,35 @@ bool validarEdad(int edad) {
     return edad >= 0 && edad <= 120;
 }
 
+// Pide un campo de texto mostrando el valor actual; ENTER lo conserva
+bool editarCampo(const char* etiqueta, char* campo, int maxLen) {
+    std::string linea;
+    std::cout << etiqueta << " [" << campo << "]: ";
+    std::getline(std::cin, linea);
+    if (linea.empty())
+        return true;
+    if (!validarTexto(linea.c_str(), maxLen))
+        return false;
+    std::memset(campo, 0, maxLen);
+    std::memcpy(campo, linea.data(), linea.size());
+    return true;
+}
+
+// Pide un campo numérico mostrando el valor actual; ENTER lo conserva
+bool editarNumero(const char* etiqueta, int& valor) {
+    std::string linea;
+    std::cout << etiqueta << " [" << valor << "]: ";
+    std::getline(std::cin, linea);
+    if (linea.empty())
+        return true;
+    char* fin = nullptr;
+    long v = std::strtol(linea.c_str(), &fin, 10);
+    if (*fin != '\0')
+        return false;
+    valor = (int)v;
+    return true;
+}
+
 int main()
 {
     inicializarArchivos(); // Prepara los archivos necesarios
@@ -323,12 +395,16 @@ int main()
     int opcion;
     while (true)
     {
+        // Entre operaciones el rol de escritor queda libre para la GUI
+        tabla.soltar();
+
         // Menú principal
         std::cout << "\n--- MENÚ GESTOR DE REGISTROS ---\n";
         std::cout << "1. Buscar por DNI\n";
         std::cout << "2. Insertar nuevo registro\n";
         std::cout << "3. Eliminar todos los registros de un DNI\n";
         std::cout << "4. Eliminar un registro específico de un DNI\n";
+        std::cout << "5. Editar un registro de un DNI\n";
         std::cout << "0. Salir\n";
         std::cout << "Opción: ";
         std::cin >> opcion;
@@ -426,18 +502,7 @@ int main()
             insertarRegistro(r);
 
             // Sincroniza y reabre archivos tras la inserción
-            registros_file.flush();
-            registros_file.close();
-            tabla_file.flush();
-            tabla_file.close();
-
-            tabla_file.open("tabla_hash.dat", std::ios::in | std::ios::out | std::ios::binary);
-            registros_file.open("registros.dat", std::ios::in | std::ios::out | std::ios::binary);
-            if (!tabla_file.is_open() || !registros_file.is_open())
-            {
-                std::cerr << "Error reabriendo archivos tras inserción.\n";
-                exit(1);
-            }
+            abrirArchivos();
 
             std::cout << "Registro insertado con éxito.\n";
         }
@@ -464,18 +529,61 @@ int main()
             std::cin >> idxEliminar;
             idxEliminar--;  // Ajustar de índice de usuario (1-based) a índice real (0-based)
 
-            if (idxEliminar < 0 || idxEliminar >= offsets.size()) {
+            if (idxEliminar < 0 || idxEliminar >= (int)offsets.size()) {
+                std::cout << "Índice inválido.\n";
+                continue;
+            }
+            eliminarUnRegistroDeDNI(dni, offsets[idxEliminar]);
+
+        }
+        else if (opcion == 5)
+        {
+            // Editar un registro de un DNI (ENTER conserva cada campo)
+            std::cout << "Ingrese DNI: ";
+            std::cin >> dni;
+            auto offsets = mostrarRegistrosConIndices(dni);
+            if (offsets.empty()) {
+                std::cout << "No hay registros para editar.\n";
+                continue;
+            }
+            int idxEditar;
+            std::cout << "Ingrese el número del registro a editar: ";
+            std::cin >> idxEditar;
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');  // Limpia ENTER
+            idxEditar--;
+            if (idxEditar < 0 || idxEditar >= (int)offsets.size()) {
                 std::cout << "Índice inválido.\n";
                 continue;
             }
-            eliminarUnRegistroDeDNI(dni, idxEliminar);
 
+            RegistroClinico r;
+            if (!edicion::leerVigente(registros_file, offsets[idxEditar], dni, r)) {
+                std::cerr << "El registro ya no existe.\n";
+                continue;
+            }
+            bool ok = editarCampo("Fecha (AAAA-MM-DD)", r.fecha, 11) && validarFecha(r.fecha) &&
+                      editarNumero("DNI", r.dni) && validarDNI(r.dni) &&
+                      editarCampo("Nombre", r.nombre, 25) && editarCampo("Apellido", r.apellido, 25) &&
+                      editarNumero("Edad", r.edad) && validarEdad(r.edad) &&
+                      editarCampo("Medico", r.medico, 40) && editarCampo("Motivo", r.motivo, 50) &&
+                      editarCampo("Examenes", r.examenes, 50) && editarCampo("Resultados", r.resultados, 30) &&
+                      editarCampo("Receta", r.receta, 60);
+            if (!ok) {
+                std::cerr << "Valor inválido; no se modificó el registro.\n";
+                continue;
+            }
+            if (!actualizarRegistro(dni, offsets[idxEditar], r)) {
+                std::cerr << "No se pudo actualizar el registro.\n";
+                continue;
+            }
+            std::cout << (r.dni == dni ? "Registro actualizado en el lugar.\n" : "Registro movido al DNI nuevo.\n");
         }
 
     }
 
     tabla_file.close();
     registros_file.close();
+    tabla.soltar();
     std::cout << "Saliendo del gestor.\n";
     return 0;
 }
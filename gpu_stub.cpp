@@ -4,7 +4,12 @@
 // - contarPacientesRangoEdad_GPU: replica el comportamiento del kernel (cuenta visitas)
 // - contarPacientesRangoEdadUnicos_CPU: cuenta pacientes únicos por DNI (deduplicación en host)
 // Usar el stub cuando no exista soporte CUDA en la máquina de desarrollo.
+// Si hay columnas frescas junto a registros.dat (columnas.h) se cuentan sobre
+// edad.col/dni.col; si no, sobre la copia compacta v2 (registro_v2.h) y, si
+// tampoco está, se recorre registros.dat completo.
 #include "common.h"
+#include "columnas.h"
+#include "registro_v2.h"
 #include <fstream>
 #include <vector>
 #include <iostream>
@@ -15,6 +20,10 @@
 // Location: gpu_stub.cpp -> contarPacientesRangoEdad_GPU
 extern "C" long long contarPacientesRangoEdad_GPU(const char* archivo, int minEdad, int maxEdad)
 {
+    long long desdeColumnas = 0;
+    if (columnas::contarRangoEdad(archivo, minEdad, maxEdad, desdeColumnas)) return desdeColumnas;
+    if (registro_v2::contarRangoEdad(archivo, minEdad, maxEdad, false, desdeColumnas)) return desdeColumnas;
+
     const size_t CHUNK = 100000;
     std::ifstream in(archivo, std::ios::binary | std::ios::ate);
     if (!in.is_open()) {
@@ -50,6 +59,10 @@ extern "C" long long contarPacientesRangoEdad_GPU(const char* archivo, int minEd
 // Location: gpu_stub.cpp -> contarPacientesRangoEdadUnicos_CPU
 extern "C" long long contarPacientesRangoEdadUnicos_CPU(const char* archivo, int minEdad, int maxEdad)
 {
+    long long desdeColumnas = 0;
+    if (columnas::contarUnicosRangoEdad(archivo, minEdad, maxEdad, desdeColumnas)) return desdeColumnas;
+    if (registro_v2::contarRangoEdad(archivo, minEdad, maxEdad, true, desdeColumnas)) return desdeColumnas;
+
     const size_t CHUNK = 100000;
     std::ifstream in(archivo, std::ios::binary | std::ios::ate);
     if (!in.is_open()) {
@@ -0,0 +1,123 @@
+// indice_fecha.cpp
+// Herramienta para el índice por fecha (ver indice_fecha.h).
+// Uso:
+//   indice_fecha construir [registros.dat] [--cadenas tabla_hash.dat]
+//   indice_fecha rango <AAAA-MM-DD> <AAAA-MM-DD> [registros.dat] [--offsets] [--limite N]
+//   indice_fecha compactar [registros.dat]
+//   indice_fecha info [registros.dat]
+// `construir` recorre registros.dat en orden; con --cadenas indexa solo los
+// registros alcanzables desde la tabla hash (descarta copias sueltas).
+// `rango` imprime los registros (o solo los offsets) con fecha en el rango.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "indice_fecha.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int construir(const std::string& ruta, const std::string& ruta_tabla)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = ruta_tabla.empty() ? indice_fecha::construir(ruta) : indice_fecha::construirDesdeCadenas(ruta, ruta_tabla);
+    indice_fecha::Indice idx;
+    if (!ok || !idx.abrir(ruta)) {
+        std::cerr << "Error al construir el índice por fecha de " << ruta << "\n";
+        return 1;
+    }
+    std::cout << "Índice por fecha: " << idx.cabecera().num_entradas << " entradas ("
+              << idx.cabecera().sin_fecha << " registros sin fecha válida) en " << segundosDesde(t0) << " s\n";
+    return 0;
+}
+
+int rango(const std::string& desde, const std::string& hasta, const std::string& ruta, bool solo_offsets, size_t limite)
+{
+    int32_t d0 = columnas::fechaADias(desde.c_str()), d1 = columnas::fechaADias(hasta.c_str());
+    if (desde.size() != 10 || hasta.size() != 10 || d0 == columnas::FECHA_INVALIDA || d1 == columnas::FECHA_INVALIDA) {
+        std::cerr << "Fechas inválidas (formato AAAA-MM-DD)\n";
+        return 1;
+    }
+    indice_fecha::Indice idx;
+    if (!idx.abrir(ruta)) {
+        std::cerr << "No hay índice por fecha para " << ruta << " (correr indice_fecha construir)\n";
+        return 1;
+    }
+    if (!idx.fresco()) {
+        std::cerr << "El índice por fecha no cubre el registros.dat actual (correr indice_fecha construir)\n";
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<indice_fecha::Entrada> res;
+    if (!idx.rango(d0, d1, res, limite)) {
+        std::cerr << "Error al leer el índice\n";
+        return 1;
+    }
+    double t = segundosDesde(t0);
+
+    int fd = solo_offsets ? -1 : ::open(ruta.c_str(), O_RDONLY);
+    for (auto& e : res) {
+        if (solo_offsets) {
+            std::cout << e.offset << "\n";
+            continue;
+        }
+        RegistroClinico r;
+        if (fd < 0 || ::pread(fd, &r, sizeof(r), (off_t)e.offset) != (ssize_t)sizeof(r)) continue;
+        std::cout << "Offset " << e.offset << ": " << r.fecha << " | DNI " << r.dni << " | " << r.nombre << " "
+                  << r.apellido << " | " << r.medico << " | " << r.motivo << "\n";
+    }
+    if (fd >= 0) ::close(fd);
+    std::cerr << res.size() << " registro(s) entre " << desde << " y " << hasta << " (índice: " << t << " s)\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = (argc > 1) ? argv[1] : "";
+    std::string ruta = "registros.dat", ruta_tabla;
+    std::vector<std::string> pos;
+    bool solo_offsets = false;
+    size_t limite = SIZE_MAX;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--cadenas" && i + 1 < argc) ruta_tabla = argv[++i];
+        else if (a == "--offsets") solo_offsets = true;
+        else if (a == "--limite" && i + 1 < argc) limite = (size_t)std::max(0LL, std::atoll(argv[++i]));
+        else pos.push_back(a);
+    }
+    if (modo == "construir") {
+        if (!pos.empty()) ruta = pos[0];
+        return construir(ruta, ruta_tabla);
+    }
+    if (modo == "rango" && pos.size() >= 2) {
+        if (pos.size() > 2) ruta = pos[2];
+        return rango(pos[0], pos[1], ruta, solo_offsets, limite);
+    }
+    if (modo == "compactar" || modo == "info") {
+        if (!pos.empty()) ruta = pos[0];
+        indice_fecha::Indice idx;
+        if (!idx.abrir(ruta)) {
+            std::cerr << "No hay índice por fecha para " << ruta << "\n";
+            return 1;
+        }
+        if (modo == "compactar" && !idx.compactar()) {
+            std::cerr << "Error al compactar el índice\n";
+            return 1;
+        }
+        std::cout << "Índice por fecha: " << idx.cabecera().num_entradas << " entradas, " << idx.entradasDelta()
+                  << " en el delta, " << idx.cabecera().sin_fecha << " sin fecha, "
+                  << (idx.fresco() ? "fresco" : "desactualizado") << "\n";
+        return 0;
+    }
+    std::cerr << "Uso:\n"
+              << "  indice_fecha construir [registros.dat] [--cadenas tabla_hash.dat]\n"
+              << "  indice_fecha rango <AAAA-MM-DD> <AAAA-MM-DD> [registros.dat] [--offsets] [--limite N]\n"
+              << "  indice_fecha compactar [registros.dat]\n"
+              << "  indice_fecha info [registros.dat]\n";
+    return 1;
+}
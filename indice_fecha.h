@@ -0,0 +1,361 @@
+// indice_fecha.h
+// Índice secundario por `fecha` para consultas por rango ("todas las visitas
+// entre 2024-01-01 y 2024-03-31") sin recorrer registros.dat:
+// - `indice_fecha.dat`  : IndiceCabecera + entradas (días, offset) ordenadas por
+//   (días, offset) + nivel superior disperso (la fecha de cada PASO-ésima
+//   entrada) que se carga en memoria. Una consulta hace búsqueda binaria en el
+//   nivel superior y lee entradas desde ahí hasta pasar el fin del rango: el
+//   costo es proporcional al resultado (más un paso), no al archivo.
+// - `indice_fecha.delta`: altas y bajas posteriores a la construcción, sin
+//   ordenar (inserciones de la GUI / gestor). Las consultas las combinan con la
+//   base y, cuando el delta supera UMBRAL_DELTA entradas, se fusiona en la base.
+// Las fechas que no son AAAA-MM-DD no se indexan (se cuentan en `sin_fecha`).
+// Frescura: tamaño de registros.dat == tam_registros + altas al final del delta *
+// sizeof(RegistroClinico) (un alta que reusa una lápida no cambia el tamaño).
+// Lo construyen el loader (en paralelo) y `indice_fecha construir`.
+#pragma once
+#include "common.h"
+#include "columnas.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace indice_fecha {
+
+static const char IDX_MAGIC[8] = {'P', 'P', 'F', 'E', 'C', 'H', 'A', '1'};
+static const int32_t IDX_VERSION = 1;
+static const int32_t PASO_DEFECTO = 256;        // entradas por elemento del nivel superior
+static const long long UMBRAL_DELTA = 65536;    // entradas del delta antes de fusionar
+static const uint8_t DELTA_ALTA = 1;
+static const uint8_t DELTA_BAJA = 2;
+
+#pragma pack(push, 1)
+struct IndiceCabecera {
+    char magic[8];             // IDX_MAGIC
+    int32_t version;           // IDX_VERSION
+    int32_t paso;              // entradas por elemento del nivel superior
+    int64_t num_entradas;
+    int64_t tam_registros;     // bytes de registros.dat cubiertos por la base
+    int64_t sin_fecha;         // registros sin fecha válida (no indexados)
+    int64_t reservado[3];
+};
+
+struct Entrada {
+    int32_t dias;              // días desde 1970-01-01 (columnas::fechaADias)
+    int64_t offset;            // offset del registro en registros.dat
+};
+
+struct EntradaDelta {
+    int32_t dias;
+    uint8_t tipo;              // DELTA_ALTA o DELTA_BAJA
+    int64_t offset;
+};
+#pragma pack(pop)
+
+inline bool operator<(const Entrada &a, const Entrada &b)
+{
+    return a.dias != b.dias ? a.dias < b.dias : a.offset < b.offset;
+}
+
+inline std::string rutaIndice(const std::string &r) { return rutaJunto(r, "indice_fecha.dat"); }
+inline std::string rutaDelta(const std::string &r) { return rutaJunto(r, "indice_fecha.delta"); }
+
+inline long long offsetEntrada(long long i)
+{
+    return (long long)sizeof(IndiceCabecera) + i * (long long)sizeof(Entrada);
+}
+
+inline IndiceCabecera cabecera(long long num, long long tam_registros, long long sin_fecha, int32_t paso)
+{
+    IndiceCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, IDX_MAGIC, sizeof(IDX_MAGIC));
+    c.version = IDX_VERSION;
+    c.paso = paso;
+    c.num_entradas = num;
+    c.tam_registros = tam_registros;
+    c.sin_fecha = sin_fecha;
+    return c;
+}
+
+// Escribe el índice completo a partir de entradas ya ordenadas (vía temporal + rename)
+inline bool escribir(const std::string &ruta_registros, const std::vector<Entrada> &entradas, long long tam_registros,
+                     long long sin_fecha, int32_t paso = PASO_DEFECTO)
+{
+    const std::string ruta = rutaIndice(ruta_registros), tmp = ruta + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    IndiceCabecera cab = cabecera((long long)entradas.size(), tam_registros, sin_fecha, paso);
+    std::vector<int32_t> superior;
+    for (size_t i = 0; i < entradas.size(); i += (size_t)paso) superior.push_back(entradas[i].dias);
+    size_t bytes = entradas.size() * sizeof(Entrada);
+    bool ok = ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) &&
+              ::pwrite(fd, entradas.data(), bytes, (off_t)sizeof(cab)) == (ssize_t)bytes &&
+              ::pwrite(fd, superior.data(), superior.size() * sizeof(int32_t), (off_t)(sizeof(cab) + bytes)) ==
+                  (ssize_t)(superior.size() * sizeof(int32_t));
+    ::close(fd);
+    // Base nueva: el delta anterior ya está incluido (o no corresponde)
+    ok = ok && ::rename(tmp.c_str(), ruta.c_str()) == 0;
+    if (ok) ::truncate(rutaDelta(ruta_registros).c_str(), 0);
+    return ok;
+}
+
+// Construye el índice recorriendo registros.dat en orden (todos los registros
+// salvo las lápidas: salida del loader, de Limpieza o de la compactación de la GUI)
+inline bool construir(const std::string &ruta_registros, size_t registros_por_lote = 1 << 15)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    long long num = tam / (long long)sz;
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    std::vector<Entrada> entradas;
+    long long sin_fecha = 0;
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+        for (size_t k = 0; ok && k < n; ++k) {
+            if (esBorrado(buf[k])) continue;
+            int32_t d = columnas::fechaADias(buf[k].fecha);
+            if (d == columnas::FECHA_INVALIDA) ++sin_fecha;
+            else entradas.push_back(Entrada{d, (i + (long long)k) * (long long)sz});
+        }
+    }
+    ::close(in);
+    if (!ok) return false;
+    std::sort(entradas.begin(), entradas.end());
+    return escribir(ruta_registros, entradas, num * (long long)sz, sin_fecha);
+}
+
+// Construye el índice solo con los registros alcanzables desde tabla_hash.dat
+// (descarta lápidas y copias sueltas de eliminaciones anteriores)
+inline bool construirDesdeCadenas(const std::string &ruta_registros, const std::string &ruta_tabla)
+{
+    tabla_hash::Tabla tabla;
+    if (!tabla_hash::cargar(ruta_tabla, tabla)) return false;
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    std::vector<Entrada> entradas;
+    long long sin_fecha = 0;
+    for (const HashExtent &e : tabla.entradas) {
+        tabla_hash::recorrerBucket(e, tam,
+            [&](long long off, void *dst, size_t n) { return ::pread(in, dst, n, (off_t)off) == (ssize_t)n; },
+            [&](long long off, const RegistroClinico &r) {
+                int32_t d = columnas::fechaADias(r.fecha);
+                if (d == columnas::FECHA_INVALIDA) ++sin_fecha;
+                else entradas.push_back(Entrada{d, off});
+            });
+    }
+    ::close(in);
+    std::sort(entradas.begin(), entradas.end());
+    long long num = tam / (long long)sizeof(RegistroClinico);
+    return escribir(ruta_registros, entradas, num * (long long)sizeof(RegistroClinico), sin_fecha);
+}
+
+class Indice {
+public:
+    Indice() = default;
+    Indice(const Indice &) = delete;
+    Indice &operator=(const Indice &) = delete;
+    ~Indice() { cerrar(); }
+
+    // Carga cabecera, nivel superior y delta. false si no hay índice.
+    bool abrir(const std::string &ruta_registros) {
+        cerrar();
+        ruta_registros_ = ruta_registros;
+        fd_ = ::open(rutaIndice(ruta_registros).c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        bool ok = ::pread(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  std::memcmp(cab_.magic, IDX_MAGIC, sizeof(IDX_MAGIC)) == 0 && cab_.version == IDX_VERSION &&
+                  cab_.paso > 0 && cab_.num_entradas >= 0;
+        if (ok) {
+            superior_.resize((size_t)((cab_.num_entradas + cab_.paso - 1) / cab_.paso));
+            size_t bytes = superior_.size() * sizeof(int32_t);
+            ok = ::pread(fd_, superior_.data(), bytes, (off_t)offsetEntrada(cab_.num_entradas)) == (ssize_t)bytes;
+        }
+        ok = ok && cargarDelta();
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        superior_.clear();
+        altas_.clear();
+        bajas_.clear();
+    }
+
+    const IndiceCabecera &cabecera() const { return cab_; }
+    long long entradasDelta() const { return entradas_delta_; }
+
+    // El índice cubre exactamente el registros.dat actual
+    bool fresco() const { return cubre(tamArchivo(ruta_registros_)); }
+    // Variante sin stat: cubre exactamente los primeros `tam_registros` bytes
+    bool cubre(long long tam_registros) const {
+        return fd_ >= 0 && tam_registros == cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico);
+    }
+
+    // Entradas con fecha en [desde, hasta] (días), ordenadas por (días, offset)
+    bool rango(int32_t desde, int32_t hasta, std::vector<Entrada> &resultado, size_t limite = SIZE_MAX) const {
+        resultado.clear();
+        desde = std::max(desde, columnas::FECHA_INVALIDA + 1);
+        if (fd_ < 0 || desde > hasta) return fd_ >= 0;
+        // Primer bloque del nivel superior que puede contener `desde`
+        size_t j = (size_t)(std::lower_bound(superior_.begin(), superior_.end(), desde) - superior_.begin());
+        long long i = (j == 0) ? 0 : (long long)(j - 1) * cab_.paso;
+        std::vector<Entrada> buf((size_t)cab_.paso);
+        bool fin = false;
+        while (!fin && i < cab_.num_entradas) {
+            size_t n = (size_t)std::min<long long>(cab_.paso, cab_.num_entradas - i);
+            if (::pread(fd_, buf.data(), n * sizeof(Entrada), (off_t)offsetEntrada(i)) != (ssize_t)(n * sizeof(Entrada)))
+                return false;
+            for (size_t k = 0; k < n; ++k) {
+                if (buf[k].dias > hasta) { fin = true; break; }
+                if (buf[k].dias >= desde && !bajas_.count(buf[k].offset)) resultado.push_back(buf[k]);
+            }
+            i += (long long)n;
+        }
+        // Altas vivas del delta (ordenadas al cargar)
+        auto a = std::lower_bound(altas_.begin(), altas_.end(), Entrada{desde, -1});
+        std::vector<Entrada> delta(a, std::upper_bound(a, altas_.end(), Entrada{hasta, INT64_MAX}));
+        if (!delta.empty()) {
+            std::vector<Entrada> mezcla;
+            mezcla.reserve(resultado.size() + delta.size());
+            std::merge(resultado.begin(), resultado.end(), delta.begin(), delta.end(), std::back_inserter(mezcla));
+            resultado.swap(mezcla);
+        }
+        if (resultado.size() > limite) resultado.resize(limite);
+        return true;
+    }
+
+    // Fusiona el delta en la base (lectura secuencial de la base)
+    bool compactar() {
+        if (fd_ < 0) return false;
+        std::vector<Entrada> todas;
+        todas.reserve((size_t)cab_.num_entradas + altas_.size());
+        std::vector<Entrada> buf(1 << 15);
+        for (long long i = 0; i < cab_.num_entradas; i += (long long)buf.size()) {
+            size_t n = (size_t)std::min<long long>((long long)buf.size(), cab_.num_entradas - i);
+            if (::pread(fd_, buf.data(), n * sizeof(Entrada), (off_t)offsetEntrada(i)) != (ssize_t)(n * sizeof(Entrada)))
+                return false;
+            for (size_t k = 0; k < n; ++k)
+                if (!bajas_.count(buf[k].offset)) todas.push_back(buf[k]);
+        }
+        size_t antes = todas.size();
+        todas.insert(todas.end(), altas_.begin(), altas_.end());
+        std::inplace_merge(todas.begin(), todas.begin() + (long long)antes, todas.end());
+        long long tam = cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico);
+        std::string ruta = ruta_registros_;
+        int32_t paso = cab_.paso;
+        long long sin_fecha = cab_.sin_fecha + sin_fecha_delta_;
+        cerrar();
+        return escribir(ruta, todas, tam, sin_fecha, paso) && abrir(ruta);
+    }
+
+private:
+    // Las bajas ocultan la entrada de la base y el alta previa del delta con ese
+    // offset; un alta posterior en el mismo offset (lápida reusada) vuelve a valer.
+    bool cargarDelta() {
+        altas_.clear();
+        bajas_.clear();
+        altas_totales_ = sin_fecha_delta_ = entradas_delta_ = 0;
+        int fd = ::open(rutaDelta(ruta_registros_).c_str(), O_RDONLY);
+        if (fd < 0) return true; // sin delta
+        std::unordered_map<long long, int32_t> vivas; // offset -> días de las altas del delta
+        std::vector<EntradaDelta> buf(4096);
+        ssize_t leidos;
+        off_t off = 0;
+        while ((leidos = ::pread(fd, buf.data(), buf.size() * sizeof(EntradaDelta), off)) > 0) {
+            size_t n = (size_t)leidos / sizeof(EntradaDelta);
+            if (n == 0) break;
+            for (size_t k = 0; k < n; ++k) {
+                const EntradaDelta &e = buf[k];
+                ++entradas_delta_;
+                if (e.tipo == DELTA_BAJA) {
+                    bajas_.insert(e.offset);
+                    vivas.erase(e.offset);
+                    if (e.dias == columnas::FECHA_INVALIDA) --sin_fecha_delta_;
+                    continue;
+                }
+                if (e.offset == cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico))
+                    ++altas_totales_;
+                if (e.dias == columnas::FECHA_INVALIDA) ++sin_fecha_delta_;
+                vivas[e.offset] = e.dias;
+            }
+            off += (off_t)(n * sizeof(EntradaDelta));
+        }
+        ::close(fd);
+        for (const auto &v : vivas)
+            if (v.second != columnas::FECHA_INVALIDA) altas_.push_back(Entrada{v.second, v.first});
+        std::sort(altas_.begin(), altas_.end());
+        return true;
+    }
+
+    std::string ruta_registros_;
+    int fd_ = -1;
+    IndiceCabecera cab_{};
+    std::vector<int32_t> superior_;
+    std::vector<Entrada> altas_;
+    std::unordered_set<long long> bajas_;
+    long long altas_totales_ = 0;
+    long long sin_fecha_delta_ = 0;
+    long long entradas_delta_ = 0;
+};
+
+// Registra en el delta el alta (`tipo` DELTA_ALTA) o baja de un registro. Si
+// no hay índice no hace nada. Cuando el delta crece más que UMBRAL_DELTA se
+// fusiona en la base (costo amortizado entre muchas inserciones).
+inline bool registrar(const std::string &ruta_registros, const RegistroClinico &r, long long offset,
+                      uint8_t tipo = DELTA_ALTA)
+{
+    if (tamArchivo(rutaIndice(ruta_registros)) < 0) return true;
+    EntradaDelta e{columnas::fechaADias(r.fecha), tipo, offset};
+    int fd = ::open(rutaDelta(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, &e, sizeof(e)) == (ssize_t)sizeof(e);
+    off_t tam = ::lseek(fd, 0, SEEK_END);
+    ::close(fd);
+    if (ok && tam / (off_t)sizeof(EntradaDelta) > UMBRAL_DELTA) {
+        Indice idx;
+        ok = idx.abrir(ruta_registros) && idx.compactar();
+    }
+    return ok;
+}
+
+// Registra las altas de `n` registros escritos seguidos desde `offset_base`
+// (insercion_lote.h) con un solo write al delta
+inline bool registrarLote(const std::string &ruta_registros, const RegistroClinico *r, size_t n, long long offset_base)
+{
+    if (n == 0 || tamArchivo(rutaIndice(ruta_registros)) < 0) return true;
+    std::vector<EntradaDelta> es(n);
+    for (size_t i = 0; i < n; ++i)
+        es[i] = EntradaDelta{columnas::fechaADias(r[i].fecha), DELTA_ALTA,
+                             offset_base + (long long)i * (long long)sizeof(RegistroClinico)};
+    int fd = ::open(rutaDelta(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    const size_t bytes = es.size() * sizeof(EntradaDelta);
+    bool ok = ::write(fd, es.data(), bytes) == (ssize_t)bytes;
+    off_t tam = ::lseek(fd, 0, SEEK_END);
+    ::close(fd);
+    if (ok && tam / (off_t)sizeof(EntradaDelta) > UMBRAL_DELTA) {
+        Indice idx;
+        ok = idx.abrir(ruta_registros) && idx.compactar();
+    }
+    return ok;
+}
+
+} // namespace indice_fecha
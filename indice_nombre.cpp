@@ -0,0 +1,126 @@
+// indice_nombre.cpp
+// Herramienta para el índice por prefijo de apellido/nombre (ver indice_nombre.h).
+// Uso:
+//   indice_nombre construir [registros.dat] [--cadenas tabla_hash.dat]
+//   indice_nombre buscar <prefijo> [registros.dat] [--offsets] [--limite N]
+//   indice_nombre compactar [registros.dat]
+//   indice_nombre info [registros.dat]
+// `buscar` normaliza el prefijo igual que las claves ("Pérez an" -> "perez an")
+// e imprime las primeras N coincidencias en orden alfabético.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "indice_nombre.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int construir(const std::string& ruta, const std::string& ruta_tabla)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = ruta_tabla.empty() ? indice_nombre::construir(ruta) : indice_nombre::construirDesdeCadenas(ruta, ruta_tabla);
+    indice_nombre::Indice idx;
+    if (!ok || !idx.abrir(ruta)) {
+        std::cerr << "Error al construir el índice por nombre de " << ruta << "\n";
+        return 1;
+    }
+    std::cout << "Índice por nombre: " << idx.cabecera().num_entradas << " entradas en " << idx.cabecera().num_bloques
+              << " bloques (" << tamArchivo(indice_nombre::rutaIndice(ruta)) << " bytes) en "
+              << segundosDesde(t0) << " s\n";
+    return 0;
+}
+
+int buscar(const std::string& texto, const std::string& ruta, bool solo_offsets, size_t limite)
+{
+    std::string prefijo = indice_nombre::normalizar(texto);
+    if (prefijo.empty()) {
+        std::cerr << "Prefijo vacío\n";
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    indice_nombre::Indice idx;
+    if (!idx.abrir(ruta)) {
+        std::cerr << "No hay índice por nombre para " << ruta << " (correr indice_nombre construir)\n";
+        return 1;
+    }
+    if (!idx.fresco()) {
+        std::cerr << "El índice por nombre no cubre el registros.dat actual (correr indice_nombre construir)\n";
+        return 1;
+    }
+    double t_abrir = segundosDesde(t0);
+    t0 = std::chrono::steady_clock::now();
+    std::vector<indice_nombre::Entrada> res;
+    if (!idx.buscarPrefijo(prefijo, limite, res)) {
+        std::cerr << "Error al leer el índice\n";
+        return 1;
+    }
+    double t = segundosDesde(t0);
+
+    int fd = solo_offsets ? -1 : ::open(ruta.c_str(), O_RDONLY);
+    for (auto& e : res) {
+        if (solo_offsets) {
+            std::cout << e.offset << "\n";
+            continue;
+        }
+        RegistroClinico r;
+        if (fd < 0 || ::pread(fd, &r, sizeof(r), (off_t)e.offset) != (ssize_t)sizeof(r)) continue;
+        std::cout << "Offset " << e.offset << ": " << r.apellido << ", " << r.nombre << " | DNI " << r.dni << " | "
+                  << r.fecha << " | " << r.medico << " | " << r.motivo << "\n";
+    }
+    if (fd >= 0) ::close(fd);
+    std::cerr << res.size() << " registro(s) con prefijo \"" << prefijo << "\" (búsqueda: " << t * 1e3
+              << " ms, apertura: " << t_abrir * 1e3 << " ms)\n";
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = (argc > 1) ? argv[1] : "";
+    std::string ruta = "registros.dat", ruta_tabla;
+    std::vector<std::string> pos;
+    bool solo_offsets = false;
+    size_t limite = indice_nombre::LIMITE_DEFECTO;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--cadenas" && i + 1 < argc) ruta_tabla = argv[++i];
+        else if (a == "--offsets") solo_offsets = true;
+        else if (a == "--limite" && i + 1 < argc) limite = (size_t)std::max(1LL, std::atoll(argv[++i]));
+        else pos.push_back(a);
+    }
+    if (modo == "construir") {
+        if (!pos.empty()) ruta = pos[0];
+        return construir(ruta, ruta_tabla);
+    }
+    if (modo == "buscar" && !pos.empty()) {
+        if (pos.size() > 1) ruta = pos[1];
+        return buscar(pos[0], ruta, solo_offsets, limite);
+    }
+    if (modo == "compactar" || modo == "info") {
+        if (!pos.empty()) ruta = pos[0];
+        indice_nombre::Indice idx;
+        if (!idx.abrir(ruta)) {
+            std::cerr << "No hay índice por nombre para " << ruta << "\n";
+            return 1;
+        }
+        if (modo == "compactar" && !idx.compactar()) {
+            std::cerr << "Error al compactar el índice\n";
+            return 1;
+        }
+        std::cout << "Índice por nombre: " << idx.cabecera().num_entradas << " entradas en "
+                  << idx.cabecera().num_bloques << " bloques, " << idx.entradasDelta() << " en el delta, "
+                  << (idx.fresco() ? "fresco" : "desactualizado") << "\n";
+        return 0;
+    }
+    std::cerr << "Uso:\n"
+              << "  indice_nombre construir [registros.dat] [--cadenas tabla_hash.dat]\n"
+              << "  indice_nombre buscar <prefijo> [registros.dat] [--offsets] [--limite N]\n"
+              << "  indice_nombre compactar [registros.dat]\n"
+              << "  indice_nombre info [registros.dat]\n";
+    return 1;
+}
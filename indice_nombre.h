@@ -0,0 +1,575 @@
+// indice_nombre.h
+// Índice persistente por prefijo de `apellido nombre` para búsquedas de
+// recepción ("gonz", "perez ana") sin conocer el DNI:
+// - Clave normalizada: minúsculas, sin tildes (á->a, ñ->n, ü->u, ...), signos
+//   como espacio y espacios colapsados; apellido + ' ' + nombre.
+// - `indice_nombre.dat`: NombreCabecera + bloques de POR_BLOQUE entradas
+//   ordenadas por (clave, offset) con codificación por prefijo común (front
+//   coding: cada clave guarda cuántos bytes comparte con la anterior y el
+//   resto) + directorio con la primera clave completa de cada bloque. El
+//   directorio se carga en memoria: una búsqueda hace búsqueda binaria en él y
+//   decodifica bloques desde ahí hasta salir del prefijo o juntar el límite.
+// - `indice_nombre.delta`: altas y bajas posteriores a la construcción, como
+//   en indice_fecha.h (se combinan en cada búsqueda y se fusionan en la base al
+//   superar UMBRAL_DELTA entradas).
+// Frescura: tamaño de registros.dat == tam_registros + altas al final del delta *
+// sizeof(RegistroClinico) (un alta que reusa una lápida no cambia el tamaño).
+// Lo construyen el loader (en paralelo) y `indice_nombre construir`.
+#pragma once
+#include "common.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace indice_nombre {
+
+static const char NOMB_MAGIC[8] = {'P', 'P', 'N', 'O', 'M', 'B', 'R', '1'};
+static const int32_t NOMB_VERSION = 1;
+static const int CLAVE_MAX = 52;                  // apellido(24) + ' ' + nombre(24) + '\0', con margen
+static const int32_t POR_BLOQUE_DEFECTO = 128;    // entradas por bloque codificado
+static const long long UMBRAL_DELTA = 65536;      // entradas del delta antes de fusionar
+static const size_t LIMITE_DEFECTO = 50;          // coincidencias que devuelve una búsqueda
+static const uint8_t DELTA_ALTA = 1;
+static const uint8_t DELTA_BAJA = 2;
+
+#pragma pack(push, 1)
+struct NombreCabecera {
+    char magic[8];             // NOMB_MAGIC
+    int32_t version;           // NOMB_VERSION
+    int32_t por_bloque;        // entradas por bloque
+    int64_t num_entradas;
+    int64_t num_bloques;
+    int64_t tam_registros;     // bytes de registros.dat cubiertos por la base
+    int64_t offset_directorio; // inicio del directorio (tras los bloques)
+    int64_t reservado[2];
+};
+
+// Entrada sin codificar (también es el formato del temporal del loader)
+struct Entrada {
+    char clave[CLAVE_MAX];     // clave normalizada terminada en '\0'
+    int64_t offset;            // offset del registro en registros.dat
+};
+
+// Elemento del directorio: dónde empieza cada bloque y su primera clave
+struct BloqueDir {
+    int64_t offset;            // offset del bloque en indice_nombre.dat
+    int32_t bytes;
+    int32_t num;
+    char primera[CLAVE_MAX];
+};
+
+struct EntradaDelta {
+    uint8_t tipo;              // DELTA_ALTA o DELTA_BAJA
+    Entrada e;
+};
+#pragma pack(pop)
+
+inline bool operator<(const Entrada &a, const Entrada &b)
+{
+    int c = std::strncmp(a.clave, b.clave, CLAVE_MAX);
+    return c != 0 ? c < 0 : a.offset < b.offset;
+}
+
+inline std::string rutaIndice(const std::string &r) { return rutaJunto(r, "indice_nombre.dat"); }
+inline std::string rutaDelta(const std::string &r) { return rutaJunto(r, "indice_nombre.delta"); }
+
+// Letra base de un carácter UTF-8 de dos bytes C3 xx (Latin-1 suplemento); 0 si no es letra
+inline char letraBase(unsigned char b)
+{
+    if (b == 0x9F) return 's'; // ß
+    if (b == 0xBF) return 'y'; // ÿ
+    b &= 0xDF; // mayúscula y minúscula comparten los 5 bits bajos
+    if (b >= 0x80 && b <= 0x85) return 'a';
+    if (b == 0x87) return 'c';
+    if (b >= 0x88 && b <= 0x8B) return 'e';
+    if (b >= 0x8C && b <= 0x8F) return 'i';
+    if (b == 0x91) return 'n';
+    if ((b >= 0x92 && b <= 0x96) || b == 0x98) return 'o';
+    if (b >= 0x99 && b <= 0x9C) return 'u';
+    if (b == 0x9D) return 'y';
+    return 0;
+}
+
+// Agrega a `out` el texto normalizado (hasta `n` bytes o '\0'). Los espacios
+// se colapsan; `espacio_final` conserva un espacio final (para "perez " =
+// apellido completo en una búsqueda).
+inline void normalizar(const char *s, size_t n, std::string &out, bool espacio_final = false)
+{
+    bool espacio = true; // no empezar con espacio
+    bool pendiente = false;
+    for (size_t i = 0; i < n && s[i]; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        char base = 0;
+        if (c < 0x80) {
+            if (c >= 'A' && c <= 'Z') base = (char)(c - 'A' + 'a');
+            else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) base = (char)c;
+        } else if (c == 0xC3 && i + 1 < n && ((unsigned char)s[i + 1] & 0xC0) == 0x80) {
+            base = letraBase((unsigned char)s[++i]);
+        } else {
+            // Otros caracteres multibyte: se saltan completos
+            while (i + 1 < n && ((unsigned char)s[i + 1] & 0xC0) == 0x80) ++i;
+            continue;
+        }
+        if (!base) {
+            if (!espacio) pendiente = true;
+            continue;
+        }
+        if (pendiente) out.push_back(' ');
+        pendiente = false;
+        out.push_back(base);
+        espacio = false;
+    }
+    if (espacio_final && pendiente) out.push_back(' ');
+}
+
+inline std::string normalizar(const std::string &texto)
+{
+    std::string out;
+    normalizar(texto.data(), texto.size(), out, true);
+    return out;
+}
+
+// Clave de un registro: apellido + ' ' + nombre normalizados
+inline Entrada entrada(const RegistroClinico &r, long long offset)
+{
+    std::string k;
+    normalizar(r.apellido, sizeof(r.apellido), k);
+    k.push_back(' ');
+    normalizar(r.nombre, sizeof(r.nombre), k);
+    Entrada e;
+    std::memset(e.clave, 0, sizeof(e.clave));
+    std::memcpy(e.clave, k.data(), std::min(k.size(), (size_t)CLAVE_MAX - 1));
+    e.offset = offset;
+    return e;
+}
+
+// La clave empieza con `prefijo`: 0; antes: <0; después: >0
+inline int compararPrefijo(const char *clave, const std::string &prefijo)
+{
+    return std::strncmp(clave, prefijo.c_str(), std::min(prefijo.size(), (size_t)CLAVE_MAX));
+}
+
+// Codifica entradas ya ordenadas en bloques con prefijo común. Los offsets del
+// directorio son `base` + posición en el flujo de bytes producido.
+class Codificador {
+public:
+    explicit Codificador(long long base = 0, int32_t por_bloque = POR_BLOQUE_DEFECTO)
+        : base_(base), por_bloque_(por_bloque) {}
+
+    void agregar(const Entrada &e) {
+        if (en_bloque_ == 0 || en_bloque_ == por_bloque_) {
+            BloqueDir b;
+            std::memset(&b, 0, sizeof(b));
+            b.offset = base_ + escritos_ + (long long)datos.size();
+            std::memcpy(b.primera, e.clave, CLAVE_MAX);
+            directorio.push_back(b);
+            en_bloque_ = 0;
+            previa_[0] = '\0';
+        }
+        size_t largo = strnlen(e.clave, CLAVE_MAX - 1), comun = 0;
+        while (comun < largo && previa_[comun] == e.clave[comun]) ++comun;
+        size_t antes = datos.size();
+        datos.push_back((char)(uint8_t)comun);
+        datos.push_back((char)(uint8_t)(largo - comun));
+        datos.append(e.clave + comun, largo - comun);
+        datos.append(reinterpret_cast<const char *>(&e.offset), sizeof(e.offset));
+        std::memcpy(previa_, e.clave, largo);
+        previa_[largo] = '\0';
+        BloqueDir &b = directorio.back();
+        b.bytes += (int32_t)(datos.size() - antes);
+        ++b.num;
+        ++en_bloque_;
+        ++num_entradas;
+    }
+
+    // Entrega los bytes acumulados (para escribirlos) y sigue contando desde ahí
+    void tomarDatos(std::string &out) {
+        escritos_ += (long long)datos.size();
+        out.swap(datos);
+        datos.clear();
+    }
+
+    long long bytesTotales() const { return escritos_ + (long long)datos.size(); }
+
+    std::string datos;
+    std::vector<BloqueDir> directorio;
+    long long num_entradas = 0;
+
+private:
+    long long base_;
+    long long escritos_ = 0;
+    int32_t por_bloque_;
+    int32_t en_bloque_ = 0;
+    char previa_[CLAVE_MAX] = {0};
+};
+
+// Decodifica un bloque completo; `visitar(const Entrada&)` devuelve false para cortar
+template <typename VisitarFn>
+inline bool decodificarBloque(const char *p, size_t bytes, VisitarFn visitar)
+{
+    Entrada e;
+    std::memset(e.clave, 0, sizeof(e.clave));
+    size_t i = 0;
+    while (i + 2 <= bytes) {
+        size_t comun = (uint8_t)p[i], resto = (uint8_t)p[i + 1];
+        i += 2;
+        if (comun + resto >= (size_t)CLAVE_MAX || i + resto + sizeof(int64_t) > bytes) return false;
+        std::memcpy(e.clave + comun, p + i, resto);
+        e.clave[comun + resto] = '\0';
+        i += resto;
+        std::memcpy(&e.offset, p + i, sizeof(e.offset));
+        i += sizeof(e.offset);
+        if (!visitar(e)) return true;
+    }
+    return i == bytes;
+}
+
+inline NombreCabecera cabecera(long long num, long long bloques, long long tam_registros, long long off_dir,
+                               int32_t por_bloque)
+{
+    NombreCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, NOMB_MAGIC, sizeof(NOMB_MAGIC));
+    c.version = NOMB_VERSION;
+    c.por_bloque = por_bloque;
+    c.num_entradas = num;
+    c.num_bloques = bloques;
+    c.tam_registros = tam_registros;
+    c.offset_directorio = off_dir;
+    return c;
+}
+
+// Escritura secuencial de un índice completo a partir de entradas ordenadas
+// (vía temporal + rename; la cabecera se escribe al final)
+class Escritor {
+public:
+    explicit Escritor(const std::string &ruta_registros, int32_t por_bloque = POR_BLOQUE_DEFECTO)
+        : ruta_registros_(ruta_registros), tmp_(rutaIndice(ruta_registros) + ".tmp"),
+          cod_((long long)sizeof(NombreCabecera), por_bloque), por_bloque_(por_bloque) {
+        fd_ = ::open(tmp_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok_ = fd_ >= 0;
+    }
+    ~Escritor() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    void agregar(const Entrada &e) {
+        cod_.agregar(e);
+        if (cod_.datos.size() >= (1u << 20)) volcar();
+    }
+
+    bool terminar(long long tam_registros) {
+        volcar();
+        long long off_dir = (long long)sizeof(NombreCabecera) + cod_.bytesTotales();
+        size_t bytes_dir = cod_.directorio.size() * sizeof(BloqueDir);
+        NombreCabecera cab = cabecera(cod_.num_entradas, (long long)cod_.directorio.size(), tam_registros, off_dir, por_bloque_);
+        ok_ = ok_ && ::pwrite(fd_, cod_.directorio.data(), bytes_dir, (off_t)off_dir) == (ssize_t)bytes_dir &&
+              ::pwrite(fd_, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        // Base nueva: el delta anterior ya está incluido (o no corresponde)
+        ok_ = ok_ && ::rename(tmp_.c_str(), rutaIndice(ruta_registros_).c_str()) == 0;
+        if (ok_) ::truncate(rutaDelta(ruta_registros_).c_str(), 0);
+        return ok_;
+    }
+
+private:
+    void volcar() {
+        std::string bytes;
+        long long pos = (long long)sizeof(NombreCabecera) + cod_.bytesTotales() - (long long)cod_.datos.size();
+        cod_.tomarDatos(bytes);
+        ok_ = ok_ && ::pwrite(fd_, bytes.data(), bytes.size(), (off_t)pos) == (ssize_t)bytes.size();
+    }
+
+    std::string ruta_registros_, tmp_;
+    Codificador cod_;
+    int32_t por_bloque_;
+    int fd_ = -1;
+    bool ok_ = false;
+};
+
+inline bool escribir(const std::string &ruta_registros, const std::vector<Entrada> &entradas, long long tam_registros)
+{
+    Escritor w(ruta_registros);
+    for (const Entrada &e : entradas) w.agregar(e);
+    return w.terminar(tam_registros);
+}
+
+// Construye el índice recorriendo registros.dat en orden y ordenando en
+// memoria (sizeof(Entrada) bytes por registro; el loader lo hace repartido)
+inline bool construir(const std::string &ruta_registros, size_t registros_por_lote = 1 << 15)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long num = (long long)::lseek(in, 0, SEEK_END) / (long long)sz;
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    std::vector<Entrada> entradas;
+    entradas.reserve((size_t)num);
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+        for (size_t k = 0; ok && k < n; ++k)
+            if (!esBorrado(buf[k])) entradas.push_back(entrada(buf[k], (i + (long long)k) * (long long)sz));
+    }
+    ::close(in);
+    if (!ok) return false;
+    std::sort(entradas.begin(), entradas.end());
+    return escribir(ruta_registros, entradas, num * (long long)sz);
+}
+
+// Construye el índice solo con los registros alcanzables desde tabla_hash.dat
+// (descarta lápidas y copias sueltas de eliminaciones anteriores)
+inline bool construirDesdeCadenas(const std::string &ruta_registros, const std::string &ruta_tabla)
+{
+    tabla_hash::Tabla tabla;
+    if (!tabla_hash::cargar(ruta_tabla, tabla)) return false;
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    std::vector<Entrada> entradas;
+    for (const HashExtent &e : tabla.entradas) {
+        tabla_hash::recorrerBucket(e, tam,
+            [&](long long off, void *dst, size_t n) { return ::pread(in, dst, n, (off_t)off) == (ssize_t)n; },
+            [&](long long off, const RegistroClinico &r) { entradas.push_back(entrada(r, off)); });
+    }
+    ::close(in);
+    std::sort(entradas.begin(), entradas.end());
+    long long num = tam / (long long)sizeof(RegistroClinico);
+    return escribir(ruta_registros, entradas, num * (long long)sizeof(RegistroClinico));
+}
+
+class Indice {
+public:
+    Indice() = default;
+    Indice(const Indice &) = delete;
+    Indice &operator=(const Indice &) = delete;
+    ~Indice() { cerrar(); }
+
+    // Carga cabecera, directorio y delta. false si no hay índice.
+    bool abrir(const std::string &ruta_registros) {
+        cerrar();
+        ruta_registros_ = ruta_registros;
+        fd_ = ::open(rutaIndice(ruta_registros).c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st;
+        bool ok = ::fstat(fd_, &st) == 0 && ::pread(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  std::memcmp(cab_.magic, NOMB_MAGIC, sizeof(NOMB_MAGIC)) == 0 && cab_.version == NOMB_VERSION &&
+                  cab_.num_bloques >= 0 && cab_.offset_directorio >= (long long)sizeof(cab_);
+        if (ok) {
+            ino_ = st.st_ino;
+            directorio_.resize((size_t)cab_.num_bloques);
+            size_t bytes = directorio_.size() * sizeof(BloqueDir);
+            ok = ::pread(fd_, directorio_.data(), bytes, (off_t)cab_.offset_directorio) == (ssize_t)bytes;
+        }
+        ok = ok && cargarDelta();
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        directorio_.clear();
+        altas_.clear();
+        bajas_.clear();
+    }
+
+    bool abierto() const { return fd_ >= 0; }
+
+    // Vuelve a leer lo que cambió desde abrir(): la base si otro proceso la
+    // reemplazó (compactación, reconstrucción) o el delta si creció
+    bool sincronizar() {
+        struct stat st;
+        if (::stat(rutaIndice(ruta_registros_).c_str(), &st) != 0) {
+            cerrar();
+            return false;
+        }
+        if (fd_ < 0 || st.st_ino != ino_) return abrir(ruta_registros_);
+        if (tamArchivo(rutaDelta(ruta_registros_)) != bytes_delta_) return cargarDelta();
+        return true;
+    }
+
+    const NombreCabecera &cabecera() const { return cab_; }
+    long long entradasDelta() const { return entradas_delta_; }
+
+    // El índice cubre exactamente el registros.dat actual
+    bool fresco() const { return cubre(tamArchivo(ruta_registros_)); }
+    // Variante sin stat: cubre exactamente los primeros `tam_registros` bytes
+    bool cubre(long long tam_registros) const {
+        return fd_ >= 0 && tam_registros == cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico);
+    }
+
+    // Hasta `limite` entradas cuya clave empieza con `prefijo` (ya normalizado),
+    // en orden de (clave, offset). Lee solo los bloques que tocan el prefijo.
+    bool buscarPrefijo(const std::string &prefijo, size_t limite, std::vector<Entrada> &resultado) const {
+        resultado.clear();
+        if (fd_ < 0) return false;
+        // Primer bloque que puede contener el prefijo: el anterior al primero que empieza >= prefijo
+        size_t j = (size_t)(std::lower_bound(directorio_.begin(), directorio_.end(), prefijo,
+                                             [](const BloqueDir &b, const std::string &p) {
+                                                 return compararPrefijo(b.primera, p) < 0;
+                                             }) - directorio_.begin());
+        if (j > 0) --j;
+        std::vector<char> buf;
+        bool fin = false;
+        for (; !fin && j < directorio_.size() && resultado.size() < limite; ++j) {
+            const BloqueDir &b = directorio_[j];
+            buf.resize((size_t)b.bytes);
+            if (::pread(fd_, buf.data(), buf.size(), (off_t)b.offset) != (ssize_t)buf.size()) return false;
+            bool ok = decodificarBloque(buf.data(), buf.size(), [&](const Entrada &e) {
+                int c = compararPrefijo(e.clave, prefijo);
+                if (c > 0) {
+                    fin = true;
+                    return false;
+                }
+                if (c == 0 && !bajas_.count(e.offset)) resultado.push_back(e);
+                return resultado.size() < limite;
+            });
+            if (!ok) return false;
+        }
+        // Altas del delta (ordenadas al cargar)
+        Entrada desde;
+        std::memset(&desde, 0, sizeof(desde));
+        std::memcpy(desde.clave, prefijo.data(), std::min(prefijo.size(), (size_t)CLAVE_MAX - 1));
+        desde.offset = -1;
+        std::vector<Entrada> delta;
+        for (auto a = std::lower_bound(altas_.begin(), altas_.end(), desde);
+             a != altas_.end() && compararPrefijo(a->clave, prefijo) == 0 && delta.size() < limite; ++a)
+            delta.push_back(*a);
+        if (!delta.empty()) {
+            std::vector<Entrada> mezcla(resultado.size() + delta.size());
+            std::merge(resultado.begin(), resultado.end(), delta.begin(), delta.end(), mezcla.begin());
+            resultado.swap(mezcla);
+        }
+        if (resultado.size() > limite) resultado.resize(limite);
+        return true;
+    }
+
+    // Fusiona el delta en la base (la base se decodifica en orden y se mezcla con las altas)
+    bool compactar() {
+        if (fd_ < 0) return false;
+        Escritor w(ruta_registros_, cab_.por_bloque);
+        auto a = altas_.begin();
+        std::vector<char> buf;
+        for (const BloqueDir &b : directorio_) {
+            buf.resize((size_t)b.bytes);
+            if (::pread(fd_, buf.data(), buf.size(), (off_t)b.offset) != (ssize_t)buf.size()) return false;
+            bool ok = decodificarBloque(buf.data(), buf.size(), [&](const Entrada &e) {
+                for (; a != altas_.end() && *a < e; ++a) w.agregar(*a);
+                if (!bajas_.count(e.offset)) w.agregar(e);
+                return true;
+            });
+            if (!ok) return false;
+        }
+        for (; a != altas_.end(); ++a) w.agregar(*a);
+        long long tam = cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico);
+        std::string ruta = ruta_registros_;
+        bool ok = w.terminar(tam);
+        return ok && abrir(ruta);
+    }
+
+private:
+    // Como en indice_fecha: una baja oculta la base y el alta previa del delta
+    // con ese offset; un alta posterior en el mismo offset vuelve a valer.
+    bool cargarDelta() {
+        altas_.clear();
+        bajas_.clear();
+        altas_totales_ = entradas_delta_ = bytes_delta_ = 0;
+        int fd = ::open(rutaDelta(ruta_registros_).c_str(), O_RDONLY);
+        if (fd < 0) {
+            bytes_delta_ = -1;
+            return true; // sin delta
+        }
+        std::unordered_map<long long, Entrada> vivas; // offset -> alta del delta
+        std::vector<EntradaDelta> buf(4096);
+        ssize_t leidos;
+        off_t off = 0;
+        while ((leidos = ::pread(fd, buf.data(), buf.size() * sizeof(EntradaDelta), off)) > 0) {
+            size_t n = (size_t)leidos / sizeof(EntradaDelta);
+            if (n == 0) break;
+            for (size_t k = 0; k < n; ++k) {
+                const EntradaDelta &e = buf[k];
+                ++entradas_delta_;
+                if (e.tipo == DELTA_BAJA) {
+                    bajas_.insert(e.e.offset);
+                    vivas.erase(e.e.offset);
+                    continue;
+                }
+                if (e.e.offset == cab_.tam_registros + altas_totales_ * (long long)sizeof(RegistroClinico))
+                    ++altas_totales_;
+                vivas[e.e.offset] = e.e;
+            }
+            off += (off_t)(n * sizeof(EntradaDelta));
+        }
+        ::close(fd);
+        bytes_delta_ = (long long)off;
+        for (const auto &v : vivas) altas_.push_back(v.second);
+        std::sort(altas_.begin(), altas_.end());
+        return true;
+    }
+
+    std::string ruta_registros_;
+    int fd_ = -1;
+    ino_t ino_ = 0;
+    NombreCabecera cab_{};
+    std::vector<BloqueDir> directorio_;
+    std::vector<Entrada> altas_;
+    std::unordered_set<long long> bajas_;
+    long long altas_totales_ = 0;
+    long long entradas_delta_ = 0;
+    long long bytes_delta_ = -1;
+};
+
+// Registra en el delta el alta (`tipo` DELTA_ALTA) o baja de un registro. Si
+// no hay índice no hace nada. Cuando el delta crece más que UMBRAL_DELTA se
+// fusiona en la base (costo amortizado entre muchas inserciones).
+inline bool registrar(const std::string &ruta_registros, const RegistroClinico &r, long long offset,
+                      uint8_t tipo = DELTA_ALTA)
+{
+    if (tamArchivo(rutaIndice(ruta_registros)) < 0) return true;
+    EntradaDelta e{tipo, entrada(r, offset)};
+    int fd = ::open(rutaDelta(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, &e, sizeof(e)) == (ssize_t)sizeof(e);
+    off_t tam = ::lseek(fd, 0, SEEK_END);
+    ::close(fd);
+    if (ok && tam / (off_t)sizeof(EntradaDelta) > UMBRAL_DELTA) {
+        Indice idx;
+        ok = idx.abrir(ruta_registros) && idx.compactar();
+    }
+    return ok;
+}
+
+// Registra las altas de `n` registros escritos seguidos desde `offset_base`
+// (insercion_lote.h) con un solo write al delta
+inline bool registrarLote(const std::string &ruta_registros, const RegistroClinico *r, size_t n, long long offset_base)
+{
+    if (n == 0 || tamArchivo(rutaIndice(ruta_registros)) < 0) return true;
+    std::vector<EntradaDelta> es(n);
+    for (size_t i = 0; i < n; ++i)
+        es[i] = EntradaDelta{DELTA_ALTA, entrada(r[i], offset_base + (long long)i * (long long)sizeof(RegistroClinico))};
+    int fd = ::open(rutaDelta(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    const size_t bytes = es.size() * sizeof(EntradaDelta);
+    bool ok = ::write(fd, es.data(), bytes) == (ssize_t)bytes;
+    off_t tam = ::lseek(fd, 0, SEEK_END);
+    ::close(fd);
+    if (ok && tam / (off_t)sizeof(EntradaDelta) > UMBRAL_DELTA) {
+        Indice idx;
+        ok = idx.abrir(ruta_registros) && idx.compactar();
+    }
+    return ok;
+}
+
+} // namespace indice_nombre
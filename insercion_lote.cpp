@@ -0,0 +1,110 @@
+// insercion_lote.cpp
+// Inserta por lotes (insercion_lote.h) los registros que llegan por stdin.
+// Uso:
+//   insercion_lote [registros.dat] [tabla_hash.dat] [--binario] [--lote N] < entrada
+// La entrada es CSV con el formato de csv/ (las líneas de cabecera se saltean,
+// así vale `cat csv/*.csv`) o, con --binario, RegistroClinico crudos de 307
+// bytes (p. ej. un registros.dat de otra carga; sus lápidas se saltean). Se
+// inserta de a N registros (262144 por defecto) y al final se imprime registros/s.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "csv_mmap.h"
+#include "insercion_lote.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::string ruta_registros = "registros.dat", ruta_tabla = "tabla_hash.dat";
+    bool binario = false;
+    size_t por_lote = (size_t)1 << 18;
+    std::vector<std::string> pos;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--binario") binario = true;
+        else if (a == "--lote" && i + 1 < argc) por_lote = (size_t)std::max(1LL, std::atoll(argv[++i]));
+        else if (a.rfind("--", 0) == 0) {
+            std::cerr << "Uso: insercion_lote [registros.dat] [tabla_hash.dat] [--binario] [--lote N] < entrada\n";
+            return 1;
+        } else pos.push_back(a);
+    }
+    if (pos.size() > 0) ruta_registros = pos[0];
+    if (pos.size() > 1) ruta_tabla = pos[1];
+
+    auto t0 = std::chrono::steady_clock::now();
+    lote::Resultado total;
+    long long lotes = 0;
+    std::vector<RegistroClinico> registros;
+    registros.reserve(por_lote);
+    // Inserta los registros acumulados de a `por_lote` (con `todo`, también el resto)
+    auto insertar = [&](bool todo) {
+        size_t hecho = 0;
+        std::vector<RegistroClinico> parte;
+        while (registros.size() - hecho >= por_lote || (todo && hecho < registros.size())) {
+            size_t n = std::min(por_lote, registros.size() - hecho);
+            parte.assign(registros.begin() + (long)hecho, registros.begin() + (long)(hecho + n));
+            hecho += n;
+            lote::Resultado r;
+            if (!lote::insertar(ruta_registros, ruta_tabla, parte, &r)) {
+                std::cerr << "Error insertando el lote " << lotes + 1 << " en " << ruta_registros
+                          << " (o la tabla está en uso por la GUI o gestor_dni)\n";
+                return false;
+            }
+            total.insertados += r.insertados;
+            total.descartados += r.descartados;
+            total.divisiones += r.divisiones;
+            ++lotes;
+        }
+        registros.erase(registros.begin(), registros.begin() + (long)hecho);
+        return true;
+    };
+
+    if (binario) {
+        RegistroClinico r;
+        while (std::fread(&r, sizeof(r), 1, stdin) == 1) {
+            if (esBorrado(r)) continue; // lápidas de un registros.dat copiado
+            registros.push_back(r);
+            if (registros.size() >= por_lote && !insertar(false)) return 1;
+        }
+    } else {
+        // Bloques de stdin; la línea cortada al final de un bloque pasa al siguiente
+        const size_t BLOQUE = (size_t)16 << 20;
+        std::string buf;
+        std::vector<char> leido(BLOQUE);
+        bool fin = false;
+        while (!fin) {
+            size_t n = std::fread(leido.data(), 1, leido.size(), stdin);
+            fin = n < leido.size();
+            buf.append(leido.data(), n);
+            size_t corte = fin ? buf.size() : buf.rfind('\n');
+            if (corte == std::string::npos) continue;
+            if (!fin) ++corte;
+            csv_mmap::recorrerLineas(buf.data(), corte, 0, corte, false, [&](const char *a, const char *b) {
+                if (b - a >= 6 && std::memcmp(a, "fecha,", 6) == 0) return;
+                registros.emplace_back();
+                csv_mmap::parsearCampos(a, b, registros.back());
+            });
+            buf.erase(0, corte);
+            if (!insertar(false)) return 1;
+        }
+    }
+    if (!insertar(true)) return 1;
+
+    double s = segundosDesde(t0);
+    std::cout << total.insertados << " registros insertados en " << lotes << " lotes, " << s << " s ("
+              << (s > 0 ? (long long)(total.insertados / s) : 0) << " registros/s)";
+    if (total.divisiones) std::cout << ", " << total.divisiones << " buckets divididos";
+    if (total.descartados) std::cout << ", " << total.descartados << " descartados";
+    std::cout << "\n";
+    return 0;
+}
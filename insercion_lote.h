@@ -0,0 +1,147 @@
+// insercion_lote.h
+// Inserción por lotes en `registros.dat` / `tabla_hash.dat`: en vez de abrir
+// archivos, escribir un registro y persistir la tabla por cada alta, el lote
+// - se ordena por bucket (conteo) y cada registro se enlaza en memoria al
+//   anterior de su bucket dentro del lote (el primero, a la cabeza actual);
+// - se agrega al final de registros.dat con escrituras secuenciales;
+// - persiste solo las páginas de la tabla con cabezas nuevas, una vez. Si el
+//   lote supera el factor de carga los buckets se dividen antes de escribirlo
+//   (tabla_hash::crecer reenlaza solo los registros que ya estaban y los
+//   nuevos van directo a su bucket final);
+// - registra las altas en los índices por fecha y nombre, el filtro de DNI y
+//   el directorio de pacientes con sus variantes por lote.
+// Como el loader, no reusa lápidas (la lista de libres sigue valiendo). Los
+// registros nuevos se anteponen a las cadenas, así que los tramos de una tabla
+// agrupada siguen valiendo. El orden es registros, tabla y derivados: si el
+// proceso cae entre medio, los derivados quedan desactualizados (se ignoran),
+// nunca apuntando a registros sin enlazar. Antes se aplica el diario de la GUI
+// (registros_wal.h), si quedó alguno. Falla si la GUI o gestor_dni tienen la
+// tabla abierta (tabla_compartida.h).
+#pragma once
+#include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lote {
+
+static const size_t BYTES_ESCRITURA = (size_t)64 << 20; // por pwrite
+
+struct Resultado {
+    long long insertados = 0;
+    long long descartados = 0;        // DNI reservado para lápidas
+    long long buckets_tocados = 0;
+    int divisiones = 0;
+};
+
+// Inserta `registros` (se ignora su pos_siguiente). Si no existe la tabla la
+// crea vacía, como la GUI. false si la tabla está en uso o falla alguna escritura de registros o tabla;
+// un derivado que no se pudo actualizar queda desactualizado.
+inline bool insertar(const std::string &ruta_registros, const std::string &ruta_tabla,
+                     const std::vector<RegistroClinico> &registros, Resultado *resultado = nullptr)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    Resultado res;
+    tabla_compartida::Exclusivo exclusivo(ruta_tabla);
+    if (!exclusivo) return false;
+    if (wal::recuperar(ruta_registros, ruta_tabla) < 0) return false;
+    tabla_hash::Tabla tabla;
+    struct stat st;
+    if (::stat(ruta_tabla.c_str(), &st) != 0 &&
+        !tabla_hash::guardar(ruta_tabla, tabla_hash::tablaVacia(LAYOUT_CADENAS, TABLE_SIZE, CARGA_MAX_DEFECTO)))
+        return false;
+    if (!tabla_hash::cargar(ruta_tabla, tabla)) return false;
+    int fd = ::open(ruta_registros.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    long long base = (long long)::lseek(fd, 0, SEEK_END);
+    base -= base % sz; // descarta un registro a medio escribir
+
+    for (const RegistroClinico &r : registros)
+        if (r.dni == DNI_BORRADO) ++res.descartados;
+    tabla.num_registros += (long long)registros.size() - res.descartados;
+    if (tabla_hash::debeDividir(tabla)) {
+        std::fstream rf(ruta_registros, std::ios::in | std::ios::out | std::ios::binary);
+        std::fstream tf(ruta_tabla, std::ios::in | std::ios::out | std::ios::binary);
+        res.divisiones = tabla_hash::crecer(tabla, rf, tf);
+        if (!rf || !tf) {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    // Orden por bucket (estable): cada bucket queda contiguo en el lote
+    const size_t nb = tabla.entradas.size();
+    std::vector<int> bucket_de(registros.size());
+    std::vector<long long> inicio(nb + 1, 0);
+    for (size_t i = 0; i < registros.size(); ++i) {
+        bucket_de[i] = registros[i].dni == DNI_BORRADO ? -1 : tabla_hash::bucket(tabla, registros[i].dni);
+        if (bucket_de[i] >= 0) ++inicio[(size_t)bucket_de[i] + 1];
+    }
+    for (size_t b = 0; b < nb; ++b) inicio[b + 1] += inicio[b];
+    const size_t n = (size_t)inicio[nb];
+    std::vector<RegistroClinico> salida(n);
+    {
+        std::vector<long long> siguiente(inicio.begin(), inicio.end() - 1);
+        for (size_t i = 0; i < registros.size(); ++i)
+            if (bucket_de[i] >= 0) salida[(size_t)siguiente[(size_t)bucket_de[i]]++] = registros[i];
+    }
+
+    // Enlaces en memoria: cada registro apunta al anterior de su bucket
+    std::vector<int> sucios;
+    for (size_t b = 0; b < nb; ++b) {
+        if (inicio[b] == inicio[b + 1]) continue;
+        long long cabeza = tabla.entradas[b].head_offset;
+        for (long long i = inicio[b]; i < inicio[b + 1]; ++i) {
+            salida[(size_t)i].pos_siguiente = cabeza;
+            cabeza = base + i * sz;
+        }
+        tabla.entradas[b].head_offset = cabeza;
+        sucios.push_back((int)b);
+    }
+    res.buckets_tocados = (long long)sucios.size();
+
+    // Registros: escrituras secuenciales al final
+    bool ok = true;
+    const char *datos = reinterpret_cast<const char *>(salida.data());
+    const size_t bytes = n * sizeof(RegistroClinico);
+    for (size_t hecho = 0; ok && hecho < bytes;) {
+        size_t cuanto = std::min(BYTES_ESCRITURA, bytes - hecho);
+        ssize_t w = ::pwrite(fd, datos + hecho, cuanto, (off_t)(base + (long long)hecho));
+        ok = w > 0;
+        if (ok) hecho += (size_t)w;
+    }
+    ok = ok && ::ftruncate(fd, (off_t)(base + (long long)bytes)) == 0;
+    ::close(fd);
+    if (!ok) return false;
+
+    // Tabla: las páginas sucias, una vez cada una
+    {
+        std::fstream tf(ruta_tabla, std::ios::in | std::ios::out | std::ios::binary);
+        if (!tf.is_open() || !tabla_hash::escribirPaginas(tf, tabla, sucios)) return false;
+        tf.flush();
+        if (!tf) return false;
+    }
+
+    // Derivados: las altas ocupan [base, base + bytes) en el orden de `salida`
+    indice_fecha::registrarLote(ruta_registros, salida.data(), n, base);
+    indice_nombre::registrarLote(ruta_registros, salida.data(), n, base);
+    filtro_dni::registrarLote(ruta_registros, salida.data(), n, base);
+    pacientes::registrarLote(ruta_registros, salida.data(), n, base);
+    res.insertados = (long long)n;
+    if (resultado) *resultado = res;
+    return true;
+}
+
+} // namespace lote
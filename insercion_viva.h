@@ -0,0 +1,350 @@
+// insercion_viva.h
+// Estado de escritura de la tabla viva y sus caminos de inserción y
+// eliminación, los mismos para la GUI y para la prueba de carga
+// `bench_io insert-mt`:
+// - `Estado` reúne los archivos abiertos, la tabla compartida entre procesos
+//   (tabla_compartida.h), las franjas y la cola de reservas (bloqueo_franjas.h),
+//   el diario (registros_wal.h) y los derivados en memoria (filtro de DNI y
+//   directorio de pacientes) con sus locks.
+// - `insertar` toma el lugar de una lápida (registros_libres.h) o reserva uno al
+//   final, escribe el registro, registra el alta en los derivados en orden de
+//   offset (`altas_hasta`/`derivados_cv`), publica la cabeza, la anota en el
+//   diario y confirma en grupo fuera de los locks; si se supera el factor de
+//   carga divide buckets con la tabla exclusiva.
+// - `eliminar` desenlaza de la cadena del DNI los registros elegidos y los
+//   convierte en lápidas, que las inserciones siguientes reusan.
+// - `checkpoint`, `retomar` y `soltar` son los del rol de escritor: al tomarlo
+//   por primera vez o después de otro proceso se releen el final de
+//   registros.dat y los derivados y se abre el diario (nunca sin el rol: el
+//   dueño anterior puede tener transacciones sin checkpoint), y antes de
+//   soltarlo el diario queda vacío.
+// Orden de locks: offsets_mutex (de la GUI), table_mutex, franja,
+// registros_io_mutex, derivados_mutex, tabla_file_mutex; el rol de escritor se
+// pide antes que table_mutex (lo comparten los hilos, así que puede pedirse
+// con offsets_mutex tomado).
+#pragma once
+#include "bloqueo_franjas.h"
+#include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "registros_libres.h"
+#include "registros_mmap.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace viva {
+
+struct Estado {
+    // Archivos binarios para la tabla hash y los registros clínicos
+    std::fstream tabla_file;
+    std::fstream registros_file;           // lápidas, lugares reusados y reenlaces (las altas al final van por registros_fd)
+    int registros_fd = -1;                 // altas con pwrite en el lugar reservado en cola_registros
+    // Lecturas de registros: mmap/pread sin locks, compartido por todos los hilos
+    registros_mmap::AlmacenRegistros almacen_registros;
+    std::string ruta_tabla;
+    std::string ruta_registros;
+    // Tabla hash viva (formato legado, v2 con tramos agrupados o v3 que crece),
+    // compartida con los demás procesos: las búsquedas la leen sin locks y cada
+    // escritura toma antes el rol de escritor. Los cambios que reenlazan cadenas
+    // en el lugar van entre empezarCambio y terminarCambio.
+    tabla_compartida::Segmento tabla_viva;
+    std::shared_mutex table_mutex;         // compartido para las inserciones, exclusivo para los cambios de estructura (las búsquedas no lo toman)
+    // Con table_mutex compartido, la franja del bucket protege su entrada de
+    // tabla_viva (cabeza y anotación en el diario); el lugar al final de
+    // registros.dat se reserva con fetch_add en cola_registros
+    franjas::Franjas franjas_buckets;
+    franjas::Cola cola_registros;
+    // Cada inserción o eliminación la avanza: la compactación en segundo plano
+    // descarta su copia si hubo escrituras mientras copiaba
+    std::atomic<unsigned long long> version_registros{0};
+    // Filtro de DNI y directorio de pacientes en memoria, protegidos por
+    // derivados_mutex; cerrados si no existen o no cubren registros.dat
+    filtro_dni::Filtro filtro_dnis;
+    pacientes::Directorio directorio_pacientes;
+    // Turno de tabla_viva con el que se cargaron el filtro y el directorio: si el
+    // rol de escritor pasó después a otro proceso, no tienen sus altas
+    std::atomic<unsigned long long> turno_derivados{0};
+    // Derivados (índices por fecha y nombre, filtro, directorio) y num_registros:
+    // una inserción los actualiza con derivados_mutex exclusivo. Las altas al final
+    // se registran en orden de offset, porque los derivados solo siguen frescos si
+    // cubren registros.dat sin huecos: cada una espera en derivados_cv a que
+    // altas_hasta llegue a su offset.
+    std::shared_mutex derivados_mutex;
+    std::condition_variable_any derivados_cv;
+    long long altas_hasta = 0;             // protegido por derivados_mutex
+    std::mutex registros_io_mutex;         // serializa escrituras sobre registros_file (los lectores usan almacen_registros)
+    std::mutex tabla_file_mutex;           // escrituras sobre tabla_file
+    // Diario de inserciones y eliminaciones: se agrega con table_mutex exclusivo
+    // o con la franja del bucket y se confirma (commit en grupo) ya sin locks.
+    // Las cabezas quedan solo en tabla_viva hasta el checkpoint siguiente. Se
+    // abre (y se vacía) recién en `retomar`, con el rol de escritor: antes puede
+    // tenerlo otro proceso con transacciones sin checkpoint. Sin diario
+    // (`con_diario` false en `abrir`) no se anota nada y el checkpoint solo
+    // escribe la tabla.
+    wal::Diario diario_registros;
+    bool con_diario = true;
+
+    // Se adjunta a la tabla compartida (que aplica el diario de una sesión
+    // anterior si hace falta) y abre los archivos; el filtro y el directorio los
+    // abre el que llama (`recargarDerivados`) y el diario, la primera escritura.
+    // false con `error` si falla.
+    bool abrir(const std::string &registros, const std::string &tabla, std::string *error, bool diario = true)
+    {
+        ruta_registros = registros;
+        ruta_tabla = tabla;
+        con_diario = diario;
+        if (!tabla_viva.adjuntar(ruta_registros, ruta_tabla, error)) return false;
+        tabla_file.open(ruta_tabla, std::ios::in | std::ios::out | std::ios::binary);
+        registros_file.open(ruta_registros, std::ios::in | std::ios::out | std::ios::binary);
+        if (!tabla_file.is_open() || !registros_file.is_open()) {
+            if (error) *error = "no se pudieron abrir tabla='" + ruta_tabla + "' registros='" + ruta_registros + "'";
+            return false;
+        }
+        registros_fd = ::open(ruta_registros.c_str(), O_RDWR);
+        if (registros_fd < 0) {
+            if (error) *error = "no se pudo abrir '" + ruta_registros + "'";
+            return false;
+        }
+        reiniciarCola();
+        if (!almacen_registros.abrir(ruta_registros)) {
+            if (error) *error = "no se pudo proyectar '" + ruta_registros + "'";
+            return false;
+        }
+        turno_derivados = tabla_viva.turno();
+        return true;
+    }
+
+    // Final de registros.dat para las reservas y las altas en orden (al abrir o
+    // tras reemplazarlo; sin inserciones en curso)
+    void reiniciarCola()
+    {
+        long long fin = (long long)::lseek(registros_fd, 0, SEEK_END);
+        fin -= fin % (long long)sizeof(RegistroClinico); // un registro a medio escribir se pisa
+        cola_registros.reiniciar(fin);
+        std::lock_guard<std::shared_mutex> dlock(derivados_mutex);
+        altas_hasta = fin;
+    }
+
+    // Vuelve a cargar el filtro de DNI y el directorio de pacientes tras reemplazar registros.dat
+    void recargarDerivados()
+    {
+        std::unique_lock<std::shared_mutex> wlock(table_mutex);
+        std::lock_guard<std::shared_mutex> dlock(derivados_mutex);
+        if (filtro_dnis.abrir(ruta_registros) && !filtro_dnis.fresco()) filtro_dnis.cerrar();
+        if (directorio_pacientes.abrir(ruta_registros) && !directorio_pacientes.fresco()) directorio_pacientes.cerrar();
+    }
+
+    // Primera vez con el rol de escritor, o otro proceso escribió desde que este
+    // lo tuvo por última vez (se llama al tomarlo, sin escritores del proceso en
+    // curso): el final de registros.dat, el almacén, el diario y los derivados.
+    // El diario se abre o se vacía recién aquí: el que tuvo el rol antes lo dejó
+    // vacío, o murió y tabla_compartida lo aplicó al tomarlo.
+    void retomar()
+    {
+        unsigned long long turno = tabla_viva.turno();
+        reiniciarCola();
+        almacen_registros.publicar(cola_registros.fin());
+        if (con_diario && !(diario_registros.abierto() ? diario_registros.truncar() : diario_registros.abrir(ruta_registros)))
+            std::cerr << "Error abriendo el diario '" << wal::rutaDiario(ruta_registros)
+                      << "'; las escrituras no son durables" << std::endl;
+        recargarDerivados();
+        turno_derivados = turno;
+    }
+
+    // Checkpoint del diario: registros.dat a disco, tabla_viva a la tabla
+    // (temporal + rename, se reabre tabla_file) y el diario vacío. Se llama con
+    // el rol de escritor, table_mutex exclusivo y registros_io_mutex tomados.
+    bool checkpoint()
+    {
+        std::lock_guard<std::mutex> lg(tabla_file_mutex);
+        registros_file.flush();
+        tabla_file.close();
+        tabla_hash::Tabla actual;
+        tabla_viva.copiar(actual);
+        bool ok;
+        if (diario_registros.abierto()) {
+            ok = wal::checkpoint(diario_registros, ruta_registros, ruta_tabla, actual);
+        } else {
+            const std::string tmp = ruta_tabla + ".tmp";
+            ok = wal::sincronizar(ruta_registros) && tabla_hash::guardar(tmp, actual) && wal::sincronizar(tmp) &&
+                 ::rename(tmp.c_str(), ruta_tabla.c_str()) == 0;
+        }
+        tabla_file.open(ruta_tabla, std::ios::in | std::ios::out | std::ios::binary);
+        if (!ok) std::cerr << "No se pudo hacer el checkpoint del diario" << std::endl;
+        return ok;
+    }
+
+    // Deja la tabla al día y el diario vacío y suelta el rol de escritor (al
+    // salir, sin escritores del proceso en curso)
+    void soltar()
+    {
+        tabla_viva.soltar([this] {
+            std::unique_lock<std::shared_mutex> wlock(table_mutex);
+            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+            checkpoint();
+        });
+    }
+
+    // Inserta `r` en la cadena de su bucket: escribe en registros.dat, anota la
+    // operación en el diario y actualiza la cabeza en memoria (la tabla se
+    // escribe en el checkpoint). Con table_mutex compartido: inserciones en
+    // buckets de otra franja y las búsquedas avanzan a la vez.
+    // Devuelve el offset del registro, o NULL_OFFSET si no se pudo escribir el
+    // registro o el diario.
+    long long insertar(const RegistroClinico &r)
+    {
+        RegistroClinico tmp = r;
+        const long long sz = (long long)sizeof(tmp);
+        uint64_t lsn = 0;
+        long long new_off;
+        bool dividir = false, hacer_checkpoint = false;
+        tabla_compartida::Escritura rol(tabla_viva, [this] { retomar(); });
+        {
+            std::shared_lock<std::shared_mutex> rlock(table_mutex);
+            int pos = tabla_viva.bucket(r.dni);
+            std::lock_guard<std::mutex> flock(franjas_buckets.de(pos));
+            ++version_registros;
+            // el lugar de una lápida si hay; si no, uno reservado al final
+            {
+                std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+                new_off = libres::tomar(ruta_registros, registros_file);
+            }
+            const bool al_final = new_off == NULL_OFFSET;
+            if (al_final) new_off = cola_registros.reservar(sz);
+            tmp.pos_siguiente = tabla_viva.leer(pos).head_offset;
+            bool escrito = ::pwrite(registros_fd, &tmp, sizeof(tmp), (off_t)new_off) == (ssize_t)sizeof(tmp);
+            // el registro ya está en el archivo: visible para los lectores (de este
+            // proceso y de los demás) antes que la cabeza
+            if (escrito && al_final) {
+                almacen_registros.publicar(new_off + sz);
+                tabla_viva.publicarTamRegistros(new_off + sz);
+            }
+            {
+                std::unique_lock<std::shared_mutex> dlock(derivados_mutex);
+                if (al_final) derivados_cv.wait(dlock, [&] { return altas_hasta == new_off; });
+                if (escrito) {
+                    // altas en los deltas de los índices por fecha y nombre (si existen)
+                    indice_fecha::registrar(ruta_registros, tmp, new_off);
+                    indice_nombre::registrar(ruta_registros, tmp, new_off);
+                    // el DNI entra al filtro antes que la cabeza: ninguna búsqueda lo descarta
+                    if (filtro_dnis.abierto() && !filtro_dnis.registrar(tmp.dni, new_off))
+                        std::cerr << "Filtro de DNI desactualizado; se deja de usar" << std::endl;
+                    // y al directorio del paciente (antes que la cabeza, como el filtro)
+                    if (directorio_pacientes.abierto() && !directorio_pacientes.registrar(tmp.dni, new_off))
+                        std::cerr << "Directorio de pacientes desactualizado; se deja de usar" << std::endl;
+                    tabla_viva.sumarRegistros(1);
+                    dividir = tabla_viva.debeDividir();
+                }
+                // el turno pasa aunque la escritura haya fallado (el hueco deja
+                // desactualizados a los derivados, que se ignoran)
+                if (al_final) {
+                    altas_hasta = new_off + sz;
+                    derivados_cv.notify_all();
+                }
+            }
+            if (!escrito) {
+                std::cerr << "No se pudo escribir el registro en " << ruta_registros << std::endl;
+                return NULL_OFFSET;
+            }
+            // update head (el tramo agrupado sigue al final de la cadena)
+            tabla_viva.escribirCabeza(pos, new_off);
+            // al diario: el registro y la cabeza nueva, en el orden de la franja
+            wal::Transaccion tx;
+            tx.escritura(new_off, &tmp, sizeof(tmp));
+            tx.cabeza(pos, new_off, false, 1);
+            lsn = diario_registros.agregar(tx);
+            hacer_checkpoint = diario_registros.bytes() >= wal::UMBRAL_CHECKPOINT;
+        }
+        // Superado el factor de carga se dividen buckets (reenlaza pos_siguiente
+        // en el lugar y escribe la tabla): con la tabla exclusiva, y el diario
+        // se vacía antes porque sus buckets son los del tamaño de tabla actual
+        if (dividir || hacer_checkpoint) {
+            std::unique_lock<std::shared_mutex> wlock(table_mutex);
+            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+            if (tabla_viva.debeDividir()) {
+                checkpoint();
+                std::lock_guard<std::mutex> lg(tabla_file_mutex);
+                tabla_compartida::crecer(tabla_viva, registros_file, tabla_file);
+            } else if (diario_registros.bytes() >= wal::UMBRAL_CHECKPOINT) {
+                checkpoint();
+            }
+        }
+        // Fuera de los locks: otros escritores avanzan y el primero que confirma
+        // lleva al disco las operaciones de todos con un solo fsync
+        if (!diario_registros.confirmar(lsn)) {
+            std::cerr << "No se pudo escribir el diario; la inserción no es durable" << std::endl;
+            return NULL_OFFSET;
+        }
+        return new_off;
+    }
+
+    // Desenlaza de la cadena del DNI los registros para los que `quitar(offset,
+    // registro)` es true y los convierte en lápidas (registros_libres.h): se
+    // reescribe un pos_siguiente por registro y nada se mueve, así que los
+    // derivados solo reciben la baja. Los pos_siguiente reescritos, las lápidas y
+    // la cabeza nueva van al diario como una transacción. Devuelve cuántos se eliminaron.
+    template <typename QuitarFn>
+    long long eliminar(int dni, QuitarFn quitar)
+    {
+        std::vector<std::pair<long long, RegistroClinico>> quitados;
+        uint64_t lsn;
+        tabla_compartida::Escritura rol(tabla_viva, [this] { retomar(); });
+        {
+            std::unique_lock<std::shared_mutex> wlock(table_mutex);
+            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+            int pos = tabla_viva.bucket(dni);
+            std::vector<std::pair<long long, long long>> enlaces;
+            // las búsquedas que estén recorriendo la cadena sin locks la repiten
+            tabla_viva.empezarCambio();
+            ++version_registros;
+            long long head = libres::quitarDeCadena(tabla_viva.leer(pos).head_offset, tamArchivo(ruta_registros),
+                                                    registros_file, quitar, quitados, &enlaces);
+            // la cadena cambió: el tramo agrupado del bucket deja de valer
+            if (!quitados.empty()) tabla_viva.escribirEntrada(pos, HashExtent{head, NULL_OFFSET, 0});
+            tabla_viva.terminarCambio();
+            if (quitados.empty()) return 0;
+            tabla_viva.sumarRegistros(-(long long)quitados.size());
+            wal::Transaccion tx;
+            for (const auto &e : enlaces)
+                tx.escritura(e.first + (long long)offsetof(RegistroClinico, pos_siguiente), &e.second, sizeof(e.second));
+            std::unique_lock<std::shared_mutex> dlock(derivados_mutex); // el directorio lo leen las búsquedas
+            for (const auto &q : quitados) {
+                indice_fecha::registrar(ruta_registros, q.second, q.first, indice_fecha::DELTA_BAJA);
+                indice_nombre::registrar(ruta_registros, q.second, q.first, indice_nombre::DELTA_BAJA);
+                if (directorio_pacientes.abierto() && !directorio_pacientes.registrar(q.second.dni, q.first, pacientes::BAJA))
+                    std::cerr << "Directorio de pacientes desactualizado; se deja de usar" << std::endl;
+                // el filtro no puede quitar claves: el DNI vuelve a costar un recorrido
+                RegistroClinico lapida;
+                if (libres::liberar(ruta_registros, registros_file, q.first, &lapida))
+                    tx.escritura(q.first, &lapida, sizeof(lapida));
+            }
+            dlock.unlock();
+            registros_file.flush();
+            tx.cabeza(pos, head, true, -(long long)quitados.size());
+            lsn = diario_registros.agregar(tx);
+            if (diario_registros.bytes() >= wal::UMBRAL_CHECKPOINT) checkpoint();
+        }
+        if (!diario_registros.confirmar(lsn))
+            std::cerr << "No se pudo escribir el diario; la eliminación no es durable" << std::endl;
+        return (long long)quitados.size();
+    }
+};
+
+} // namespace viva
@@ -5,7 +5,10 @@
 //    chunks, copia a dispositivo, ejecuta el kernel y suma las coincidencias.
 // Nota: esta implementación cuenta registros (visitas). Para contar pacientes
 // únicos se requiere deduplicación por DNI (host o GPU).
+// Si `edad.col` está fresca (columnas.h) se copia al dispositivo solo esa
+// columna (1 byte por registro en lugar del registro completo).
 #include "common.h"
+#include "columnas.h"
 #include <cuda_runtime.h>
 #include <cstdio>
 #include <cstdlib>
@@ -24,10 +27,63 @@ __global__ void filtrarPorEdadKernel(const RegistroClinico* recs, int n, int min
     flags[idx] = (edad >= minEdad && edad <= maxEdad) ? 1 : 0;
 }
 
+// CUDA Kernel (GPU): contar sobre la columna de edades
+// Location: kernel_filtro.cu -> contarEdadColumnaKernel
+// Cada bloque reduce sus coincidencias en memoria compartida y suma una vez a `total`
+__global__ void contarEdadColumnaKernel(const unsigned char* edades, int n, int minEdad, int maxEdad, unsigned long long* total)
+{
+    __shared__ unsigned int cuenta;
+    if (threadIdx.x == 0) cuenta = 0;
+    __syncthreads();
+    int idx = blockIdx.x * blockDim.x + threadIdx.x;
+    if (idx < n) {
+        int edad = edades[idx];
+        if (edad != columnas::EDAD_FUERA && edad >= minEdad && edad <= maxEdad) atomicAdd(&cuenta, 1u);
+    }
+    __syncthreads();
+    if (threadIdx.x == 0 && cuenta) atomicAdd(total, (unsigned long long)cuenta);
+}
+
+// Conteo sobre edad.col; false si la columna no está fresca o no cubre el rango
+static bool contarDesdeColumna(const char* archivo, int minEdad, int maxEdad, long long& resultado)
+{
+    columnas::CabeceraColumna cab;
+    int fd = columnas::abrirFresca(archivo, "edad", cab);
+    if (fd < 0) return false;
+    if (cab.tipo != columnas::COL_UINT8 || !columnas::rangoCubierto(cab, minEdad, maxEdad)) { close(fd); return false; }
+
+    const size_t LOTE = 1 << 24; // 16M edades por copia
+    unsigned char* d_edades = nullptr;
+    unsigned long long* d_total = nullptr;
+    bool ok = cudaMalloc((void**)&d_edades, LOTE) == cudaSuccess &&
+              cudaMalloc((void**)&d_total, sizeof(unsigned long long)) == cudaSuccess &&
+              cudaMemset(d_total, 0, sizeof(unsigned long long)) == cudaSuccess;
+    if (ok) {
+        ok = columnas::recorrer<uint8_t>(fd, cab, [&](const uint8_t* e, size_t n, long long) {
+            if (!ok) return;
+            if (cudaMemcpy(d_edades, e, n, cudaMemcpyHostToDevice) != cudaSuccess) { ok = false; return; }
+            int threads = 256;
+            int blocks = (int)((n + threads - 1) / threads);
+            contarEdadColumnaKernel<<<blocks, threads>>>(d_edades, (int)n, minEdad, maxEdad, d_total);
+            if (cudaGetLastError() != cudaSuccess) ok = false;
+        }, LOTE) && ok;
+    }
+    unsigned long long total = 0;
+    if (ok) ok = cudaMemcpy(&total, d_total, sizeof(total), cudaMemcpyDeviceToHost) == cudaSuccess;
+    if (d_edades) cudaFree(d_edades);
+    if (d_total) cudaFree(d_total);
+    close(fd);
+    if (ok) resultado = (long long)total;
+    return ok;
+}
+
 // CUDA Wrapper (GPU): contarPacientesRangoEdad_GPU
 // Location: kernel_filtro.cu -> contarPacientesRangoEdad_GPU
 extern "C" long long contarPacientesRangoEdad_GPU(char* archivo, int minEdad, int maxEdad)
 {
+    long long desdeColumna = 0;
+    if (contarDesdeColumna(archivo, minEdad, maxEdad, desdeColumna)) return desdeColumna;
+
     const size_t CHUNK = 100000; // 100k registros por chunk
     std::ifstream in(archivo, std::ios::binary | std::ios::ate);
     if (!in.is_open()) {
@@ -11,6 +11,7 @@
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QDialog>
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <vector>
@@ -20,9 +21,24 @@
 #include <cstring>
 #include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 // Usar definiciones compartidas
 #include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+#include "insercion_viva.h"
+#include "registros_edicion.h"
+#include "registros_libres.h"
+#include "tabla_hash.h"
+#include "registros_mmap.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
 #include "time_utils.h"
 
 // GPU integration points (wrappers)
@@ -31,22 +47,45 @@ extern "C" long long contarPacientesRangoEdad_GPU(const char* archivo, int minEd
 // CPU stub (fallback) — implementado en gpu_stub.cpp
 extern "C" long long contarPacientesRangoEdadUnicos_CPU(const char* archivo, int minEdad, int maxEdad);
 
-// Archivos binarios para la tabla hash y los registros clínicos
-std::fstream tabla_file;
-std::fstream registros_file;
+// Archivos, tabla hash viva (compartida con gestor_dni y las herramientas,
+// tabla_compartida.h), franjas, diario y derivados en memoria: el estado de
+// escritura de insercion_viva.h, el mismo que ejercita `bench_io insert-mt`.
+// Se usa con los nombres de siempre; ahí están sus invariantes y el orden de
+// locks (offsets_mutex va primero).
+viva::Estado vivo;
+std::fstream &tabla_file = vivo.tabla_file;
+std::fstream &registros_file = vivo.registros_file;
+int &registros_fd = vivo.registros_fd;
+registros_mmap::AlmacenRegistros &almacen_registros = vivo.almacen_registros;
 // Paths abiertos (para debug/UI)
-std::string g_tabla_path;
-std::string g_registros_path;
-// In-memory table + synchronization
-std::vector<HashEntry> in_memory_table;
-std::shared_mutex table_mutex;          // shared for readers, exclusive for writers
-std::mutex registros_io_mutex;         // protect seek/read/write on registros_file
-std::mutex tabla_file_mutex;           // protect writes to tabla_file
-
-// Función hash simple para obtener la posición en la tabla hash a partir del DNI
+std::string &g_tabla_path = vivo.ruta_tabla;
+std::string &g_registros_path = vivo.ruta_registros;
+tabla_compartida::Segmento &tabla_viva = vivo.tabla_viva;
+std::shared_mutex &table_mutex = vivo.table_mutex;
+std::atomic<unsigned long long> &version_registros = vivo.version_registros;
+filtro_dni::Filtro &filtro_dnis = vivo.filtro_dnis;
+pacientes::Directorio &directorio_pacientes = vivo.directorio_pacientes;
+std::atomic<unsigned long long> &turno_derivados = vivo.turno_derivados;
+std::shared_mutex &derivados_mutex = vivo.derivados_mutex;
+std::mutex &registros_io_mutex = vivo.registros_io_mutex;
+std::mutex &tabla_file_mutex = vivo.tabla_file_mutex;
+wal::Diario &diario_registros = vivo.diario_registros;
+// Las secuencias de la UI que guardan offsets entre dos pasos (buscar y
+// mostrar, buscar y eliminar) lo toman compartido; la compactación, que mueve
+// los registros, exclusivo (antes que table_mutex)
+std::shared_mutex offsets_mutex;
+// Índice por apellido/nombre (se abre en la primera búsqueda y se sincroniza con el delta)
+indice_nombre::Indice indice_nombres;
+std::mutex indice_nombres_mutex;
+
+// Posición en la tabla hash a partir del DNI (depende del tamaño actual de la tabla)
 int hash1(int dni) {
-    // Usa una operación AND para obtener un valor entre 0 y TABLE_SIZE-1
-    return dni & (TABLE_SIZE - 1);
+    return tabla_viva.bucket(dni);
+}
+
+// Final de registros.dat para las reservas y las altas en orden
+void reiniciarCola() {
+    vivo.reiniciarCola();
 }
 
 // Inicializa los archivos binarios si no existen y los abre para lectura/escritura
@@ -63,9 +102,7 @@ void inicializarArchivos() {
     if (tabla_path.empty()) {
         // crear en el primer candidato (cwd)
         tabla_path = tabla_candidates[0];
-        std::ofstream out(tabla_path, std::ios::binary);
-        HashEntry empty; empty.head_offset = NULL_OFFSET;
-        for (int i = 0; i < TABLE_SIZE; ++i) out.write(reinterpret_cast<char*>(&empty), sizeof(empty));
+        tabla_hash::guardar(tabla_path, tabla_hash::tablaVacia(LAYOUT_CADENAS, TABLE_SIZE, CARGA_MAX_DEFECTO));
     }
 
     std::string registros_path;
@@ -77,216 +114,348 @@ void inicializarArchivos() {
         std::ofstream out(registros_path, std::ios::binary);
     }
 
-    // Abre ambos archivos en modo lectura/escritura binario
-    tabla_file.open(tabla_path, std::ios::in | std::ios::out | std::ios::binary);
-    registros_file.open(registros_path, std::ios::in | std::ios::out | std::ios::binary);
-    if (!tabla_file.is_open() || !registros_file.is_open()) {
-        std::cerr << "Error abriendo archivos binarios: tabla='" << tabla_path << "' registros='" << registros_path << "'" << std::endl;
+    // Tabla compartida, antes de abrir nada: si no existe se crea desde el disco
+    // aplicando lo que quedó en el diario de una sesión anterior (caída sin
+    // checkpoint); si otro proceso ya la tiene, se usa esa sin leer tabla_hash.dat.
+    // Después los archivos y el almacén (insercion_viva.h); el diario se abre
+    // con el rol de escritor, en la primera escritura
+    std::string error;
+    if (!vivo.abrir(registros_path, tabla_path, &error)) {
+        std::cerr << "Error abriendo los archivos: " << error << std::endl;
         exit(1);
     }
-    // Guardar paths globales para debug/UI
-    g_tabla_path = tabla_path;
-    g_registros_path = registros_path;
     std::cout << "Archivos abiertos: tabla='" << tabla_path << "' registros='" << registros_path << "'\n";
 
-    // Cargar tabla en memoria
-    in_memory_table.resize(TABLE_SIZE);
-    tabla_file.seekg(0, std::ios::beg);
-    for (int i = 0; i < TABLE_SIZE; ++i) {
-        HashEntry e;
-        tabla_file.read(reinterpret_cast<char*>(&e), sizeof(e));
-        if (!tabla_file) { e.head_offset = NULL_OFFSET; }
-        in_memory_table[i] = e;
+    std::cout << "Tabla compartida '" << tabla_viva.nombre() << "': " << tabla_viva.numBuckets() << " buckets\n";
+    if (filtro_dnis.abrir(registros_path) && !filtro_dnis.fresco()) {
+        std::cerr << "filtro_dni.dat no cubre registros.dat; se ignora (correr filtro_dni construir)" << std::endl;
+        filtro_dnis.cerrar();
+    }
+    if (directorio_pacientes.abrir(registros_path) && !directorio_pacientes.fresco()) {
+        std::cerr << "pacientes.dat no cubre registros.dat; se ignora (correr directorio_pacientes construir)" << std::endl;
+        directorio_pacientes.cerrar();
     }
-    // reset file position
-    tabla_file.clear();
 }
 
-// Escribe el offset del primer registro (head) en la posición dada de la tabla hash
-void escribirHead(int pos, long long head_offset) {
-    {
-        std::unique_lock<std::shared_mutex> wlock(table_mutex);
-        in_memory_table[pos].head_offset = head_offset;
+// Vuelve a cargar el filtro de DNI y el directorio de pacientes tras reemplazar registros.dat
+void recargarDerivados() {
+    vivo.recargarDerivados();
+}
+
+// Primera escritura de la GUI, u otro proceso escribió desde que tuvo el rol
+// de escritor por última vez
+void retomarTabla() {
+    vivo.retomar();
+}
+
+// true si el filtro y el directorio en memoria tienen todas las altas. Otro
+// proceso con el rol de escritor (gestor_dni) solo los actualiza en disco:
+// mientras lo tiene se ignoran y, cuando lo suelta, se recargan.
+bool derivadosAlDia() {
+    const int32_t duenio = tabla_viva.duenio();
+    if (duenio != 0 && duenio != (int32_t)::getpid()) return false;
+    unsigned long long turno = tabla_viva.turno();
+    if (turno != turno_derivados.load()) {
+        recargarDerivados();
+        turno_derivados = turno;
     }
-    // persist to disk
-    std::lock_guard<std::mutex> lg(tabla_file_mutex);
-    tabla_file.seekp(pos * sizeof(HashEntry), std::ios::beg);
-    HashEntry e{head_offset};
-    tabla_file.write(reinterpret_cast<char*>(&e), sizeof(e));
-    tabla_file.flush();
+    return true;
 }
 
 // Lee el offset del primer registro (head) en la posición dada de la tabla hash
+// (sin locks, de tabla_viva)
 long long leerHead(int pos) {
-    std::shared_lock<std::shared_mutex> rlock(table_mutex);
-    return in_memory_table[pos].head_offset;
+    return tabla_viva.leer(pos).head_offset;
+}
+
+// Lee la entrada completa (head y tramo agrupado) de la posición dada
+HashExtent leerEntrada(int pos) {
+    return tabla_viva.leer(pos);
 }
 
-// Inserta un nuevo registro clínico en la lista enlazada correspondiente al hash del DNI
-void insertarRegistro(const RegistroClinico& r) {
-    // GUI CRUD: insertarRegistro -> escribe en `registros.dat` y actualiza `tabla_hash.dat` (persistente)
-    int pos = hash1(r.dni);
-    RegistroClinico tmp = r;
+// Checkpoint del diario (con el rol de escritor, table_mutex exclusivo y
+// registros_io_mutex tomados)
+bool checkpointDiario() {
+    return vivo.checkpoint();
+}
+
+// Inserta un nuevo registro clínico en la lista enlazada correspondiente al hash
+// del DNI. Devuelve su offset, o NULL_OFFSET si no se pudo escribir.
+long long insertarRegistro(const RegistroClinico& r) {
+    // GUI CRUD: insertarRegistro -> escribe en `registros.dat`, anota la
+    // operación en el diario y actualiza la cabeza en memoria (insercion_viva.h)
     time_utils::ScopedTimer t(std::string("insertarRegistro DNI:") + std::to_string(r.dni));
-    // exclusive on table while updating head
-    std::unique_lock<std::shared_mutex> wlock(table_mutex);
-    // append record safely
-    {
-        std::lock_guard<std::mutex> io_lock(registros_io_mutex);
-        registros_file.seekp(0, std::ios::end);
-        long long new_off = registros_file.tellp();
-        tmp.pos_siguiente = in_memory_table[pos].head_offset;
-        registros_file.write(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-        registros_file.flush();
-        // update in-memory and persist head
-        in_memory_table[pos].head_offset = new_off;
-        // persist only this head
-        {
-            std::lock_guard<std::mutex> lg(tabla_file_mutex);
-            tabla_file.seekp(pos * sizeof(HashEntry), std::ios::beg);
-            HashEntry e{new_off};
-            tabla_file.write(reinterpret_cast<char*>(&e), sizeof(e));
-            tabla_file.flush();
-        }
-    }
+    return vivo.insertar(r);
 }
 
 // Busca todos los registros clínicos asociados a un DNI y devuelve sus offsets en el archivo
 std::vector<long long> buscarRegistros(int dni) {
-    // GUI CRUD: buscarRegistros -> recorre lista enlazada usando `in_memory_table` y `registros.dat`
-    registros_file.clear();  // Limpia flags como EOF
-    registros_file.seekg(0, std::ios::beg); // Vuelve al inicio
-
+    // GUI CRUD: buscarRegistros -> recorre lista enlazada usando `tabla_viva` y `registros.dat`
+    // (cabeza y lecturas sin locks: varios hilos buscan a la vez mientras otros escriben)
     time_utils::ScopedTimer t(std::string("buscarRegistros DNI:") + std::to_string(dni));
     std::vector<long long> offsets;
-    int pos = hash1(dni);
-    long long offset = leerHead(pos);
-    RegistroClinico r;
-
-    if (offset == NULL_OFFSET) return offsets; // Si no hay registros, retorna vacío
-
-        long long filesize = 0;
-        try {
-            filesize = std::filesystem::file_size(g_registros_path.empty() ? "registros.dat" : g_registros_path);
-        } catch (...) {
-            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
-            registros_file.seekg(0, std::ios::end);
-            filesize = registros_file.tellg();
-            registros_file.seekg(0, std::ios::beg);
+    // lo que agregaron otros procesos (gestor_dni) entra al almacén
+    const long long escritos = tabla_viva.tamRegistros();
+    if (escritos > almacen_registros.tam()) almacen_registros.publicar(escritos);
+    const bool derivados = derivadosAlDia();
+    while (true) {
+        // bucket y entrada con el mismo tamaño de tabla (nunca a mitad de una división)
+        unsigned long long epoca;
+        HashExtent entrada = tabla_viva.entradaDe(dni, epoca);
+        if (entrada.head_offset == NULL_OFFSET) return offsets; // Si no hay registros, retorna vacío
+        if (derivados) {
+            std::shared_lock<std::shared_mutex> dlock(derivados_mutex);
+            // DNI que seguro no está (p. ej. un paciente nuevo): sin leer registros.dat
+            if (filtro_dnis.abierto() && !filtro_dnis.puedeContener(dni)) return offsets;
+            // Con directorio: la lista del paciente, sin recorrer la cadena del bucket
+            if (directorio_pacientes.abierto() && directorio_pacientes.buscar(dni, offsets)) return offsets;
+            offsets.clear();
         }
 
-    // Recorre la lista enlazada de registros para ese DNI
-    while (offset != NULL_OFFSET) {
-        if (offset < 0 || offset + sizeof(r) > filesize) break; // Verifica límites de archivo
-        {
-            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
-            registros_file.seekg(offset, std::ios::beg);
-            registros_file.read(reinterpret_cast<char*>(&r), sizeof(r));
-        }
-        if (r.dni == dni) offsets.push_back(offset); // Si el DNI coincide, guarda el offset
-        offset = r.pos_siguiente; // Avanza al siguiente registro en la lista
+        // Recorre la lista enlazada de registros para ese DNI (los límites del
+        // archivo los controla el almacén; un tramo agrupado se lee contiguo)
+        almacen_registros.recorrerBucket(entrada, [&](long long offset, const RegistroClinico& r) {
+            if (r.dni == dni) offsets.push_back(offset); // Si el DNI coincide, guarda el offset
+        });
+        if (tabla_viva.validar(epoca)) return offsets;
+        offsets.clear(); // una división o eliminación reenlazó cadenas durante el recorrido: repetir
     }
+}
+
+// Busca registros cuyo "apellido nombre" empieza con `texto` (sin distinguir
+// mayúsculas ni tildes) en el índice por nombre; devuelve hasta `limite` offsets
+// en orden alfabético. `ok` queda en false si no hay índice fresco.
+std::vector<long long> buscarPorNombre(const std::string& texto, bool& ok,
+                                       size_t limite = indice_nombre::LIMITE_DEFECTO) {
+    time_utils::ScopedTimer t(std::string("buscarPorNombre: ") + texto);
+    std::vector<long long> offsets;
+    std::lock_guard<std::mutex> lock(indice_nombres_mutex);
+    const std::string ruta = g_registros_path.empty() ? "registros.dat" : g_registros_path;
+    ok = (indice_nombres.abierto() ? indice_nombres.sincronizar() : indice_nombres.abrir(ruta)) &&
+         indice_nombres.fresco();
+    std::vector<indice_nombre::Entrada> res;
+    std::string prefijo = indice_nombre::normalizar(texto);
+    if (!ok || prefijo.empty() || !indice_nombres.buscarPrefijo(prefijo, limite, res)) return offsets;
+    for (auto& e : res) offsets.push_back(e.offset);
     return offsets;
 }
 
-// Elimina todos los registros asociados a un DNI, reconstruyendo la lista enlazada
-// dni: el DNI cuyos registros se eliminarán completamente del archivo
-void eliminarPorDNI(int dni) {
-    int pos = hash1(dni);                  // Calcula la posición en la tabla hash para el DNI
-    long long head = leerHead(pos);        // Obtiene el offset del primer registro de la lista enlazada
-    long long nuevo_head = NULL_OFFSET;    // Nuevo head para la lista reconstruida
-    long long offset = head;               // Offset actual en la lista enlazada
-    RegistroClinico r;
-    std::vector<RegistroClinico> nuevos;   // Vector para almacenar los registros que se conservarán
-
-    // Recorre la lista enlazada y guarda solo los registros que NO corresponden al DNI a eliminar
-    while (offset != NULL_OFFSET) {
-        {
-            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
-            registros_file.seekg(offset, std::ios::beg); // Posiciona el puntero de lectura en el registro actual
-            registros_file.read(reinterpret_cast<char*>(&r), sizeof(r));
-        }
-        if (r.dni != dni) {
-            nuevos.push_back(r); // Solo guarda los registros que no se eliminan
-        }
-        offset = r.pos_siguiente; // Avanza al siguiente registro en la lista
-    }
+// Lee una copia del registro en `offset` (false si está fuera del archivo)
+bool leerRegistro(long long offset, RegistroClinico& r) {
+    const RegistroClinico* v = almacen_registros.ver(offset, r);
+    if (!v) return false;
+    if (v != &r) r = *v;
+    return true;
+}
 
-    // Sobrescribe el archivo de registros solo con los registros no eliminados
-    registros_file.close();
-    // Abre el archivo en modo truncado para borrar todo y escribir solo los registros restantes
-    registros_file.open(g_registros_path.empty() ? "registros.dat" : g_registros_path, std::ios::out | std::ios::trunc | std::ios::binary);
-
-    long long new_offset = 0;
-    // Reconstruye la lista enlazada en orden inverso para mantener el orden original
-    for (auto& reg : nuevos) {
-        reg.pos_siguiente = nuevo_head; // El siguiente registro apunta al anterior en la lista
-        nuevo_head = new_offset;        // Actualiza el nuevo head al offset actual
-        registros_file.write(reinterpret_cast<char*>(&reg), sizeof(reg));
-        new_offset += sizeof(reg);
-    }
-    // Actualiza el head de la lista en la tabla hash
-    escribirHead(pos, nuevos.empty() ? NULL_OFFSET : (new_offset - sizeof(RegistroClinico)));
+// Reconstruye los índices, el filtro y el directorio que existan para `ruta`
+// (los offsets cambiaron). Se llama sin locks: si una inserción se cruza con la
+// reconstrucción el derivado queda desactualizado (se ignora), nunca erróneo.
+void reconstruirDerivados(const std::string& ruta) {
+    if (tamArchivo(indice_fecha::rutaIndice(ruta)) >= 0 && !indice_fecha::construir(ruta))
+        std::cerr << "No se pudo reconstruir el índice por fecha" << std::endl;
+    if (tamArchivo(indice_nombre::rutaIndice(ruta)) >= 0 && !indice_nombre::construir(ruta))
+        std::cerr << "No se pudo reconstruir el índice por nombre" << std::endl;
+    if (tamArchivo(filtro_dni::rutaFiltro(ruta)) >= 0 && !filtro_dni::construir(ruta))
+        std::cerr << "No se pudo reconstruir el filtro de DNI" << std::endl;
+    if (tamArchivo(pacientes::rutaDirectorio(ruta)) >= 0 && !pacientes::construir(ruta))
+        std::cerr << "No se pudo reconstruir el directorio de pacientes" << std::endl;
+}
+
+// Desenlaza de la cadena del DNI los registros para los que `quitar(offset,
+// registro)` es true y los convierte en lápidas (viva::Estado::eliminar).
+// Devuelve cuántos se eliminaron.
+template <typename QuitarFn>
+long long eliminarDeCadena(int dni, QuitarFn quitar) {
+    return vivo.eliminar(dni, quitar);
 }
 
-// Elimina un registro específico (por índice) de los registros asociados a un DNI
+// Elimina todos los registros asociados a un DNI
+// dni: el DNI cuyos registros se eliminarán
+void eliminarPorDNI(int dni) {
+    eliminarDeCadena(dni, [&](long long, const RegistroClinico& r) { return r.dni == dni; });
+}
+
+// Elimina un registro específico de los registros asociados a un DNI
 // dni: el DNI cuyos registros se buscan
-// indexEliminar: el índice (0-based) del registro a eliminar entre los registros de ese DNI
-void eliminarRegistroEspecifico(int dni, int indexEliminar) {
-    int pos = hash1(dni);                  // Calcula la posición en la tabla hash
-    long long offset = leerHead(pos);      // Obtiene el offset del primer registro de la lista enlazada
-    long long nuevo_head = NULL_OFFSET;    // Nuevo head para reconstruir la lista
-    RegistroClinico actual;
-    int idx = 0;
-
-    std::vector<RegistroClinico> nuevos;   // Vector para almacenar los registros que se conservarán
-
-    // Recorre la lista enlazada y guarda todos los registros excepto el que se quiere eliminar
-    while (offset != NULL_OFFSET) {
-        {
-            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
-            registros_file.seekg(offset);      // Posiciona el puntero de lectura en el registro actual
-            registros_file.read(reinterpret_cast<char*>(&actual), sizeof(actual));
-        }
-        long long siguiente = actual.pos_siguiente; // Guarda el offset al siguiente registro
+// offsetEliminar: el offset (según buscarRegistros) del registro a eliminar; se
+// identifica por offset porque el orden del directorio puede no ser el de la cadena
+void eliminarRegistroEspecifico(int dni, long long offsetEliminar) {
+    eliminarDeCadena(dni, [&](long long offset, const RegistroClinico& r) {
+        return r.dni == dni && offset == offsetEliminar;
+    });
+}
 
-        // Si el registro no es el que se debe eliminar, lo agrega al vector de nuevos registros
-        if (actual.dni != dni || idx != indexEliminar) {
-            RegistroClinico copia = actual;
-            nuevos.push_back(copia);
+// Edita el registro en `offset` (del DNI `dni`). Con el mismo DNI se sobrescribe
+// en el lugar (registros_edicion.h): una escritura de los campos y una
+// transacción del diario con esos bytes; la cadena, la tabla, el filtro y el
+// directorio no cambian. Con otro DNI se reubica: se inserta el nuevo y después
+// se elimina el viejo. false si el registro ya no está (eliminado, reusado o
+// reubicado por otra edición) o si no se pudo escribir.
+bool actualizarRegistro(int dni, long long offset, const RegistroClinico& nuevo) {
+    time_utils::ScopedTimer t(std::string("actualizarRegistro DNI:") + std::to_string(dni));
+    RegistroClinico viejo;
+    uint64_t lsn = 0;
+    bool reubicar;
+    tabla_compartida::Escritura rol(tabla_viva, retomarTabla);
+    {
+        std::unique_lock<std::shared_mutex> wlock(table_mutex);
+        std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+        if (!leerRegistro(offset, viejo) || esBorrado(viejo) || viejo.dni != dni) return false;
+        reubicar = !edicion::enElLugar(viejo, nuevo);
+        if (!reubicar) {
+            const std::string ruta = g_registros_path.empty() ? "registros.dat" : g_registros_path;
+            // la compactación que esté copiando descarta su copia
+            ++version_registros;
+            if (!edicion::sobrescribir(registros_file, offset, nuevo)) return false;
+            edicion::registrarDerivados(ruta, offset, viejo, nuevo);
+            wal::Transaccion tx;
+            tx.escritura(offset, &nuevo, (uint32_t)edicion::BYTES_CAMPOS);
+            lsn = diario_registros.agregar(tx);
+            if (diario_registros.bytes() >= wal::UMBRAL_CHECKPOINT) checkpointDiario();
         }
-        // Solo incrementa el índice si el registro pertenece al DNI buscado
-        if (actual.dni == dni)
-            idx++;
-
-        offset = siguiente; // Avanza al siguiente registro en la lista
     }
+    if (reubicar) {
+        // Otro bucket: primero el alta, así una caída entre medio no pierde el
+        // registro, y el viejo se elimina solo si el alta quedó escrita. Entre
+        // los dos pasos no hay locks: si otra edición o una baja ya quitó el
+        // viejo, se deshace el alta para no dejar dos copias.
+        long long nuevo_off = insertarRegistro(nuevo);
+        if (nuevo_off == NULL_OFFSET) return false;
+        if (eliminarDeCadena(dni, [&](long long off, const RegistroClinico& r) {
+                return off == offset && r.dni == dni;
+            }) == 1)
+            return true;
+        eliminarDeCadena(nuevo.dni, [&](long long off, const RegistroClinico& r) {
+            return off == nuevo_off && r.dni == nuevo.dni;
+        });
+        return false;
+    }
+    if (!diario_registros.confirmar(lsn))
+        std::cerr << "No se pudo escribir el diario; la edición no es durable" << std::endl;
+    return true;
+}
 
-    // Sobrescribe el archivo de registros solo con los registros no eliminados
-    registros_file.close();
-    registros_file.open(g_registros_path.empty() ? "registros.dat" : g_registros_path, std::ios::out | std::ios::trunc | std::ios::binary);
-
-    long long head = NULL_OFFSET;
-    long long new_offset = 0;
-    // Reconstruye la lista enlazada en orden inverso para mantener el orden original
-    for (auto it = nuevos.rbegin(); it != nuevos.rend(); ++it) {
-        it->pos_siguiente = head; // El siguiente registro apunta al anterior en la lista
-        registros_file.write(reinterpret_cast<char*>(&(*it)), sizeof(*it));
-        head = new_offset;        // Actualiza el head al nuevo registro insertado
-        new_offset += sizeof(RegistroClinico);
+// Mantenimiento en segundo plano, cada INTERVALO_MANTENIMIENTO:
+// - checkpoint del diario si tiene operaciones (las inserciones no escriben
+//   tabla_hash.dat);
+// - compactación cuando las lápidas superan UMBRAL_BASURA de registros.dat: se
+//   copian los registros vivos a un temporal sin tomar locks (solo se leen, con
+//   su propio descriptor) y los locks se toman únicamente para el reemplazo. Si
+//   hubo escrituras durante la copia se descarta y se reintenta en la vuelta siguiente.
+static const double UMBRAL_BASURA = libres::UMBRAL_BASURA_DEFECTO;
+static const std::chrono::seconds INTERVALO_MANTENIMIENTO(5);
+std::mutex mantenimiento_mutex;
+std::condition_variable mantenimiento_cv;
+bool mantenimiento_detener = false;    // protegido por mantenimiento_mutex
+std::thread mantenimiento;
+
+// Una pasada: true si reemplazó registros.dat
+bool compactarRegistros() {
+    const std::string ruta = g_registros_path.empty() ? "registros.dat" : g_registros_path;
+    if (libres::fraccionBasura(ruta) < UMBRAL_BASURA) return false;
+    time_utils::ScopedTimer t("compactarRegistros");
+    tabla_hash::Tabla vieja, nueva;
+    unsigned long long version;
+    // con el rol de escritor hasta el reemplazo: otro proceso no escribe en medio
+    tabla_compartida::Escritura rol(tabla_viva, retomarTabla);
+    {
+        // exclusivo: las inserciones cambian cabezas con el lock compartido
+        std::unique_lock<std::shared_mutex> wlock(table_mutex);
+        tabla_viva.copiar(vieja);
+        version = version_registros.load();
     }
+    int fd = ::open(ruta.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const std::string tmp = ruta + ".compacto";
+    const std::string tabla_tmp = g_tabla_path + ".compacto";
+    bool ok = libres::compactar(vieja, tamArchivo(ruta),
+        [&](long long off, void* dst, size_t n) { return ::pread(fd, dst, n, (off_t)off) == (ssize_t)n; },
+        tmp, nueva);
+    ::close(fd);
+    if (ok) {
+        std::unique_lock<std::shared_mutex> olock(offsets_mutex);
+        std::unique_lock<std::shared_mutex> wlock(table_mutex);
+        std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+        ok = version_registros.load() == version;
+        // El diario habla de los offsets viejos: se vacía antes del reemplazo
+        if (ok) ok = checkpointDiario();
+        if (ok) ok = tabla_hash::guardar(tabla_tmp, nueva);
+        if (ok) {
+            // El rename (en vez de truncar en el lugar) evita que un lector
+            // concurrente toque páginas que dejaron de existir; los dos archivos
+            // se reemplazan como par (una caída entre medio se completa al abrir)
+            {
+                std::lock_guard<std::mutex> lg(tabla_file_mutex);
+                registros_file.close();
+                tabla_file.close();
+                ok = wal::reemplazarPar(ruta, tmp, g_tabla_path, tabla_tmp);
+                if (!ok) std::cerr << "No se pudo reemplazar " << ruta << " y " << g_tabla_path
+                                   << " (si quedó registros.reemplazo, se completa al abrir)" << std::endl;
+                registros_file.open(ruta, std::ios::in | std::ios::out | std::ios::binary);
+                tabla_file.open(g_tabla_path, std::ios::in | std::ios::out | std::ios::binary);
+            }
+            ::close(registros_fd);
+            registros_fd = ::open(ruta.c_str(), O_RDWR);
+            reiniciarCola();
+            almacen_registros.reabrir();
+            if (ok) {
+                std::lock_guard<std::shared_mutex> dlock(derivados_mutex);
+                std::error_code ec;
+                std::filesystem::remove(libres::rutaLibres(ruta), ec);
+                // los demás procesos reabren registros.dat al ver la generación nueva
+                tabla_viva.empezarCambio();
+                tabla_viva.publicar(nueva);
+                tabla_viva.reemplazarRegistros(tamArchivo(ruta));
+                tabla_viva.terminarCambio();
+                // Los derivados en memoria dejan de valer hasta reconstruirlos
+                filtro_dnis.cerrar();
+                directorio_pacientes.cerrar();
+            }
+        }
+    }
+    // Con un reemplazo a medias los temporales son los que se completan al abrir
+    std::error_code ec;
+    if (!wal::reemplazoPendiente(ruta)) {
+        std::filesystem::remove(tmp, ec);
+        std::filesystem::remove(tabla_tmp, ec);
+    }
+    if (!ok) return false;
+    reconstruirDerivados(ruta);
+    recargarDerivados();
+    return true;
+}
 
-    // Actualiza el head de la lista en la tabla hash
-    escribirHead(pos, nuevos.empty() ? NULL_OFFSET : (new_offset - sizeof(RegistroClinico)));
+void bucleMantenimiento() {
+    std::unique_lock<std::mutex> lk(mantenimiento_mutex);
+    while (!mantenimiento_cv.wait_for(lk, INTERVALO_MANTENIMIENTO, [] { return mantenimiento_detener; })) {
+        lk.unlock();
+        if (diario_registros.bytes() > 0) {
+            tabla_compartida::Escritura rol(tabla_viva, retomarTabla);
+            std::unique_lock<std::shared_mutex> wlock(table_mutex);
+            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+            checkpointDiario();
+        }
+        compactarRegistros();
+        // Si otro proceso (gestor_dni) espera el rol de escritor, se lo pasa
+        // con el diario vacío; la GUI lo vuelve a tomar en su próxima escritura
+        tabla_viva.ceder([] {
+            std::unique_lock<std::shared_mutex> wlock(table_mutex);
+            std::lock_guard<std::mutex> io_lock(registros_io_mutex);
+            if (diario_registros.bytes() > 0) checkpointDiario();
+        });
+        lk.lock();
+    }
 }
 
 // Ventana principal de la aplicación, hereda de QWidget
 class MainWindow : public QWidget {
 public:
     MainWindow(QWidget *parent = nullptr);
-    void buscar();      // Método para buscar registros por DNI
+    void buscar();      // Método para buscar registros por DNI o apellido/nombre
     void insertar();    // Método para insertar un nuevo registro
     void eliminar();    // Método para eliminar registros
+    void editar();      // Método para editar un registro
 
 
 private:
@@ -313,16 +482,18 @@ MainWindow::MainWindow(QWidget *parent) : QWidget(parent) {
     // Menú principal
     QWidget *menu = new QWidget;
     QVBoxLayout *menuLayout = new QVBoxLayout(menu);
-    QPushButton *btnBuscar = new QPushButton("Buscar por DNI");
+    QPushButton *btnBuscar = new QPushButton("Buscar por DNI o nombre");
     QPushButton *btnInsertar = new QPushButton("Insertar Registro");
     QPushButton *btnEliminar = new QPushButton("Eliminar por DNI");
     QPushButton *btnEliminarUno = new QPushButton("Eliminar un Registro por DNI");
+    QPushButton *btnEditar = new QPushButton("Editar un Registro por DNI");
     QPushButton *btnGPU = new QPushButton("Análisis GPU");
     QPushButton *btnSalir = new QPushButton("Salir");
     menuLayout->addWidget(btnBuscar);
     menuLayout->addWidget(btnInsertar);
     menuLayout->addWidget(btnEliminar);
     menuLayout->addWidget(btnEliminarUno);
+    menuLayout->addWidget(btnEditar);
     menuLayout->addWidget(btnGPU);
     menuLayout->addWidget(btnSalir);
 
@@ -347,6 +518,7 @@ MainWindow::MainWindow(QWidget *parent) : QWidget(parent) {
     QObject::connect(btnInsertar, &QPushButton::clicked, this, &MainWindow::insertar);
     QObject::connect(btnEliminar, &QPushButton::clicked, this, &MainWindow::eliminar);
     //QObject::connect(btnEliminarUno, &QPushButton::clicked, this, &MainWindow::eliminar);
+    QObject::connect(btnEditar, &QPushButton::clicked, this, &MainWindow::editar);
     QObject::connect(btnGPU, &QPushButton::clicked, [=]() {
         bool ok1 = false;
         int minEdad = QInputDialog::getInt(this, "Análisis GPU", "Edad mínima:", 0, 0, 200, 1, &ok1);
@@ -387,57 +559,82 @@ MainWindow::MainWindow(QWidget *parent) : QWidget(parent) {
     QObject::connect(btnSalir, &QPushButton::clicked, qApp, &QApplication::quit);
 }
 
-// Método para buscar registros por DNI y mostrarlos uno a uno
+// Muestra los registros en `registros` (offsets) uno a uno, con navegación
+void mostrarRegistros(const std::vector<long long>& registros) {
+    int index = 0;
+
+    // Función lambda recursiva para mostrar los registros uno a uno
+    std::function<void()> mostrar;
+    mostrar = [&]() {
+        RegistroClinico r{};
+        leerRegistro(registros[index], r);
+        QString info = "Resultado " + QString::number(index + 1) + "/" + QString::number(registros.size()) + ":\n";
+        info += "Fecha: " + QString(r.fecha) + "\nDNI: " + QString::number(r.dni) +
+                "\nNombre: " + QString(r.nombre) +
+                "\nApellido: " + QString(r.apellido) +
+                "\nEdad: " + QString::number(r.edad) +
+                "\nMédico: " + QString(r.medico) +
+                "\nMotivo: " + QString(r.motivo) +
+                "\nExámenes: " + QString(r.examenes) +
+                "\nResultados: " + QString(r.resultados) +
+                "\nReceta: " + QString(r.receta);
+        QMessageBox msgBox;
+        QPushButton *prevBtn = msgBox.addButton("<< Anterior", QMessageBox::ActionRole);
+        QPushButton *nextBtn = msgBox.addButton("Siguiente >>", QMessageBox::ActionRole);
+        QPushButton *closeBtn = msgBox.addButton(QMessageBox::Close);
+        msgBox.setText(info);
+        // Permite navegar entre los registros encontrados
+        QObject::connect(prevBtn, &QPushButton::clicked, [&]() {
+            if (index > 0) --index;
+            msgBox.done(0);
+            mostrar();
+        });
+        QObject::connect(nextBtn, &QPushButton::clicked, [&]() {
+            if (index < registros.size() - 1) ++index;
+            msgBox.done(0);
+            mostrar();
+        });
+        msgBox.exec();
+    };
+
+    mostrar();  // Muestra el primer registro
+}
+
+// Método para buscar registros por DNI o por prefijo de apellido/nombre y mostrarlos uno a uno
 void MainWindow::buscar() {
     QDialog d(this);
     QFormLayout form(&d);
     QLineEdit *dniEdit = new QLineEdit;
     QPushButton *buscarBtn = new QPushButton("Buscar");
-    form.addRow("DNI:", dniEdit);
+    form.addRow("DNI o apellido [nombre]:", dniEdit);
     form.addWidget(buscarBtn);
     QObject::connect(buscarBtn, &QPushButton::clicked, [&]() {
-        int dni = dniEdit->text().toInt();
+        // Solo dígitos: búsqueda por DNI; si no, por prefijo de apellido/nombre
+        QString texto = dniEdit->text().trimmed();
+        bool esDni = false;
+        int dni = texto.toInt(&esDni);
+        if (!esDni) {
+            std::shared_lock<std::shared_mutex> olock(offsets_mutex);
+            bool indiceOk = false;
+            auto registros = buscarPorNombre(dniEdit->text().toStdString(), indiceOk);
+            d.accept();
+            if (!indiceOk) {
+                QMessageBox::warning(this, "Sin índice",
+                                     "No hay índice por nombre actualizado (correr indice_nombre construir).");
+                return;
+            }
+            if (registros.empty()) {
+                QMessageBox::information(this, "Sin resultados", "No se encontraron registros para \"" + texto + "\".");
+                return;
+            }
+            mostrarRegistros(registros);
+            return;
+        }
+        std::shared_lock<std::shared_mutex> olock(offsets_mutex); // los offsets valen hasta cerrar la vista
         auto registros = buscarRegistros(dni);
         d.accept();
         if (!registros.empty()) {
-            int index = 0;
-
-            // Función lambda recursiva para mostrar los registros uno a uno
-            std::function<void()> mostrar;
-            mostrar = [&]() {
-                RegistroClinico r;
-                registros_file.seekg(registros[index]);
-                registros_file.read(reinterpret_cast<char*>(&r), sizeof(r));
-                QString info = "Resultado " + QString::number(index + 1) + "/" + QString::number(registros.size()) + ":\n";
-                info += "Fecha: " + QString(r.fecha) + "\nDNI: " + QString::number(r.dni) +
-                        "\nNombre: " + QString(r.nombre) +
-                        "\nApellido: " + QString(r.apellido) +
-                        "\nEdad: " + QString::number(r.edad) +
-                        "\nMédico: " + QString(r.medico) +
-                        "\nMotivo: " + QString(r.motivo) +
-                        "\nExámenes: " + QString(r.examenes) +
-                        "\nResultados: " + QString(r.resultados) +
-                        "\nReceta: " + QString(r.receta);
-                QMessageBox msgBox;
-                QPushButton *prevBtn = msgBox.addButton("<< Anterior", QMessageBox::ActionRole);
-                QPushButton *nextBtn = msgBox.addButton("Siguiente >>", QMessageBox::ActionRole);
-                QPushButton *closeBtn = msgBox.addButton(QMessageBox::Close);
-                msgBox.setText(info);
-                // Permite navegar entre los registros encontrados
-                QObject::connect(prevBtn, &QPushButton::clicked, [&]() {
-                    if (index > 0) --index;
-                    msgBox.done(0);
-                    mostrar();
-                });
-                QObject::connect(nextBtn, &QPushButton::clicked, [&]() {
-                    if (index < registros.size() - 1) ++index;
-                    msgBox.done(0);
-                    mostrar();
-                });
-                msgBox.exec();
-            };
-
-            mostrar();  // Muestra el primer registro
+            mostrarRegistros(registros);
         } else {
             // Mostrar información de depuración: head offset y paths usados
             int pos = hash1(dni);
@@ -454,11 +651,8 @@ void MainWindow::buscar() {
     d.exec();
 }
 
-// Método para insertar un nuevo registro clínico
-void MainWindow::insertar() {
-    QDialog d(this);
-    QFormLayout form(&d);
-    RegistroClinico r{};
+// Campos del formulario de un registro (alta y edición)
+struct FormularioRegistro {
     QLineEdit *dni = new QLineEdit;
     QLineEdit *nombre = new QLineEdit;
     QLineEdit *apellido = new QLineEdit;
@@ -470,35 +664,48 @@ void MainWindow::insertar() {
     QLineEdit *resultado = new QLineEdit;
     QLineEdit *receta = new QLineEdit;
 
-    form.addRow("DNI:", dni);
-    form.addRow("Nombre:", nombre);
-    form.addRow("Apellido:", apellido);
-    form.addRow("Edad:", edad);
-    form.addRow("Fecha (YYYY-MM-DD):", fecha);
-    form.addRow("Médico:", medico);
-    form.addRow("Motivo:", motivo);
-    form.addRow("Exámenes:", examen);
-    form.addRow("Resultados:", resultado);
-    form.addRow("Receta:", receta);
+    void agregarA(QFormLayout &form) {
+        form.addRow("DNI:", dni);
+        form.addRow("Nombre:", nombre);
+        form.addRow("Apellido:", apellido);
+        form.addRow("Edad:", edad);
+        form.addRow("Fecha (YYYY-MM-DD):", fecha);
+        form.addRow("Médico:", medico);
+        form.addRow("Motivo:", motivo);
+        form.addRow("Exámenes:", examen);
+        form.addRow("Resultados:", resultado);
+        form.addRow("Receta:", receta);
+    }
 
-    QPushButton *btnInsert = new QPushButton("Guardar");
-    form.addWidget(btnInsert);
+    // Carga los valores de `r` (edición)
+    void mostrar(const RegistroClinico &r) {
+        dni->setText(QString::number(r.dni));
+        nombre->setText(r.nombre);
+        apellido->setText(r.apellido);
+        edad->setText(QString::number(r.edad));
+        fecha->setText(r.fecha);
+        medico->setText(r.medico);
+        motivo->setText(r.motivo);
+        examen->setText(r.examenes);
+        resultado->setText(r.resultados);
+        receta->setText(r.receta);
+    }
 
-    // Al presionar guardar, toma los datos y los inserta en el archivo
-    QObject::connect(btnInsert, &QPushButton::clicked, [&]() {
+    // Valida los campos y los copia a `r`; si algo no vale avisa en `d` y devuelve false
+    bool leer(QDialog &d, RegistroClinico &r) {
         // === VALIDACIONES ===
 
         // Validar DNI (8 dígitos numéricos)
         QString dniTexto = dni->text().trimmed();
         if (dniTexto.length() != 8 || !dniTexto.toInt()) {
             QMessageBox::warning(&d, "Error", "DNI inválido. Debe tener 8 dígitos numéricos.");
-            return;
+            return false;
         }
 
         // Validar Nombre y Apellido (no vacíos)
         if (nombre->text().trimmed().isEmpty() || apellido->text().trimmed().isEmpty()) {
             QMessageBox::warning(&d, "Error", "Nombre y Apellido no pueden estar vacíos.");
-            return;
+            return false;
         }
 
         // Validar Edad (número positivo)
@@ -506,20 +713,20 @@ void MainWindow::insertar() {
         int edadValor = edad->text().toInt(&edadOK);
         if (!edadOK || edadValor <= 0) {
             QMessageBox::warning(&d, "Error", "Edad inválida. Debe ser un número positivo.");
-            return;
+            return false;
         }
 
         // Validar Fecha (formato YYYY-MM-DD)
         QRegExp regexFecha("\\d{4}-\\d{2}-\\d{2}");
         if (!regexFecha.exactMatch(fecha->text())) {
             QMessageBox::warning(&d, "Error", "Fecha inválida. Use el formato YYYY-MM-DD.");
-            return;
+            return false;
         }
 
         // Validar Médico y Motivo (no vacíos)
         if (medico->text().trimmed().isEmpty() || motivo->text().trimmed().isEmpty()) {
             QMessageBox::warning(&d, "Error", "Los campos 'Médico' y 'Motivo' no pueden estar vacíos.");
-            return;
+            return false;
         }
 
         // === COPIA DE DATOS ===
@@ -534,7 +741,24 @@ void MainWindow::insertar() {
         strncpy(r.examenes, examen->text().toStdString().c_str(), sizeof(r.examenes));
         strncpy(r.resultados, resultado->text().toStdString().c_str(), sizeof(r.resultados));
         strncpy(r.receta, receta->text().toStdString().c_str(), sizeof(r.receta));
+        return true;
+    }
+};
 
+// Método para insertar un nuevo registro clínico
+void MainWindow::insertar() {
+    QDialog d(this);
+    QFormLayout form(&d);
+    RegistroClinico r{};
+    FormularioRegistro campos;
+    campos.agregarA(form);
+
+    QPushButton *btnInsert = new QPushButton("Guardar");
+    form.addWidget(btnInsert);
+
+    // Al presionar guardar, toma los datos y los inserta en el archivo
+    QObject::connect(btnInsert, &QPushButton::clicked, [&]() {
+        if (!campos.leer(d, r)) return;
         insertarRegistro(r); // Inserta el registro en el archivo binario
         QMessageBox::information(&d, "Insertado", "Registro insertado correctamente.");
         d.accept();
@@ -543,6 +767,56 @@ void MainWindow::insertar() {
     d.exec();
 }
 
+// Método para editar un registro de un DNI (seleccionando cuál): con el mismo
+// DNI se sobrescribe en el lugar; si cambia el DNI se mueve a la cadena nueva
+void MainWindow::editar() {
+    bool ok = false;
+    int dni = QInputDialog::getInt(this, "Editar Registro", "DNI:", 0, 0, 99999999, 1, &ok);
+    if (!ok) return;
+    std::shared_lock<std::shared_mutex> olock(offsets_mutex); // hasta guardar el elegido
+    auto registros = buscarRegistros(dni);
+    if (registros.empty()) {
+        QMessageBox::information(this, "Sin registros", "No se encontraron registros.");
+        return;
+    }
+
+    QStringList opciones;
+    for (size_t i = 0; i < registros.size(); ++i) {
+        RegistroClinico r;
+        if (!leerRegistro(registros[i], r)) continue;
+        opciones << QString("[" + QString::number(i + 1) + "] ") + r.fecha + " - " + r.motivo;
+    }
+    QString elegido = QInputDialog::getItem(this, "Elegir Registro", "Seleccione registro a editar:", opciones, 0, false, &ok);
+    if (!ok || elegido.isEmpty()) return;
+    int idx = elegido.mid(1, elegido.indexOf("]") - 1).toInt() - 1;
+    if (idx < 0 || idx >= (int)registros.size()) return;
+    const long long offset = registros[(size_t)idx];
+
+    QDialog d(this);
+    QFormLayout form(&d);
+    RegistroClinico r{};
+    leerRegistro(offset, r);
+    FormularioRegistro campos;
+    campos.agregarA(form);
+    campos.mostrar(r);
+    QPushButton *btnGuardar = new QPushButton("Guardar cambios");
+    form.addWidget(btnGuardar);
+
+    QObject::connect(btnGuardar, &QPushButton::clicked, [&]() {
+        RegistroClinico nuevo{};
+        if (!campos.leer(d, nuevo)) return;
+        if (!actualizarRegistro(dni, offset, nuevo)) {
+            QMessageBox::warning(&d, "Error", "El registro ya no existe (fue eliminado).");
+            d.reject();
+            return;
+        }
+        QMessageBox::information(&d, "Actualizado", "Registro actualizado correctamente.");
+        d.accept();
+    });
+
+    d.exec();
+}
+
 
 // Método para eliminar registros por DNI o uno específico
 void MainWindow::eliminar() {
@@ -567,6 +841,7 @@ void MainWindow::eliminar() {
     // Elimina un registro específico de un DNI (seleccionando cuál)
     QObject::connect(eliminarUnoBtn, &QPushButton::clicked, [&]() {
         int dni = dniEdit->text().toInt();
+        std::shared_lock<std::shared_mutex> olock(offsets_mutex); // hasta eliminar el elegido
         auto registros = buscarRegistros(dni);
         if (registros.empty()) {
             QMessageBox::information(&d, "Sin registros", "No se encontraron registros.");
@@ -576,8 +851,7 @@ void MainWindow::eliminar() {
         QStringList opciones;
         for (size_t i = 0; i < registros.size(); ++i) {
             RegistroClinico r;
-            registros_file.seekg(registros[i]);
-            registros_file.read(reinterpret_cast<char*>(&r), sizeof(r));
+            if (!leerRegistro(registros[i], r)) continue;
             opciones << QString("[" + QString::number(i + 1) + "] ") + r.fecha + " - " + r.motivo;
         }
 
@@ -585,7 +859,7 @@ void MainWindow::eliminar() {
         QString elegido = QInputDialog::getItem(&d, "Elegir Registro", "Seleccione registro a eliminar:", opciones, 0, false, &ok);
         if (ok && !elegido.isEmpty()) {
             int idx = elegido.mid(1, elegido.indexOf("]") - 1).toInt() - 1;
-            eliminarRegistroEspecifico(dni, idx);
+            if (idx >= 0 && idx < (int)registros.size()) eliminarRegistroEspecifico(dni, registros[(size_t)idx]);
             QMessageBox::information(&d, "Eliminado", "El registro fue eliminado correctamente.");
             d.accept();
         }
@@ -600,10 +874,20 @@ void MainWindow::eliminar() {
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
     // GUI: inicialización de archivos y carga de tabla en memoria
-    // (inicializarArchivos carga `tabla_hash.dat` a `in_memory_table`)
+    // (inicializarArchivos se adjunta a la tabla compartida `tabla_viva`)
     time_utils::ScopedTimer init_timer("GUI inicializarArchivos");
     inicializarArchivos(); // Prepara los archivos binarios
+    mantenimiento = std::thread(bucleMantenimiento);
     MainWindow w;
     w.show();
-    return app.exec();
+    int res = app.exec();
+    {
+        std::lock_guard<std::mutex> lk(mantenimiento_mutex);
+        mantenimiento_detener = true;
+    }
+    mantenimiento_cv.notify_all();
+    mantenimiento.join();
+    // Al salir la tabla queda al día, el diario vacío y el rol de escritor libre
+    vivo.soltar();
+    return res;
 }
@@ -0,0 +1,569 @@
+// registro_v2.h
+// Codificación compacta v2 de los registros, derivada de `registros.dat`:
+// - `registros_v2.dat`  : CabeceraV2 + un RegistroCompacto (tamaño fijo) por
+//                         registro, en el mismo orden que registros.dat.
+// - `textos_v2.heap`    : texto libre de largo variable (nombre, apellido,
+//                         resultados, receta) referenciado por offset/largo.
+// - `diccionario_v2.dat`: valores distintos de medico, motivo y examenes; el
+//                         registro guarda solo su ID (uint16).
+// La fecha se guarda como días desde 1970-01-01 (int32) y la edad como uint8;
+// los valores que no entran (fecha no AAAA-MM-DD, edad fuera de 0..254, texto
+// fuera del diccionario) van tal cual al heap, así la conversión es exacta.
+// El registro de la fila i corresponde al offset i * sizeof(RegistroClinico)
+// de registros.dat: `tabla_hash.dat` sirve sin cambios y `siguiente` es la
+// fila del próximo registro de la cadena (-1 al final).
+// registros.dat sigue siendo el almacén que se escribe (GUI, loader); v2 es
+// una copia de solo lectura con cabecera de frescura (tamaño/mtime) como las
+// columnas de columnas.h.
+#pragma once
+#include "common.h"
+#include "columnas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace registro_v2 {
+
+static const char REG_MAGIC[8] = {'P', 'P', 'R', 'E', 'G', '2', 0, 0};
+static const char DIC_MAGIC[8] = {'P', 'P', 'D', 'I', 'C', '2', 0, 0};
+static const int32_t V2_VERSION = 1;
+static const uint16_t ID_EN_HEAP = 0xFFFF;        // valor fuera del diccionario
+static const size_t MAX_IDS = ID_EN_HEAP;         // IDs válidos: 0..65534
+static const uint8_t FLAG_FECHA_CRUDA = 1;        // fecha textual en el heap
+static const uint8_t FLAG_EDAD_CRUDA = 2;         // edad int32 en el heap
+
+enum ColumnaDic { COL_MEDICO = 0, COL_MOTIVO = 1, COL_EXAMENES = 2, NUM_COLUMNAS_DIC = 3 };
+
+#pragma pack(push, 1)
+struct RegistroCompacto {
+    int32_t dni;
+    int32_t fecha;                 // días desde 1970-01-01
+    uint8_t edad;
+    uint8_t flags;                 // FLAG_FECHA_CRUDA | FLAG_EDAD_CRUDA
+    uint16_t ids[NUM_COLUMNAS_DIC];// medico, motivo, examenes (ID_EN_HEAP = texto en el heap)
+    uint16_t heap_len;
+    int64_t heap_offset;
+    int64_t siguiente;             // fila siguiente de la cadena o -1
+};
+
+struct CabeceraV2 {
+    char magic[8];                 // REG_MAGIC
+    int32_t version;               // V2_VERSION
+    int32_t tam_registro;          // sizeof(RegistroCompacto)
+    int64_t num_registros;
+    int64_t tam_heap;
+    int64_t tam_registros;         // tamaño de registros.dat de origen
+    int64_t mtime_registros;       // mtime (ns) de registros.dat de origen
+    int64_t reservado[2];
+};
+#pragma pack(pop)
+
+// Rutas de los archivos v2 junto a registros.dat
+inline std::string rutaRegistros(const std::string &r) { return rutaJunto(r, "registros_v2.dat"); }
+inline std::string rutaHeap(const std::string &r) { return rutaJunto(r, "textos_v2.heap"); }
+inline std::string rutaDiccionario(const std::string &r) { return rutaJunto(r, "diccionario_v2.dat"); }
+
+// Texto de un campo de ancho fijo (hasta el primer NUL)
+inline std::string texto(const char *campo, size_t ancho) { return std::string(campo, strnlen(campo, ancho)); }
+
+inline std::string campoDic(const RegistroClinico &r, int col)
+{
+    if (col == COL_MEDICO) return texto(r.medico, sizeof(r.medico));
+    if (col == COL_MOTIVO) return texto(r.motivo, sizeof(r.motivo));
+    return texto(r.examenes, sizeof(r.examenes));
+}
+
+// Inversa de columnas::fechaADias ("AAAA-MM-DD")
+inline std::string diasAFecha(int32_t dias)
+{
+    long long z = (long long)dias + 719468;
+    const long long era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    long long y = (long long)yoe + era * 400 + (m <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u", y, m, d);
+    return buf;
+}
+
+// Fecha como días si vuelve a dar exactamente el mismo texto
+inline bool fechaCompacta(const RegistroClinico &r, int32_t &dias)
+{
+    dias = columnas::fechaADias(r.fecha);
+    return dias != columnas::FECHA_INVALIDA && diasAFecha(dias) == texto(r.fecha, sizeof(r.fecha));
+}
+
+// ---------------------------------------------------------------------------
+// Diccionario
+// ---------------------------------------------------------------------------
+
+// Frecuencia de cada valor de las columnas de diccionario
+struct Frecuencias {
+    std::unordered_map<std::string, long long> col[NUM_COLUMNAS_DIC];
+
+    void agregar(const RegistroClinico &r) {
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) ++col[c][campoDic(r, c)];
+    }
+    void combinar(const Frecuencias &o) {
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c)
+            for (auto &kv : o.col[c]) col[c][kv.first] += kv.second;
+    }
+
+    // Serialización para MPI: por columna [n uint32] y n veces [largo uint8][bytes][cuenta int64]
+    std::string serializar() const {
+        std::string s;
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            uint32_t n = (uint32_t)col[c].size();
+            s.append(reinterpret_cast<const char *>(&n), sizeof(n));
+            for (auto &kv : col[c]) {
+                s.push_back((char)(uint8_t)kv.first.size());
+                s.append(kv.first);
+                s.append(reinterpret_cast<const char *>(&kv.second), sizeof(kv.second));
+            }
+        }
+        return s;
+    }
+    bool deserializar(const char *p, size_t n) {
+        size_t i = 0;
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            uint32_t k;
+            if (n - i < sizeof(k)) return false;
+            std::memcpy(&k, p + i, sizeof(k));
+            i += sizeof(k);
+            for (uint32_t j = 0; j < k; ++j) {
+                if (i >= n) return false;
+                size_t largo = (uint8_t)p[i++];
+                long long cuenta;
+                if (n - i < largo + sizeof(cuenta)) return false;
+                std::string v(p + i, largo);
+                std::memcpy(&cuenta, p + i + largo, sizeof(cuenta));
+                i += largo + sizeof(cuenta);
+                col[c][v] += cuenta;
+            }
+        }
+        return true;
+    }
+};
+
+class Diccionario {
+public:
+    // Los MAX_IDS valores más frecuentes de cada columna, con IDs en orden
+    // lexicográfico (el resultado no depende de cómo se repartió la carga)
+    static Diccionario construir(const Frecuencias &f) {
+        Diccionario d;
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            std::vector<std::pair<long long, std::string>> v;
+            v.reserve(f.col[c].size());
+            for (auto &kv : f.col[c]) v.emplace_back(kv.second, kv.first);
+            if (v.size() > MAX_IDS) {
+                std::nth_element(v.begin(), v.begin() + MAX_IDS, v.end(), [](const auto &a, const auto &b) {
+                    return a.first != b.first ? a.first > b.first : a.second < b.second;
+                });
+                v.resize(MAX_IDS);
+            }
+            for (auto &e : v) d.valores_[c].push_back(e.second);
+            std::sort(d.valores_[c].begin(), d.valores_[c].end());
+        }
+        d.indexar();
+        return d;
+    }
+
+    uint16_t id(int col, const std::string &valor) const {
+        auto it = ids_[col].find(valor);
+        return it == ids_[col].end() ? ID_EN_HEAP : it->second;
+    }
+    const std::string &valor(int col, uint16_t id) const { return valores_[col][id]; }
+    size_t tam(int col) const { return valores_[col].size(); }
+
+    // Formato: DIC_MAGIC, por columna [n uint32] y n veces [largo uint8][bytes]
+    std::string serializar() const {
+        std::string s(DIC_MAGIC, sizeof(DIC_MAGIC));
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            uint32_t n = (uint32_t)valores_[c].size();
+            s.append(reinterpret_cast<const char *>(&n), sizeof(n));
+            for (auto &v : valores_[c]) {
+                s.push_back((char)(uint8_t)v.size());
+                s.append(v);
+            }
+        }
+        return s;
+    }
+    bool deserializar(const std::string &s) {
+        size_t i = sizeof(DIC_MAGIC);
+        if (s.size() < i || std::memcmp(s.data(), DIC_MAGIC, sizeof(DIC_MAGIC)) != 0) return false;
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            uint32_t n;
+            if (s.size() - i < sizeof(n)) return false;
+            std::memcpy(&n, s.data() + i, sizeof(n));
+            i += sizeof(n);
+            if (n > MAX_IDS) return false;
+            valores_[c].clear();
+            for (uint32_t k = 0; k < n; ++k) {
+                if (i >= s.size()) return false;
+                size_t largo = (uint8_t)s[i++];
+                if (s.size() - i < largo) return false;
+                valores_[c].emplace_back(s.data() + i, largo);
+                i += largo;
+            }
+        }
+        indexar();
+        return true;
+    }
+
+    bool guardar(const std::string &ruta) const {
+        std::ofstream out(ruta, std::ios::binary | std::ios::trunc);
+        std::string s = serializar();
+        return out.is_open() && (bool)out.write(s.data(), (std::streamsize)s.size());
+    }
+    bool cargar(const std::string &ruta) {
+        std::ifstream in(ruta, std::ios::binary);
+        if (!in.is_open()) return false;
+        std::string s((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return deserializar(s);
+    }
+
+private:
+    void indexar() {
+        for (int c = 0; c < NUM_COLUMNAS_DIC; ++c) {
+            ids_[c].clear();
+            for (size_t k = 0; k < valores_[c].size(); ++k) ids_[c][valores_[c][k]] = (uint16_t)k;
+        }
+    }
+
+    std::vector<std::string> valores_[NUM_COLUMNAS_DIC];
+    std::unordered_map<std::string, uint16_t> ids_[NUM_COLUMNAS_DIC];
+};
+
+// ---------------------------------------------------------------------------
+// Codificación de un registro
+// Heap de cada registro: nombre, apellido, resultados, receta ([largo uint8][bytes]),
+// luego los valores fuera del diccionario, la fecha cruda y la edad cruda (int32)
+// si corresponde.
+// ---------------------------------------------------------------------------
+
+namespace detalle {
+
+inline void agregarTexto(std::string &heap, const char *campo, size_t ancho)
+{
+    size_t n = strnlen(campo, ancho);
+    heap.push_back((char)(uint8_t)n);
+    heap.append(campo, n);
+}
+
+inline bool leerTexto(const char *heap, size_t n, size_t &i, char *campo, size_t ancho)
+{
+    if (i >= n) return false;
+    size_t largo = (uint8_t)heap[i++];
+    if (largo > ancho || n - i < largo) return false;
+    std::memset(campo, 0, ancho);
+    std::memcpy(campo, heap + i, largo);
+    i += largo;
+    return true;
+}
+
+inline char *campoDic(RegistroClinico &r, int col, size_t &ancho)
+{
+    if (col == COL_MEDICO) { ancho = sizeof(r.medico); return r.medico; }
+    if (col == COL_MOTIVO) { ancho = sizeof(r.motivo); return r.motivo; }
+    ancho = sizeof(r.examenes);
+    return r.examenes;
+}
+
+} // namespace detalle
+
+// Codifica `r` en `c` y agrega su parte variable al final de `heap`.
+// `heap_base` es el offset en textos_v2.heap donde empieza `heap`.
+inline void codificar(const RegistroClinico &r, const Diccionario &dic, long long heap_base, RegistroCompacto &c,
+                      std::string &heap)
+{
+    const size_t inicio = heap.size();
+    std::memset(&c, 0, sizeof(c));
+    c.dni = r.dni;
+    c.siguiente = (r.pos_siguiente == NULL_OFFSET) ? -1 : r.pos_siguiente / (long long)sizeof(RegistroClinico);
+    detalle::agregarTexto(heap, r.nombre, sizeof(r.nombre));
+    detalle::agregarTexto(heap, r.apellido, sizeof(r.apellido));
+    detalle::agregarTexto(heap, r.resultados, sizeof(r.resultados));
+    detalle::agregarTexto(heap, r.receta, sizeof(r.receta));
+    for (int col = 0; col < NUM_COLUMNAS_DIC; ++col) {
+        std::string v = campoDic(r, col);
+        c.ids[col] = dic.id(col, v);
+        if (c.ids[col] == ID_EN_HEAP) {
+            heap.push_back((char)(uint8_t)v.size());
+            heap.append(v);
+        }
+    }
+    if (!fechaCompacta(r, c.fecha)) {
+        c.fecha = columnas::FECHA_INVALIDA;
+        c.flags |= FLAG_FECHA_CRUDA;
+        detalle::agregarTexto(heap, r.fecha, sizeof(r.fecha));
+    }
+    if (r.edad >= 0 && r.edad < 255) {
+        c.edad = (uint8_t)r.edad;
+    } else {
+        c.edad = 255;
+        c.flags |= FLAG_EDAD_CRUDA;
+        heap.append(reinterpret_cast<const char *>(&r.edad), sizeof(r.edad));
+    }
+    c.heap_offset = heap_base + (long long)inicio;
+    c.heap_len = (uint16_t)(heap.size() - inicio);
+}
+
+// Bytes de heap que ocupará `r` (para repartir el heap antes de escribir)
+inline size_t bytesHeap(const RegistroClinico &r, const Diccionario &dic)
+{
+    RegistroCompacto c;
+    std::string heap;
+    codificar(r, dic, 0, c, heap);
+    return heap.size();
+}
+
+// Reconstruye el registro original a partir de `c` y su heap (`heap`, c.heap_len bytes)
+inline bool decodificar(const RegistroCompacto &c, const char *heap, const Diccionario &dic, RegistroClinico &r)
+{
+    std::memset(&r, 0, sizeof(r));
+    const size_t n = c.heap_len;
+    size_t i = 0;
+    r.dni = c.dni;
+    r.pos_siguiente = (c.siguiente < 0) ? NULL_OFFSET : c.siguiente * (long long)sizeof(RegistroClinico);
+    if (!detalle::leerTexto(heap, n, i, r.nombre, sizeof(r.nombre)) ||
+        !detalle::leerTexto(heap, n, i, r.apellido, sizeof(r.apellido)) ||
+        !detalle::leerTexto(heap, n, i, r.resultados, sizeof(r.resultados)) ||
+        !detalle::leerTexto(heap, n, i, r.receta, sizeof(r.receta)))
+        return false;
+    for (int col = 0; col < NUM_COLUMNAS_DIC; ++col) {
+        size_t ancho = 0;
+        char *campo = detalle::campoDic(r, col, ancho);
+        if (c.ids[col] == ID_EN_HEAP) {
+            if (!detalle::leerTexto(heap, n, i, campo, ancho)) return false;
+        } else {
+            if (c.ids[col] >= dic.tam(col)) return false;
+            const std::string &v = dic.valor(col, c.ids[col]);
+            std::memcpy(campo, v.data(), std::min(v.size(), ancho));
+        }
+    }
+    if (c.flags & FLAG_FECHA_CRUDA) {
+        if (!detalle::leerTexto(heap, n, i, r.fecha, sizeof(r.fecha))) return false;
+    } else {
+        std::string f = diasAFecha(c.fecha);
+        std::memcpy(r.fecha, f.data(), std::min(f.size(), sizeof(r.fecha)));
+    }
+    if (c.flags & FLAG_EDAD_CRUDA) {
+        if (n - i < sizeof(r.edad)) return false;
+        std::memcpy(&r.edad, heap + i, sizeof(r.edad));
+    } else {
+        r.edad = c.edad;
+    }
+    return true;
+}
+
+inline CabeceraV2 cabecera(long long num, long long tam_heap, long long tam, long long mtime)
+{
+    CabeceraV2 c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, REG_MAGIC, sizeof(REG_MAGIC));
+    c.version = V2_VERSION;
+    c.tam_registro = (int32_t)sizeof(RegistroCompacto);
+    c.num_registros = num;
+    c.tam_heap = tam_heap;
+    c.tam_registros = tam;
+    c.mtime_registros = mtime;
+    return c;
+}
+
+// Escribe la cabecera de registros_v2.dat con el tamaño/mtime actuales de
+// registros.dat (al final de la generación: recién entonces queda fresca)
+inline bool escribirCabecera(const std::string &ruta_registros, long long num, long long tam_heap)
+{
+    long long tam = 0, mtime = 0;
+    if (!columnas::estadoArchivo(ruta_registros, tam, mtime)) return false;
+    CabeceraV2 cab = cabecera(num, tam_heap, tam, mtime);
+    int fd = ::open(rutaRegistros(ruta_registros).c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = ::pwrite(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+    ::close(fd);
+    return ok;
+}
+
+// Conversión secuencial registros.dat -> v2 (dos pasadas: diccionario y codificación)
+inline bool convertir(const std::string &ruta_registros, size_t registros_por_lote = 1 << 15)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long num = (long long)::lseek(in, 0, SEEK_END) / (long long)sz;
+    std::vector<RegistroClinico> buf(registros_por_lote);
+    auto leerLote = [&](long long i, size_t n) {
+        return ::pread(in, buf.data(), n * sz, (off_t)(i * (long long)sz)) == (ssize_t)(n * sz);
+    };
+
+    Frecuencias frec;
+    bool ok = true;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = leerLote(i, n);
+        for (size_t k = 0; ok && k < n; ++k) frec.agregar(buf[k]);
+    }
+    Diccionario dic = Diccionario::construir(frec);
+    ok = ok && dic.guardar(rutaDiccionario(ruta_registros));
+
+    int out = ::open(rutaRegistros(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int heap_fd = ::open(rutaHeap(ruta_registros).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ok = ok && out >= 0 && heap_fd >= 0;
+    if (ok) {
+        CabeceraV2 vacia;
+        std::memset(&vacia, 0, sizeof(vacia));
+        ok = ::pwrite(out, &vacia, sizeof(vacia), 0) == (ssize_t)sizeof(vacia);
+    }
+    std::vector<RegistroCompacto> filas(registros_por_lote);
+    std::string heap;
+    long long heap_total = 0;
+    for (long long i = 0; ok && i < num; i += (long long)registros_por_lote) {
+        size_t n = (size_t)std::min<long long>((long long)registros_por_lote, num - i);
+        ok = leerLote(i, n);
+        heap.clear();
+        for (size_t k = 0; ok && k < n; ++k) codificar(buf[k], dic, heap_total, filas[k], heap);
+        off_t off = (off_t)sizeof(CabeceraV2) + (off_t)(i * (long long)sizeof(RegistroCompacto));
+        ok = ok && ::pwrite(out, filas.data(), n * sizeof(RegistroCompacto), off) == (ssize_t)(n * sizeof(RegistroCompacto)) &&
+             ::pwrite(heap_fd, heap.data(), heap.size(), (off_t)heap_total) == (ssize_t)heap.size();
+        heap_total += (long long)heap.size();
+    }
+    if (out >= 0) ::close(out);
+    if (heap_fd >= 0) ::close(heap_fd);
+    ::close(in);
+    return ok && escribirCabecera(ruta_registros, num, heap_total);
+}
+
+// ---------------------------------------------------------------------------
+// Lectura
+// ---------------------------------------------------------------------------
+
+class Almacen {
+public:
+    Almacen() = default;
+    Almacen(const Almacen &) = delete;
+    Almacen &operator=(const Almacen &) = delete;
+    ~Almacen() { cerrar(); }
+
+    // Abre la copia v2 de `ruta_registros`. Con `exigir_fresca` solo si su
+    // cabecera coincide con el tamaño/mtime actuales de registros.dat.
+    bool abrir(const std::string &ruta_registros, bool exigir_fresca = true) {
+        cerrar();
+        fd_ = ::open(rutaRegistros(ruta_registros).c_str(), O_RDONLY);
+        heap_fd_ = ::open(rutaHeap(ruta_registros).c_str(), O_RDONLY);
+        bool ok = fd_ >= 0 && heap_fd_ >= 0 && ::pread(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  std::memcmp(cab_.magic, REG_MAGIC, sizeof(REG_MAGIC)) == 0 && cab_.version == V2_VERSION &&
+                  cab_.tam_registro == (int32_t)sizeof(RegistroCompacto);
+        if (ok && exigir_fresca) {
+            long long tam = 0, mtime = 0;
+            ok = columnas::estadoArchivo(ruta_registros, tam, mtime) && tam == cab_.tam_registros &&
+                 mtime == cab_.mtime_registros;
+        }
+        ok = ok && dic_.cargar(rutaDiccionario(ruta_registros));
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar() {
+        if (fd_ >= 0) ::close(fd_);
+        if (heap_fd_ >= 0) ::close(heap_fd_);
+        fd_ = heap_fd_ = -1;
+    }
+
+    bool abierto() const { return fd_ >= 0; }
+    const CabeceraV2 &cabecera() const { return cab_; }
+    const Diccionario &diccionario() const { return dic_; }
+
+    // Tamaño equivalente de registros.dat (para tabla_hash::recorrerBucket)
+    long long tamLegado() const { return cab_.num_registros * (long long)sizeof(RegistroClinico); }
+
+    bool leerCompactos(long long fila, RegistroCompacto *dst, size_t n) const {
+        if (fila < 0 || fila + (long long)n > cab_.num_registros) return false;
+        off_t off = (off_t)sizeof(CabeceraV2) + (off_t)(fila * (long long)sizeof(RegistroCompacto));
+        return ::pread(fd_, dst, n * sizeof(RegistroCompacto), off) == (ssize_t)(n * sizeof(RegistroCompacto));
+    }
+
+    bool decodificar(const RegistroCompacto &c, RegistroClinico &r) const {
+        char heap[1024];
+        if (c.heap_len > sizeof(heap) || c.heap_offset < 0 || c.heap_offset + c.heap_len > cab_.tam_heap) return false;
+        if (::pread(heap_fd_, heap, c.heap_len, (off_t)c.heap_offset) != (ssize_t)c.heap_len) return false;
+        return registro_v2::decodificar(c, heap, dic_, r);
+    }
+
+    // Edad exacta (lee el heap solo si la edad no entraba en uint8)
+    bool edad(const RegistroCompacto &c, int &edad) const {
+        if (!(c.flags & FLAG_EDAD_CRUDA)) { edad = c.edad; return true; }
+        RegistroClinico r;
+        if (!decodificar(c, r)) return false;
+        edad = r.edad;
+        return true;
+    }
+
+    // Lee registros completos desde un offset de registros.dat (misma firma que
+    // el `leer` de tabla_hash::recorrerBucket; `bytes` múltiplo del registro)
+    bool leer(long long offset, void *destino, size_t bytes) const {
+        const long long sz = (long long)sizeof(RegistroClinico);
+        if (offset % sz != 0 || bytes % (size_t)sz != 0) return false;
+        size_t n = bytes / (size_t)sz;
+        std::vector<RegistroCompacto> filas(n);
+        if (!leerCompactos(offset / sz, filas.data(), n)) return false;
+        RegistroClinico *dst = static_cast<RegistroClinico *>(destino);
+        for (size_t k = 0; k < n; ++k)
+            if (!decodificar(filas[k], dst[k])) return false;
+        return true;
+    }
+
+    // Recorre las filas compactas en lotes: visitar(fila, const RegistroCompacto&).
+    // Sin tocar el heap: para filtros por enteros (edad, fecha, IDs de diccionario).
+    template <typename F>
+    bool recorrer(F visitar, size_t filas_por_lote = 1 << 16) const {
+        std::vector<RegistroCompacto> buf(filas_por_lote);
+        for (long long i = 0; i < cab_.num_registros; i += (long long)filas_por_lote) {
+            size_t n = (size_t)std::min<long long>((long long)filas_por_lote, cab_.num_registros - i);
+            if (!leerCompactos(i, buf.data(), n)) return false;
+            for (size_t k = 0; k < n; ++k) visitar(i + (long long)k, buf[k]);
+        }
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    int heap_fd_ = -1;
+    CabeceraV2 cab_{};
+    Diccionario dic_;
+};
+
+// Conteo por rango de edad sobre v2 fresco; false si no hay copia v2 utilizable
+inline bool contarRangoEdad(const std::string &ruta_registros, int minEdad, int maxEdad, bool unicos,
+                            long long &resultado)
+{
+    Almacen a;
+    if (!a.abrir(ruta_registros)) return false;
+    long long total = 0;
+    std::unordered_set<int> vistos;
+    bool ok = true;
+    ok = a.recorrer([&](long long, const RegistroCompacto &c) {
+        int e = c.edad;
+        if ((c.flags & FLAG_EDAD_CRUDA) && !a.edad(c, e)) { ok = false; return; }
+        if (e < minEdad || e > maxEdad) return;
+        if (unicos) vistos.insert(c.dni);
+        else ++total;
+    }) && ok;
+    if (ok) resultado = unicos ? (long long)vistos.size() : total;
+    return ok;
+}
+
+} // namespace registro_v2
@@ -0,0 +1,69 @@
+// registros_edicion.h
+// Edición de un registro de `registros.dat` sin borrar y volver a insertar:
+// - Si el DNI no cambia, el registro se sobrescribe en su mismo offset (es de
+//   tamaño fijo). Se escriben solo los campos anteriores a `pos_siguiente`, así
+//   el enlace de la cadena (y un tramo agrupado) no se toca: una escritura de
+//   offsetof(RegistroClinico, pos_siguiente) bytes.
+// - El filtro de DNI y el directorio de pacientes no cambian (mismo DNI, mismo
+//   offset). En los índices por fecha y nombre, si cambió la clave, se anota la
+//   baja y el alta del mismo offset en el delta (el alta vuelve a valer).
+// - Si el DNI cambia, el registro pertenece a otro bucket: el que llama lo
+//   reubica insertando el nuevo y recién después eliminando el viejo (una caída
+//   entre medio deja las dos versiones, nunca ninguna).
+#pragma once
+#include "common.h"
+#include "indice_fecha.h"
+#include "indice_nombre.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace edicion {
+
+// Bytes que reescribe una edición en el lugar (todo salvo pos_siguiente)
+static const size_t BYTES_CAMPOS = offsetof(RegistroClinico, pos_siguiente);
+
+// true si `nuevo` puede escribirse en el lugar de `viejo`
+inline bool enElLugar(const RegistroClinico &viejo, const RegistroClinico &nuevo)
+{
+    return viejo.dni == nuevo.dni;
+}
+
+// Lee el registro en `offset` y comprueba que siga vivo y sea del DNI `dni`
+// (entre que se eligió y se edita pudo eliminarse o reusarse el lugar)
+inline bool leerVigente(std::fstream &registros, long long offset, int dni, RegistroClinico &r)
+{
+    registros.seekg(offset, std::ios::beg);
+    bool ok = (bool)registros.read(reinterpret_cast<char *>(&r), sizeof(r)) && !esBorrado(r) && r.dni == dni;
+    registros.clear();
+    return ok;
+}
+
+// Sobrescribe en `offset` los campos de `nuevo` (su pos_siguiente se ignora)
+inline bool sobrescribir(std::fstream &registros, long long offset, const RegistroClinico &nuevo)
+{
+    registros.seekp(offset, std::ios::beg);
+    bool ok = (bool)registros.write(reinterpret_cast<const char *>(&nuevo), (std::streamsize)BYTES_CAMPOS);
+    registros.flush();
+    return ok && (bool)registros;
+}
+
+// Anota en los deltas de los índices por fecha y nombre (si existen) la baja de
+// `viejo` y el alta de `nuevo` en `offset`, solo en los que cambió la clave
+inline void registrarDerivados(const std::string &ruta_registros, long long offset, const RegistroClinico &viejo,
+                               const RegistroClinico &nuevo)
+{
+    if (std::strncmp(viejo.fecha, nuevo.fecha, sizeof(viejo.fecha)) != 0) {
+        indice_fecha::registrar(ruta_registros, viejo, offset, indice_fecha::DELTA_BAJA);
+        indice_fecha::registrar(ruta_registros, nuevo, offset);
+    }
+    if (std::strncmp(viejo.apellido, nuevo.apellido, sizeof(viejo.apellido)) != 0 ||
+        std::strncmp(viejo.nombre, nuevo.nombre, sizeof(viejo.nombre)) != 0) {
+        indice_nombre::registrar(ruta_registros, viejo, offset, indice_nombre::DELTA_BAJA);
+        indice_nombre::registrar(ruta_registros, nuevo, offset);
+    }
+}
+
+} // namespace edicion
@@ -0,0 +1,229 @@
+// registros_libres.h
+// Eliminación con lápidas y lista de libres para `registros.dat`:
+// - Borrar un registro lo desenlaza de su cadena (se reescribe un solo
+//   `pos_siguiente`, o la cabeza del bucket) y lo convierte en lápida
+//   (`esBorrado`, ver common.h) en su mismo lugar: los demás offsets no cambian,
+//   así que los índices, el filtro y el directorio siguen valiendo con una baja.
+// - Las lápidas forman una lista enlazada por `pos_siguiente` cuya cabeza y
+//   cantidad están en `libres.dat`. Una inserción toma primero un lugar de la
+//   lista y solo si está vacía agrega al final.
+// - `compactar` reescribe los registros vivos (los alcanzables desde la tabla)
+//   en un archivo nuevo; la GUI lo hace en segundo plano cuando la fracción de
+//   lápidas supera un umbral y `Limpieza` lo hace a pedido.
+// La lista se valida al usarla: si la cabeza no es una lápida (registros.dat
+// se recreó) se descarta.
+#pragma once
+#include "common.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libres {
+
+static const char LIBRES_MAGIC[8] = {'P', 'P', 'L', 'I', 'B', 'R', 'E', '1'};
+static const int32_t LIBRES_VERSION = 1;
+static const double UMBRAL_BASURA_DEFECTO = 0.25; // fracción de lápidas que dispara la compactación
+
+#pragma pack(push, 1)
+struct LibresCabecera {
+    char magic[8];             // LIBRES_MAGIC
+    int32_t version;           // LIBRES_VERSION
+    int32_t reservado32;
+    int64_t cabeza;            // primera lápida libre (NULL_OFFSET: lista vacía)
+    int64_t cantidad;          // lápidas en la lista
+    int64_t reservado[4];
+};
+#pragma pack(pop)
+
+inline std::string rutaLibres(const std::string &r) { return rutaJunto(r, "libres.dat"); }
+
+inline LibresCabecera cabecera(long long cabeza = NULL_OFFSET, long long cantidad = 0)
+{
+    LibresCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, LIBRES_MAGIC, sizeof(LIBRES_MAGIC));
+    c.version = LIBRES_VERSION;
+    c.cabeza = cabeza;
+    c.cantidad = cantidad;
+    return c;
+}
+
+// Cabecera de la lista (vacía si no hay libres.dat o es inválido)
+inline LibresCabecera leer(const std::string &ruta_registros)
+{
+    LibresCabecera c = cabecera();
+    int fd = ::open(rutaLibres(ruta_registros).c_str(), O_RDONLY);
+    if (fd < 0) return c;
+    bool ok = ::pread(fd, &c, sizeof(c), 0) == (ssize_t)sizeof(c) &&
+              std::memcmp(c.magic, LIBRES_MAGIC, sizeof(LIBRES_MAGIC)) == 0 && c.version == LIBRES_VERSION &&
+              c.cantidad >= 0;
+    ::close(fd);
+    return ok ? c : cabecera();
+}
+
+inline bool guardar(const std::string &ruta_registros, const LibresCabecera &c)
+{
+    int fd = ::open(rutaLibres(ruta_registros).c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) return false;
+    bool ok = ::pwrite(fd, &c, sizeof(c), 0) == (ssize_t)sizeof(c);
+    ::close(fd);
+    return ok;
+}
+
+// Fracción de registros.dat ocupada por lápidas
+inline double fraccionBasura(const std::string &ruta_registros)
+{
+    long long tam = tamArchivo(ruta_registros);
+    if (tam <= 0) return 0.0;
+    return (double)leer(ruta_registros).cantidad * (double)sizeof(RegistroClinico) / (double)tam;
+}
+
+inline RegistroClinico lapida(long long siguiente_libre)
+{
+    RegistroClinico r;
+    std::memset(&r, 0, sizeof(r));
+    r.dni = DNI_BORRADO;
+    r.edad = -1; // fuera de cualquier rango de edad de los análisis por columnas
+    r.pos_siguiente = siguiente_libre;
+    return r;
+}
+
+inline bool leerRegistro(std::fstream &registros, long long offset, RegistroClinico &r)
+{
+    registros.seekg(offset, std::ios::beg);
+    return (bool)registros.read(reinterpret_cast<char *>(&r), sizeof(r));
+}
+
+inline bool escribirRegistro(std::fstream &registros, long long offset, const RegistroClinico &r)
+{
+    registros.seekp(offset, std::ios::beg);
+    return (bool)registros.write(reinterpret_cast<const char *>(&r), sizeof(r));
+}
+
+// Saca un lugar libre para una inserción: su offset, o NULL_OFFSET si la lista
+// está vacía. Lo que haya en ese lugar lo sobrescribe el que llama.
+inline long long tomar(const std::string &ruta_registros, std::fstream &registros)
+{
+    LibresCabecera c = leer(ruta_registros);
+    if (c.cantidad <= 0 || c.cabeza == NULL_OFFSET) return NULL_OFFSET;
+    RegistroClinico r;
+    if (c.cabeza < 0 || c.cabeza % (long long)sizeof(RegistroClinico) != 0 || !leerRegistro(registros, c.cabeza, r) ||
+        !esBorrado(r)) {
+        // La lista no corresponde a este registros.dat: se descarta
+        registros.clear();
+        guardar(ruta_registros, cabecera());
+        return NULL_OFFSET;
+    }
+    long long offset = c.cabeza;
+    c.cabeza = r.pos_siguiente;
+    --c.cantidad;
+    return guardar(ruta_registros, c) ? offset : NULL_OFFSET;
+}
+
+// Convierte en lápida el registro (ya desenlazado de su cadena) en `offset` y
+// lo agrega a la lista. La lápida se escribe antes que la cabecera: si el
+// proceso cae entre medio el lugar queda perdido hasta compactar, nunca en uso doble.
+// Con `escrita` devuelve la lápida (para anotarla en el diario, registros_wal.h).
+inline bool liberar(const std::string &ruta_registros, std::fstream &registros, long long offset,
+                    RegistroClinico *escrita = nullptr)
+{
+    LibresCabecera c = leer(ruta_registros);
+    RegistroClinico r = lapida(c.cantidad > 0 ? c.cabeza : NULL_OFFSET);
+    if (escrita) *escrita = r;
+    if (!escribirRegistro(registros, offset, r)) return false;
+    registros.flush();
+    c.cabeza = offset;
+    c.cantidad = std::max<int64_t>(0, c.cantidad) + 1;
+    return guardar(ruta_registros, c);
+}
+
+// Desenlaza de la cadena que empieza en `cabeza` los registros para los que
+// `quitar(offset, registro)` es true (reescribe el `pos_siguiente` del anterior)
+// y los deja en `quitados`. Devuelve la cabeza nueva. La cadena se sigue por
+// `pos_siguiente` (también vale con layout agrupado; el que llama anula el tramo).
+// Con `enlaces` deja cada reescritura como (offset del anterior, siguiente nuevo).
+template <typename QuitarFn>
+inline long long quitarDeCadena(long long cabeza, long long filesize, std::fstream &registros, QuitarFn quitar,
+                                std::vector<std::pair<long long, RegistroClinico>> &quitados,
+                                std::vector<std::pair<long long, long long>> *enlaces = nullptr)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    long long nueva_cabeza = cabeza, anterior = NULL_OFFSET, offset = cabeza;
+    for (long long pasos = 0; offset != NULL_OFFSET && pasos <= filesize / sz; ++pasos) {
+        RegistroClinico r;
+        if (offset < 0 || offset + sz > filesize || !leerRegistro(registros, offset, r)) break;
+        if (quitar(offset, r)) {
+            quitados.emplace_back(offset, r);
+            if (anterior == NULL_OFFSET) {
+                nueva_cabeza = r.pos_siguiente;
+            } else {
+                registros.seekp(anterior + (long long)offsetof(RegistroClinico, pos_siguiente), std::ios::beg);
+                registros.write(reinterpret_cast<const char *>(&r.pos_siguiente), sizeof(long long));
+                if (enlaces) enlaces->emplace_back(anterior, r.pos_siguiente);
+            }
+        } else {
+            anterior = offset;
+        }
+        offset = r.pos_siguiente;
+    }
+    registros.clear();
+    registros.flush();
+    return nueva_cabeza;
+}
+
+// Escribe en `ruta_destino` los registros alcanzables desde `vieja` (las
+// lápidas y copias sueltas quedan afuera) y deja en `nueva` la tabla con los
+// offsets nuevos, con el mismo tamaño y layout. `leer(offset, destino, bytes)`
+// como en tabla_hash::recorrerBucket.
+template <typename LeerFn>
+inline bool compactar(const tabla_hash::Tabla &vieja, long long filesize, LeerFn leer, const std::string &ruta_destino,
+                      tabla_hash::Tabla &nueva)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    const bool agrupado = tabla_hash::esV2(vieja.layout);
+    nueva = tabla_hash::tablaVacia(vieja.layout, (long long)vieja.entradas.size(), vieja.carga_max);
+    nueva.buckets_base = vieja.buckets_base;
+    std::ofstream out(ruta_destino, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    long long pos = 0;
+    std::vector<RegistroClinico> lista;
+    for (size_t b = 0; b < vieja.entradas.size() && out; ++b) {
+        lista.clear();
+        tabla_hash::recorrerBucket(vieja.entradas[b], filesize, leer,
+                                   [&](long long, const RegistroClinico &r) { lista.push_back(r); });
+        if (lista.empty()) continue;
+        if (agrupado) {
+            // En orden de cadena, contiguos: cada uno apunta al slot siguiente
+            nueva.entradas[b] = HashExtent{pos, pos, (long long)lista.size()};
+            for (size_t j = 0; j < lista.size(); ++j) {
+                lista[j].pos_siguiente = (j + 1 < lista.size()) ? pos + sz : NULL_OFFSET;
+                out.write(reinterpret_cast<const char *>(&lista[j]), sz);
+                pos += sz;
+            }
+            continue;
+        }
+        // En orden inverso: la cabeza queda al final, como al insertar
+        long long cabeza = NULL_OFFSET;
+        for (size_t j = lista.size(); j-- > 0;) {
+            lista[j].pos_siguiente = cabeza;
+            out.write(reinterpret_cast<const char *>(&lista[j]), sz);
+            cabeza = pos;
+            pos += sz;
+        }
+        nueva.entradas[b].head_offset = cabeza;
+    }
+    nueva.num_registros = pos / sz;
+    out.close();
+    return (bool)out;
+}
+
+} // namespace libres
@@ -0,0 +1,149 @@
+// registros_mmap.h
+// Acceso de solo lectura a `registros.dat` para muchos hilos a la vez, sin
+// locks ni seek compartido:
+// - Si el archivo cabe en el presupuesto de espacio de direcciones, se proyecta
+//   con mmap(MAP_SHARED) reservando todo el presupuesto, así los registros que
+//   se agregan después (escritos por otro descriptor) quedan visibles sin
+//   volver a mapear. `ver` devuelve un puntero al registro dentro del mapeo.
+// - Lo que queda fuera del mapeo (archivo mayor al presupuesto) se lee con
+//   pread, que no comparte posición entre hilos.
+// El escritor publica el nuevo tamaño con `publicar` después de escribir el
+// registro (y antes de publicar la cabeza que lo referencia). Si el archivo se
+// reemplaza (rename), `reabrir` publica el mapeo nuevo; los anteriores se
+// liberan recién en `cerrar` porque algún lector podría seguir usándolos.
+#pragma once
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace registros_mmap {
+
+// Presupuesto de espacio de direcciones por defecto para el mapeo
+static const long long PRESUPUESTO_DEFECTO = (sizeof(void *) >= 8) ? (64LL << 30) : (512LL << 20);
+
+class AlmacenRegistros {
+public:
+    AlmacenRegistros() = default;
+    AlmacenRegistros(const AlmacenRegistros &) = delete;
+    AlmacenRegistros &operator=(const AlmacenRegistros &) = delete;
+    ~AlmacenRegistros() { cerrar(); }
+
+    // Abre (o vuelve a abrir tras un reemplazo del archivo) `ruta`
+    bool abrir(const std::string &ruta, long long presupuesto = PRESUPUESTO_DEFECTO) {
+        std::lock_guard<std::mutex> lk(m_);
+        int fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+        std::unique_ptr<Mapeo> nuevo(new Mapeo);
+        nuevo->fd = fd;
+        nuevo->tam.store((long long)st.st_size, std::memory_order_relaxed);
+        // Un archivo más grande que el presupuesto se lee solo con pread
+        if ((long long)st.st_size <= presupuesto && presupuesto > 0) {
+            void *p = ::mmap(nullptr, (size_t)presupuesto, PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                // Las búsquedas saltan por el archivo: no conviene read-ahead
+                ::madvise(p, (size_t)presupuesto, MADV_RANDOM);
+                nuevo->base = static_cast<const char *>(p);
+                nuevo->capacidad = presupuesto;
+            }
+        }
+        ruta_ = ruta;
+        presupuesto_ = presupuesto;
+        Mapeo *previo = actual_.exchange(nuevo.get(), std::memory_order_acq_rel);
+        mapeos_.push_back(std::move(nuevo));
+        (void)previo; // se libera en cerrar(): puede haber lectores en curso
+        return true;
+    }
+
+    bool reabrir() { return abrir(ruta_, presupuesto_); }
+
+    // Libera todos los mapeos. Solo cuando no hay lectores activos.
+    void cerrar() {
+        std::lock_guard<std::mutex> lk(m_);
+        actual_.store(nullptr, std::memory_order_release);
+        for (auto &mp : mapeos_) {
+            if (mp->base) ::munmap(const_cast<char *>(mp->base), (size_t)mp->capacidad);
+            if (mp->fd >= 0) ::close(mp->fd);
+        }
+        mapeos_.clear();
+    }
+
+    bool abierto() const { return actual_.load(std::memory_order_acquire) != nullptr; }
+
+    // Tamaño visible del archivo (bytes)
+    long long tam() const {
+        const Mapeo *mp = actual_.load(std::memory_order_acquire);
+        return mp ? mp->tam.load(std::memory_order_acquire) : 0;
+    }
+
+    // El escritor avisa que el archivo ya tiene `nuevo_tam` bytes escritos
+    void publicar(long long nuevo_tam) {
+        Mapeo *mp = actual_.load(std::memory_order_acquire);
+        if (!mp) return;
+        long long t = mp->tam.load(std::memory_order_relaxed);
+        while (nuevo_tam > t && !mp->tam.compare_exchange_weak(t, nuevo_tam, std::memory_order_release)) {}
+    }
+
+    // Vista del registro en `offset`: puntero dentro del mapeo (sin copia) o,
+    // fuera de él, `respaldo` leído con pread. nullptr si está fuera del archivo.
+    const RegistroClinico *ver(long long offset, RegistroClinico &respaldo) const {
+        const Mapeo *mp = actual_.load(std::memory_order_acquire);
+        if (!mp) return nullptr;
+        const long long sz = (long long)sizeof(RegistroClinico);
+        if (offset < 0 || offset + sz > mp->tam.load(std::memory_order_acquire)) return nullptr;
+        if (mp->base && offset + sz <= mp->capacidad)
+            return reinterpret_cast<const RegistroClinico *>(mp->base + offset);
+        if (::pread(mp->fd, &respaldo, (size_t)sz, (off_t)offset) != (ssize_t)sz) return nullptr;
+        return &respaldo;
+    }
+
+    // Recorre los registros del bucket en orden de cadena (igual que
+    // tabla_hash::recorrerBucket, pero sin copiar lo que está mapeado)
+    template <typename F>
+    void recorrerBucket(const HashExtent &e, F visitar) const {
+        const long long sz = (long long)sizeof(RegistroClinico);
+        RegistroClinico respaldo;
+        long long offset = e.head_offset;
+        while (offset != NULL_OFFSET) {
+            if (offset == e.ext_offset && e.ext_count > 0) {
+                for (long long k = 0; k < e.ext_count; ++k) {
+                    const RegistroClinico *r = ver(offset + k * sz, respaldo);
+                    if (!r) return;
+                    visitar(offset + k * sz, *r);
+                }
+                return;
+            }
+            const RegistroClinico *r = ver(offset, respaldo);
+            if (!r) return;
+            visitar(offset, *r);
+            offset = r->pos_siguiente;
+        }
+    }
+
+private:
+    struct Mapeo {
+        int fd = -1;
+        const char *base = nullptr;
+        long long capacidad = 0;          // bytes proyectados (0 = solo pread)
+        std::atomic<long long> tam{0};    // bytes válidos del archivo
+    };
+
+    std::atomic<Mapeo *> actual_{nullptr};
+    std::vector<std::unique_ptr<Mapeo>> mapeos_; // actual + retirados (viven hasta cerrar)
+    std::mutex m_;                               // solo abrir/cerrar
+    std::string ruta_;
+    long long presupuesto_ = PRESUPUESTO_DEFECTO;
+};
+
+} // namespace registros_mmap
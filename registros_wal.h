@@ -0,0 +1,442 @@
+// registros_wal.h
+// Diario de escritura anticipada (`registros.wal`) para las inserciones y
+// eliminaciones de la GUI:
+// - Cada operación se anota como una transacción: las escrituras que hizo en
+//   registros.dat (el registro nuevo, el `pos_siguiente` reescrito de un
+//   anterior, una lápida) y el cambio de cabeza de su bucket. La transacción
+//   tiene su suma (FNV-1a): una cola cortada por una caída se descarta entera.
+// - Commit en grupo: `agregar` solo copia la transacción a un buffer en
+//   memoria (se llama con el lock de la tabla, así el orden del diario es el de
+//   las operaciones) y `confirmar`, ya sin locks, espera a que llegue al disco.
+//   El primero que confirma escribe el buffer de todos y hace un único
+//   fdatasync; los demás esperan ese mismo fsync. Con N escritores a la vez el
+//   costo de un fsync se reparte entre N inserciones.
+// - Las cabezas se aplican solo en memoria: tabla_hash.dat se escribe en el
+//   checkpoint (registros.dat a disco, tabla completa por temporal + rename,
+//   diario vacío), que la GUI hace en segundo plano, antes de dividir buckets y
+//   antes de reemplazar registros.dat al compactar.
+// - `recuperar` reaplica las transacciones completas sobre registros.dat y la
+//   tabla del último checkpoint (todas las escrituras son idempotentes). La
+//   llaman al empezar la GUI, gestor_dni, Limpieza, rehash_tabla y el loader
+//   incremental; mientras la GUI está abierta, las herramientas que solo leen
+//   tabla_hash.dat ven las inserciones recién desde el checkpoint siguiente.
+//   Un registro escrito cuya transacción no llegó al disco queda suelto (sin
+//   enlazar) hasta la compactación siguiente.
+// - `reemplazarPar` cambia registros.dat y la tabla por sus versiones nuevas
+//   (Limpieza, rehash_tabla, compactación de la GUI): anota los dos temporales
+//   en `registros.reemplazo` antes de renombrarlos y `recuperar` completa los
+//   rename que una caída dejó a medias, así nunca queda registros.dat nuevo con
+//   la tabla vieja (ni al revés).
+// Los índices, el filtro y el directorio no se anotan: se actualizan como
+// siempre y, si una caída los deja adelantados o atrasados, su chequeo de
+// frescura por tamaño los descarta.
+#pragma once
+#include "common.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wal {
+
+static const char WAL_MAGIC[8] = {'P', 'P', 'W', 'A', 'L', '0', '0', '1'};
+static const int32_t WAL_VERSION = 1;
+static const uint32_t MAGIC_TRANSACCION = 0x54584E31; // "TXN1"
+static const long long UMBRAL_CHECKPOINT = 8LL << 20;  // bytes de diario que fuerzan un checkpoint
+static const uint8_t OP_ESCRITURA = 1;
+static const uint8_t OP_CABEZA = 2;
+
+#pragma pack(push, 1)
+struct WalCabecera {
+    char magic[8];             // WAL_MAGIC
+    int32_t version;           // WAL_VERSION
+    int32_t reservado32;
+    int64_t checkpoints;       // checkpoints hechos (informativo)
+    int64_t reservado[5];
+};
+
+struct TransaccionCabecera {
+    uint32_t magic;            // MAGIC_TRANSACCION
+    uint32_t bytes;            // largo del cuerpo (operaciones)
+    uint64_t lsn;              // número de secuencia
+    uint64_t suma;             // FNV-1a 64 del cuerpo
+};
+
+// Cuerpo: secuencia de operaciones, cada una con su tipo (uint8) y:
+struct OpEscritura {           // OP_ESCRITURA, seguida de `largo` bytes
+    int64_t offset;            // en registros.dat
+    uint32_t largo;
+};
+
+struct OpCabeza {              // OP_CABEZA
+    int32_t bucket;
+    uint8_t anular_tramo;      // la cadena cambió: el tramo agrupado deja de valer
+    int64_t cabeza;
+    int64_t delta_registros;   // suma al contador de la cabecera
+};
+#pragma pack(pop)
+
+inline std::string rutaDiario(const std::string &r) { return rutaJunto(r, "registros.wal"); }
+inline std::string rutaReemplazo(const std::string &r) { return rutaJunto(r, "registros.reemplazo"); }
+
+inline uint64_t suma(const char *p, size_t n)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// fsync de un archivo por ruta (registros.dat antes de vaciar el diario)
+inline bool sincronizar(const std::string &ruta)
+{
+    int fd = ::open(ruta.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// fsync del directorio que contiene `ruta` (hace durables sus rename)
+inline bool sincronizarDirectorio(const std::string &ruta)
+{
+    std::filesystem::path dir = std::filesystem::path(ruta).parent_path();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+inline WalCabecera cabecera(long long checkpoints = 0)
+{
+    WalCabecera c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.magic, WAL_MAGIC, sizeof(WAL_MAGIC));
+    c.version = WAL_VERSION;
+    c.checkpoints = checkpoints;
+    return c;
+}
+
+// Transacción en armado (las operaciones de una inserción o eliminación)
+class Transaccion {
+public:
+    void escritura(long long offset, const void *datos, uint32_t largo) {
+        OpEscritura op{offset, largo};
+        agregar(OP_ESCRITURA, &op, sizeof(op));
+        cuerpo_.append(static_cast<const char *>(datos), largo);
+    }
+    void cabeza(int bucket, long long cabeza, bool anular_tramo, long long delta_registros) {
+        OpCabeza op{bucket, (uint8_t)(anular_tramo ? 1 : 0), cabeza, delta_registros};
+        agregar(OP_CABEZA, &op, sizeof(op));
+    }
+    const std::string &cuerpo() const { return cuerpo_; }
+    bool vacia() const { return cuerpo_.empty(); }
+
+private:
+    void agregar(uint8_t tipo, const void *op, size_t bytes) {
+        cuerpo_.push_back((char)tipo);
+        cuerpo_.append(static_cast<const char *>(op), bytes);
+    }
+    std::string cuerpo_;
+};
+
+// Diario abierto para agregar, con commit en grupo. Seguro entre hilos.
+class Diario {
+public:
+    Diario() = default;
+    Diario(const Diario &) = delete;
+    Diario &operator=(const Diario &) = delete;
+    ~Diario() { cerrar(); }
+
+    // Abre (o crea vacío) el diario de `ruta_registros` y lo vacía: correr
+    // `recuperar` antes y, si otros procesos comparten la tabla, tener el rol de
+    // escritor (tabla_compartida.h), que puede tener otro con transacciones sin
+    // checkpoint.
+    bool abrir(const std::string &ruta_registros) {
+        cerrar();
+        std::lock_guard<std::mutex> lk(m_);
+        ruta_ = rutaDiario(ruta_registros);
+        fd_ = ::open(ruta_.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) return false;
+        WalCabecera c;
+        bool ok = ::pread(fd_, &c, sizeof(c), 0) == (ssize_t)sizeof(c) &&
+                  std::memcmp(c.magic, WAL_MAGIC, sizeof(WAL_MAGIC)) == 0 && c.version == WAL_VERSION;
+        if (!ok) c = cabecera();
+        cab_ = c;
+        // Lo que hubiera después de la cabecera ya fue recuperado
+        ok = ::ftruncate(fd_, 0) == 0 && ::pwrite(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+             ::fdatasync(fd_) == 0;
+        fin_ = (long long)sizeof(cab_);
+        if (!ok) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        return ok;
+    }
+
+    void cerrar() {
+        std::lock_guard<std::mutex> lk(m_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        pendiente_.clear();
+    }
+
+    bool abierto() const { return fd_ >= 0; }
+
+    // Copia la transacción al buffer y devuelve su número de secuencia (0 si
+    // el diario no está abierto)
+    uint64_t agregar(const Transaccion &t) {
+        std::lock_guard<std::mutex> lk(m_);
+        if (fd_ < 0 || t.vacia()) return 0;
+        TransaccionCabecera c{MAGIC_TRANSACCION, (uint32_t)t.cuerpo().size(), ++ultimo_lsn_,
+                              suma(t.cuerpo().data(), t.cuerpo().size())};
+        pendiente_.append(reinterpret_cast<const char *>(&c), sizeof(c));
+        pendiente_.append(t.cuerpo());
+        return c.lsn;
+    }
+
+    // Espera a que la transacción `lsn` esté en disco. Si nadie está
+    // escribiendo, este hilo escribe el buffer acumulado (suyo y de los demás)
+    // con un solo fdatasync.
+    bool confirmar(uint64_t lsn) {
+        std::unique_lock<std::mutex> lk(m_);
+        while (lsn_durable_ < lsn && !error_) {
+            if (escribiendo_) {
+                cv_.wait(lk);
+                continue;
+            }
+            escribiendo_ = true;
+            std::string lote;
+            lote.swap(pendiente_);
+            uint64_t hasta = ultimo_lsn_;
+            long long pos = fin_;
+            int fd = fd_;
+            lk.unlock();
+            bool ok = fd >= 0 && ::pwrite(fd, lote.data(), lote.size(), (off_t)pos) == (ssize_t)lote.size() &&
+                      ::fdatasync(fd) == 0;
+            lk.lock();
+            escribiendo_ = false;
+            if (ok) {
+                fin_ = pos + (long long)lote.size();
+                lsn_durable_ = hasta;
+                ++grupos_;
+            } else {
+                error_ = true;
+            }
+            cv_.notify_all();
+        }
+        return lsn_durable_ >= lsn;
+    }
+
+    // Todo lo agregado hasta ahora, en disco
+    bool confirmarTodo() {
+        uint64_t lsn;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            lsn = ultimo_lsn_;
+        }
+        return confirmar(lsn);
+    }
+
+    // Vacía el diario (tras un checkpoint). El que llama garantiza que no se
+    // agregan transacciones mientras tanto.
+    bool truncar() {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [&] { return !escribiendo_; });
+        if (fd_ < 0) return false;
+        ++cab_.checkpoints;
+        bool ok = ::ftruncate(fd_, (off_t)sizeof(cab_)) == 0 &&
+                  ::pwrite(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) && ::fdatasync(fd_) == 0;
+        if (ok) fin_ = (long long)sizeof(cab_);
+        return ok;
+    }
+
+    // Bytes anotados desde el último checkpoint (en disco y en el buffer)
+    long long bytes() const {
+        std::lock_guard<std::mutex> lk(m_);
+        return fin_ - (long long)sizeof(cab_) + (long long)pendiente_.size();
+    }
+
+    // fsync hechos (cada uno confirmó un grupo de transacciones) y transacciones
+    unsigned long long grupos() const { std::lock_guard<std::mutex> lk(m_); return grupos_; }
+    unsigned long long transacciones() const { std::lock_guard<std::mutex> lk(m_); return ultimo_lsn_; }
+
+private:
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::string ruta_;
+    int fd_ = -1;
+    WalCabecera cab_{};
+    long long fin_ = 0;
+    std::string pendiente_;
+    uint64_t ultimo_lsn_ = 0, lsn_durable_ = 0;
+    unsigned long long grupos_ = 0;
+    bool escribiendo_ = false, error_ = false;
+};
+
+// Recorre las transacciones completas del diario en orden. `aplicar(cuerpo,
+// bytes)` recibe cada una; se detiene en la primera cortada o con suma inválida.
+template <typename AplicarFn>
+inline long long recorrer(const std::string &ruta_registros, AplicarFn aplicar)
+{
+    int fd = ::open(rutaDiario(ruta_registros).c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+    long long aplicadas = 0;
+    off_t pos = (off_t)sizeof(WalCabecera);
+    std::vector<char> cuerpo;
+    TransaccionCabecera c;
+    while (::pread(fd, &c, sizeof(c), pos) == (ssize_t)sizeof(c) && c.magic == MAGIC_TRANSACCION) {
+        cuerpo.resize(c.bytes);
+        if (::pread(fd, cuerpo.data(), c.bytes, pos + (off_t)sizeof(c)) != (ssize_t)c.bytes ||
+            suma(cuerpo.data(), cuerpo.size()) != c.suma)
+            break;
+        if (!aplicar(cuerpo.data(), cuerpo.size())) break;
+        ++aplicadas;
+        pos += (off_t)(sizeof(c) + c.bytes);
+    }
+    ::close(fd);
+    return aplicadas;
+}
+
+// true si el diario de `ruta_registros` tiene transacciones sin checkpoint
+inline bool pendiente(const std::string &ruta_registros)
+{
+    struct stat st;
+    return ::stat(rutaDiario(ruta_registros).c_str(), &st) == 0 && st.st_size > (off_t)sizeof(WalCabecera);
+}
+
+// Deja el diario con solo su cabecera (lo que tenía ya está en registros.dat y la tabla)
+inline bool vaciar(const std::string &ruta_registros)
+{
+    int fw = ::open(rutaDiario(ruta_registros).c_str(), O_WRONLY);
+    if (fw < 0) return true;
+    bool ok = ::ftruncate(fw, (off_t)sizeof(WalCabecera)) == 0 && ::fdatasync(fw) == 0;
+    ::close(fw);
+    return ok;
+}
+
+// true si un reemplazo de registros.dat y la tabla quedó sin completar
+inline bool reemplazoPendiente(const std::string &ruta_registros)
+{
+    struct stat st;
+    return ::stat(rutaReemplazo(ruta_registros).c_str(), &st) == 0;
+}
+
+// Termina el reemplazo anotado en `registros.reemplazo`, si hay: renombra los
+// temporales que siguen en pie (los ya renombrados no existen) y borra el
+// marcador. false si un rename falla (el marcador queda para reintentar).
+inline bool completarReemplazo(const std::string &ruta_registros)
+{
+    const std::string marcador = rutaReemplazo(ruta_registros);
+    std::ifstream in(marcador);
+    if (!in.is_open()) return true;
+    std::string rutas[4]; // temporal y destino de registros, temporal y destino de la tabla
+    for (std::string &r : rutas) std::getline(in, r);
+    in.close();
+    for (int i = 0; i < 4 && !rutas[3].empty(); i += 2) {
+        struct stat st;
+        if (::stat(rutas[i].c_str(), &st) != 0) continue;
+        if (::rename(rutas[i].c_str(), rutas[i + 1].c_str()) != 0 || !sincronizarDirectorio(rutas[i + 1])) return false;
+    }
+    return ::unlink(marcador.c_str()) == 0 && sincronizarDirectorio(marcador);
+}
+
+// Reemplaza registros.dat y la tabla por los temporales ya escritos (en el
+// mismo sistema de archivos que sus destinos). El marcador, durable antes del
+// primer rename, es el punto de confirmación: desde ahí una caída termina en
+// los archivos nuevos. false si falló antes del marcador (no cambió nada) o si
+// un rename falló (lo completa el próximo `recuperar`).
+inline bool reemplazarPar(const std::string &ruta_registros, const std::string &tmp_registros,
+                          const std::string &ruta_tabla, const std::string &tmp_tabla)
+{
+    if (!sincronizar(tmp_registros) || !sincronizar(tmp_tabla)) return false;
+    const std::string marcador = rutaReemplazo(ruta_registros);
+    const std::string tmp = marcador + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << std::filesystem::absolute(tmp_registros).string() << '\n'
+            << std::filesystem::absolute(ruta_registros).string() << '\n'
+            << std::filesystem::absolute(tmp_tabla).string() << '\n'
+            << std::filesystem::absolute(ruta_tabla).string() << '\n';
+        if (!out) return false;
+    }
+    if (!sincronizar(tmp) || ::rename(tmp.c_str(), marcador.c_str()) != 0 || !sincronizarDirectorio(marcador))
+        return false;
+    return completarReemplazo(ruta_registros);
+}
+
+// Aplica las transacciones del diario sobre registros.dat y la tabla de
+// `ruta_tabla` (la del último checkpoint), persiste ambos y vacía el diario.
+// Antes completa un reemplazo cortado (`reemplazarPar`).
+// Devuelve cuántas transacciones aplicó (0 si no había diario) o -1 si falló.
+inline long long recuperar(const std::string &ruta_registros, const std::string &ruta_tabla)
+{
+    if (!completarReemplazo(ruta_registros)) return -1;
+    if (!pendiente(ruta_registros)) return 0;
+    tabla_hash::Tabla tabla;
+    if (!tabla_hash::cargar(ruta_tabla, tabla)) return -1;
+    int fd = ::open(ruta_registros.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    bool ok = true;
+    long long aplicadas = recorrer(ruta_registros, [&](const char *p, size_t n) {
+        const char *fin = p + n;
+        while (ok && p < fin) {
+            uint8_t tipo = (uint8_t)*p++;
+            if (tipo == OP_ESCRITURA && p + sizeof(OpEscritura) <= fin) {
+                OpEscritura op;
+                std::memcpy(&op, p, sizeof(op));
+                p += sizeof(op);
+                if (p + op.largo > fin) return false;
+                ok = ::pwrite(fd, p, op.largo, (off_t)op.offset) == (ssize_t)op.largo;
+                p += op.largo;
+            } else if (tipo == OP_CABEZA && p + sizeof(OpCabeza) <= fin) {
+                OpCabeza op;
+                std::memcpy(&op, p, sizeof(op));
+                p += sizeof(op);
+                if (op.bucket < 0 || op.bucket >= (int32_t)tabla.entradas.size()) return false;
+                if (op.anular_tramo) tabla.entradas[(size_t)op.bucket] = HashExtent{op.cabeza, NULL_OFFSET, 0};
+                else tabla.entradas[(size_t)op.bucket].head_offset = op.cabeza;
+                tabla.num_registros = std::max(0LL, tabla.num_registros + op.delta_registros);
+            } else {
+                return false;
+            }
+        }
+        return ok;
+    });
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    const std::string tmp = ruta_tabla + ".tmp";
+    ok = ok && tabla_hash::guardar(tmp, tabla) && sincronizar(tmp) && ::rename(tmp.c_str(), ruta_tabla.c_str()) == 0;
+    if (!ok) return -1;
+    // Diario vacío: lo aplicado ya está en registros.dat y en la tabla
+    return vaciar(ruta_registros) ? aplicadas : -1;
+}
+
+// Checkpoint de un proceso con el diario abierto: todo lo agregado en disco,
+// registros.dat sincronizado, la tabla en memoria en `ruta_tabla` (temporal +
+// rename) y el diario vacío. El que llama bloquea las escrituras mientras tanto.
+inline bool checkpoint(Diario &d, const std::string &ruta_registros, const std::string &ruta_tabla,
+                       const tabla_hash::Tabla &t)
+{
+    if (!d.confirmarTodo() || !sincronizar(ruta_registros)) return false;
+    const std::string tmp = ruta_tabla + ".tmp";
+    if (!tabla_hash::guardar(tmp, t) || !sincronizar(tmp) || ::rename(tmp.c_str(), ruta_tabla.c_str()) != 0)
+        return false;
+    return d.truncar();
+}
+
+} // namespace wal
@@ -0,0 +1,196 @@
+// rehash_tabla.cpp
+// Redimensiona offline la tabla hash (ver tabla_hash.h): elige una cantidad de
+// buckets potencia de 2 y reenlaza todas las cadenas de registros.dat de una vez,
+// en lugar de las divisiones de a un bucket que hacen las inserciones.
+// Uso:
+//   rehash_tabla [registros.dat] [tabla_hash.dat] [--carga N] [--buckets N]
+//   rehash_tabla info [registros.dat] [tabla_hash.dat]
+// --carga fija el factor de carga objetivo (por defecto el de la tabla, o 16 si
+// era fija) y --buckets la cantidad exacta (potencia de 2). `info` imprime el
+// tamaño, la carga y el largo de las cadenas sin modificar nada.
+// Solo se reenlazan los registros alcanzables desde la tabla (las lápidas de
+// las eliminaciones quedan en su lugar, sin enlazar), así que los offsets no
+// cambian y los índices por fecha/nombre y la lista de libres siguen valiendo. La tabla
+// nueva queda con layout de cadenas; para reagrupar correr `Limpieza --agrupado`.
+// Se escriben temporales y se renombran al final como par (wal::reemplazarPar):
+// si se interrumpe entre los dos renombres, el próximo en abrir los completa. Antes de redimensionar se aplica el
+// diario de la GUI (registros_wal.h), si quedó alguno. Redimensionar falla si
+// la GUI o gestor_dni tienen la tabla abierta (tabla_compartida.h); `info` lee
+// la tabla vigente del segmento compartido.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "registros_wal.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Marca en `vivo` los slots alcanzables desde la tabla y devuelve cuántos son
+long long marcarVivos(int fd, long long tam, const tabla_hash::Tabla &tabla, std::vector<bool> &vivo,
+                      long long &cadena_max)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    vivo.assign((size_t)(tam / sz), false);
+    long long n = 0;
+    cadena_max = 0;
+    for (const HashExtent &e : tabla.entradas) {
+        long long largo = 0;
+        tabla_hash::recorrerBucket(e, tam,
+            [&](long long off, void *dst, size_t bytes) { return ::pread(fd, dst, bytes, (off_t)off) == (ssize_t)bytes; },
+            [&](long long off, const RegistroClinico &) {
+                ++largo;
+                if (off % sz != 0 || vivo[(size_t)(off / sz)]) return;
+                vivo[(size_t)(off / sz)] = true;
+                ++n;
+            });
+        cadena_max = std::max(cadena_max, largo);
+    }
+    return n;
+}
+
+void imprimirTabla(const char *titulo, const tabla_hash::Tabla &t, long long vivos, long long cadena_max)
+{
+    std::cout << titulo << ": " << t.entradas.size() << " buckets (base " << t.buckets_base << "), "
+              << vivos << " registros enlazados, carga " << (double)vivos / (double)t.entradas.size()
+              << ", cadena más larga " << cadena_max << ", carga máxima "
+              << (t.carga_max > 0 ? std::to_string(t.carga_max) : std::string("- (tabla fija)"))
+              << (tabla_hash::esV2(t.layout) ? ", layout agrupado" : "") << "\n";
+}
+
+int info(const std::string &ruta_registros, const std::string &ruta_tabla)
+{
+    tabla_hash::Tabla tabla;
+    int fd = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (fd < 0 || !tabla_compartida::cargarVigente(ruta_registros, ruta_tabla, tabla)) {
+        std::cerr << "No se pudo abrir " << ruta_registros << " o " << ruta_tabla << "\n";
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+    std::vector<bool> vivo;
+    long long cadena_max = 0;
+    long long vivos = marcarVivos(fd, (long long)::lseek(fd, 0, SEEK_END), tabla, vivo, cadena_max);
+    ::close(fd);
+    imprimirTabla("Tabla", tabla, vivos, cadena_max);
+    if (tabla.num_registros != vivos && tabla_hash::esV2(tabla))
+        std::cout << "Contador de la cabecera: " << tabla.num_registros << "\n";
+    return 0;
+}
+
+int rehash(const std::string &ruta_registros, const std::string &ruta_tabla, int32_t carga, long long buckets)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    auto t0 = std::chrono::steady_clock::now();
+    tabla_compartida::Exclusivo exclusivo(ruta_tabla);
+    if (!exclusivo) {
+        std::cerr << "La tabla " << ruta_tabla << " está en uso (GUI o gestor_dni abiertos)\n";
+        return 1;
+    }
+    if (wal::recuperar(ruta_registros, ruta_tabla) < 0) {
+        std::cerr << "No se pudo aplicar " << wal::rutaDiario(ruta_registros) << "\n";
+        return 1;
+    }
+    tabla_hash::Tabla vieja;
+    int fd = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (fd < 0 || !tabla_hash::cargar(ruta_tabla, vieja)) {
+        std::cerr << "No se pudo abrir " << ruta_registros << " o " << ruta_tabla << "\n";
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+    const long long tam = (long long)::lseek(fd, 0, SEEK_END);
+
+    // Pasada 1: registros vivos (recorriendo las cadenas actuales)
+    std::vector<bool> vivo;
+    long long cadena_max = 0;
+    long long vivos = marcarVivos(fd, tam, vieja, vivo, cadena_max);
+    imprimirTabla("Antes", vieja, vivos, cadena_max);
+
+    if (carga <= 0) carga = vieja.carga_max > 0 ? vieja.carga_max : CARGA_MAX_DEFECTO;
+    if (buckets <= 0) buckets = tabla_hash::bucketsPara(vivos, carga);
+    if ((buckets & (buckets - 1)) != 0 || buckets > (1LL << 30)) {
+        std::cerr << "--buckets debe ser una potencia de 2 (<= 2^30)\n";
+        ::close(fd);
+        return 1;
+    }
+    tabla_hash::Tabla nueva = tabla_hash::tablaVacia(LAYOUT_CADENAS, buckets, carga);
+    nueva.num_registros = vivos;
+
+    // Pasada 2: copia secuencial de registros.dat; cada registro vivo se antepone
+    // a la cadena de su bucket nuevo (mismo orden que deja el loader)
+    const std::string tmp_registros = ruta_registros + ".rehash.tmp";
+    const std::string tmp_tabla = ruta_tabla + ".rehash.tmp";
+    std::ofstream out(tmp_registros, std::ios::binary | std::ios::trunc);
+    const long long LOTE = 4096;
+    std::vector<RegistroClinico> buf((size_t)LOTE);
+    std::vector<long long> largo((size_t)buckets, 0);
+    bool ok = out.is_open();
+    for (long long i = 0; ok && i < tam / sz; i += LOTE) {
+        long long n = std::min(LOTE, tam / sz - i);
+        if (::pread(fd, buf.data(), (size_t)(n * sz), (off_t)(i * sz)) != (ssize_t)(n * sz)) {
+            ok = false;
+            break;
+        }
+        for (long long k = 0; k < n; ++k) {
+            if (!vivo[(size_t)(i + k)]) continue;
+            int b = tabla_hash::bucket(nueva, buf[(size_t)k].dni);
+            buf[(size_t)k].pos_siguiente = nueva.entradas[b].head_offset;
+            nueva.entradas[b].head_offset = (i + k) * sz;
+            ++largo[(size_t)b];
+        }
+        ok = (bool)out.write(reinterpret_cast<const char *>(buf.data()), (std::streamsize)(n * sz));
+    }
+    ::close(fd);
+    out.close();
+    if (!ok || !out || !tabla_hash::guardar(tmp_tabla, nueva)) {
+        std::cerr << "Error escribiendo los temporales; no se modificó nada\n";
+        std::error_code ec;
+        std::filesystem::remove(tmp_registros, ec);
+        std::filesystem::remove(tmp_tabla, ec);
+        return 1;
+    }
+    if (!wal::reemplazarPar(ruta_registros, tmp_registros, ruta_tabla, tmp_tabla)) {
+        std::cerr << "No se pudieron reemplazar los archivos (si quedó registros.reemplazo, se completa al abrir)\n";
+        return 1;
+    }
+    imprimirTabla("Después", nueva, vivos, *std::max_element(largo.begin(), largo.end()));
+    if (tabla_hash::esV2(vieja.layout))
+        std::cout << "Aviso: la tabla estaba agrupada; correr `Limpieza --agrupado` para reagrupar\n";
+    std::cout << "Rehash en " << segundosDesde(t0) << " s (regenerar columnas y copia v2 si se usan)\n";
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> pos;
+    int32_t carga = 0;
+    long long buckets = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--carga" && i + 1 < argc) carga = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--buckets" && i + 1 < argc) buckets = std::atoll(argv[++i]);
+        else pos.push_back(a);
+    }
+    bool modo_info = !pos.empty() && pos[0] == "info";
+    if (modo_info) pos.erase(pos.begin());
+    if (pos.size() > 2 || (buckets < 0)) {
+        std::cerr << "Uso: rehash_tabla [registros.dat] [tabla_hash.dat] [--carga N] [--buckets N]\n"
+                  << "     rehash_tabla info [registros.dat] [tabla_hash.dat]\n";
+        return 1;
+    }
+    std::string ruta_registros = pos.size() > 0 ? pos[0] : "registros.dat";
+    std::string ruta_tabla = pos.size() > 1 ? pos[1] : "tabla_hash.dat";
+    return modo_info ? info(ruta_registros, ruta_tabla) : rehash(ruta_registros, ruta_tabla, carga, buckets);
+}
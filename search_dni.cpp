@@ -2,15 +2,27 @@
 // search_dni.cpp
 // Herramienta de diagnóstico para buscar e imprimir todos los registros
 // asociados a un DNI determinado usando `output/tabla_hash.dat` y `output/registros.dat`.
+// También acepta un segmento comprimido (`.seg`, ver segmento_frio.h) o la
+// copia compacta `registros_v2.dat` (ver registro_v2.h) en lugar de registros.dat;
+// esta última solo si está al día, si no se busca en registros.dat.
+// Sobre registros.dat consulta antes el filtro de DNI (filtro_dni.h, si está fresco)
+// y, si hay directorio de pacientes fresco (directorio_pacientes.h), lee solo
+// los registros del DNI en lugar de recorrer la cadena. Si la GUI o gestor_dni
+// tienen la tabla abierta, usa la del segmento compartido (tabla_compartida.h),
+// que incluye las altas aún no llevadas a tabla_hash.dat.
 #include "common.h"
+#include "directorio_pacientes.h"
+#include "filtro_dni.h"
+#include "registro_v2.h"
+#include "segmento_frio.h"
+#include "tabla_compartida.h"
+#include "tabla_hash.h"
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
-// Función hash coherente con las usadas en el resto del proyecto
-inline int hash1(int dni) { return dni & (TABLE_SIZE - 1); }
-
 void printRegistro(const RegistroClinico &r, long long offset) {
     std::cout << "Offset: " << offset << "\n";
     std::cout << " Fecha: " << r.fecha << "\n";
@@ -28,55 +40,124 @@ void printRegistro(const RegistroClinico &r, long long offset) {
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        std::cerr << "Uso: search_dni <DNI> [path_registros.dat]" << std::endl;
+        std::cerr << "Uso: search_dni <DNI> [path_registros.dat | path.seg | path/registros_v2.dat]" << std::endl;
         return 1;
     }
     int dni = std::stoi(argv[1]);
     std::string registros_path = (argc >= 3) ? argv[2] : "output/registros.dat";
     std::string tabla_path = "output/tabla_hash.dat";
 
-    // open tabla
-    std::ifstream tabla(tabla_path, std::ios::binary);
-    if (!tabla.is_open()) {
+    // open tabla (formato legado, v2 o v3 con tamaño variable). Sobre el
+    // registros.dat de la misma carpeta, la vigente del segmento compartido
+    auto cargarTabla = [&](tabla_hash::Tabla &t) {
+        std::filesystem::path r(registros_path), th(tabla_path);
+        if (r.filename() == "registros.dat" && r.parent_path() == th.parent_path())
+            return tabla_compartida::cargarVigente(registros_path, tabla_path, t);
+        return tabla_hash::cargar(tabla_path, t);
+    };
+    tabla_hash::Tabla tabla;
+    if (!cargarTabla(tabla)) {
         // try project root
         tabla_path = "tabla_hash.dat";
-        tabla.open(tabla_path, std::ios::binary);
-        if (!tabla.is_open()) {
+        if (!cargarTabla(tabla)) {
             std::cerr << "No se pudo abrir tabla_hash.dat en output/ ni en el directorio actual." << std::endl;
             return 1;
         }
     }
 
-    int pos = hash1(dni);
-    tabla.seekg(pos * sizeof(HashEntry), std::ios::beg);
-    HashEntry he;
-    tabla.read(reinterpret_cast<char*>(&he), sizeof(he));
-    tabla.close();
+    int pos = tabla_hash::bucket(tabla, dni);
+    const HashExtent &he = tabla.entradas[pos];
 
     if (he.head_offset == NULL_OFFSET) {
         std::cout << "Head offset for hash pos " << pos << " is NULL (-1). No registros." << std::endl;
         return 0;
     }
 
+    // Segmento frío: mismos offsets, se descomprimen solo los bloques del bucket
+    if (registros_path.size() > 4 && registros_path.compare(registros_path.size() - 4, 4, ".seg") == 0) {
+        segmento::Lector seg;
+        if (!seg.abrir(registros_path)) {
+            std::cerr << "No se pudo abrir el segmento: " << registros_path << std::endl;
+            return 1;
+        }
+        bool found = false;
+        tabla_hash::recorrerBucket(he, seg.tam(),
+            [&](long long offset, void *dst, size_t n) { return seg.leer(offset, dst, n); },
+            [&](long long offset, const RegistroClinico &r) {
+                if (r.dni == dni) {
+                    printRegistro(r, offset);
+                    found = true;
+                }
+            });
+        if (!found) std::cout << "No se encontraron registros con DNI " << dni << std::endl;
+        return 0;
+    }
+
+    // Copia v2: mismas filas, cada registro se decodifica con el diccionario y el
+    // heap. Solo si está al día con registros.dat (los offsets de la tabla son
+    // los del archivo actual); si no, se busca en registros.dat.
+    const std::string sufijo_v2 = "registros_v2.dat";
+    registro_v2::Almacen v2;
+    if (registros_path.size() >= sufijo_v2.size() &&
+        registros_path.compare(registros_path.size() - sufijo_v2.size(), sufijo_v2.size(), sufijo_v2) == 0) {
+        std::string origen = registros_path.substr(0, registros_path.size() - sufijo_v2.size()) + "registros.dat";
+        if (!v2.abrir(origen)) {
+            std::cerr << "La copia v2 " << registros_path << " no existe o está desactualizada; se busca en "
+                      << origen << std::endl;
+            registros_path = origen;
+        }
+    }
+    if (v2.abierto()) {
+        bool found = false;
+        tabla_hash::recorrerBucket(he, v2.tamLegado(),
+            [&](long long offset, void *dst, size_t n) { return v2.leer(offset, dst, n); },
+            [&](long long offset, const RegistroClinico &r) {
+                if (r.dni == dni) {
+                    printRegistro(r, offset);
+                    found = true;
+                }
+            });
+        if (!found) std::cout << "No se encontraron registros con DNI " << dni << std::endl;
+        return 0;
+    }
+
+    if (filtro_dni::descartado(registros_path, dni)) {
+        std::cout << "No se encontraron registros con DNI " << dni << " (descartado por filtro_dni.dat)" << std::endl;
+        return 0;
+    }
     std::ifstream regs(registros_path, std::ios::binary);
     if (!regs.is_open()) {
         std::cerr << "No se pudo abrir registros file: " << registros_path << std::endl;
         return 1;
     }
 
-    long long offset = he.head_offset;
     bool found = false;
-    RegistroClinico r;
-    while (offset != NULL_OFFSET) {
-        regs.seekg(offset, std::ios::beg);
-        regs.read(reinterpret_cast<char*>(&r), sizeof(r));
-        if (!regs) break;
-        if (r.dni == dni) {
+    pacientes::Directorio directorio;
+    std::vector<long long> offsets;
+    if (directorio.abrir(registros_path) && directorio.fresco() && directorio.buscar(dni, offsets)) {
+        for (long long offset : offsets) {
+            RegistroClinico r;
+            regs.seekg(offset, std::ios::beg);
+            if (!regs.read(reinterpret_cast<char*>(&r), sizeof(r))) break;
             printRegistro(r, offset);
             found = true;
         }
-        offset = r.pos_siguiente;
+        if (!found) std::cout << "No se encontraron registros con DNI " << dni << std::endl;
+        return 0;
     }
+    std::error_code ec;
+    long long filesize = (long long)std::filesystem::file_size(registros_path, ec);
+    tabla_hash::recorrerBucket(he, ec ? 0 : filesize,
+        [&](long long offset, void *dst, size_t n) {
+            regs.seekg(offset, std::ios::beg);
+            return (bool)regs.read(reinterpret_cast<char*>(dst), n);
+        },
+        [&](long long offset, const RegistroClinico &r) {
+            if (r.dni == dni) {
+                printRegistro(r, offset);
+                found = true;
+            }
+        });
     if (!found) std::cout << "No se encontraron registros con DNI " << dni << std::endl;
     regs.close();
     return 0;
@@ -0,0 +1,203 @@
+// segmento_frio.cpp
+// Herramienta para el segmento frío comprimido de `registros.dat` (ver segmento_frio.h).
+// Uso:
+//   segmento_frio compactar [registros.dat] [registros.seg] [registros_por_bloque]
+//   segmento_frio expandir  [registros.seg] [registros.dat]
+//   segmento_frio buscar <DNI> [registros.seg] [tabla_hash.dat]
+//   segmento_frio bench     [registros.dat] [registros.seg] [minEdad] [maxEdad] [busquedas]
+// `bench` compara el recorrido completo (conteo por rango de edad) y búsquedas
+// aleatorias por offset entre el formato crudo y el segmento.
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "segmento_frio.h"
+#include "tabla_hash.h"
+
+static double segundosDesde(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static std::string arg(int argc, char** argv, int i, const char* defecto)
+{
+    return (argc > i) ? argv[i] : defecto;
+}
+
+int compactar(const std::string& ruta_dat, const std::string& ruta_seg, int por_bloque)
+{
+    segmento::Estadisticas est;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!segmento::compactar(ruta_dat, ruta_seg, por_bloque, est)) {
+        std::cerr << "Error al compactar " << ruta_dat << " en " << ruta_seg << "\n";
+        return 1;
+    }
+    double t = segundosDesde(t0);
+    std::cout << "Segmento " << ruta_seg << ": " << est.num_registros << " registros en " << est.num_bloques
+              << " bloques de " << por_bloque << "\n";
+    std::cout << "  " << est.bytes_crudos << " -> " << est.bytes_segmento << " bytes";
+    if (est.bytes_segmento > 0) std::cout << " (ratio " << (double)est.bytes_crudos / est.bytes_segmento << "x)";
+    std::cout << ", " << t << " s";
+    if (t > 0.0) std::cout << " (" << (est.bytes_crudos / 1e6) / t << " MB/s)";
+    std::cout << "\n";
+    return 0;
+}
+
+int expandir(const std::string& ruta_seg, const std::string& ruta_dat)
+{
+    segmento::Lector lector;
+    if (!lector.abrir(ruta_seg)) {
+        std::cerr << "No se pudo abrir el segmento " << ruta_seg << "\n";
+        return 1;
+    }
+    std::ofstream out(ruta_dat, std::ios::binary | std::ios::trunc);
+    bool ok = out.is_open();
+    for (long long b = 0; ok && b < lector.cabecera().num_bloques; ++b) {
+        size_t n = 0;
+        const RegistroClinico* regs = lector.bloque(b, n);
+        ok = regs && out.write(reinterpret_cast<const char*>(regs), (std::streamsize)(n * sizeof(RegistroClinico)));
+    }
+    if (!ok) {
+        std::cerr << "Error al expandir " << ruta_seg << "\n";
+        return 1;
+    }
+    std::cout << "Expandido " << ruta_seg << " en " << ruta_dat << " (" << lector.tam() << " bytes)\n";
+    return 0;
+}
+
+int buscar(int dni, const std::string& ruta_seg, const std::string& ruta_tabla)
+{
+    segmento::Lector lector;
+    tabla_hash::Tabla tabla;
+    if (!lector.abrir(ruta_seg) || !tabla_hash::cargar(ruta_tabla, tabla)) {
+        std::cerr << "No se pudo abrir " << ruta_seg << " o " << ruta_tabla << "\n";
+        return 1;
+    }
+    long long encontrados = 0;
+    tabla_hash::recorrerBucket(tabla.entradas[tabla_hash::bucket(tabla, dni)], lector.tam(),
+        [&](long long offset, void* dst, size_t n) { return lector.leer(offset, dst, n); },
+        [&](long long offset, const RegistroClinico& r) {
+            if (r.dni != dni) return;
+            ++encontrados;
+            std::cout << "Offset " << offset << ": " << r.fecha << " | " << r.nombre << " " << r.apellido
+                      << " | edad " << r.edad << " | " << r.medico << " | " << r.motivo << "\n";
+        });
+    std::cout << encontrados << " registro(s) con DNI " << dni << " (" << lector.bloquesLeidos()
+              << " bloque(s) descomprimidos)\n";
+    return 0;
+}
+
+int bench(const std::string& ruta_dat, const std::string& ruta_seg, int minEdad, int maxEdad, int busquedas)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    segmento::Lector lector;
+    std::ifstream crudo(ruta_dat, std::ios::binary | std::ios::ate);
+    if (!lector.abrir(ruta_seg) || !crudo.is_open()) {
+        std::cerr << "No se pudo abrir " << ruta_dat << " o " << ruta_seg << "\n";
+        return 1;
+    }
+    long long tam = (long long)crudo.tellg();
+    long long num = tam / (long long)sz;
+    if (num != lector.cabecera().num_registros)
+        std::cerr << "Aviso: el segmento tiene " << lector.cabecera().num_registros << " registros y "
+                  << ruta_dat << " " << num << "\n";
+
+    // Recorrido completo en formato crudo (lotes de 100000 registros, como gpu_stub)
+    auto t0 = std::chrono::steady_clock::now();
+    long long cuenta_crudo = 0;
+    {
+        const size_t CHUNK = 100000;
+        std::vector<RegistroClinico> buf(CHUNK);
+        crudo.seekg(0, std::ios::beg);
+        for (long long i = 0; i < num; i += (long long)CHUNK) {
+            size_t n = (size_t)std::min<long long>((long long)CHUNK, num - i);
+            if (!crudo.read(reinterpret_cast<char*>(buf.data()), (std::streamsize)(n * sz))) break;
+            for (size_t k = 0; k < n; ++k) cuenta_crudo += (buf[k].edad >= minEdad && buf[k].edad <= maxEdad);
+        }
+    }
+    double t_crudo = segundosDesde(t0);
+
+    // Recorrido completo del segmento (descomprime cada bloque una vez)
+    t0 = std::chrono::steady_clock::now();
+    long long cuenta_seg = 0;
+    lector.recorrer([&](long long, const RegistroClinico& r) { cuenta_seg += (r.edad >= minEdad && r.edad <= maxEdad); });
+    double t_seg = segundosDesde(t0);
+
+    long long bytes_seg = 0;
+    {
+        std::ifstream s(ruta_seg, std::ios::binary | std::ios::ate);
+        bytes_seg = (long long)s.tellg();
+    }
+    std::cout << "Recorrido (edad " << minEdad << ".." << maxEdad << "):\n";
+    std::cout << "  crudo   : " << cuenta_crudo << " registros, " << t_crudo << " s";
+    if (t_crudo > 0.0) std::cout << ", " << (tam / 1e6) / t_crudo << " MB/s lógicos";
+    std::cout << ", " << tam << " bytes en disco\n";
+    std::cout << "  segmento: " << cuenta_seg << " registros, " << t_seg << " s";
+    if (t_seg > 0.0) std::cout << ", " << (tam / 1e6) / t_seg << " MB/s lógicos";
+    std::cout << ", " << bytes_seg << " bytes en disco";
+    if (bytes_seg > 0) std::cout << " (ratio " << (double)tam / bytes_seg << "x)";
+    std::cout << "\n";
+    if (cuenta_crudo != cuenta_seg) std::cerr << "ERROR: los conteos no coinciden\n";
+
+    // Búsquedas aleatorias por offset (un bloque por búsqueda en el segmento)
+    if (num > 0 && busquedas > 0) {
+        std::mt19937_64 rng(12345);
+        std::uniform_int_distribution<long long> dist(0, num - 1);
+        std::vector<long long> offsets((size_t)busquedas);
+        for (auto& o : offsets) o = dist(rng) * (long long)sz;
+        RegistroClinico r;
+        long long suma_crudo = 0, suma_seg = 0;
+
+        t0 = std::chrono::steady_clock::now();
+        for (long long o : offsets) {
+            crudo.clear();
+            crudo.seekg(o, std::ios::beg);
+            if (crudo.read(reinterpret_cast<char*>(&r), sz)) suma_crudo += r.dni;
+        }
+        double tb_crudo = segundosDesde(t0);
+
+        long long leidos_antes = lector.bloquesLeidos();
+        t0 = std::chrono::steady_clock::now();
+        for (long long o : offsets)
+            if (lector.leer(o, &r, sz)) suma_seg += r.dni;
+        double tb_seg = segundosDesde(t0);
+
+        std::cout << "Búsquedas aleatorias (" << busquedas << "):\n";
+        std::cout << "  crudo   : " << (tb_crudo * 1e6 / busquedas) << " us/búsqueda\n";
+        std::cout << "  segmento: " << (tb_seg * 1e6 / busquedas) << " us/búsqueda ("
+                  << (lector.bloquesLeidos() - leidos_antes) << " bloques descomprimidos)\n";
+        if (suma_crudo != suma_seg) std::cerr << "ERROR: las búsquedas no coinciden\n";
+    }
+    return (cuenta_crudo == cuenta_seg) ? 0 : 2;
+}
+
+int main(int argc, char** argv)
+{
+    std::string modo = arg(argc, argv, 1, "");
+    if (modo == "compactar") {
+        int por_bloque = (argc > 4) ? std::atoi(argv[4]) : segmento::REGISTROS_POR_BLOQUE_DEFECTO;
+        return compactar(arg(argc, argv, 2, "registros.dat"), arg(argc, argv, 3, "registros.seg"),
+                         std::max(1, por_bloque));
+    }
+    if (modo == "expandir")
+        return expandir(arg(argc, argv, 2, "registros.seg"), arg(argc, argv, 3, "registros.dat"));
+    if (modo == "buscar" && argc > 2)
+        return buscar(std::atoi(argv[2]), arg(argc, argv, 3, "registros.seg"), arg(argc, argv, 4, "tabla_hash.dat"));
+    if (modo == "bench") {
+        int minEdad = (argc > 4) ? std::atoi(argv[4]) : 0;
+        int maxEdad = (argc > 5) ? std::atoi(argv[5]) : 200;
+        int busquedas = (argc > 6) ? std::atoi(argv[6]) : 10000;
+        return bench(arg(argc, argv, 2, "registros.dat"), arg(argc, argv, 3, "registros.seg"), minEdad, maxEdad,
+                     busquedas);
+    }
+    std::cerr << "Uso:\n"
+              << "  segmento_frio compactar [registros.dat] [registros.seg] [registros_por_bloque]\n"
+              << "  segmento_frio expandir  [registros.seg] [registros.dat]\n"
+              << "  segmento_frio buscar <DNI> [registros.seg] [tabla_hash.dat]\n"
+              << "  segmento_frio bench     [registros.dat] [registros.seg] [minEdad] [maxEdad] [busquedas]\n";
+    return 1;
+}
@@ -0,0 +1,369 @@
+// segmento_frio.h
+// Formato de segmento "frío" para `registros.dat`: los registros se agrupan en
+// bloques de tamaño fijo (`registros_por_bloque` registros) y cada bloque se
+// comprime por separado con un códec LZ propio (estilo LZ4: literales + copias
+// con distancia de 16 bits). Los campos de texto son casi todo relleno NUL y
+// valores repetidos, así que comprimen bien.
+// Archivo: SegmentoCabecera | bloques comprimidos | índice (un BloqueIndice por bloque)
+// El registro del offset `o` de registros.dat está en el bloque
+// (o / sz) / registros_por_bloque, slot (o / sz) % registros_por_bloque: los
+// offsets de `tabla_hash.dat` y `pos_siguiente` siguen valiendo sin cambios.
+// Búsquedas y recorridos descomprimen solo los bloques que tocan.
+#pragma once
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace segmento {
+
+static const char SEG_MAGIC[8] = {'P', 'P', 'S', 'E', 'G', '1', 0, 0};
+static const int32_t SEG_VERSION = 1;
+static const int32_t REGISTROS_POR_BLOQUE_DEFECTO = 128;
+
+#pragma pack(push, 1)
+struct SegmentoCabecera {
+    char magic[8];                 // SEG_MAGIC
+    int32_t version;               // SEG_VERSION
+    int32_t registros_por_bloque;
+    int64_t num_registros;
+    int64_t num_bloques;
+    int64_t offset_indice;         // inicio del índice de bloques
+    int64_t tam_registros;         // bytes de registros.dat de origen
+    int64_t reservado[2];
+};
+
+struct BloqueIndice {
+    int64_t offset;                // inicio del bloque en el segmento
+    uint32_t tam_comprimido;       // bytes en disco
+    uint32_t num_registros;        // registros del bloque (el último puede ir incompleto)
+    uint32_t sin_comprimir;        // 1 si el bloque se guardó tal cual (no comprimía)
+    uint32_t reservado;
+};
+#pragma pack(pop)
+
+// ---------------------------------------------------------------------------
+// Códec LZ. Secuencia: token (nibble alto = literales, bajo = largo de copia - 4;
+// 15 indica bytes de extensión 255...), literales, distancia (2 bytes LE) y
+// extensión del largo. La última secuencia solo tiene literales.
+// ---------------------------------------------------------------------------
+
+static const size_t LZ_MIN_COPIA = 4;
+static const size_t LZ_VENTANA = 65535;
+static const int LZ_BITS_HASH = 13;
+
+// Tamaño máximo de salida de `comprimir` para `n` bytes de entrada
+inline size_t cotaComprimido(size_t n) { return n + n / 255 + 16; }
+
+namespace detalle {
+
+inline uint32_t leer32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void escribirLargo(uint8_t *dst, size_t &op, size_t resto)
+{
+    while (resto >= 255) {
+        dst[op++] = 255;
+        resto -= 255;
+    }
+    dst[op++] = (uint8_t)resto;
+}
+
+inline void emitir(const uint8_t *src, size_t anchor, size_t literales, size_t copia, size_t distancia,
+                   uint8_t *dst, size_t &op)
+{
+    size_t ml = copia ? copia - LZ_MIN_COPIA : 0;
+    dst[op++] = (uint8_t)((std::min<size_t>(literales, 15) << 4) | std::min<size_t>(ml, 15));
+    if (literales >= 15) escribirLargo(dst, op, literales - 15);
+    std::memcpy(dst + op, src + anchor, literales);
+    op += literales;
+    if (!copia) return;
+    dst[op++] = (uint8_t)(distancia & 0xFF);
+    dst[op++] = (uint8_t)(distancia >> 8);
+    if (ml >= 15) escribirLargo(dst, op, ml - 15);
+}
+
+inline bool leerLargo(const uint8_t *src, size_t n, size_t &ip, size_t &largo)
+{
+    uint8_t b;
+    do {
+        if (ip >= n) return false;
+        b = src[ip++];
+        largo += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace detalle
+
+// Comprime `n` bytes en `dst` (capacidad >= cotaComprimido(n)); devuelve los bytes escritos
+inline size_t comprimir(const uint8_t *src, size_t n, uint8_t *dst)
+{
+    std::vector<int32_t> tabla((size_t)1 << LZ_BITS_HASH, -1);
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + LZ_MIN_COPIA <= n) {
+        uint32_t secuencia = detalle::leer32(src + ip);
+        uint32_t h = (secuencia * 2654435761u) >> (32 - LZ_BITS_HASH);
+        int32_t ref = tabla[h];
+        tabla[h] = (int32_t)ip;
+        if (ref < 0 || ip - (size_t)ref > LZ_VENTANA || detalle::leer32(src + ref) != secuencia) {
+            ++ip;
+            continue;
+        }
+        size_t largo = LZ_MIN_COPIA;
+        while (ip + largo < n && src[ref + largo] == src[ip + largo]) ++largo;
+        detalle::emitir(src, anchor, ip - anchor, largo, ip - (size_t)ref, dst, op);
+        ip += largo;
+        anchor = ip;
+    }
+    detalle::emitir(src, anchor, n - anchor, 0, 0, dst, op);
+    return op;
+}
+
+// Descomprime `n` bytes en `dst` (capacidad `cap`). false si la entrada está corrupta.
+inline bool descomprimir(const uint8_t *src, size_t n, uint8_t *dst, size_t cap, size_t &escritos)
+{
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+        size_t literales = token >> 4;
+        if (literales == 15 && !detalle::leerLargo(src, n, ip, literales)) return false;
+        if (literales > n - ip || literales > cap - op) return false;
+        std::memcpy(dst + op, src + ip, literales);
+        ip += literales;
+        op += literales;
+        if (ip == n) break; // última secuencia: solo literales
+        if (n - ip < 2) return false;
+        size_t distancia = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        size_t largo = token & 15;
+        if (largo == 15 && !detalle::leerLargo(src, n, ip, largo)) return false;
+        largo += LZ_MIN_COPIA;
+        if (distancia == 0 || distancia > op || largo > cap - op) return false;
+        const uint8_t *ref = dst + op - distancia;
+        if (distancia >= largo) std::memcpy(dst + op, ref, largo);
+        else for (size_t k = 0; k < largo; ++k) dst[op + k] = ref[k]; // copia solapada (rachas)
+        op += largo;
+    }
+    escritos = op;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Escritura
+// ---------------------------------------------------------------------------
+
+struct Estadisticas {
+    long long num_registros = 0;
+    long long num_bloques = 0;
+    long long bytes_crudos = 0;
+    long long bytes_segmento = 0;
+};
+
+// Genera el segmento `ruta_segmento` a partir de `ruta_registros`
+inline bool compactar(const std::string &ruta_registros, const std::string &ruta_segmento,
+                      int registros_por_bloque, Estadisticas &est)
+{
+    const size_t sz = sizeof(RegistroClinico);
+    registros_por_bloque = std::max(1, registros_por_bloque);
+    int in = ::open(ruta_registros.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    long long tam = (long long)::lseek(in, 0, SEEK_END);
+    ::posix_fadvise(in, 0, tam, POSIX_FADV_SEQUENTIAL);
+    int out = ::open(ruta_segmento.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) { ::close(in); return false; }
+
+    SegmentoCabecera cab;
+    std::memset(&cab, 0, sizeof(cab));
+    std::memcpy(cab.magic, SEG_MAGIC, sizeof(SEG_MAGIC));
+    cab.version = SEG_VERSION;
+    cab.registros_por_bloque = registros_por_bloque;
+    cab.num_registros = tam / (long long)sz;
+    cab.num_bloques = (cab.num_registros + registros_por_bloque - 1) / registros_por_bloque;
+    cab.tam_registros = tam;
+
+    const size_t crudo_max = (size_t)registros_por_bloque * sz;
+    std::vector<uint8_t> crudo(crudo_max), comprimido(cotaComprimido(crudo_max));
+    std::vector<BloqueIndice> indice((size_t)cab.num_bloques);
+    long long pos = (long long)sizeof(cab);
+    bool ok = true;
+    for (long long b = 0; ok && b < cab.num_bloques; ++b) {
+        long long primero = b * registros_por_bloque;
+        size_t n = (size_t)std::min<long long>(registros_por_bloque, cab.num_registros - primero);
+        size_t bytes = n * sz;
+        ok = ::pread(in, crudo.data(), bytes, (off_t)(primero * (long long)sz)) == (ssize_t)bytes;
+        if (!ok) break;
+        size_t c = comprimir(crudo.data(), bytes, comprimido.data());
+        BloqueIndice &e = indice[(size_t)b];
+        e.offset = pos;
+        e.num_registros = (uint32_t)n;
+        e.sin_comprimir = (c >= bytes) ? 1u : 0u;
+        e.tam_comprimido = (uint32_t)(e.sin_comprimir ? bytes : c);
+        const uint8_t *datos = e.sin_comprimir ? crudo.data() : comprimido.data();
+        ok = ::pwrite(out, datos, e.tam_comprimido, (off_t)pos) == (ssize_t)e.tam_comprimido;
+        pos += e.tam_comprimido;
+    }
+    cab.offset_indice = pos;
+    size_t bytes_indice = indice.size() * sizeof(BloqueIndice);
+    ok = ok && ::pwrite(out, indice.data(), bytes_indice, (off_t)pos) == (ssize_t)bytes_indice;
+    // La cabecera va al final: un segmento a medio escribir no tiene magic válido
+    ok = ok && ::pwrite(out, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+    ::close(out);
+    ::close(in);
+
+    est.num_registros = cab.num_registros;
+    est.num_bloques = cab.num_bloques;
+    est.bytes_crudos = tam;
+    est.bytes_segmento = pos + (long long)bytes_indice;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Lectura
+// ---------------------------------------------------------------------------
+
+// Lector de un segmento. Guarda el último bloque descomprimido, así que una
+// instancia no debe compartirse entre hilos (abrir una por hilo).
+class Lector {
+public:
+    struct Ubicacion {
+        long long bloque;
+        long long slot;
+    };
+
+    Lector() = default;
+    Lector(const Lector &) = delete;
+    Lector &operator=(const Lector &) = delete;
+    ~Lector() { cerrar(); }
+
+    bool abrir(const std::string &ruta) {
+        cerrar();
+        fd_ = ::open(ruta.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        bool ok = ::pread(fd_, &cab_, sizeof(cab_), 0) == (ssize_t)sizeof(cab_) &&
+                  std::memcmp(cab_.magic, SEG_MAGIC, sizeof(SEG_MAGIC)) == 0 &&
+                  cab_.version == SEG_VERSION && cab_.registros_por_bloque > 0 && cab_.num_registros >= 0 &&
+                  cab_.num_bloques == (cab_.num_registros + cab_.registros_por_bloque - 1) / cab_.registros_por_bloque;
+        // el índice tiene que entrar en el archivo (una cabecera dañada no pide memoria de más)
+        struct stat st;
+        ok = ok && ::fstat(fd_, &st) == 0 && cab_.offset_indice >= (int64_t)sizeof(cab_) &&
+             cab_.num_bloques <= ((long long)st.st_size - cab_.offset_indice) / (long long)sizeof(BloqueIndice);
+        if (ok) {
+            indice_.resize((size_t)cab_.num_bloques);
+            size_t bytes = indice_.size() * sizeof(BloqueIndice);
+            ok = ::pread(fd_, indice_.data(), bytes, (off_t)cab_.offset_indice) == (ssize_t)bytes;
+        }
+        // Cada bloque tiene registros_por_bloque registros salvo el último (es lo
+        // que supone `ubicar`); una entrada con más desbordaría crudo_ al leerla
+        for (size_t b = 0; ok && b < indice_.size(); ++b) {
+            long long esperados = std::min<long long>(cab_.registros_por_bloque,
+                                                      cab_.num_registros - (long long)b * cab_.registros_por_bloque);
+            ok = indice_[b].num_registros == esperados && indice_[b].offset >= 0;
+        }
+        if (!ok) { cerrar(); return false; }
+        crudo_.resize((size_t)std::min<long long>(cab_.registros_por_bloque, cab_.num_registros));
+        bloque_actual_ = -1;
+        return true;
+    }
+
+    void cerrar() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        indice_.clear();
+        bloque_actual_ = -1;
+    }
+
+    const SegmentoCabecera &cabecera() const { return cab_; }
+    const std::vector<BloqueIndice> &indice() const { return indice_; }
+
+    // Tamaño lógico (el de registros.dat de origen, múltiplo del registro)
+    long long tam() const { return cab_.num_registros * (long long)sizeof(RegistroClinico); }
+
+    Ubicacion ubicar(long long offset) const {
+        long long i = offset / (long long)sizeof(RegistroClinico);
+        return Ubicacion{i / cab_.registros_por_bloque, i % cab_.registros_por_bloque};
+    }
+
+    // Registros del bloque `b` (descomprime solo si no es el último usado)
+    const RegistroClinico *bloque(long long b, size_t &n) {
+        if (b < 0 || b >= cab_.num_bloques) return nullptr;
+        const BloqueIndice &e = indice_[(size_t)b];
+        if (b != bloque_actual_) {
+            size_t bytes = (size_t)e.num_registros * sizeof(RegistroClinico);
+            uint8_t *destino = reinterpret_cast<uint8_t *>(crudo_.data());
+            bool ok;
+            if (e.sin_comprimir) {
+                ok = e.tam_comprimido == bytes &&
+                     ::pread(fd_, destino, bytes, (off_t)e.offset) == (ssize_t)bytes;
+            } else {
+                comprimido_.resize(e.tam_comprimido);
+                size_t escritos = 0;
+                ok = ::pread(fd_, comprimido_.data(), e.tam_comprimido, (off_t)e.offset) == (ssize_t)e.tam_comprimido &&
+                     descomprimir(comprimido_.data(), e.tam_comprimido, destino, bytes, escritos) && escritos == bytes;
+            }
+            if (!ok) { bloque_actual_ = -1; return nullptr; }
+            bloque_actual_ = b;
+            ++bloques_leidos_;
+        }
+        n = e.num_registros;
+        return crudo_.data();
+    }
+
+    // Copia `bytes` desde el offset lógico `offset` (puede cruzar bloques).
+    // Misma firma que el `leer` de tabla_hash::recorrerBucket.
+    bool leer(long long offset, void *destino, size_t bytes) {
+        const long long sz = (long long)sizeof(RegistroClinico);
+        if (offset < 0 || offset + (long long)bytes > tam()) return false;
+        char *dst = static_cast<char *>(destino);
+        while (bytes > 0) {
+            Ubicacion u = ubicar(offset);
+            size_t n = 0;
+            const RegistroClinico *regs = bloque(u.bloque, n);
+            if (!regs) return false;
+            long long dentro = offset - (u.bloque * cab_.registros_por_bloque) * sz;
+            size_t cuantos = std::min<size_t>(bytes, (size_t)((long long)n * sz - dentro));
+            std::memcpy(dst, reinterpret_cast<const char *>(regs) + dentro, cuantos);
+            dst += cuantos;
+            offset += (long long)cuantos;
+            bytes -= cuantos;
+        }
+        return true;
+    }
+
+    // Recorre todos los registros en orden de archivo: visitar(offset, registro)
+    template <typename F>
+    bool recorrer(F visitar) {
+        const long long sz = (long long)sizeof(RegistroClinico);
+        for (long long b = 0; b < cab_.num_bloques; ++b) {
+            size_t n = 0;
+            const RegistroClinico *regs = bloque(b, n);
+            if (!regs) return false;
+            long long base = b * cab_.registros_por_bloque * sz;
+            for (size_t k = 0; k < n; ++k) visitar(base + (long long)k * sz, regs[k]);
+        }
+        return true;
+    }
+
+    long long bloquesLeidos() const { return bloques_leidos_; }
+
+private:
+    int fd_ = -1;
+    SegmentoCabecera cab_{};
+    std::vector<BloqueIndice> indice_;
+    std::vector<RegistroClinico> crudo_;
+    std::vector<uint8_t> comprimido_;
+    long long bloque_actual_ = -1;
+    long long bloques_leidos_ = 0;
+};
+
+} // namespace segmento
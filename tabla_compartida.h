@@ -0,0 +1,601 @@
+// tabla_compartida.h
+// Tabla hash viva compartida entre procesos (la GUI, gestor_dni y las
+// herramientas de consulta se adjuntan a la misma en vez de cargar cada uno
+// tabla_hash.dat):
+// - Las entradas, la geometría y el contador de registros viven en un segmento
+//   POSIX (shm_open) cuyo nombre sale de la ruta canónica de tabla_hash.dat. El
+//   primero que se adjunta aplica el diario (registros_wal.h) y carga la tabla
+//   del disco; los siguientes la encuentran lista. Las entradas y la época del
+//   seqlock son las de tabla_concurrente.h: cualquier proceso busca sin locks.
+// - Sincronización con locks OFD (fcntl) sobre `<tabla canónica>.lock`, que el núcleo
+//   suelta si el proceso muere:
+//   byte 0, presencia: compartido mientras el proceso está adjunto. Las
+//   herramientas que reescriben los archivos (Limpieza, rehash_tabla, la carga,
+//   insercion_lote) lo piden exclusivo con `Exclusivo` y fallan si hay alguien.
+//   byte 1, rol de escritor: un solo proceso por vez modifica registros.dat y la
+//   tabla. Sus hilos lo comparten (`entrar`/`salir`); se toma al escribir y se
+//   suelta con `soltar` (gestor_dni, al terminar cada operación) o con `ceder`
+//   si otro proceso lo espera (la GUI, tras el checkpoint del diario).
+// - Al tomar el rol se revisa lo que pudo dejar un escritor muerto: si la época
+//   quedó impar (a mitad de un cambio) o el diario tiene transacciones (un
+//   proceso vivo lo vacía antes de soltar el rol), la tabla se reconstruye del
+//   disco con el diario aplicado.
+// - La capacidad de entradas se fija al crear el segmento (x8 las actuales; el
+//   tmpfs asigna las páginas al tocarlas). Agotada, la tabla deja de dividir
+//   buckets hasta que una herramienta exclusiva la reconstruya.
+// - El segmento sobrevive a los procesos pero no a un reinicio: el siguiente que
+//   se adjunta lo crea de nuevo desde el disco.
+#pragma once
+#include "common.h"
+#include "registros_wal.h"
+#include "tabla_concurrente.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tabla_compartida {
+
+static const char SEGMENTO_MAGIC[8] = {'P', 'P', 'S', 'H', 'M', '0', '0', '1'};
+static const long long CAPACIDAD_MINIMA = 1LL << 22; // entradas reservadas como mínimo
+static const int32_t ESTADO_INICIANDO = 0;
+static const int32_t ESTADO_LISTO = 1;
+static const int BYTE_PRESENCIA = 0;
+static const int BYTE_ESCRITOR = 1;
+static const unsigned VUELTAS_REPARAR = 1u << 16; // esperas de un lector antes de revisar si el escritor murió
+
+// Cabecera del segmento; las entradas van a continuación. El segmento nace en
+// cero, que es un estado válido de todos los atómicos.
+struct Cabecera {
+    char magic[8];
+    std::atomic<int32_t> estado;
+    int32_t layout;
+    int32_t carga_max;
+    std::atomic<int32_t> duenio;          // pid con el rol de escritor (0: nadie)
+    std::atomic<int32_t> ultimo_escritor; // pid del último que tomó el rol
+    std::atomic<int32_t> esperando;       // procesos esperando el rol
+    long long capacidad;                  // entradas reservadas
+    std::atomic<unsigned long long> turno;      // +1 cada vez que el rol pasa a otro proceso
+    std::atomic<unsigned long long> generacion; // +1 cada vez que se reemplaza registros.dat
+    std::atomic<long long> tam_registros;       // bytes escritos de registros.dat
+    std::atomic<long long> num_registros;
+    std::atomic<unsigned long long> id_registros; // dispositivo e inodo de registros.dat
+    alignas(64) std::atomic<long long> num_buckets;
+    std::atomic<long long> buckets_base;
+    alignas(64) tabla_concurrente::Epoca epoca;
+};
+
+inline size_t tamCabecera() { return (sizeof(Cabecera) + 63) / 64 * 64; }
+inline size_t tamSegmento(long long capacidad)
+{
+    return tamCabecera() + (size_t)capacidad * sizeof(tabla_concurrente::Entrada);
+}
+
+// Ruta canónica de la tabla: la misma para todas las rutas que llegan al
+// archivo (relativas, con `..` o por un enlace simbólico)
+inline std::string rutaCanonica(const std::string &ruta_tabla)
+{
+    std::error_code ec;
+    std::string canonica = std::filesystem::weakly_canonical(ruta_tabla, ec).string();
+    return ec ? ruta_tabla : canonica;
+}
+
+// Archivo de bloqueos junto a la tabla canónica, como el nombre del segmento:
+// dos procesos que la abren por rutas distintas se bloquean sobre el mismo
+inline std::string rutaBloqueo(const std::string &ruta_tabla) { return rutaCanonica(ruta_tabla) + ".lock"; }
+
+// Nombre POSIX del segmento: el mismo para todas las rutas que llegan al archivo
+inline std::string nombreSegmento(const std::string &ruta_tabla)
+{
+    std::string canonica = rutaCanonica(ruta_tabla);
+    char nombre[48];
+    std::snprintf(nombre, sizeof(nombre), "/pp_tabla_%016llx",
+                  (unsigned long long)wal::suma(canonica.data(), canonica.size()));
+    return nombre;
+}
+
+// Lock OFD sobre un byte del archivo de bloqueo (F_RDLCK, F_WRLCK o F_UNLCK). Es
+// del descriptor y no del proceso: el núcleo lo suelta al cerrarlo o al morir.
+inline bool bloquear(int fd, int byte, short tipo, bool esperar)
+{
+    struct flock fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.l_type = tipo;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = byte;
+    fl.l_len = 1;
+    while (::fcntl(fd, esperar ? F_OFD_SETLKW : F_OFD_SETLK, &fl) != 0)
+        if (errno != EINTR) return false;
+    return true;
+}
+
+// Identidad del archivo (dispositivo e inodo): cambia si alguien lo reemplazó
+inline unsigned long long idArchivo(const std::string &ruta)
+{
+    struct stat st;
+    if (::stat(ruta.c_str(), &st) != 0) return 0;
+    return ((unsigned long long)st.st_dev << 40) ^ (unsigned long long)st.st_ino;
+}
+
+class Segmento {
+public:
+    Segmento() = default;
+    Segmento(const Segmento &) = delete;
+    Segmento &operator=(const Segmento &) = delete;
+    ~Segmento() { cerrar(); }
+
+    // Se adjunta al segmento de `ruta_tabla` (lo crea desde el disco si no
+    // existe). Los archivos ya deben existir.
+    bool adjuntar(const std::string &ruta_registros, const std::string &ruta_tabla, std::string *error = nullptr)
+    {
+        cerrar();
+        ruta_registros_ = ruta_registros;
+        ruta_tabla_ = ruta_tabla;
+        nombre_ = nombreSegmento(ruta_tabla);
+        auto fallar = [&](const std::string &msg) {
+            if (error) *error = msg;
+            cerrar();
+            return false;
+        };
+        fd_ = ::open(rutaBloqueo(ruta_tabla).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0) return fallar("no se pudo abrir " + rutaBloqueo(ruta_tabla));
+        if (!bloquear(fd_, BYTE_PRESENCIA, F_RDLCK, false))
+            return fallar("la tabla está en uso exclusivo (Limpieza, rehash_tabla o una carga)");
+        shm_ = ::shm_open(nombre_.c_str(), O_RDWR | O_CREAT, 0600);
+        if (shm_ < 0) return fallar("no se pudo abrir el segmento " + nombre_);
+
+        // Con el rol libre se crea o se repara; si lo tiene otro proceso el
+        // segmento ya está listo, salvo que lo esté creando: se espera
+        bool con_rol = bloquear(fd_, BYTE_ESCRITOR, F_WRLCK, false);
+        if (!con_rol && (!mapear_() || cab_->estado.load(std::memory_order_acquire) != ESTADO_LISTO)) {
+            desmapear_();
+            con_rol = bloquear(fd_, BYTE_ESCRITOR, F_WRLCK, true);
+            if (!con_rol) return fallar("no se pudo tomar " + rutaBloqueo(ruta_tabla));
+        }
+        if (con_rol) {
+            bool ok = (cab_ || mapear_()) ? revisar_() : inicializar_();
+            bloquear(fd_, BYTE_ESCRITOR, F_UNLCK, false);
+            if (!ok) return fallar("no se pudo cargar " + ruta_tabla + " en el segmento " + nombre_);
+        }
+        return true;
+    }
+
+    void cerrar()
+    {
+        if (rol_ && cab_) cab_->duenio.store(0, std::memory_order_release);
+        rol_ = false;
+        retomado_ = false;
+        usuarios_ = 0;
+        desmapear_();
+        if (shm_ >= 0) ::close(shm_);
+        if (fd_ >= 0) ::close(fd_); // suelta los locks
+        shm_ = fd_ = -1;
+    }
+
+    bool adjunto() const { return cab_ != nullptr; }
+    const std::string &nombre() const { return nombre_; }
+
+    // ---- Lectura sin locks (como tabla_concurrente::Vista)
+
+    long long numBuckets() const { return cab_->num_buckets.load(std::memory_order_acquire); }
+    long long base() const { return cab_->buckets_base.load(std::memory_order_acquire); }
+    long long numRegistros() const { return cab_->num_registros.load(std::memory_order_acquire); }
+    long long capacidad() const { return capacidad_; }
+    int32_t layout() const { return cab_->layout; }
+    int32_t cargaMax() const { return cab_->carga_max; }
+    int bucket(int dni) const { return tabla_hash::bucket(numBuckets(), base(), dni); }
+
+    // Entrada de `pos` (vacía si está fuera de la tabla)
+    HashExtent leer(int pos) const
+    {
+        if (pos < 0 || pos >= std::min(capacidad_, numBuckets())) return tabla_hash::entradaVacia();
+        return entradas_[pos].leer();
+    }
+
+    // Época par a validar después de leer. Si un escritor de otro proceso murió
+    // a mitad de un cambio, el lector termina reparando la tabla.
+    unsigned long long empezarLectura()
+    {
+        for (unsigned vueltas = 1;; ++vueltas) {
+            unsigned long long e = cab_->epoca.valor();
+            if (!(e & 1)) return e;
+            std::this_thread::yield();
+            if (vueltas % VUELTAS_REPARAR == 0) repararSiAbandonada();
+        }
+    }
+    bool validar(unsigned long long epoca) const { return cab_->epoca.validar(epoca); }
+
+    HashExtent entradaDe(int dni, unsigned long long &epoca, int *pos = nullptr)
+    {
+        while (true) {
+            epoca = empezarLectura();
+            int b = bucket(dni);
+            HashExtent e = leer(b);
+            if (validar(epoca)) {
+                if (pos) *pos = b;
+                return e;
+            }
+        }
+    }
+
+    // Copia coherente de la tabla (checkpoint, compactación, herramientas)
+    void copiar(tabla_hash::Tabla &t)
+    {
+        while (true) {
+            unsigned long long epoca = empezarLectura();
+            long long nb = std::min(capacidad_, numBuckets());
+            t.layout = layout();
+            t.carga_max = cargaMax();
+            t.buckets_base = base();
+            t.num_registros = numRegistros();
+            t.entradas.resize((size_t)nb);
+            for (long long i = 0; i < nb; ++i) t.entradas[(size_t)i] = entradas_[i].leer();
+            if (validar(epoca)) return;
+        }
+    }
+
+    // Bytes de registros.dat que ya escribió algún proceso
+    long long tamRegistros() const { return cab_->tam_registros.load(std::memory_order_acquire); }
+    // Cambia cuando se reemplaza registros.dat: hay que reabrirlo
+    unsigned long long generacion() const { return cab_->generacion.load(std::memory_order_acquire); }
+    // Cambia cuando el rol pasa a otro proceso; `duenio` es quien lo tiene ahora
+    unsigned long long turno() const { return cab_->turno.load(std::memory_order_acquire); }
+    int32_t duenio() const { return cab_->duenio.load(std::memory_order_acquire); }
+
+    // ---- Escritura (con el rol tomado)
+
+    void empezarCambio() { cab_->epoca.empezarCambio(); }
+    void terminarCambio() { cab_->epoca.terminarCambio(); }
+
+    // Cabeza nueva de `pos` tras anteponer un registro (el tramo sigue valiendo)
+    void escribirCabeza(int pos, long long cabeza) { entradas_[pos].head.store(cabeza, std::memory_order_release); }
+    // Entrada completa de `pos` (dentro de un cambio: la cadena se reenlazó)
+    void escribirEntrada(int pos, const HashExtent &e) { entradas_[pos].escribir(e); }
+
+    void sumarRegistros(long long delta)
+    {
+        long long n = cab_->num_registros.load(std::memory_order_relaxed);
+        while (!cab_->num_registros.compare_exchange_weak(n, std::max(0LL, n + delta), std::memory_order_release)) {}
+    }
+
+    // Tabla completa (dentro de un cambio): false si supera la capacidad
+    bool publicar(const tabla_hash::Tabla &t)
+    {
+        const long long n = (long long)t.entradas.size();
+        if (n > capacidad_) return false;
+        for (long long i = 0; i < n; ++i) entradas_[i].escribir(t.entradas[(size_t)i]);
+        cab_->num_registros.store(t.num_registros, std::memory_order_release);
+        cab_->buckets_base.store(t.buckets_base, std::memory_order_release);
+        cab_->num_buckets.store(n, std::memory_order_release);
+        return true;
+    }
+
+    // Nuevo final de registros.dat tras escribir hasta `fin`
+    void publicarTamRegistros(long long fin)
+    {
+        long long actual = cab_->tam_registros.load(std::memory_order_relaxed);
+        while (actual < fin &&
+               !cab_->tam_registros.compare_exchange_weak(actual, fin, std::memory_order_release)) {}
+    }
+    // registros.dat se reemplazó (compactación): los demás lo reabren
+    void reemplazarRegistros(long long tam)
+    {
+        cab_->id_registros.store(idArchivo(ruta_registros_), std::memory_order_release);
+        cab_->tam_registros.store(tam, std::memory_order_release);
+        cab_->generacion.fetch_add(1, std::memory_order_release);
+    }
+
+    // Acceso de tabla_hash::dividir y crecer (ver tabla_compartida::crecer)
+    HashExtent entrada(int pos) const { return leer(pos); }
+    void fijar(int pos, const HashExtent &e) { escribirEntrada(pos, e); }
+    bool agregar(const HashExtent &e)
+    {
+        const long long nb = numBuckets(), b = base();
+        if (nb >= capacidad_) return false;
+        entradas_[nb].escribir(e);
+        if (nb + 1 == 2 * b) cab_->buckets_base.store(2 * b, std::memory_order_release);
+        cab_->num_buckets.store(nb + 1, std::memory_order_release);
+        return true;
+    }
+    bool debeDividir() const
+    {
+        return numBuckets() < capacidad_ && tabla_hash::debeDividir(numBuckets(), numRegistros(), cargaMax());
+    }
+    bool conCabecera() const
+    {
+        return tabla_hash::esV2(layout()) || cargaMax() > 0 || numBuckets() != TABLE_SIZE;
+    }
+    TablaCabecera cabecera() const
+    {
+        TablaCabecera cab;
+        std::memset(&cab, 0, sizeof(cab));
+        std::memcpy(cab.magic, TABLA_MAGIC, sizeof(TABLA_MAGIC));
+        cab.version = TABLA_VERSION;
+        cab.layout = layout();
+        cab.num_buckets = numBuckets();
+        cab.buckets_base = base();
+        cab.num_registros = numRegistros();
+        cab.carga_max = cargaMax();
+        return cab;
+    }
+
+    // ---- Rol de escritor
+
+    // Toma el rol para el hilo que llama (los hilos del proceso lo comparten).
+    // La primera vez, o si desde la última vez escribió otro proceso, llama a
+    // `al_volver` antes de que entre otro hilo: ahí se refresca lo que el proceso
+    // tenga en memoria y se abre lo que solo puede tocar el escritor (el diario).
+    // Va antes que cualquier otro lock del proceso.
+    template <typename F>
+    void entrar(F al_volver)
+    {
+        std::lock_guard<std::mutex> lk(rol_m_);
+        if (usuarios_++ > 0 || rol_) return;
+        bool otro = tomar_();
+        rol_ = true;
+        if (otro || !retomado_) al_volver();
+        retomado_ = true;
+    }
+    void entrar()
+    {
+        entrar([] {});
+    }
+    void salir()
+    {
+        std::lock_guard<std::mutex> lk(rol_m_);
+        --usuarios_;
+    }
+
+    // Suelta el rol si ningún hilo lo usa; antes llama a `antes` (el checkpoint
+    // que deja el disco al día). Devuelve true si el proceso quedó sin el rol.
+    template <typename F>
+    bool soltar(F antes)
+    {
+        std::lock_guard<std::mutex> lk(rol_m_);
+        if (!rol_) return true;
+        if (usuarios_ > 0) return false;
+        antes();
+        cab_->duenio.store(0, std::memory_order_release);
+        bloquear(fd_, BYTE_ESCRITOR, F_UNLCK, false);
+        rol_ = false;
+        return true;
+    }
+    bool soltar()
+    {
+        return soltar([] {});
+    }
+    // Como soltar, pero solo si otro proceso espera el rol
+    template <typename F>
+    bool ceder(F antes)
+    {
+        if (cab_->esperando.load(std::memory_order_acquire) == 0) return !rol_;
+        return soltar(antes);
+    }
+
+    // Si el rol está libre y la tabla quedó a mitad de un cambio, la reconstruye
+    void repararSiAbandonada()
+    {
+        std::unique_lock<std::mutex> lk(rol_m_, std::try_to_lock);
+        if (!lk.owns_lock() || rol_ || !bloquear(fd_, BYTE_ESCRITOR, F_WRLCK, false)) return;
+        if (cab_->epoca.enCambio()) {
+            if (!revisar_()) std::cerr << "tabla_compartida: no se pudo reconstruir " << ruta_tabla_ << "\n";
+            cab_->turno.fetch_add(1, std::memory_order_release);
+        }
+        bloquear(fd_, BYTE_ESCRITOR, F_UNLCK, false);
+    }
+
+private:
+    bool mapear_()
+    {
+        struct stat st;
+        if (::fstat(shm_, &st) != 0 || (size_t)st.st_size < tamSegmento(0)) return false;
+        void *p = ::mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_, 0);
+        if (p == MAP_FAILED) return false;
+        mapa_ = p;
+        tam_mapa_ = (size_t)st.st_size;
+        cab_ = static_cast<Cabecera *>(p);
+        entradas_ = reinterpret_cast<tabla_concurrente::Entrada *>(static_cast<char *>(p) + tamCabecera());
+        capacidad_ = (long long)((tam_mapa_ - tamCabecera()) / sizeof(tabla_concurrente::Entrada));
+        return true;
+    }
+    void desmapear_()
+    {
+        if (mapa_) ::munmap(mapa_, tam_mapa_);
+        mapa_ = nullptr;
+        tam_mapa_ = 0;
+        cab_ = nullptr;
+        entradas_ = nullptr;
+        capacidad_ = 0;
+    }
+
+    // Crea el contenido desde el disco (con el rol, sin lectores: estado INICIANDO)
+    bool inicializar_()
+    {
+        tabla_hash::Tabla t;
+        if (wal::recuperar(ruta_registros_, ruta_tabla_) < 0 || !tabla_hash::cargar(ruta_tabla_, t)) return false;
+        const long long capacidad = std::max(CAPACIDAD_MINIMA, 8 * (long long)t.entradas.size());
+        struct stat st;
+        if (::fstat(shm_, &st) != 0) return false;
+        if ((size_t)st.st_size < tamSegmento(capacidad)) {
+            desmapear_();
+            if (::ftruncate(shm_, (off_t)tamSegmento(capacidad)) != 0) return false;
+        }
+        if (!cab_ && !mapear_()) return false;
+        cab_->estado.store(ESTADO_INICIANDO, std::memory_order_release);
+        std::memcpy(cab_->magic, SEGMENTO_MAGIC, sizeof(SEGMENTO_MAGIC));
+        cab_->layout = t.layout;
+        cab_->carga_max = t.carga_max;
+        cab_->capacidad = capacidad_;
+        if (!publicar(t)) return false;
+        cab_->tam_registros.store(std::max(0LL, tamArchivo(ruta_registros_)), std::memory_order_release);
+        cab_->id_registros.store(idArchivo(ruta_registros_), std::memory_order_release);
+        if (cab_->epoca.enCambio()) cab_->epoca.terminarCambio();
+        cab_->estado.store(ESTADO_LISTO, std::memory_order_release);
+        return true;
+    }
+
+    // Lo que pudo dejar el escritor anterior (con el rol)
+    bool revisar_()
+    {
+        if (cab_->estado.load(std::memory_order_acquire) != ESTADO_LISTO ||
+            std::memcmp(cab_->magic, SEGMENTO_MAGIC, sizeof(SEGMENTO_MAGIC)) != 0)
+            return inicializar_();
+        if (!cab_->epoca.enCambio() && !wal::pendiente(ruta_registros_) && !wal::reemplazoPendiente(ruta_registros_) &&
+            cab_->id_registros.load(std::memory_order_acquire) == idArchivo(ruta_registros_))
+            return true;
+        // Murió a mitad de un cambio, sin checkpoint o con un reemplazo de
+        // archivos a medias, o los archivos se reemplazaron sin pasar por
+        // Exclusivo: lo válido es el disco con el diario aplicado (los lectores
+        // esperan mientras tanto)
+        if (!cab_->epoca.enCambio()) cab_->epoca.empezarCambio();
+        tabla_hash::Tabla t;
+        if (wal::recuperar(ruta_registros_, ruta_tabla_) < 0 || !tabla_hash::cargar(ruta_tabla_, t)) return false;
+        cab_->layout = t.layout;
+        cab_->carga_max = t.carga_max;
+        if (!publicar(t)) return false;
+        cab_->tam_registros.store(std::max(0LL, tamArchivo(ruta_registros_)), std::memory_order_release);
+        cab_->id_registros.store(idArchivo(ruta_registros_), std::memory_order_release);
+        cab_->epoca.terminarCambio();
+        return true;
+    }
+
+    // Toma el lock del rol; true si antes lo tuvo otro proceso
+    bool tomar_()
+    {
+        if (!bloquear(fd_, BYTE_ESCRITOR, F_WRLCK, false)) {
+            cab_->esperando.fetch_add(1, std::memory_order_acq_rel);
+            bloquear(fd_, BYTE_ESCRITOR, F_WRLCK, true);
+            cab_->esperando.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        if (!revisar_()) std::cerr << "tabla_compartida: no se pudo reconstruir " << ruta_tabla_ << "\n";
+        const int32_t yo = (int32_t)::getpid();
+        const bool otro = cab_->ultimo_escritor.load(std::memory_order_acquire) != yo;
+        if (otro) {
+            cab_->ultimo_escritor.store(yo, std::memory_order_release);
+            cab_->turno.fetch_add(1, std::memory_order_release);
+        }
+        cab_->duenio.store(yo, std::memory_order_release);
+        return otro;
+    }
+
+    std::string ruta_registros_, ruta_tabla_, nombre_;
+    int fd_ = -1;  // archivo de bloqueo
+    int shm_ = -1; // segmento
+    void *mapa_ = nullptr;
+    size_t tam_mapa_ = 0;
+    Cabecera *cab_ = nullptr;
+    tabla_concurrente::Entrada *entradas_ = nullptr;
+    long long capacidad_ = 0;
+    std::mutex rol_m_;
+    int usuarios_ = 0; // hilos dentro de entrar/salir
+    bool rol_ = false; // el proceso tiene el lock del rol
+    bool retomado_ = false; // ya llamó a al_volver alguna vez
+};
+
+// Rol de escritor mientras dura el alcance
+class Escritura {
+public:
+    explicit Escritura(Segmento &s) : s_(s) { s_.entrar(); }
+    template <typename F>
+    Escritura(Segmento &s, F al_volver) : s_(s)
+    {
+        s_.entrar(al_volver);
+    }
+    ~Escritura() { s_.salir(); }
+    Escritura(const Escritura &) = delete;
+    Escritura &operator=(const Escritura &) = delete;
+
+private:
+    Segmento &s_;
+};
+
+// Divide buckets del segmento como tabla_hash::crecer, dentro de un cambio de estructura
+inline int crecer(Segmento &s, std::fstream &registros, std::fstream &tabla)
+{
+    if (!s.debeDividir()) return 0;
+    s.empezarCambio();
+    int hechas = tabla_hash::crecer(s, registros, tabla);
+    s.terminarCambio();
+    return hechas;
+}
+
+// Persiste la entrada `pos` del segmento en tabla_hash.dat (quien escribe sin diario)
+inline bool escribirEntrada(std::ostream &out, const Segmento &s, int pos)
+{
+    return tabla_hash::escribirEntrada(out, s.conCabecera(), pos, s.leer(pos));
+}
+
+// Persiste la cabecera (tamaño y contador). No-op en formato legado.
+inline bool escribirCabecera(std::ostream &out, const Segmento &s)
+{
+    if (!s.conCabecera()) return true;
+    TablaCabecera cab = s.cabecera();
+    out.seekp(0, std::ios::beg);
+    out.write(reinterpret_cast<const char *>(&cab), sizeof(cab));
+    return (bool)out;
+}
+
+// true si hay un segmento creado para `ruta_tabla`
+inline bool existe(const std::string &ruta_tabla)
+{
+    int fd = ::shm_open(nombreSegmento(ruta_tabla).c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    ::close(fd);
+    return true;
+}
+
+// Tabla vigente para las herramientas de consulta: la del segmento si existe
+// (incluye lo que la GUI todavía no llevó a tabla_hash.dat), si no la del disco
+inline bool cargarVigente(const std::string &ruta_registros, const std::string &ruta_tabla, tabla_hash::Tabla &t)
+{
+    if (existe(ruta_tabla)) {
+        Segmento s;
+        if (s.adjuntar(ruta_registros, ruta_tabla)) {
+            s.copiar(t);
+            return true;
+        }
+    }
+    return tabla_hash::cargar(ruta_tabla, t);
+}
+
+// Acceso exclusivo a los archivos para las herramientas que los reescriben:
+// falla si hay procesos adjuntos y, mientras dura, nadie se adjunta. Borra el
+// segmento: el próximo que se adjunte lo crea de nuevo desde el disco.
+class Exclusivo {
+public:
+    explicit Exclusivo(const std::string &ruta_tabla)
+    {
+        fd_ = ::open(rutaBloqueo(ruta_tabla).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0 || !bloquear(fd_, BYTE_PRESENCIA, F_WRLCK, false)) return;
+        ::shm_unlink(nombreSegmento(ruta_tabla).c_str());
+        ok_ = true;
+    }
+    ~Exclusivo()
+    {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    Exclusivo(const Exclusivo &) = delete;
+    Exclusivo &operator=(const Exclusivo &) = delete;
+
+    explicit operator bool() const { return ok_; }
+
+private:
+    int fd_ = -1;
+    bool ok_ = false;
+};
+
+} // namespace tabla_compartida
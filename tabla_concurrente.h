@@ -0,0 +1,159 @@
+// tabla_concurrente.h
+// Vista de las cabezas de la tabla hash para leerlas sin locks (la GUI la
+// consulta en cada búsqueda desde varios hilos):
+// - Cada entrada (cabeza y tramo agrupado) y la geometría son atómicas: el
+//   escritor publica una cabeza nueva con store(release) después de escribir el
+//   registro al que apunta, y el lector la lee con load(acquire).
+// - Los cambios de estructura (división de buckets, eliminaciones que reenlazan
+//   una cadena, compactación) van entre `empezarCambio` y `terminarCambio`, que
+//   dejan la época impar mientras duran (seqlock): el lector anota la época
+//   antes de leer y, si cambió al terminar de recorrer la cadena, repite.
+//   Anteponer un registro a una cadena no es un cambio de estructura.
+// - El arreglo se reserva con capacidad de sobra; si una división la supera se
+//   copia a uno nuevo y se publica el puntero. El viejo no se libera hasta
+//   destruir la vista porque un lector puede seguir usándolo (como los mapeos
+//   de registros_mmap.h); crece al doble, así lo retenido no supera lo vigente.
+// Los escritores se ordenan entre sí con sus propios locks: la vista solo
+// refleja lo que ya escribieron en su tabla_hash::Tabla. `Entrada` y `Epoca`
+// no tienen punteros: la tabla compartida entre procesos (tabla_compartida.h)
+// las usa igual dentro de memoria compartida.
+#pragma once
+#include "common.h"
+#include "tabla_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace tabla_concurrente {
+
+static_assert(std::atomic<long long>::is_always_lock_free, "las entradas deben ser atómicas sin locks");
+
+// Cabeza y tramo de un bucket: el escritor guarda la cabeza al final
+// (release), así quien la lee (acquire) ve también el tramo
+struct Entrada {
+    std::atomic<long long> head{NULL_OFFSET};
+    std::atomic<long long> ext_offset{NULL_OFFSET};
+    std::atomic<long long> ext_count{0};
+
+    HashExtent leer() const {
+        return HashExtent{head.load(std::memory_order_acquire), ext_offset.load(std::memory_order_acquire),
+                          ext_count.load(std::memory_order_acquire)};
+    }
+    void escribir(const HashExtent &e) {
+        ext_offset.store(e.ext_offset, std::memory_order_relaxed);
+        ext_count.store(e.ext_count, std::memory_order_relaxed);
+        head.store(e.head_offset, std::memory_order_release);
+    }
+};
+
+// Época del seqlock: impar mientras dura un cambio de estructura
+class Epoca {
+public:
+    void empezarCambio() {
+        valor_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void terminarCambio() { valor_.fetch_add(1, std::memory_order_release); }
+    bool enCambio() const { return valor_.load(std::memory_order_acquire) & 1; }
+
+    unsigned long long valor() const { return valor_.load(std::memory_order_acquire); }
+
+    // Época par (sin cambio en curso) a validar después de leer
+    unsigned long long empezarLectura() const {
+        unsigned long long e;
+        while ((e = valor()) & 1) std::this_thread::yield();
+        return e;
+    }
+    // true si entre empezarLectura y ahora no hubo cambios de estructura
+    bool validar(unsigned long long epoca) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return valor_.load(std::memory_order_relaxed) == epoca;
+    }
+
+private:
+    std::atomic<unsigned long long> valor_{0};
+};
+
+class Vista {
+public:
+    Vista() = default;
+    Vista(const Vista &) = delete;
+    Vista &operator=(const Vista &) = delete;
+
+    // Copia completa de `t`: al abrir y, dentro de un cambio, tras dividir
+    // buckets o reemplazar la tabla
+    void publicar(const tabla_hash::Tabla &t) {
+        const long long n = (long long)t.entradas.size();
+        Arreglo *a = actual_.load(std::memory_order_relaxed);
+        if (!a || a->capacidad < n) {
+            auto nuevo = std::make_unique<Arreglo>(std::max(n * 2, (long long)TABLE_SIZE));
+            a = nuevo.get();
+            arreglos_.push_back(std::move(nuevo));
+        }
+        for (long long i = 0; i < n; ++i) a->e[(size_t)i].escribir(t.entradas[(size_t)i]);
+        actual_.store(a, std::memory_order_release);
+        // la geometría después del arreglo: quien ve la nueva ve también sus entradas
+        buckets_base_.store(t.buckets_base, std::memory_order_release);
+        num_buckets_.store(n, std::memory_order_release);
+    }
+
+    // Cabeza nueva de `pos` tras anteponer un registro (el tramo sigue valiendo)
+    void escribirCabeza(int pos, long long cabeza) {
+        actual_.load(std::memory_order_relaxed)->e[(size_t)pos].head.store(cabeza, std::memory_order_release);
+    }
+
+    // Entrada completa de `pos` (dentro de un cambio: la cadena se reenlazó)
+    void escribirEntrada(int pos, const HashExtent &e) {
+        actual_.load(std::memory_order_relaxed)->e[(size_t)pos].escribir(e);
+    }
+
+    void empezarCambio() { epoca_.empezarCambio(); }
+    void terminarCambio() { epoca_.terminarCambio(); }
+    unsigned long long empezarLectura() const { return epoca_.empezarLectura(); }
+    bool validar(unsigned long long epoca) const { return epoca_.validar(epoca); }
+
+    long long numBuckets() const { return num_buckets_.load(std::memory_order_acquire); }
+    int bucket(int dni) const {
+        return tabla_hash::bucket(num_buckets_.load(std::memory_order_acquire),
+                                  buckets_base_.load(std::memory_order_acquire), dni);
+    }
+
+    // Entrada de `pos` (vacía si está fuera de la tabla publicada)
+    HashExtent leer(int pos) const {
+        const Arreglo *a = actual_.load(std::memory_order_acquire);
+        if (!a || pos < 0 || pos >= std::min(a->capacidad, numBuckets())) return tabla_hash::entradaVacia();
+        return a->e[(size_t)pos].leer();
+    }
+
+    // Bucket y entrada de `dni` sin un cambio de estructura en el medio;
+    // `epoca` valida después el recorrido de la cadena
+    HashExtent entradaDe(int dni, unsigned long long &epoca, int *pos = nullptr) const {
+        while (true) {
+            epoca = empezarLectura();
+            int b = bucket(dni);
+            HashExtent e = leer(b);
+            if (validar(epoca)) {
+                if (pos) *pos = b;
+                return e;
+            }
+        }
+    }
+
+private:
+    struct Arreglo {
+        explicit Arreglo(long long n) : capacidad(n), e(new Entrada[(size_t)n]) {}
+        long long capacidad;
+        std::unique_ptr<Entrada[]> e;
+    };
+
+    std::atomic<Arreglo *> actual_{nullptr};
+    std::vector<std::unique_ptr<Arreglo>> arreglos_; // actual + retirados (solo el escritor)
+    alignas(64) std::atomic<long long> num_buckets_{0};
+    std::atomic<long long> buckets_base_{TABLE_SIZE};
+    alignas(64) Epoca epoca_;
+};
+
+} // namespace tabla_concurrente
@@ -0,0 +1,367 @@
+// tabla_hash.h
+// Lectura/escritura de `tabla_hash.dat` en sus formatos y recorrido de los
+// registros de un bucket:
+// - legado: TABLE_SIZE HashEntry (solo la cabeza de cada cadena), sin cabecera.
+// - v2: TablaCabecera + TABLE_SIZE HashExtent. Con layout agrupado cada bucket
+//   indica además el tramo contiguo (offset, count) que ocupan sus registros,
+//   así una búsqueda lo lee con una sola lectura secuencial.
+// - v3: igual que v2 pero con cantidad de buckets variable. La tabla crece por
+//   hashing lineal: cuando num_registros supera carga_max * num_buckets se
+//   divide el bucket apuntado por el puntero de división (num_buckets - base)
+//   y sus registros se reparten entre él y el bucket nuevo, reenlazando solo
+//   `pos_siguiente` en registros.dat (los offsets no cambian).
+// Solo una tabla fija con layout de cadenas se guarda en formato legado.
+#pragma once
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace tabla_hash {
+
+struct Tabla {
+    int32_t layout = LAYOUT_CADENAS;
+    std::vector<HashExtent> entradas;
+    long long buckets_base = TABLE_SIZE; // nivel del hashing lineal
+    long long num_registros = 0;         // registros enlazados (para el factor de carga)
+    int32_t carga_max = 0;               // 0: tabla fija, no se divide
+};
+
+// Geometría de la tabla: lo único que hace falta para ubicar un DNI (los
+// procesos que no cargan la tabla completa, como los ranks del loader)
+struct Geometria {
+    long long num_buckets = TABLE_SIZE;
+    long long buckets_base = TABLE_SIZE;
+};
+
+inline HashExtent entradaVacia() { return HashExtent{NULL_OFFSET, NULL_OFFSET, 0}; }
+
+inline Tabla tablaVacia(int32_t layout = LAYOUT_CADENAS, long long num_buckets = TABLE_SIZE, int32_t carga_max = 0)
+{
+    Tabla t;
+    t.layout = layout;
+    t.entradas.assign((size_t)num_buckets, entradaVacia());
+    t.buckets_base = num_buckets;
+    t.carga_max = carga_max;
+    return t;
+}
+
+inline Geometria geometria(const Tabla &t) { return Geometria{(long long)t.entradas.size(), t.buckets_base}; }
+
+// Bucket de un DNI (hashing lineal). Con num_buckets == base es el `dni & (N-1)`
+// de siempre; los buckets por debajo del puntero de división ya se dividieron
+// y usan un bit más del hash.
+inline int bucket(long long num_buckets, long long buckets_base, int dni)
+{
+    unsigned long long h = (uint32_t)dni;
+    unsigned long long b = h & (unsigned long long)(buckets_base - 1);
+    if ((long long)b < num_buckets - buckets_base) b = h & (unsigned long long)(2 * buckets_base - 1);
+    return (int)b;
+}
+inline int bucket(const Geometria &g, int dni) { return bucket(g.num_buckets, g.buckets_base, dni); }
+inline int bucket(const Tabla &t, int dni) { return bucket((long long)t.entradas.size(), t.buckets_base, dni); }
+
+// Potencia de 2 (>= TABLE_SIZE) que deja `registros` con carga <= carga_max
+inline long long bucketsPara(long long registros, int32_t carga_max)
+{
+    long long nb = TABLE_SIZE;
+    if (carga_max <= 0) return nb;
+    while (nb < (1LL << 30) && registros > (long long)carga_max * nb) nb <<= 1;
+    return nb;
+}
+
+inline bool esV2(int32_t layout) { return layout != LAYOUT_CADENAS; }
+// Una tabla lleva cabecera si está agrupada o si su tamaño no es el legado
+inline bool esV2(const Tabla &t)
+{
+    return esV2(t.layout) || t.carga_max > 0 || t.entradas.size() != (size_t)TABLE_SIZE;
+}
+
+// Offset en el archivo de la entrada `pos` (la cabeza siempre está en sus primeros 8 bytes)
+inline long long offsetEntrada(bool con_cabecera, int pos)
+{
+    if (!con_cabecera) return (long long)pos * (long long)sizeof(HashEntry);
+    return (long long)sizeof(TablaCabecera) + (long long)pos * (long long)sizeof(HashExtent);
+}
+inline long long offsetEntrada(const Tabla &t, int pos) { return offsetEntrada(esV2(t), pos); }
+
+inline TablaCabecera cabecera(const Tabla &t)
+{
+    TablaCabecera cab;
+    std::memset(&cab, 0, sizeof(cab));
+    std::memcpy(cab.magic, TABLA_MAGIC, sizeof(TABLA_MAGIC));
+    cab.version = TABLA_VERSION;
+    cab.layout = t.layout;
+    cab.num_buckets = (int64_t)t.entradas.size();
+    cab.buckets_base = t.buckets_base;
+    cab.num_registros = t.num_registros;
+    cab.carga_max = t.carga_max;
+    return cab;
+}
+
+// Carga la tabla detectando el formato. Si el archivo es corto, las entradas
+// faltantes quedan vacías (comportamiento heredado de los loaders).
+inline bool cargar(const std::string &ruta, Tabla &t)
+{
+    t = tablaVacia();
+    std::ifstream in(ruta, std::ios::binary);
+    if (!in.is_open()) return false;
+    TablaCabecera cab;
+    std::memset(&cab, 0, sizeof(cab));
+    in.read(reinterpret_cast<char *>(&cab), sizeof(cab));
+    if (in.gcount() == (std::streamsize)sizeof(cab) && std::memcmp(cab.magic, TABLA_MAGIC, sizeof(TABLA_MAGIC)) == 0) {
+        long long nb = cab.num_buckets, base = cab.buckets_base;
+        if (cab.version < 3 || base <= 0) {
+            // v2: tamaño fijo, los campos de crecimiento eran reservados
+            nb = base = TABLE_SIZE;
+            cab.num_registros = 0;
+            cab.carga_max = 0;
+        }
+        if ((base & (base - 1)) != 0 || nb < base || nb >= 2 * base || nb > (1LL << 31)) return false;
+        t = tablaVacia(cab.layout, nb, cab.carga_max);
+        t.buckets_base = base;
+        t.num_registros = cab.num_registros;
+        in.read(reinterpret_cast<char *>(t.entradas.data()), (std::streamsize)nb * sizeof(HashExtent));
+        return true;
+    }
+    in.clear();
+    in.seekg(0, std::ios::beg);
+    std::vector<HashEntry> heads(TABLE_SIZE);
+    in.read(reinterpret_cast<char *>(heads.data()), (std::streamsize)TABLE_SIZE * sizeof(HashEntry));
+    int leidas = (int)(in.gcount() / (std::streamsize)sizeof(HashEntry));
+    for (int i = 0; i < leidas; ++i) t.entradas[i].head_offset = heads[i].head_offset;
+    return true;
+}
+
+// Escribe la tabla completa (truncando el archivo)
+inline bool guardar(const std::string &ruta, const Tabla &t)
+{
+    std::ofstream out(ruta, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    if (esV2(t)) {
+        TablaCabecera cab = cabecera(t);
+        out.write(reinterpret_cast<const char *>(&cab), sizeof(cab));
+        out.write(reinterpret_cast<const char *>(t.entradas.data()), (std::streamsize)t.entradas.size() * sizeof(HashExtent));
+    } else {
+        std::vector<HashEntry> heads(TABLE_SIZE);
+        for (int i = 0; i < TABLE_SIZE; ++i) heads[i].head_offset = t.entradas[i].head_offset;
+        out.write(reinterpret_cast<const char *>(heads.data()), (std::streamsize)TABLE_SIZE * sizeof(HashEntry));
+    }
+    return (bool)out;
+}
+
+// Persiste la cabecera (tamaño y contador de registros). No-op en formato legado.
+inline bool escribirCabecera(std::ostream &out, const Tabla &t)
+{
+    if (!esV2(t)) return true;
+    TablaCabecera cab = cabecera(t);
+    out.seekp(0, std::ios::beg);
+    out.write(reinterpret_cast<const char *>(&cab), sizeof(cab));
+    return (bool)out;
+}
+
+// Persiste solo la cabeza del bucket `pos` (una inserción no altera el tramo)
+inline bool escribirCabeza(std::ostream &out, const Tabla &t, int pos)
+{
+    out.seekp(offsetEntrada(t, pos), std::ios::beg);
+    out.write(reinterpret_cast<const char *>(&t.entradas[pos].head_offset), sizeof(long long));
+    return (bool)out;
+}
+
+// Persiste la entrada `e` del bucket `pos` (cabeza y tramo) en una tabla con o sin cabecera
+inline bool escribirEntrada(std::ostream &out, bool con_cabecera, int pos, const HashExtent &e)
+{
+    out.seekp(offsetEntrada(con_cabecera, pos), std::ios::beg);
+    if (con_cabecera) out.write(reinterpret_cast<const char *>(&e), sizeof(HashExtent));
+    else out.write(reinterpret_cast<const char *>(&e.head_offset), sizeof(long long));
+    return (bool)out;
+}
+
+// Persiste la entrada completa del bucket `pos` (cabeza y tramo)
+inline bool escribirEntrada(std::ostream &out, const Tabla &t, int pos)
+{
+    return escribirEntrada(out, esV2(t), pos, t.entradas[(size_t)pos]);
+}
+
+// Persiste las entradas de los buckets `sucios` de a páginas (4 KiB de entradas
+// consecutivas): cada página con alguna entrada sucia se escribe una sola vez,
+// y después la cabecera. Lo usa la inserción por lotes (insercion_lote.h).
+inline bool escribirPaginas(std::ostream &out, const Tabla &t, std::vector<int> sucios)
+{
+    const size_t tam_entrada = esV2(t) ? sizeof(HashExtent) : sizeof(HashEntry);
+    const long long por_pagina = std::max<long long>(1, 4096 / (long long)tam_entrada);
+    const long long total = esV2(t) ? (long long)t.entradas.size() : (long long)TABLE_SIZE;
+    std::sort(sucios.begin(), sucios.end());
+    std::vector<char> pagina;
+    for (size_t i = 0; i < sucios.size() && out;) {
+        const long long p = sucios[i] / por_pagina;
+        const long long ini = p * por_pagina, fin = std::min(total, ini + por_pagina);
+        pagina.resize((size_t)(fin - ini) * tam_entrada);
+        for (long long e = ini; e < fin; ++e) {
+            char *dst = pagina.data() + (size_t)(e - ini) * tam_entrada;
+            if (esV2(t)) std::memcpy(dst, &t.entradas[(size_t)e], sizeof(HashExtent));
+            else std::memcpy(dst, &t.entradas[(size_t)e].head_offset, sizeof(long long));
+        }
+        out.seekp(offsetEntrada(t, (int)ini), std::ios::beg);
+        out.write(pagina.data(), (std::streamsize)pagina.size());
+        while (i < sucios.size() && sucios[i] / por_pagina == p) ++i;
+    }
+    return escribirCabecera(out, t) && (bool)out;
+}
+
+// Recorre los registros del bucket en orden de cadena. Mientras la cadena no
+// llegue al tramo se sigue registro a registro (inserciones posteriores al
+// agrupado); al llegar al tramo se lee completo en lecturas secuenciales.
+// `leer(offset, destino, bytes)` devuelve false si la lectura falla y
+// `visitar(offset, registro)` se llama por cada registro.
+template <typename LeerFn, typename VisitarFn>
+inline void recorrerBucket(const HashExtent &e, long long filesize, LeerFn leer, VisitarFn visitar)
+{
+    const long long sz = (long long)sizeof(RegistroClinico);
+    long long offset = e.head_offset;
+    while (offset != NULL_OFFSET) {
+        if (offset < 0 || offset + sz > filesize) return;
+        if (offset == e.ext_offset && e.ext_count > 0) {
+            const long long LOTE = 1024;
+            long long count = std::min(e.ext_count, (filesize - offset) / sz);
+            std::vector<RegistroClinico> buf((size_t)std::min(count, LOTE));
+            for (long long hecho = 0; hecho < count;) {
+                long long n = std::min(count - hecho, LOTE);
+                if (!leer(offset + hecho * sz, buf.data(), (size_t)(n * sz))) return;
+                for (long long i = 0; i < n; ++i) visitar(offset + (hecho + i) * sz, buf[(size_t)i]);
+                hecho += n;
+            }
+            return;
+        }
+        RegistroClinico r;
+        if (!leer(offset, &r, (size_t)sz)) return;
+        visitar(offset, r);
+        offset = r.pos_siguiente;
+    }
+}
+
+inline bool debeDividir(long long num_buckets, long long num_registros, int32_t carga_max)
+{
+    return carga_max > 0 && num_buckets < (1LL << 31) && num_registros > (long long)carga_max * num_buckets;
+}
+inline bool debeDividir(const Tabla &t)
+{
+    return debeDividir((long long)t.entradas.size(), t.num_registros, t.carga_max);
+}
+
+// Acceso a las entradas que usan `dividir` y `crecer`: este sobre una Tabla en
+// memoria; la tabla compartida entre procesos (tabla_compartida.h) ofrece el mismo.
+struct AccesoTabla {
+    Tabla &t;
+    long long numBuckets() const { return (long long)t.entradas.size(); }
+    long long base() const { return t.buckets_base; }
+    HashExtent entrada(int pos) const { return t.entradas[(size_t)pos]; }
+    void fijar(int pos, const HashExtent &e) { t.entradas[(size_t)pos] = e; }
+    // Agrega el bucket siguiente; al completar 2 * base sube el nivel
+    bool agregar(const HashExtent &e)
+    {
+        t.entradas.push_back(e);
+        if (numBuckets() == 2 * t.buckets_base) t.buckets_base *= 2;
+        return true;
+    }
+    bool debeDividir() const { return tabla_hash::debeDividir(t); }
+    bool conCabecera() const { return esV2(t); }
+    TablaCabecera cabecera() const { return tabla_hash::cabecera(t); }
+};
+
+// Divide el bucket apuntado por el puntero de división (hashing lineal).
+// Orden pensado para que ante una caída a mitad de camino ninguna búsqueda
+// pierda registros (a lo sumo recorre de más):
+//   1. se agrega el bucket nuevo con cabeza en su primer registro y se
+//      persiste la cabecera con el tamaño nuevo;
+//   2. el bucket viejo pasa a empezar en su primer registro propio;
+//   3. se reenlazan los `pos_siguiente` de adelante hacia atrás, cada uno al
+//      siguiente registro de su mismo bucket (solo los que cambian).
+// Ambos buckets quedan sin tramo (layout agrupado) hasta el próximo Limpieza.
+// `leer(offset, destino, bytes)` como en recorrerBucket,
+// `enlazar(offset_registro, siguiente)` reescribe un pos_siguiente y
+// `persistir(pos)` guarda la entrada `pos` y la cabecera.
+template <typename AccesoT, typename LeerFn, typename EnlazarFn, typename PersistirFn>
+inline bool dividir(AccesoT &&t, long long filesize, LeerFn leer, EnlazarFn enlazar, PersistirFn persistir)
+{
+    const long long nb = t.numBuckets(), base = t.base();
+    const int p = (int)(nb - base), q = (int)nb;
+    const unsigned long long mascara = (unsigned long long)(2 * base - 1);
+
+    struct Nodo { long long offset, siguiente; bool nuevo; };
+    std::vector<Nodo> nodos;
+    recorrerBucket(t.entrada(p), filesize, leer, [&](long long offset, const RegistroClinico &r) {
+        nodos.push_back(Nodo{offset, r.pos_siguiente, ((uint32_t)r.dni & mascara) == (unsigned long long)q});
+    });
+
+    long long cabeza[2] = {NULL_OFFSET, NULL_OFFSET};
+    for (auto it = nodos.rbegin(); it != nodos.rend(); ++it) cabeza[it->nuevo] = it->offset;
+
+    if (!t.agregar(HashExtent{cabeza[1], NULL_OFFSET, 0})) return false;
+    if (!persistir(q)) return false;
+    t.fijar(p, HashExtent{cabeza[0], NULL_OFFSET, 0});
+    if (!persistir(p)) return false;
+
+    // siguiente[i] = próximo nodo del mismo bucket (se calcula de atrás hacia adelante)
+    std::vector<long long> siguiente(nodos.size());
+    long long proximo[2] = {NULL_OFFSET, NULL_OFFSET};
+    for (size_t i = nodos.size(); i-- > 0;) {
+        siguiente[i] = proximo[nodos[i].nuevo];
+        proximo[nodos[i].nuevo] = nodos[i].offset;
+    }
+    for (size_t i = 0; i < nodos.size(); ++i)
+        if (nodos[i].siguiente != siguiente[i] && !enlazar(nodos[i].offset, siguiente[i])) return false;
+    return true;
+}
+
+template <typename LeerFn, typename EnlazarFn, typename PersistirFn>
+inline bool dividir(Tabla &t, long long filesize, LeerFn leer, EnlazarFn enlazar, PersistirFn persistir)
+{
+    return dividir(AccesoTabla{t}, filesize, leer, enlazar, persistir);
+}
+
+// Divide mientras la carga supere carga_max, sobre streams ya abiertos de
+// registros.dat (lectura/escritura) y tabla_hash.dat. Devuelve las divisiones hechas.
+template <typename AccesoT>
+inline int crecer(AccesoT &&t, std::fstream &registros, std::fstream &tabla)
+{
+    if (!t.debeDividir()) return 0;
+    registros.clear();
+    registros.seekg(0, std::ios::end);
+    long long filesize = (long long)registros.tellg();
+    auto leer = [&](long long offset, void *dst, size_t n) {
+        registros.clear();
+        registros.seekg(offset, std::ios::beg);
+        registros.read(static_cast<char *>(dst), (std::streamsize)n);
+        return registros.gcount() == (std::streamsize)n;
+    };
+    auto enlazar = [&](long long offset, long long sig) {
+        registros.clear();
+        registros.seekp(offset + (long long)offsetof(RegistroClinico, pos_siguiente), std::ios::beg);
+        registros.write(reinterpret_cast<const char *>(&sig), sizeof(sig));
+        return (bool)registros;
+    };
+    auto persistir = [&](int pos) {
+        tabla.clear();
+        if (!escribirEntrada(tabla, t.conCabecera(), pos, t.entrada(pos))) return false;
+        if (t.conCabecera()) {
+            TablaCabecera cab = t.cabecera();
+            tabla.seekp(0, std::ios::beg);
+            tabla.write(reinterpret_cast<const char *>(&cab), sizeof(cab));
+        }
+        return (bool)tabla.flush();
+    };
+    int hechas = 0;
+    while (t.debeDividir() && dividir(t, filesize, leer, enlazar, persistir)) ++hechas;
+    registros.flush();
+    return hechas;
+}
+inline int crecer(Tabla &t, std::fstream &registros, std::fstream &tabla)
+{
+    return crecer(AccesoTabla{t}, registros, tabla);
+}
+
+} // namespace tabla_hash